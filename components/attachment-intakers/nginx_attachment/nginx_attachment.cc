@@ -37,6 +37,7 @@
 #include "nginx_attachment_config.h"
 #include "nginx_attachment_opaque.h"
 #include "nginx_parser.h"
+#include "overload_controller.h"
 #include "i_instance_awareness.h"
 #include "common.h"
 #include "config.h"
@@ -77,6 +78,8 @@ using namespace std;
 using ChunkType = ngx_http_chunk_type_e;
 
 static const uint32_t corrupted_session_id = CORRUPTED_SESSION_ID;
+// The doorbell inspection lets the other routines run every this many messages, while the attachment keeps sending
+static const uint doorbell_messages_per_yield = 256;
 static const AlertInfo alert(AlertTeam::CORE, "nginx attachment");
 
 class FailopenModeListener : public Listener<FailopenModeEvent>
@@ -194,6 +197,9 @@ public:
         num_of_nginx_ipc_elements = getProfileAgentSettingWithDefault<uint>(
             NUM_OF_NGINX_IPC_ELEMENTS, "nginxAttachment.numOfNginxIpcElements"
         );
+        nginx_ipc_version = getProfileAgentSettingWithDefault<uint>(
+            SHMEM_IPC_V1, "nginxAttachment.sharedMemoryIpcVersion"
+        );
 
         nginx_attachment_metric.init(
             "Nginx Attachment data",
@@ -233,12 +239,26 @@ public:
         nginx_plugin_cpu_metric.registerContext<string>("Service Name", "Nginx Attachment");
         nginx_plugin_cpu_metric.registerListener();
 
+        nginx_overload_metric.init(
+            "Nginx Attachment overload control data",
+            ReportIS::AudienceTeam::AGENT_CORE,
+            ReportIS::IssuingEngine::AGENT_CORE,
+            metric_report_interval,
+            true
+        );
+        nginx_overload_metric.registerListener();
+
+        overload_controller.init(timer);
+
 #ifdef FAILURE_TEST
         intentional_failure_handler.init();
 #endif
 
+        users_identifiers_config = getConfigurationHandle<UsersAllIdentifiersConfig>("rulebase", "usersIdentifiers");
+
         generateAttachmentConfig();
         registerConfigLoadCb([this]() { generateAttachmentConfig(); });
+        registerConfigLoadCb([this]() { overload_controller.loadConfiguration(); });
 
         createStaticResourcesFolder();
 
@@ -360,6 +380,7 @@ public:
         if (attachment_ipc != nullptr) {
             destroyIpc(attachment_ipc, 1);
             attachment_ipc = nullptr;
+            clearIpcBatch();
         }
     }
 
@@ -446,6 +467,7 @@ private:
             if (nginx_worker_user_id != nginx_user_id || nginx_worker_group_id != nginx_group_id) {
                 destroyIpc(attachment_ipc, 1);
                 attachment_ipc = nullptr;
+                clearIpcBatch();
             } else if (isCorruptedShmem(attachment_ipc, 1)) {
                 dbgWarning(D_NGINX_ATTACHMENT)
                     << "Destroying shmem IPC for Attachment with corrupted shared memory. Attachment id: "
@@ -453,6 +475,20 @@ private:
 
                 destroyIpc(attachment_ipc, 1);
                 attachment_ipc = nullptr;
+                clearIpcBatch();
+            } else if (!isIpcUserAttached(attachment_ipc)) {
+                // An attachment that knows only version 1 queues fails to attach to version 2 queues, and registers
+                // again. From now on its queues are created in version 1.
+                dbgWarning(D_NGINX_ATTACHMENT)
+                    << "Attachment did not attach to version "
+                    << getIpcVersion(attachment_ipc)
+                    << " shmem IPC, falling back to version 1. Attachment id: "
+                    << curr_instance_unique_id;
+
+                is_ipc_v2_unsupported = true;
+                destroyIpc(attachment_ipc, 1);
+                attachment_ipc = nullptr;
+                clearIpcBatch();
             } else {
                 dbgInfo(D_NGINX_ATTACHMENT) << "Re-registering attachment with id: " << curr_instance_unique_id;
                 uint max_registrations = getProfileAgentSettingWithDefault<uint>(
@@ -471,6 +507,7 @@ private:
                     if (++curr_attachment_registrations_counter > max_registrations) {
                         destroyIpc(attachment_ipc, 1);
                         attachment_ipc = nullptr;
+                        clearIpcBatch();
 
                         dbgWarning(D_NGINX_ATTACHMENT)
                             << "Attachment with id: "
@@ -488,12 +525,13 @@ private:
         }
 
         if (attachment_ipc == nullptr) {
-            attachment_ipc = initIpc(
+            attachment_ipc = initIpcWithVersion(
                 curr_instance_unique_id.c_str(),
                 nginx_user_id,
                 nginx_group_id,
                 1,
                 num_of_nginx_ipc_elements,
+                is_ipc_v2_unsupported ? SHMEM_IPC_V1 : nginx_ipc_version,
                 IpcDebug
             );
 
@@ -542,6 +580,7 @@ private:
                         nginx_attachment_event.resetAllCounters();
                         nginx_intaker_event.notify();
                         nginx_intaker_event.resetAllCounters();
+                        overload_controller.notifyMetric();
                     }
                 );
 
@@ -602,8 +641,13 @@ private:
         signaled_session_id = *reinterpret_cast<const uint32_t *>(comm_trigger.unpack().data());
         comm_status.erase(attachment_sock);
         traffic_indicator = true;
+        overload_controller.reportQueueUsage(getRxQueueUsage(attachment_ipc));
+
+        if (isPeerWaitingOnDoorbell(attachment_ipc)) return handleDoorbellInspection();
 
-        while (isDataAvailable(attachment_ipc)) {
+        auto end_inspection_round = make_scope_exit([this] () { endInspectionRound(); });
+        is_batching_verdicts = true;
+        while (hasPendingMessage(attachment_ipc)) {
             traffic_indicator = true;
             Maybe<pair<uint32_t, bool>> session_verdict = handleRequestFromQueue(attachment_ipc, signaled_session_id);
             if (!session_verdict.ok()) return true;
@@ -620,6 +664,8 @@ private:
 
                 DELAY_IF_NEEDED(IntentionalFailureHandler::FailureType::WriteDataToSocket);
 
+                flushPendingVerdicts();
+                releaseConsumedMessages(attachment_ipc);
                 if (!SHOULD_FAIL(
                     true,
                     IntentionalFailureHandler::FailureType::WriteDataToSocket,
@@ -649,6 +695,57 @@ private:
         return true;
     }
 
+    // An attachment that waits for its verdicts on the IPC doorbell signals the socket only when this side armed its
+    // doorbell, so a single signal covers all the data that was sent until the queue is drained. The verdicts are
+    // published with a single ring of the attachment's doorbell, which wakes the attachment only if it is idle.
+    bool
+    handleDoorbellInspection()
+    {
+        disarmDoorbell(attachment_ipc);
+        auto end_inspection_round = make_scope_exit([this] () { endInspectionRound(); });
+        is_batching_verdicts = true;
+
+        bool has_verdicts = false;
+        uint handled_messages = 0;
+        while (true) {
+            while (hasPendingMessage(attachment_ipc)) {
+                Maybe<pair<uint32_t, bool>> session_verdict = handleRequestFromQueue(attachment_ipc);
+                if (!session_verdict.ok() || session_verdict.unpack().first == corrupted_session_id) {
+                    // The message may still be in the queue, so stop here like the socket inspection does. The armed
+                    // doorbell has the attachment signal again when it sends more data.
+                    has_verdicts |= session_verdict.ok() && session_verdict.unpack().second;
+                    publishDoorbellVerdicts(has_verdicts);
+                    armDoorbell(attachment_ipc);
+                    return true;
+                }
+                has_verdicts |= session_verdict.unpack().second;
+
+                if (++handled_messages % doorbell_messages_per_yield == 0) {
+                    publishDoorbellVerdicts(has_verdicts);
+                    mainloop->yield(true);
+                }
+            }
+            publishDoorbellVerdicts(has_verdicts);
+
+            if (!armDoorbell(attachment_ipc)) break;
+            disarmDoorbell(attachment_ipc);
+        }
+
+        return true;
+    }
+
+    void
+    publishDoorbellVerdicts(bool &has_verdicts)
+    {
+        flushPendingVerdicts();
+        releaseConsumedMessages(attachment_ipc);
+        if (!has_verdicts) return;
+
+        dbgTrace(D_NGINX_ATTACHMENT) << "Ringing the attachment's doorbell to read verdicts";
+        ringDoorbell(attachment_ipc);
+        has_verdicts = false;
+    }
+
     bool
     isSignalPending()
     {
@@ -1052,12 +1149,18 @@ private:
                 return handleStartTransaction(data, opaque);
             case ChunkType::REQUEST_HEADER:
                 return handleMultiModifiableChunks(
-                    NginxParser::parseRequestHeaders(data, ignored_headers),
+                    NginxParser::parseRequestHeaders(data, ignored_headers, users_identifiers_config),
                     "request header",
                     true
                 );
-            case ChunkType::REQUEST_BODY:
+            case ChunkType::REQUEST_BODY: {
+                if (overload_controller.shouldCapRequestBody(opaque.getInspectedRequestBodySize())) {
+                    dbgTrace(D_NGINX_ATTACHMENT) << "Request body inspection is capped due to overload";
+                    return FilterVerdict(INSPECT);
+                }
+                opaque.addInspectedRequestBodySize(data.size());
                 return handleModifiableChunk(NginxParser::parseRequestBody(data), "request body", true);
+            }
             case ChunkType::REQUEST_END: {
                 i_transaction_table->setExpiration(chrono::hours(1));
                 return FilterVerdict(http_manager->inspectEndRequest());
@@ -1072,6 +1175,10 @@ private:
             case ChunkType::RESPONSE_HEADER:
                 return handleResponseHeaders(data, opaque);
             case ChunkType::RESPONSE_BODY:
+                if (overload_controller.shouldSkipResponseBody()) {
+                    dbgTrace(D_NGINX_ATTACHMENT) << "Response body inspection is skipped due to overload";
+                    return FilterVerdict(ACCEPT);
+                }
                 nginx_attachment_event.addResponseInspectionCounter(1);
                 return handleResponseBody(data, opaque);
             case ChunkType::RESPONSE_END:
@@ -1252,6 +1359,11 @@ private:
         verdict_to_send.verdict = static_cast<uint16_t>(verdict.getVerdict());
         verdict_to_send.session_id = session_id;
 
+        if (verdict.getVerdict() == INJECT || verdict.getVerdict() == DROP) {
+            // These verdicts are followed by their data, and have to reach the queue after the verdicts before them
+            flushPendingVerdicts();
+        }
+
         vector<const char *> verdict_fragments = { reinterpret_cast<const char *>(&verdict_to_send) };
         vector<uint16_t> fragments_sizes = { sizeof(verdict_to_send) };
 
@@ -1286,9 +1398,53 @@ private:
             nginx_attachment_event.addTrafficVerdictCounter(nginxAttachmentEvent::trafficVerdict::WAIT);
         }
 
+        if (is_batching_verdicts && ipc == attachment_ipc) {
+            if (num_of_pending_verdicts == max_ipc_batch_size) flushPendingVerdicts();
+            pending_verdicts[num_of_pending_verdicts++] = verdict_to_send;
+            return;
+        }
+
         sendChunkedData(ipc, fragments_sizes.data(), verdict_fragments.data(), verdict_fragments.size());
     }
 
+    // Verdicts that are sent during an inspection round are pushed together before the attachment is signaled to
+    // read them, so the shared write position is updated once per batch instead of once per verdict.
+    void
+    flushPendingVerdicts()
+    {
+        if (num_of_pending_verdicts == 0) return;
+        if (attachment_ipc == nullptr) {
+            num_of_pending_verdicts = 0;
+            return;
+        }
+
+        const char *verdicts_data[max_ipc_batch_size];
+        uint16_t verdicts_sizes[max_ipc_batch_size];
+        for (uint16_t i = 0; i < num_of_pending_verdicts; i++) {
+            verdicts_data[i] = reinterpret_cast<const char *>(&pending_verdicts[i]);
+            verdicts_sizes[i] = sizeof(pending_verdicts[i]);
+        }
+
+        int res = sendDataBatch(attachment_ipc, verdicts_sizes, verdicts_data, num_of_pending_verdicts);
+        if (res < num_of_pending_verdicts) {
+            dbgWarning(D_NGINX_ATTACHMENT)
+                << "Failed to send "
+                << num_of_pending_verdicts - max(res, 0)
+                << " out of "
+                << num_of_pending_verdicts
+                << " verdicts to the NGINX attachment";
+        }
+        num_of_pending_verdicts = 0;
+    }
+
+    void
+    endInspectionRound()
+    {
+        flushPendingVerdicts();
+        is_batching_verdicts = false;
+        releaseConsumedMessages(attachment_ipc);
+    }
+
 // LCOV_EXCL_START Reason: cannot test dump of memory raw data (written in c) during UT
     const string
     dumpIpcWrapper(SharedMemoryIPC *attachment_ipc)
@@ -1299,16 +1455,17 @@ private:
 // LCOV_EXCL_STOP
 
     bool
-    isFailOpenTriggered() const
+    isFailOpenTriggered()
     {
-        return attachment_config.getIsFailOpenModeEnabled() && fail_open_mode_listener.isFailopenMode();
+        if (!attachment_config.getIsFailOpenModeEnabled()) return false;
+        return fail_open_mode_listener.isFailopenMode() || overload_controller.shouldFailOpen();
     }
 
     void
     handleFailureMode(SharedMemoryIPC *attachment_ipc, uint32_t cur_session_id)
     {
-        popData(attachment_ipc);
-        while (isDataAvailable(attachment_ipc)) {
+        consumeMessage(attachment_ipc);
+        while (hasPendingMessage(attachment_ipc)) {
             Maybe<pair<uint16_t, const char *>> read_data = readData(attachment_ipc);
             if (!read_data.ok()) break;
 
@@ -1322,7 +1479,7 @@ private:
             auto transaction_data = reinterpret_cast<const ngx_http_cp_request_data_t *>(incoming_data);
             if (transaction_data->session_id != cur_session_id) break;
 
-            popData(attachment_ipc);
+            consumeMessage(attachment_ipc);
         }
 
         handleVerdictResponse(
@@ -1333,27 +1490,88 @@ private:
         );
     }
 
+    // Messages are peeked from the shared memory in batches, and the slots of the messages that were already handled
+    // are released together, so the shared read position is updated once per batch instead of once per message.
+    void
+    clearIpcBatch()
+    {
+        ipc_batch_size = 0;
+        ipc_batch_index = 0;
+    }
+
+    void
+    resetAttachmentIpc(SharedMemoryIPC *attachment_ipc)
+    {
+        resetIpc(attachment_ipc, num_of_nginx_ipc_elements);
+        clearIpcBatch();
+        num_of_pending_verdicts = 0;
+    }
+
+    void
+    releaseConsumedMessages(SharedMemoryIPC *attachment_ipc)
+    {
+        if (attachment_ipc == nullptr || ipc_batch_index == 0) return;
+
+        dbgTrace(D_NGINX_ATTACHMENT) << "Releasing " << ipc_batch_index << " handled messages from the IPC";
+        popDataBatch(attachment_ipc, ipc_batch_index);
+        clearIpcBatch();
+    }
+
+    void
+    consumeMessage(SharedMemoryIPC *attachment_ipc)
+    {
+        if (ipc_batch_index < ipc_batch_size) {
+            ipc_batch_index++;
+            return;
+        }
+        popData(attachment_ipc);
+    }
+
+    bool
+    hasPendingMessage(SharedMemoryIPC *attachment_ipc)
+    {
+        if (ipc_batch_index < ipc_batch_size) return true;
+        releaseConsumedMessages(attachment_ipc);
+        return isDataAvailable(attachment_ipc);
+    }
+
+    int
+    fetchIpcBatch(SharedMemoryIPC *attachment_ipc)
+    {
+        if (ipc_batch_index < ipc_batch_size) return ipc_batch_size - ipc_batch_index;
+
+        releaseConsumedMessages(attachment_ipc);
+        int res = receiveDataBatch(attachment_ipc, ipc_batch_sizes, ipc_batch_data, max_ipc_batch_size);
+        if (res > 0) ipc_batch_size = res;
+        return res;
+    }
+
     Maybe<pair<uint16_t, const char *>>
     readData(SharedMemoryIPC *attachment_ipc)
     {
         const char *incoming_data = nullptr;
-        uint16_t incoming_data_size;
+        uint16_t incoming_data_size = 0;
 
         DELAY_IF_NEEDED(IntentionalFailureHandler::FailureType::GetDataFromAttchment);
-        int res = receiveData(attachment_ipc, &incoming_data_size, &incoming_data);
+        int res = fetchIpcBatch(attachment_ipc);
         if (res == corrupted_shmem_error) {
             dbgError(D_NGINX_ATTACHMENT)
                 << "Failed to receive data from corrupted IPC Resetting the IPC"
                 << dumpIpcWrapper(attachment_ipc);
 
-            resetIpc(attachment_ipc, num_of_nginx_ipc_elements);
+            resetAttachmentIpc(attachment_ipc);
             nginx_attachment_event.addNetworkingCounter(nginxAttachmentEvent::networkVerdict::CONNECTION_FAIL);
             return genError("Failed to receive data from corrupted IPC");
         }
 
+        if (res > 0) {
+            incoming_data = ipc_batch_data[ipc_batch_index];
+            incoming_data_size = ipc_batch_sizes[ipc_batch_index];
+        }
+
         bool did_fail_on_purpose = false;
         if (SHOULD_FAIL(
-            res == 0, IntentionalFailureHandler::FailureType::GetDataFromAttchment, &did_fail_on_purpose
+            res > 0, IntentionalFailureHandler::FailureType::GetDataFromAttchment, &did_fail_on_purpose
         )) {
             dbgWarning(D_NGINX_ATTACHMENT) << "Failed to receive data from NGINX attachment";
             nginx_attachment_event.addNetworkingCounter(nginxAttachmentEvent::networkVerdict::CONNECTION_FAIL);
@@ -1374,8 +1592,7 @@ private:
                 << dumpIpcWrapper(attachment_ipc)
                 << (did_fail_on_purpose ? "[Intentional Failure]" : "");
 
-            popData(attachment_ipc);
-            resetIpc(attachment_ipc, num_of_nginx_ipc_elements);
+            resetAttachmentIpc(attachment_ipc);
             nginx_attachment_event.addNetworkingCounter(nginxAttachmentEvent::networkVerdict::CONNECTION_FAIL);
             return genError("Data received is smaller than expected");
         }
@@ -1384,9 +1601,11 @@ private:
     }
 
     Maybe<pair<uint32_t, bool>>
-    handleRequestFromQueue(SharedMemoryIPC *attachment_ipc, uint32_t signaled_session_id)
+    handleRequestFromQueue(SharedMemoryIPC *attachment_ipc, const Maybe<uint32_t> &signaled_session_id = genError(""))
     {
+        auto read_start_time = timer->getMonotonicTime();
         Maybe<pair<uint16_t, const char *>> read_data = readData(attachment_ipc);
+        nginx_attachment_event.addIpcReadLatency((timer->getMonotonicTime() - read_start_time).count());
         if (!read_data.ok()) {
             dbgWarning(D_NGINX_ATTACHMENT) << "Failed to read data. Error: " << read_data.getErr();
             return make_pair(corrupted_session_id, true);
@@ -1409,8 +1628,7 @@ private:
                 <<  static_cast<int>(transaction_data->data_type)
                 << " to ChunkType enum. Resetting IPC"
                 << dumpIpcWrapper(attachment_ipc);
-            popData(attachment_ipc);
-            resetIpc(attachment_ipc, num_of_nginx_ipc_elements);
+            resetAttachmentIpc(attachment_ipc);
             nginx_attachment_event.addNetworkingCounter(nginxAttachmentEvent::networkVerdict::CONNECTION_FAIL);
             return make_pair(corrupted_session_id, true);
         }
@@ -1419,7 +1637,7 @@ private:
             const ngx_http_cp_metric_data_t *recieved_metric_data =
                 reinterpret_cast<const ngx_http_cp_metric_data_t *>(incoming_data);
             sendMetricToKibana(recieved_metric_data);
-            popData(attachment_ipc);
+            consumeMessage(attachment_ipc);
             return pair<uint32_t, bool>(0, false);
         }
 
@@ -1434,14 +1652,14 @@ private:
             << transaction_data->session_id;
 
         const uint32_t cur_session_id = transaction_data->session_id;
-        if (signaled_session_id != cur_session_id) {
+        if (signaled_session_id.ok() && *signaled_session_id != cur_session_id) {
             dbgDebug(D_NGINX_ATTACHMENT)
                 << "Ignoring inspection of irrelevant transaction. Signaled session ID: "
-                << signaled_session_id
+                << *signaled_session_id
                 << ", Inspected Session ID: "
                 << cur_session_id;
 
-            popData(attachment_ipc);
+            consumeMessage(attachment_ipc);
             return make_pair(cur_session_id, false);
         }
 
@@ -1462,17 +1680,35 @@ private:
         }
 
         if (!setActiveTransactionEntry(transaction_data->session_id, chunked_data_type.unpack())) {
-            popData(attachment_ipc);
+            consumeMessage(attachment_ipc);
             return make_pair(cur_session_id, false);
         }
 
+        Maybe<bool> is_final_verdict = inspectChunk(*chunked_data_type, transaction_data, incoming_data_size);
+        // The Buffers that referenced the message's slot were released (or copied by whoever keeps them) by the end of
+        // the inspection, so from here on the slot can be released.
+        consumeMessage(attachment_ipc);
+        if (!is_final_verdict.ok()) return make_pair(cur_session_id, true);
+
+        bool should_signal = (*is_final_verdict || !hasPendingMessage(attachment_ipc));
+        return make_pair(cur_session_id, should_signal);
+    }
+
+    // Inspects the data of a message as a Buffer that references the message's slot in the shared memory, and
+    // returns whether the verdict is final. The slot must not be released before this returns.
+    Maybe<bool>
+    inspectChunk(
+        ChunkType chunked_data_type,
+        const ngx_http_cp_request_data_t *transaction_data,
+        uint16_t incoming_data_size)
+    {
         const Buffer inspection_data(
             transaction_data->data,
             incoming_data_size - sizeof(ngx_http_cp_request_data_t),
             Buffer::MemoryType::VOLATILE
         );
 
-        if (*chunked_data_type == ChunkType::REQUEST_START && !createTransactionState(inspection_data)) {
+        if (chunked_data_type == ChunkType::REQUEST_START && !createTransactionState(inspection_data)) {
             dbgWarning(D_NGINX_ATTACHMENT)
                 << "Failed to handle new request. Returning default verdict: "
                 << verdictToString(default_verdict.getVerdict());
@@ -1483,9 +1719,8 @@ private:
                 transaction_data->session_id,
                 false
             );
-            popData(attachment_ipc);
             removeTransactionEntry(transaction_data->session_id);
-            return make_pair(cur_session_id, true);
+            return genError("Failed to create the transaction state");
         }
 
         if (i_transaction_table != nullptr) {
@@ -1496,13 +1731,16 @@ private:
         NginxAttachmentOpaque &opaque = i_transaction_table->getState<NginxAttachmentOpaque>();
         opaque.activateContext();
 
-        FilterVerdict verdict = handleChunkedData(*chunked_data_type, inspection_data, opaque);
+        auto inspection_start_time = timer->getMonotonicTime();
+        FilterVerdict verdict = handleChunkedData(chunked_data_type, inspection_data, opaque);
+        overload_controller.reportVerdictLatency(timer->getMonotonicTime() - inspection_start_time);
 
         bool is_header =
-            *chunked_data_type == ChunkType::REQUEST_HEADER  ||
-            *chunked_data_type == ChunkType::RESPONSE_HEADER ||
-            *chunked_data_type == ChunkType::CONTENT_LENGTH;
+            chunked_data_type == ChunkType::REQUEST_HEADER  ||
+            chunked_data_type == ChunkType::RESPONSE_HEADER ||
+            chunked_data_type == ChunkType::CONTENT_LENGTH;
         handleVerdictResponse(verdict, attachment_ipc, transaction_data->session_id, is_header);
+        nginx_attachment_event.addVerdictLatency((timer->getMonotonicTime() - inspection_start_time).count());
 
         bool is_final_verdict = verdict.getVerdict() == ACCEPT ||
                                 verdict.getVerdict() == DROP   ||
@@ -1517,17 +1755,15 @@ private:
             << " verdict_data_code="
             << static_cast<int>(verdict.getVerdict());
 
-        popData(attachment_ipc);
-
         opaque.deactivateContext();
         if (is_final_verdict) {
+            nginx_attachment_event.addTransactionCopiedBytes(opaque.getIntakeCopiedBytes());
             removeTransactionEntry(transaction_data->session_id);
         } else {
             i_transaction_table->unsetActiveKey();
         }
 
-        bool should_signal = (is_final_verdict || !isDataAvailable(attachment_ipc));
-        return make_pair(cur_session_id, should_signal);
+        return is_final_verdict;
     }
 
     bool
@@ -1828,14 +2064,26 @@ private:
     I_Socket::socketFd attachment_sock = -1;
 
     uint num_of_nginx_ipc_elements = NUM_OF_NGINX_IPC_ELEMENTS;
+    uint nginx_ipc_version = SHMEM_IPC_V1;
+    bool is_ipc_v2_unsupported = false;
     uint32_t nginx_worker_user_id = 0;
     uint32_t nginx_worker_group_id = 0;
     string instance_unique_id;
     SharedMemoryIPC *attachment_ipc = nullptr;
+    static const uint16_t max_ipc_batch_size = 32;
+    const char *ipc_batch_data[max_ipc_batch_size] = { nullptr };
+    uint16_t ipc_batch_sizes[max_ipc_batch_size] = { 0 };
+    uint16_t ipc_batch_size = 0;
+    uint16_t ipc_batch_index = 0;
+    ngx_http_cp_reply_from_service_t pending_verdicts[max_ipc_batch_size];
+    uint16_t num_of_pending_verdicts = 0;
+    bool is_batching_verdicts = false;
     HttpAttachmentConfig attachment_config;
     I_MainLoop::RoutineID attachment_routine_id = 0;
     bool traffic_indicator = false;
     unordered_set<string> ignored_headers;
+    ConfigHandle<UsersAllIdentifiersConfig> users_identifiers_config;
+    OverloadController overload_controller;
 
     // Interfaces
     I_Socket *i_socket                              = nullptr;
@@ -1864,6 +2112,7 @@ private:
     nginxIntakerMetric nginx_intaker_metric;
     TransactionTableEvent transaction_table_event;
     TransactionTableMetric transaction_table_metric;
+    NginxOverloadMetric nginx_overload_metric;
 };
 
 NginxAttachment::NginxAttachment() : Component("NginxAttachment"), pimpl(make_unique<Impl>()) {}
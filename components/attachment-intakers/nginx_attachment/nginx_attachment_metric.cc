@@ -28,6 +28,10 @@ nginxAttachmentEvent::resetAllCounters()
     irrelevant_verdict_counter = 0;
     reconf_verdict_counter = 0;
     wait_verdict_counter = 0;
+    copied_bytes_counter = 0;
+    copied_bytes_transactions_counter = 0;
+    ipc_read_latency.reset();
+    verdict_latency.reset();
 }
 
 void
@@ -97,6 +101,13 @@ nginxAttachmentEvent::addResponseInspectionCounter(uint64_t _counter)
     response_inspection_counter += _counter;
 }
 
+void
+nginxAttachmentEvent::addTransactionCopiedBytes(uint64_t _copied_bytes)
+{
+    copied_bytes_counter += _copied_bytes;
+    copied_bytes_transactions_counter += 1;
+}
+
 uint64_t
 nginxAttachmentEvent::getNetworkingCounter(networkVerdict _verdict) const
 {
@@ -143,6 +154,18 @@ nginxAttachmentEvent::getResponseInspectionCounter() const
     return response_inspection_counter;
 }
 
+uint64_t
+nginxAttachmentEvent::getCopiedBytesCounter() const
+{
+    return copied_bytes_counter;
+}
+
+uint64_t
+nginxAttachmentEvent::getCopiedBytesTransactionsCounter() const
+{
+    return copied_bytes_transactions_counter;
+}
+
 void
 nginxAttachmentMetric::upon(const nginxAttachmentEvent &event)
 {
@@ -160,4 +183,12 @@ nginxAttachmentMetric::upon(const nginxAttachmentEvent &event)
     irrelevant_verdict.report(event.getTrafficVerdictCounter(nginxAttachmentEvent::trafficVerdict::IRRELEVANT));
     reconf_verdict.report(event.getTrafficVerdictCounter(nginxAttachmentEvent::trafficVerdict::RECONF));
     response_inspection.report(event.getResponseInspectionCounter());
+    copied_bytes.report(event.getCopiedBytesCounter());
+    if (event.getCopiedBytesTransactionsCounter() > 0) {
+        copied_bytes_per_transaction.report(
+            static_cast<double>(event.getCopiedBytesCounter()) / event.getCopiedBytesTransactionsCounter()
+        );
+    }
+    ipc_read_latency.merge(event.getIpcReadLatency());
+    verdict_latency.merge(event.getVerdictLatency());
 }
@@ -109,22 +109,47 @@ NginxAttachmentOpaque::getSourceIdentifiersType() const
     return identifier_type;
 }
 
+// Saved data is registered in the context once, as a function that reads its entry in the map by reference, so
+// appending to the data or replacing it does not re-register a copy of all of it.
+string &
+NginxAttachmentOpaque::registerSavedData(const string &name, EnvKeyAttr::LogSection log_ctx)
+{
+    string &saved = saved_data[name];
+    ctx.registerFunc<string>(name, [&saved] () { return saved; }, log_ctx);
+    return saved;
+}
+
+string &
+NginxAttachmentOpaque::getSavedDataForAppend(const string &name)
+{
+    auto saved_data_entry = saved_data.find(name);
+    if (saved_data_entry != saved_data.end()) return saved_data_entry->second;
+
+    return registerSavedData(name, EnvKeyAttr::LogSection::NONE);
+}
+
 void
-NginxAttachmentOpaque::addToSavedData(const string &name, const string &data)
+NginxAttachmentOpaque::addHeaderToSavedData(const string &name, const Buffer &header_key, const Buffer &header_value)
 {
-    saved_data[name] += data;
-    ctx.registerValue(name, saved_data[name]);
+    static const string header_separator = ": ";
+    static const string header_line_end = "\r\n";
+
+    string &saved_headers = getSavedDataForAppend(name);
+    saved_headers.append(reinterpret_cast<const char *>(header_key.data()), header_key.size());
+    saved_headers.append(header_separator);
+    saved_headers.append(reinterpret_cast<const char *>(header_value.data()), header_value.size());
+    saved_headers.append(header_line_end);
+    intake_copied_bytes += header_key.size() + header_value.size() + header_separator.size() + header_line_end.size();
 }
 
 void
 NginxAttachmentOpaque::setSavedData(const string &name, const string &data, EnvKeyAttr::LogSection log_ctx)
 {
-    saved_data[name] = data;
-    ctx.registerValue(name, data, log_ctx);
+    registerSavedData(name, log_ctx) = data;
 }
 
 bool
-NginxAttachmentOpaque::setKeepAliveCtx(const string &hdr_key, const string &hdr_val)
+NginxAttachmentOpaque::setKeepAliveCtx(const Buffer &hdr_key, const Buffer &hdr_val)
 {
     if (!is_keep_alive_ctx) return false;
 
@@ -132,7 +157,11 @@ NginxAttachmentOpaque::setKeepAliveCtx(const string &hdr_key, const string &hdr_
     static bool keep_alive_hdr_initialized = false;
 
     if (keep_alive_hdr_initialized) {
-        if (!keep_alive_hdr.first.empty() && hdr_key == keep_alive_hdr.first && hdr_val == keep_alive_hdr.second) {
+        if (
+            !keep_alive_hdr.first.empty() &&
+            hdr_key.isEqual(keep_alive_hdr.first.data(), keep_alive_hdr.first.size()) &&
+            hdr_val.isEqual(keep_alive_hdr.second.data(), keep_alive_hdr.second.size())
+        ) {
             dbgTrace(D_HTTP_MANAGER) << "Registering keep alive context";
             ctx.registerValue("keep_alive_request_ctx", true);
             return true;
@@ -155,7 +184,11 @@ NginxAttachmentOpaque::setKeepAliveCtx(const string &hdr_key, const string &hdr_
                 << keep_alive_hdr.second;
         }
 
-        if (!keep_alive_hdr.second.empty() && (hdr_key == keep_alive_hdr.first && hdr_val == keep_alive_hdr.second)) {
+        if (
+            !keep_alive_hdr.second.empty() &&
+            hdr_key.isEqual(keep_alive_hdr.first.data(), keep_alive_hdr.first.size()) &&
+            hdr_val.isEqual(keep_alive_hdr.second.data(), keep_alive_hdr.second.size())
+        ) {
             dbgTrace(D_HTTP_MANAGER) << "Registering keep alive context";
             ctx.registerValue("keep_alive_request_ctx", true);
             keep_alive_hdr_initialized = true;
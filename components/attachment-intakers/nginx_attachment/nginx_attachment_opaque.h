@@ -78,16 +78,24 @@ public:
 
     const std::string & getSessionUUID() const { return uuid; }
 
-    void addToSavedData(const std::string &name, const std::string &data);
+    void addHeaderToSavedData(const std::string &name, const Buffer &header_key, const Buffer &header_value);
     void setSavedData(
         const std::string &name,
         const std::string &data,
         EnvKeyAttr::LogSection log_ctx = EnvKeyAttr::LogSection::NONE
     );
     void setApplicationState(const ApplicationState &app_state) { application_state = app_state; }
-    bool setKeepAliveCtx(const std::string &hdr_key, const std::string &hdr_val);
+    bool setKeepAliveCtx(const Buffer &hdr_key, const Buffer &hdr_val);
+
+    uint64_t getIntakeCopiedBytes() const { return intake_copied_bytes; }
+
+    void addInspectedRequestBodySize(uint64_t size) { inspected_request_body_size += size; }
+    uint64_t getInspectedRequestBodySize() const { return inspected_request_body_size; }
 
 private:
+    std::string & registerSavedData(const std::string &name, EnvKeyAttr::LogSection log_ctx);
+    std::string & getSavedDataForAppend(const std::string &name);
+
     CompressionStream       *response_compression_stream;
     HttpTransactionData     transaction_data;
     GenericRulebaseContext  gen_ctx;
@@ -99,6 +107,8 @@ private:
     std::string             identifier_type;
     std::map<std::string, std::string> saved_data;
     ApplicationState application_state = ApplicationState::UNKOWN;
+    uint64_t intake_copied_bytes = 0;
+    uint64_t inspected_request_body_size = 0;
 };
 
 #endif // __NGINX_ATTACHMENT_OPAQUE_H__
@@ -0,0 +1,74 @@
+#include "shmem_ipc.h"
+
+#include <unistd.h>
+
+#include "buffer.h"
+#include "cptest.h"
+
+using namespace std;
+using namespace testing;
+
+static void
+silentDebug(int, const char *, const char *, int, const char *, ...)
+{
+}
+
+class IpcBufferTest : public Test
+{
+public:
+    IpcBufferTest()
+    {
+        owner = initIpc(shmem_name.c_str(), getuid(), getgid(), 1, num_of_elements, silentDebug);
+        user = initIpc(shmem_name.c_str(), getuid(), getgid(), 0, num_of_elements, silentDebug);
+    }
+
+    ~IpcBufferTest()
+    {
+        if (user != nullptr) destroyIpc(user, 0);
+        if (owner != nullptr) destroyIpc(owner, 1);
+    }
+
+    const string shmem_name = "nginx_ipc_buffer_ut";
+    const uint16_t num_of_elements = 11;
+    SharedMemoryIPC *owner = nullptr;
+    SharedMemoryIPC *user = nullptr;
+};
+
+// The intaker wraps a message's data in a VOLATILE Buffer that references the message's slot, and releases the slot
+// only after that Buffer is gone. A Buffer that was taken from it must read the same data after the slot was reused.
+TEST_F(IpcBufferTest, kept_buffer_survives_reuse_of_the_slot)
+{
+    ASSERT_NE(owner, nullptr);
+    ASSERT_NE(user, nullptr);
+
+    const string message = "Host: www.example.com";
+    ASSERT_EQ(sendData(user, message.size(), message.data()), 0);
+
+    const char *read_data = nullptr;
+    uint16_t read_bytes = 0;
+    ASSERT_EQ(receiveData(owner, &read_bytes, &read_data), 0);
+
+    Buffer kept_header;
+    {
+        const Buffer inspection_data(read_data, read_bytes, Buffer::MemoryType::VOLATILE);
+        kept_header = inspection_data.getSubBuffer(6, inspection_data.size());
+        EXPECT_EQ(static_cast<const u_char *>(kept_header.data()), inspection_data.data() + 6);
+    }
+    EXPECT_EQ(popData(owner), 0);
+
+    // Keep the queue going until a message lands on the slot that was released
+    const string other_message = "User-Agent: curl/8.0";
+    const char *reused_data = nullptr;
+    for (uint i = 0; i < 2 * num_of_elements && reused_data != read_data; ++i) {
+        ASSERT_EQ(sendData(user, other_message.size(), other_message.data()), 0);
+        ASSERT_EQ(receiveData(owner, &read_bytes, &reused_data), 0);
+        EXPECT_EQ(string(reused_data, read_bytes), other_message);
+        if (reused_data != read_data) {
+            EXPECT_EQ(popData(owner), 0);
+        }
+    }
+    ASSERT_EQ(reused_data, read_data);
+
+    EXPECT_EQ(kept_header, Buffer("www.example.com"));
+    EXPECT_EQ(popData(owner), 0);
+}
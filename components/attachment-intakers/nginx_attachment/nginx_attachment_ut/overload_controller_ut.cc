@@ -0,0 +1,178 @@
+#include "../overload_controller.h"
+
+#include <sstream>
+
+#include "cptest.h"
+#include "config.h"
+#include "config_component.h"
+#include "environment.h"
+#include "mock/mock_mainloop.h"
+#include "mock/mock_time_get.h"
+
+using namespace std;
+using namespace chrono;
+using namespace testing;
+
+using DegradationLevel = OverloadController::DegradationLevel;
+
+class OverloadControllerTest : public Test
+{
+public:
+    OverloadControllerTest()
+    {
+        env.init();
+        config.preload();
+        EXPECT_CALL(timer, getMonotonicTime()).WillRepeatedly(InvokeWithoutArgs([this] () { return now; }));
+    }
+
+    void
+    loadSettings(bool is_enabled)
+    {
+        stringstream configuration;
+        configuration
+            << "{\"agentSettings\":["
+            << "{\"id\":\"1\",\"key\":\"nginxAttachment.overloadControl.enabled\",\"value\":\""
+            << (is_enabled ? "true" : "false")
+            << "\"},"
+            << "{\"id\":\"2\",\"key\":\"nginxAttachment.overloadControl.maxRequestBodySize\",\"value\":\"1000\"}"
+            << "]}";
+        EXPECT_TRUE(Singleton::Consume<Config::I_Config>::from(config)->loadConfiguration(configuration));
+    }
+
+    void
+    reportQueueUsageAfter(milliseconds elapsed, uint queue_usage)
+    {
+        now += elapsed;
+        controller.reportQueueUsage(queue_usage);
+    }
+
+    microseconds now = seconds(100);
+    NiceMock<MockTimeGet> timer;
+    NiceMock<MockMainLoop> mock_mainloop;
+    ::Environment env;
+    ConfigComponent config;
+    OverloadController controller;
+};
+
+TEST_F(OverloadControllerTest, escalates_once_per_interval_while_above_high_watermark)
+{
+    loadSettings(true);
+    controller.init(&timer);
+    EXPECT_EQ(controller.getDegradationLevel(), DegradationLevel::NONE);
+
+    reportQueueUsageAfter(seconds(1), 90);
+    EXPECT_EQ(controller.getDegradationLevel(), DegradationLevel::SKIP_RESPONSE_BODY);
+    EXPECT_TRUE(controller.shouldSkipResponseBody());
+    EXPECT_FALSE(controller.shouldCapRequestBody(2000));
+
+    reportQueueUsageAfter(milliseconds(500), 95);
+    EXPECT_EQ(controller.getDegradationLevel(), DegradationLevel::SKIP_RESPONSE_BODY);
+
+    reportQueueUsageAfter(milliseconds(500), 95);
+    EXPECT_EQ(controller.getDegradationLevel(), DegradationLevel::CAP_REQUEST_BODY);
+    EXPECT_FALSE(controller.shouldCapRequestBody(999));
+    EXPECT_TRUE(controller.shouldCapRequestBody(1000));
+    EXPECT_FALSE(controller.shouldFailOpen());
+
+    reportQueueUsageAfter(seconds(1), 100);
+    EXPECT_EQ(controller.getDegradationLevel(), DegradationLevel::FAIL_OPEN);
+    EXPECT_TRUE(controller.shouldFailOpen());
+    EXPECT_TRUE(controller.shouldSkipResponseBody());
+    EXPECT_TRUE(controller.shouldCapRequestBody(1000));
+
+    reportQueueUsageAfter(seconds(1), 100);
+    EXPECT_EQ(controller.getDegradationLevel(), DegradationLevel::FAIL_OPEN);
+}
+
+TEST_F(OverloadControllerTest, deescalates_one_level_per_recovery_interval)
+{
+    loadSettings(true);
+    controller.init(&timer);
+    for (int i = 0; i < 3; i++) reportQueueUsageAfter(seconds(1), 90);
+    ASSERT_EQ(controller.getDegradationLevel(), DegradationLevel::FAIL_OPEN);
+
+    reportQueueUsageAfter(seconds(1), 10);
+    reportQueueUsageAfter(seconds(8), 10);
+    EXPECT_EQ(controller.getDegradationLevel(), DegradationLevel::FAIL_OPEN);
+
+    reportQueueUsageAfter(seconds(1), 10);
+    EXPECT_EQ(controller.getDegradationLevel(), DegradationLevel::CAP_REQUEST_BODY);
+    EXPECT_FALSE(controller.shouldFailOpen());
+
+    reportQueueUsageAfter(seconds(5), 10);
+    EXPECT_EQ(controller.getDegradationLevel(), DegradationLevel::CAP_REQUEST_BODY);
+
+    reportQueueUsageAfter(seconds(5), 10);
+    EXPECT_EQ(controller.getDegradationLevel(), DegradationLevel::SKIP_RESPONSE_BODY);
+
+    reportQueueUsageAfter(seconds(10), 10);
+    EXPECT_EQ(controller.getDegradationLevel(), DegradationLevel::NONE);
+    EXPECT_FALSE(controller.shouldSkipResponseBody());
+}
+
+TEST_F(OverloadControllerTest, usage_between_watermarks_holds_the_level)
+{
+    loadSettings(true);
+    controller.init(&timer);
+    reportQueueUsageAfter(seconds(1), 80);
+    ASSERT_EQ(controller.getDegradationLevel(), DegradationLevel::SKIP_RESPONSE_BODY);
+
+    // Between the low watermark (70% of 80) and the high watermark, the level neither rises nor recovers
+    for (int i = 0; i < 30; i++) {
+        reportQueueUsageAfter(seconds(1), i % 2 ? 56 : 79);
+        EXPECT_EQ(controller.getDegradationLevel(), DegradationLevel::SKIP_RESPONSE_BODY);
+    }
+
+    // The recovery interval counts from the last report above the low watermark
+    reportQueueUsageAfter(seconds(1), 55);
+    reportQueueUsageAfter(seconds(8), 55);
+    EXPECT_EQ(controller.getDegradationLevel(), DegradationLevel::SKIP_RESPONSE_BODY);
+    reportQueueUsageAfter(seconds(2), 55);
+    EXPECT_EQ(controller.getDegradationLevel(), DegradationLevel::NONE);
+}
+
+TEST_F(OverloadControllerTest, stale_signal_does_not_hold_the_level)
+{
+    loadSettings(true);
+    controller.init(&timer);
+
+    now += seconds(1);
+    controller.reportVerdictLatency(milliseconds(50));
+    ASSERT_EQ(controller.getDegradationLevel(), DegradationLevel::SKIP_RESPONSE_BODY);
+    reportQueueUsageAfter(seconds(1), 90);
+    reportQueueUsageAfter(seconds(1), 90);
+    ASSERT_EQ(controller.getDegradationLevel(), DegradationLevel::FAIL_OPEN);
+
+    // No verdicts are given while failing open, so the last high latency sample expires instead of holding the level
+    reportQueueUsageAfter(seconds(5), 10);
+    EXPECT_EQ(controller.getDegradationLevel(), DegradationLevel::FAIL_OPEN);
+    reportQueueUsageAfter(seconds(5), 10);
+    EXPECT_EQ(controller.getDegradationLevel(), DegradationLevel::FAIL_OPEN);
+    reportQueueUsageAfter(seconds(5), 10);
+    EXPECT_EQ(controller.getDegradationLevel(), DegradationLevel::CAP_REQUEST_BODY);
+}
+
+TEST_F(OverloadControllerTest, disabled_controller_never_degrades)
+{
+    loadSettings(false);
+    controller.init(&timer);
+
+    for (int i = 0; i < 5; i++) reportQueueUsageAfter(seconds(1), 100);
+    EXPECT_EQ(controller.getDegradationLevel(), DegradationLevel::NONE);
+    EXPECT_FALSE(controller.shouldSkipResponseBody());
+    EXPECT_FALSE(controller.shouldCapRequestBody(1000000));
+    EXPECT_FALSE(controller.shouldFailOpen());
+}
+
+TEST_F(OverloadControllerTest, disabling_recovers_at_once)
+{
+    loadSettings(true);
+    controller.init(&timer);
+    for (int i = 0; i < 3; i++) reportQueueUsageAfter(seconds(1), 90);
+    ASSERT_EQ(controller.getDegradationLevel(), DegradationLevel::FAIL_OPEN);
+
+    loadSettings(false);
+    controller.loadConfiguration();
+    EXPECT_EQ(controller.getDegradationLevel(), DegradationLevel::NONE);
+    EXPECT_FALSE(controller.shouldFailOpen());
+}
@@ -0,0 +1,53 @@
+#include "user_identifiers_config.h"
+
+#include <sstream>
+
+#include "cptest.h"
+
+using namespace std;
+using namespace testing;
+
+static UsersAllIdentifiersConfig
+loadIdentifiers(const string &json)
+{
+    UsersAllIdentifiersConfig config;
+    stringstream json_stream(json);
+    cereal::JSONInputArchive ar(json_stream);
+    config.load(ar);
+    return config;
+}
+
+TEST(UserIdentifiersConfigTest, header_values_are_matched_without_case)
+{
+    auto config = loadIdentifiers(
+        "{\n"
+        "    \"sourceIdentifiers\": [\n"
+        "        { \"sourceIdentifier\": \"Authorization\", \"identifierValues\": [ \"sub\", \"email\" ] },\n"
+        "        { \"sourceIdentifier\": \"X-Forwarded-For\", \"identifierValues\": [ \"10.0.0.1\" ] },\n"
+        "        { \"sourceIdentifier\": \"headerkey\", \"identifierValues\": [ \"x-forwarded-for\", \"X-User\" ] }\n"
+        "    ]\n"
+        "}\n"
+    );
+
+    EXPECT_THAT(config.getHeaderValuesFromConfig("authorization"), ElementsAre("sub", "email"));
+    EXPECT_THAT(config.getHeaderValuesFromConfig("AUTHORIZATION"), ElementsAre("sub", "email"));
+    // The first definition of an identifier is the one in effect
+    EXPECT_THAT(config.getHeaderValuesFromConfig("x-forwarded-for"), ElementsAre("10.0.0.1"));
+    EXPECT_THAT(config.getHeaderValuesFromConfig("x-user"), IsEmpty());
+    EXPECT_THAT(config.getHeaderValuesFromConfig("authorizatio"), IsEmpty());
+    EXPECT_THAT(config.getHeaderValuesFromConfig("x-forwarded-fox"), IsEmpty());
+}
+
+TEST(UserIdentifiersConfigTest, copied_config_keeps_its_priorities)
+{
+    UsersAllIdentifiersConfig copied_config;
+    {
+        auto config = loadIdentifiers(
+            "{ \"sourceIdentifiers\": [ { \"sourceIdentifier\": \"cookie\", \"identifierValues\": [ \"uid\" ] } ] }"
+        );
+        copied_config = config;
+    }
+
+    EXPECT_THAT(copied_config.getHeaderValuesFromConfig("Cookie"), ElementsAre("uid"));
+    EXPECT_THAT(UsersAllIdentifiersConfig().getHeaderValuesFromConfig("cookie"), IsEmpty());
+}
@@ -29,6 +29,7 @@ USE_DEBUG_FLAG(D_NGINX_ATTACHMENT_PARSER);
 Buffer NginxParser::tenant_header_key = Buffer();
 static const Buffer proxy_ip_header_key("X-Forwarded-For", 15, Buffer::MemoryType::STATIC);
 static const Buffer source_ip("sourceip", 8, Buffer::MemoryType::STATIC);
+static const UsersAllIdentifiersConfig default_users_identifiers;
 bool is_keep_alive_ctx = getenv("SAAS_KEEP_ALIVE_HDR_NAME") != nullptr;
 
 map<Buffer, CompressionType> NginxParser::content_encodings = {
@@ -178,7 +179,10 @@ getActivetenantAndProfile(const string &str, const string &deli = ",")
 }
 
 Maybe<vector<HttpHeader>>
-NginxParser::parseRequestHeaders(const Buffer &data, const unordered_set<string> &ignored_headers)
+NginxParser::parseRequestHeaders(
+    const Buffer &data,
+    const unordered_set<string> &ignored_headers,
+    const ConfigHandle<UsersAllIdentifiersConfig> &users_identifiers_config)
 {
     auto maybe_parsed_headers = genHeaders(data);
     if (!maybe_parsed_headers.ok()) return maybe_parsed_headers.passErr();
@@ -188,20 +192,25 @@ NginxParser::parseRequestHeaders(const Buffer &data, const unordered_set<string>
     NginxAttachmentOpaque &opaque = i_transaction_table->getState<NginxAttachmentOpaque>();
 
     if (is_keep_alive_ctx || !ignored_headers.empty()) {
+        // The ignored headers are few, so every key is compared to them in place instead of being copied for a lookup
+        auto is_ignored_header = [&ignored_headers] (const HttpHeader &header)
+        {
+            for (const string &ignored_header : ignored_headers) {
+                if (header.getKey().isEqual(ignored_header.data(), ignored_header.size())) return true;
+            }
+            return false;
+        };
         bool is_last_header_removed = false;
         parsed_headers.erase(
             remove_if(
                 parsed_headers.begin(),
                 parsed_headers.end(),
-                [&opaque, &is_last_header_removed, &ignored_headers](const HttpHeader &header)
+                [&opaque, &is_last_header_removed, &is_ignored_header](const HttpHeader &header)
                 {
-                    string hdr_key = static_cast<string>(header.getKey());
-                    string hdr_val = static_cast<string>(header.getValue());
-                    if (
-                        opaque.setKeepAliveCtx(hdr_key, hdr_val)
-                        || ignored_headers.find(hdr_key) != ignored_headers.end()
-                    ) {
-                        dbgTrace(D_NGINX_ATTACHMENT_PARSER) << "Header was removed from headers list: " << hdr_key;
+                    if (opaque.setKeepAliveCtx(header.getKey(), header.getValue()) || is_ignored_header(header)) {
+                        dbgTrace(D_NGINX_ATTACHMENT_PARSER)
+                            << "Header was removed from headers list: "
+                            << dumpHex(header.getKey());
                         if (header.isLastHeader()) {
                             dbgTrace(D_NGINX_ATTACHMENT_PARSER) << "Last header was removed from headers list";
                             is_last_header_removed = true;
@@ -219,17 +228,12 @@ NginxParser::parseRequestHeaders(const Buffer &data, const unordered_set<string>
         }
     }
 
+    // The configuration is resolved once per request, and again only if a tenant header switches the active tenant
+    const UsersAllIdentifiersConfig *source_identifiers =
+        &users_identifiers_config.getWithDefault(default_users_identifiers);
     for (const HttpHeader &header : parsed_headers) {
-        auto source_identifiers = getConfigurationWithDefault<UsersAllIdentifiersConfig>(
-            UsersAllIdentifiersConfig(),
-            "rulebase",
-            "usersIdentifiers"
-        );
-        source_identifiers.parseRequestHeaders(header);
-        opaque.addToSavedData(
-            HttpTransactionData::req_headers,
-            static_cast<string>(header.getKey()) + ": " + static_cast<string>(header.getValue()) + "\r\n"
-        );
+        source_identifiers->parseRequestHeaders(header);
+        opaque.addHeaderToSavedData(HttpTransactionData::req_headers, header.getKey(), header.getValue());
 
         if (NginxParser::tenant_header_key == header.getKey()) {
             dbgDebug(D_NGINX_ATTACHMENT_PARSER)
@@ -240,8 +244,9 @@ NginxParser::parseRequestHeaders(const Buffer &data, const unordered_set<string>
 
             auto active_tenant_and_profile = getActivetenantAndProfile(header.getValue());
             opaque.setSessionTenantAndProfile(active_tenant_and_profile[0], active_tenant_and_profile[1]);
+            source_identifiers = &users_identifiers_config.getWithDefault(default_users_identifiers);
         } else if (proxy_ip_header_key == header.getKey()) {
-            source_identifiers.setXFFValuesToOpaqueCtx(header, UsersAllIdentifiersConfig::ExtractType::PROXYIP);
+            source_identifiers->setXFFValuesToOpaqueCtx(header, UsersAllIdentifiersConfig::ExtractType::PROXYIP);
         }
     }
 
@@ -21,6 +21,8 @@
 #include "http_transaction_common.h"
 #include "http_inspection_events.h"
 #include "i_encryptor.h"
+#include "config.h"
+#include "user_identifiers_config.h"
 
 class NginxParser : Singleton::Consume<I_Encryptor>
 {
@@ -30,7 +32,8 @@ public:
     static Maybe<uint64_t> parseContentLength(const Buffer &data);
     static Maybe<std::vector<HttpHeader>> parseRequestHeaders(
         const Buffer &data,
-        const std::unordered_set<std::string> &ignored_headers
+        const std::unordered_set<std::string> &ignored_headers,
+        const ConfigHandle<UsersAllIdentifiersConfig> &users_identifiers_config
     );
     static Maybe<std::vector<HttpHeader>> parseResponseHeaders(const Buffer &data);
     static Maybe<HttpBody> parseRequestBody(const Buffer &data);
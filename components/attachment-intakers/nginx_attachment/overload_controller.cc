@@ -0,0 +1,237 @@
+// Copyright (C) 2022 Check Point Software Technologies Ltd. All rights reserved.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "overload_controller.h"
+
+#include "config.h"
+#include "debug.h"
+
+using namespace std;
+
+USE_DEBUG_FLAG(D_NGINX_ATTACHMENT);
+
+// The low watermark of every signal is this percentage of its high watermark
+static const uint low_watermark_percentage = 70;
+// Every verdict latency sample moves the average by 1/verdict_latency_smoothing of the difference
+static const double verdict_latency_smoothing = 8;
+
+static string
+degradationLevelToString(OverloadController::DegradationLevel level)
+{
+    switch (level) {
+        case OverloadController::DegradationLevel::NONE:
+            return "None";
+        case OverloadController::DegradationLevel::SKIP_RESPONSE_BODY:
+            return "Skip response body";
+        case OverloadController::DegradationLevel::CAP_REQUEST_BODY:
+            return "Cap request body";
+        case OverloadController::DegradationLevel::FAIL_OPEN:
+            return "Fail open";
+        case OverloadController::DegradationLevel::COUNT:
+            break;
+    }
+    return "Unknown";
+}
+
+void
+OverloadController::init(I_TimeGet *_timer)
+{
+    timer = _timer;
+    loadConfiguration();
+    registerListener();
+}
+
+void
+OverloadController::loadConfiguration()
+{
+    is_enabled = getProfileAgentSettingWithDefault<bool>(false, "nginxAttachment.overloadControl.enabled");
+    queue_usage_high_watermark = getProfileAgentSettingWithDefault<uint>(
+        80,
+        "nginxAttachment.overloadControl.queueUsageHighWatermark"
+    );
+    verdict_latency_high_watermark = getProfileAgentSettingWithDefault<uint>(
+        20000,
+        "nginxAttachment.overloadControl.verdictLatencyHighWatermarkUsec"
+    );
+    cpu_high_watermark = getProfileAgentSettingWithDefault<uint>(
+        90,
+        "nginxAttachment.overloadControl.cpuHighWatermark"
+    );
+    max_request_body_size = getProfileAgentSettingWithDefault<uint>(
+        64 * 1024,
+        "nginxAttachment.overloadControl.maxRequestBodySize"
+    );
+    escalation_interval = chrono::milliseconds(
+        getProfileAgentSettingWithDefault<uint>(1000, "nginxAttachment.overloadControl.escalationIntervalMsec")
+    );
+    recovery_interval = chrono::seconds(
+        getProfileAgentSettingWithDefault<uint>(10, "nginxAttachment.overloadControl.recoveryIntervalSec")
+    );
+
+    if (!is_enabled && level != DegradationLevel::NONE) {
+        setDegradationLevel(DegradationLevel::NONE, timer->getMonotonicTime());
+    }
+}
+
+void
+OverloadController::reportQueueUsage(uint _queue_usage)
+{
+    queue_usage = _queue_usage;
+    queue_usage_time = timer->getMonotonicTime();
+    evaluate();
+}
+
+void
+OverloadController::reportVerdictLatency(chrono::microseconds latency)
+{
+    auto now = timer->getMonotonicTime();
+    if (isSampleValid(verdict_latency_time, now)) {
+        verdict_latency += (latency.count() - verdict_latency) / verdict_latency_smoothing;
+    } else {
+        verdict_latency = latency.count();
+    }
+    verdict_latency_time = now;
+    evaluate();
+}
+
+void
+OverloadController::upon(const CPUEvent &event)
+{
+    if (event.isExternal()) return;
+
+    cpu_usage = event.getCPU();
+    cpu_usage_time = timer->getMonotonicTime();
+    evaluate();
+}
+
+bool
+OverloadController::shouldSkipResponseBody()
+{
+    if (level < DegradationLevel::SKIP_RESPONSE_BODY) return false;
+
+    overload_event.addSkippedResponseBodyChunk();
+    return true;
+}
+
+bool
+OverloadController::shouldCapRequestBody(uint64_t inspected_request_body_size)
+{
+    if (level < DegradationLevel::CAP_REQUEST_BODY || inspected_request_body_size < max_request_body_size) {
+        return false;
+    }
+
+    overload_event.addCappedRequestBodyChunk();
+    return true;
+}
+
+bool
+OverloadController::shouldFailOpen()
+{
+    if (level < DegradationLevel::FAIL_OPEN) return false;
+
+    overload_event.addFailOpenVerdict();
+    return true;
+}
+
+void
+OverloadController::notifyMetric()
+{
+    overload_event.setDegradationLevel(static_cast<uint64_t>(level));
+    overload_event.setQueueUsage(queue_usage);
+    overload_event.setVerdictLatency(verdict_latency);
+    overload_event.setCPUUsage(cpu_usage);
+    overload_event.notify();
+    overload_event.resetAllCounters();
+}
+
+// A signal that was not sampled during the recovery interval (e.g. no verdicts are given while failing open) does
+// not hold the controller in a degraded level.
+bool
+OverloadController::isSampleValid(chrono::microseconds sample_time, chrono::microseconds now) const
+{
+    return sample_time != chrono::microseconds(0) && now - sample_time <= recovery_interval;
+}
+
+bool
+OverloadController::isAboveHighWatermark(chrono::microseconds now) const
+{
+    if (isSampleValid(queue_usage_time, now) && queue_usage >= queue_usage_high_watermark) return true;
+    if (isSampleValid(verdict_latency_time, now) && verdict_latency >= verdict_latency_high_watermark) return true;
+    return isSampleValid(cpu_usage_time, now) && cpu_usage >= cpu_high_watermark;
+}
+
+bool
+OverloadController::isBelowLowWatermark(chrono::microseconds now) const
+{
+    if (
+        isSampleValid(queue_usage_time, now) &&
+        queue_usage * 100 >= queue_usage_high_watermark * low_watermark_percentage
+    ) {
+        return false;
+    }
+    if (
+        isSampleValid(verdict_latency_time, now) &&
+        verdict_latency * 100 >= verdict_latency_high_watermark * low_watermark_percentage
+    ) {
+        return false;
+    }
+    return !isSampleValid(cpu_usage_time, now) || cpu_usage * 100 < cpu_high_watermark * low_watermark_percentage;
+}
+
+void
+OverloadController::evaluate()
+{
+    if (!is_enabled) return;
+
+    auto now = timer->getMonotonicTime();
+    if (isAboveHighWatermark(now)) {
+        last_pressure_time = now;
+        if (level != DegradationLevel::FAIL_OPEN && now - level_change_time >= escalation_interval) {
+            setDegradationLevel(static_cast<DegradationLevel>(static_cast<int>(level) + 1), now);
+        }
+        return;
+    }
+
+    if (!isBelowLowWatermark(now)) {
+        last_pressure_time = now;
+        return;
+    }
+
+    if (
+        level != DegradationLevel::NONE &&
+        now - last_pressure_time >= recovery_interval &&
+        now - level_change_time >= recovery_interval
+    ) {
+        setDegradationLevel(static_cast<DegradationLevel>(static_cast<int>(level) - 1), now);
+    }
+}
+
+void
+OverloadController::setDegradationLevel(DegradationLevel new_level, chrono::microseconds now)
+{
+    dbgInfo(D_NGINX_ATTACHMENT)
+        << "Changing the overload degradation level. Previous level: "
+        << degradationLevelToString(level)
+        << ", new level: "
+        << degradationLevelToString(new_level)
+        << ", queue usage: "
+        << queue_usage
+        << "%, verdict latency: "
+        << verdict_latency
+        << " usec, CPU usage: "
+        << cpu_usage
+        << "%";
+
+    level = new_level;
+    level_change_time = now;
+}
@@ -0,0 +1,83 @@
+// Copyright (C) 2022 Check Point Software Technologies Ltd. All rights reserved.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __OVERLOAD_CONTROLLER_H__
+#define __OVERLOAD_CONTROLLER_H__
+
+#include <chrono>
+
+#include "i_time_get.h"
+#include "cpu/cpu_metric.h"
+#include "nginx_overload_metric.h"
+
+// Degrades the inspection step by step when the agent does not keep up with the attachment, so the NGINX workers do
+// not stall waiting for verdicts. The level goes up while the receive queue usage, the verdict latency or the CPU
+// usage is above its high watermark, and goes back down once all of them stay below their low watermarks for the
+// recovery interval. Every level keeps the degradations of the levels below it.
+class OverloadController : public Listener<CPUEvent>
+{
+public:
+    enum class DegradationLevel {
+        NONE,
+        SKIP_RESPONSE_BODY,
+        CAP_REQUEST_BODY,
+        FAIL_OPEN,
+
+        COUNT
+    };
+
+    void init(I_TimeGet *_timer);
+    void loadConfiguration();
+
+    void reportQueueUsage(uint queue_usage);
+    void reportVerdictLatency(std::chrono::microseconds latency);
+    void upon(const CPUEvent &event) override;
+
+    bool shouldSkipResponseBody();
+    bool shouldCapRequestBody(uint64_t inspected_request_body_size);
+    bool shouldFailOpen();
+
+    DegradationLevel getDegradationLevel() const { return level; }
+
+    void notifyMetric();
+
+private:
+    void evaluate();
+    void setDegradationLevel(DegradationLevel new_level, std::chrono::microseconds now);
+    bool isAboveHighWatermark(std::chrono::microseconds now) const;
+    bool isBelowLowWatermark(std::chrono::microseconds now) const;
+    bool isSampleValid(std::chrono::microseconds sample_time, std::chrono::microseconds now) const;
+
+    I_TimeGet *timer = nullptr;
+    DegradationLevel level = DegradationLevel::NONE;
+    NginxOverloadEvent overload_event;
+
+    bool is_enabled = false;
+    uint queue_usage_high_watermark = 0;
+    double verdict_latency_high_watermark = 0;
+    double cpu_high_watermark = 0;
+    uint64_t max_request_body_size = 0;
+    std::chrono::microseconds escalation_interval = std::chrono::microseconds(0);
+    std::chrono::microseconds recovery_interval = std::chrono::microseconds(0);
+
+    uint queue_usage = 0;
+    double verdict_latency = 0;
+    double cpu_usage = 0;
+    std::chrono::microseconds queue_usage_time = std::chrono::microseconds(0);
+    std::chrono::microseconds verdict_latency_time = std::chrono::microseconds(0);
+    std::chrono::microseconds cpu_usage_time = std::chrono::microseconds(0);
+    std::chrono::microseconds level_change_time = std::chrono::microseconds(0);
+    std::chrono::microseconds last_pressure_time = std::chrono::microseconds(0);
+};
+
+#endif // __OVERLOAD_CONTROLLER_H__
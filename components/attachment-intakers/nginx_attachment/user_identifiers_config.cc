@@ -53,6 +53,18 @@ UsersAllIdentifiersConfig::UsersIdentifiersConfig::load(cereal::JSONInputArchive
     parseJSONKey<vector<string>>("identifierValues", identifier_values, ar);
 }
 
+bool
+UsersAllIdentifiersConfig::UsersIdentifiersConfig::isEqualSourceIdentifier(const Buffer &other) const
+{
+    if (source_identifier.size() != other.size()) return false;
+    return equal(
+        source_identifier.begin(),
+        source_identifier.end(),
+        other.begin(),
+        [] (char c1, u_char c2) { return tolower(c1) == tolower(c2); }
+    );
+}
+
 bool
 UsersAllIdentifiersConfig::UsersIdentifiersConfig::isEqualSourceIdentifier(const string &other) const
 {
@@ -72,13 +84,36 @@ UsersAllIdentifiersConfig::UsersAllIdentifiersConfig()
 vector<string>
 UsersAllIdentifiersConfig::getHeaderValuesFromConfig(const string &header_key) const
 {
-    for (auto user_identifier : user_identifiers) {
-        if (user_identifier.isEqualSourceIdentifier(header_key)) {
-            dbgDebug(D_NGINX_ATTACHMENT_PARSER) << "Match source identifier is found";
-            return user_identifier.getIdentifierValues();
-        }
+    int priority = getIdentifierPriority(header_key);
+    if (priority < 0) return vector<string>();
+
+    dbgDebug(D_NGINX_ATTACHMENT_PARSER) << "Match source identifier is found";
+    return user_identifiers[priority].getIdentifierValues();
+}
+
+template <typename Iterator>
+static size_t
+hashLowerCase(Iterator first, Iterator last)
+{
+    // FNV-1a
+    size_t hash = 14695981039346656037ull;
+    for (; first != last; ++first) {
+        hash ^= static_cast<u_char>(tolower(static_cast<u_char>(*first)));
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void
+UsersAllIdentifiersConfig::buildIdentifierPriorities()
+{
+    identifier_priorities.clear();
+    for (uint index = 0; index < user_identifiers.size(); index++) {
+        const string &identifier = user_identifiers[index].getSourceIdentifier();
+        // An identifier that is listed twice keeps its first (higher) priority
+        if (getIdentifierPriority(identifier) >= 0) continue;
+        identifier_priorities.emplace(hashLowerCase(identifier.begin(), identifier.end()), index);
     }
-    return vector<string>();
 }
 
 void
@@ -117,6 +152,8 @@ UsersAllIdentifiersConfig::load(cereal::JSONInputArchive &ar)
         auto last_defined_forwards = find(default_order.begin(), default_order.end(), *last_user_defined_header);
         user_identifiers.insert(user_identifiers.end(), last_defined_forwards + 1, default_order.end());
     }
+
+    buildIdentifierPriorities();
 }
 
 static bool
@@ -140,14 +177,26 @@ UsersAllIdentifiersConfig::setIdentifierTopaqueCtx(const HttpHeader &header) con
     }
 }
 
-bool
-UsersAllIdentifiersConfig::isHigherPriority(const string &current_identifier, const string &header_key) const
+int
+UsersAllIdentifiersConfig::getIdentifierPriority(const string &identifier) const
 {
-    for (auto user_identifier : user_identifiers) {
-        if (user_identifier.isEqualSourceIdentifier(current_identifier)) return false;
-        if (user_identifier.isEqualSourceIdentifier(header_key)) return true;
+    auto candidates = identifier_priorities.equal_range(hashLowerCase(identifier.begin(), identifier.end()));
+    for (auto candidate = candidates.first; candidate != candidates.second; ++candidate) {
+        if (user_identifiers[candidate->second].isEqualSourceIdentifier(identifier)) return candidate->second;
     }
-    return false;
+    return -1;
+}
+
+int
+UsersAllIdentifiersConfig::getIdentifierPriority(const Buffer &header_key) const
+{
+    if (identifier_priorities.empty()) return -1;
+
+    auto candidates = identifier_priorities.equal_range(hashLowerCase(header_key.begin(), header_key.end()));
+    for (auto candidate = candidates.first; candidate != candidates.second; ++candidate) {
+        if (user_identifiers[candidate->second].isEqualSourceIdentifier(header_key)) return candidate->second;
+    }
+    return -1;
 }
 
 void
@@ -456,6 +505,10 @@ UsersAllIdentifiersConfig::setCookieValuesToOpaqueCtx(const HttpHeader &header)
 void
 UsersAllIdentifiersConfig::parseRequestHeaders(const HttpHeader &header) const
 {
+    // Most headers are not source identifiers, so they are filtered before reaching the transaction state
+    int header_priority = getIdentifierPriority(header.getKey());
+    if (header_priority < 0) return;
+
     auto i_transaction_table = Singleton::Consume<I_TableSpecific<SessionID>>::by<NginxAttachment>();
     if (!i_transaction_table || !i_transaction_table->hasState<NginxAttachmentOpaque>()) {
         dbgDebug(D_NGINX_ATTACHMENT_PARSER) << "Can't get the transaction table";
@@ -463,9 +516,8 @@ UsersAllIdentifiersConfig::parseRequestHeaders(const HttpHeader &header) const
     }
 
     NginxAttachmentOpaque &opaque = i_transaction_table->getState<NginxAttachmentOpaque>();
-    const string &current_identifier = opaque.getSourceIdentifiersType();
-
-    if (!isHigherPriority(current_identifier, header.getKey())) return;
+    int current_priority = getIdentifierPriority(opaque.getSourceIdentifiersType());
+    if (current_priority >= 0 && current_priority <= header_priority) return;
 
     setIdentifierTopaqueCtx(header);
 }
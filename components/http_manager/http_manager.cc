@@ -24,6 +24,7 @@
 #include "common.h"
 #include "config.h"
 #include "http_manager_opaque.h"
+#include "http_manager_metric.h"
 #include "log_generator.h"
 #include "http_inspection_events.h"
 #include "agent_core_utilities.h"
@@ -32,6 +33,17 @@ USE_DEBUG_FLAG(D_HTTP_MANAGER);
 
 using namespace std;
 
+static const string new_transaction_stage = "newTransaction";
+static const string request_header_stage = "requestHeader";
+static const string response_header_stage = "responseHeader";
+static const string request_body_stage = "requestBody";
+static const string response_body_stage = "responseBody";
+static const string response_code_stage = "responseCode";
+static const string end_request_stage = "endRequest";
+static const string end_transaction_stage = "endTransaction";
+static const string delayed_verdict_stage = "delayedVerdict";
+static const string no_security_app = "";
+
 static ostream &
 operator<<(ostream &os, const EventVerdict &event)
 {
@@ -63,8 +75,24 @@ public:
         dbgFlow(D_HTTP_MANAGER);
 
         i_transaction_table = Singleton::Consume<I_Table>::by<HttpManager>();
+        i_time_get = Singleton::Consume<I_TimeGet>::by<HttpManager>();
 
         Singleton::Consume<I_Logging>::by<HttpManager>()->addGeneralModifier(compressAppSecLogs);
+
+        previous_buffer_cache_size = getConfigurationHandle<uint>("HTTP manager", "Previous Buffer Cache size");
+        max_request_body_size = getConfigurationHandle<uint>("HTTP manager", "Max Request Body Size");
+        max_response_body_size = getConfigurationHandle<uint>("HTTP manager", "Max Response Body Size");
+        request_size_limit_verdict = getConfigurationHandle<string>("HTTP manager", "Request Size Limit Verdict");
+        response_size_limit_verdict = getConfigurationHandle<string>("HTTP manager", "Response Size Limit Verdict");
+
+        latency_metric.init(
+            "HTTP inspection latency",
+            ReportIS::AudienceTeam::AGENT_CORE,
+            ReportIS::IssuingEngine::AGENT_CORE,
+            chrono::minutes(10),
+            true
+        );
+        latency_metric.registerListener();
     }
 
     FilterVerdict
@@ -78,7 +106,7 @@ public:
         ScopedContext ctx;
         ctx.registerValue(app_sec_marker_key, i_transaction_table->keyToString(), EnvKeyAttr::LogSection::MARKER);
 
-        return handleEvent(NewHttpTransactionEvent(event).performNamedQuery());
+        return handleEvent(performTimedQuery(new_transaction_stage, NewHttpTransactionEvent(event)));
     }
 
     FilterVerdict
@@ -112,8 +140,8 @@ public:
 
         auto event_responds =
             is_request ?
-            HttpRequestHeaderEvent(event).performNamedQuery() :
-            HttpResponseHeaderEvent(event).performNamedQuery();
+            performTimedQuery(request_header_stage, HttpRequestHeaderEvent(event)) :
+            performTimedQuery(response_header_stage, HttpResponseHeaderEvent(event));
         FilterVerdict verdict = handleEvent(event_responds);
         if (verdict.getVerdict() == ngx_http_cp_verdict_e::TRAFFIC_VERDICT_INJECT) {
             applyInjectionModifications(verdict, event_responds, event.getHeaderIndex());
@@ -150,10 +178,10 @@ public:
 
         auto event_responds =
             is_request ?
-            HttpRequestBodyEvent(event, state.getPreviousDataCache()).performNamedQuery() :
-            HttpResponseBodyEvent(event, state.getPreviousDataCache()).performNamedQuery();
+            performTimedQuery(request_body_stage, HttpRequestBodyEvent(event, state.getPreviousDataCache())) :
+            performTimedQuery(response_body_stage, HttpResponseBodyEvent(event, state.getPreviousDataCache()));
         verdict = handleEvent(event_responds);
-        state.saveCurrentDataToCache(event.getData());
+        state.saveCurrentDataToCache(event.getData(), previous_buffer_cache_size.getWithDefault(0));
         if (verdict.getVerdict() == ngx_http_cp_verdict_e::TRAFFIC_VERDICT_INJECT) {
             applyInjectionModifications(verdict, event_responds, event.getBodyChunkIndex());
         }
@@ -176,7 +204,7 @@ public:
             ctx.registerValue("UserDefined", state.getUserDefinedValue().unpack(), EnvKeyAttr::LogSection::DATA);
         }
 
-        return handleEvent(ResponseCodeEvent(event).performNamedQuery());
+        return handleEvent(performTimedQuery(response_code_stage, ResponseCodeEvent(event)));
     }
 
     FilterVerdict
@@ -196,7 +224,7 @@ public:
             ctx.registerValue("UserDefined", state.getUserDefinedValue().unpack(), EnvKeyAttr::LogSection::DATA);
         }
 
-        return handleEvent(EndRequestEvent().performNamedQuery());
+        return handleEvent(performTimedQuery(end_request_stage, EndRequestEvent()));
     }
 
     FilterVerdict
@@ -216,7 +244,7 @@ public:
             ctx.registerValue("UserDefined", state.getUserDefinedValue().unpack(), EnvKeyAttr::LogSection::DATA);
         }
 
-        return handleEvent(EndTransactionEvent().performNamedQuery());
+        return handleEvent(performTimedQuery(end_transaction_stage, EndTransactionEvent()));
     }
 
     FilterVerdict
@@ -235,7 +263,7 @@ public:
             ctx.registerValue("UserDefined", state.getUserDefinedValue().unpack(), EnvKeyAttr::LogSection::DATA);
         }
 
-        return handleEvent(WaitTransactionEvent().performNamedQuery());
+        return handleEvent(performTimedQuery(delayed_verdict_stage, WaitTransactionEvent()));
     }
 
     void
@@ -251,27 +279,40 @@ public:
     }
 
 private:
+    // Queries the security apps, reporting the latency of every app and of the whole stage
+    template <typename EventType>
+    vector<pair<string, EventVerdict>>
+    performTimedQuery(const string &stage, const EventType &event)
+    {
+        auto start_time = i_time_get->getMonotonicTime();
+        auto event_responds = event.performNamedQuery(
+            [this] () { return i_time_get->getMonotonicTime(); },
+            [&stage] (const string &security_app, chrono::microseconds latency)
+            {
+                HttpInspectionLatencyEvent(stage, security_app, latency.count()).notify();
+            }
+        );
+        auto stage_latency = i_time_get->getMonotonicTime() - start_time;
+        HttpInspectionLatencyEvent(stage, no_security_app, stage_latency.count()).notify();
+        return event_responds;
+    }
+
     ngx_http_cp_verdict_e
     handleBodySizeLimit(bool is_request_body_type, const HttpBody &event)
     {
         HttpManagerOpaque &state = i_transaction_table->getState<HttpManagerOpaque>();
         state.updatePayloadSize(event.getData().size());
 
-        auto size_limit = getConfiguration<uint>(
-            "HTTP manager",
-            is_request_body_type ? "Max Request Body Size" : "Max Response Body Size"
-        );
-
-        string size_limit_verdict = getConfigurationWithDefault<string>(
-            "Accept",
-            "HTTP manager",
-            is_request_body_type ? "Request Size Limit Verdict" : "Response Size Limit Verdict"
-        );
-
+        auto &size_limit = is_request_body_type ? max_request_body_size.get() : max_response_body_size.get();
         if (!size_limit.ok() || state.getAggeregatedPayloadSize() < size_limit.unpack()) {
             return ngx_http_cp_verdict_e::TRAFFIC_VERDICT_INSPECT;
         }
 
+        const string &size_limit_verdict =
+            is_request_body_type ?
+            request_size_limit_verdict.getWithDefault(default_size_limit_verdict) :
+            response_size_limit_verdict.getWithDefault(default_size_limit_verdict);
+
         ngx_http_cp_verdict_e verdict = size_limit_verdict == "Drop" ?
             ngx_http_cp_verdict_e::TRAFFIC_VERDICT_DROP :
             ngx_http_cp_verdict_e::TRAFFIC_VERDICT_ACCEPT;
@@ -392,12 +433,21 @@ private:
     }
 
     I_Table *i_transaction_table;
+    I_TimeGet *i_time_get;
+    HttpInspectionLatencyMetric latency_metric;
+    ConfigHandle<uint> previous_buffer_cache_size;
+    ConfigHandle<uint> max_request_body_size;
+    ConfigHandle<uint> max_response_body_size;
+    ConfigHandle<string> request_size_limit_verdict;
+    ConfigHandle<string> response_size_limit_verdict;
     static const ngx_http_cp_verdict_e default_verdict;
+    static const string default_size_limit_verdict;
     static const string app_sec_marker_key;
 };
 
 const ngx_http_cp_verdict_e HttpManager::Impl::default_verdict(ngx_http_cp_verdict_e::TRAFFIC_VERDICT_DROP);
 const string HttpManager::Impl::app_sec_marker_key = "app_sec_marker";
+const string HttpManager::Impl::default_size_limit_verdict = "Accept";
 
 HttpManager::HttpManager() : Component("HttpManager"), pimpl(make_unique<Impl>()) {}
 HttpManager::~HttpManager() {}
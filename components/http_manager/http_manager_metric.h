@@ -0,0 +1,82 @@
+// Copyright (C) 2022 Check Point Software Technologies Ltd. All rights reserved.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __HTTP_MANAGER_METRIC_H__
+#define __HTTP_MANAGER_METRIC_H__
+
+#include <string>
+
+#include "generic_metric.h"
+
+// Latency of a single inspection stage. When the security app is empty, the latency is of the whole stage.
+class HttpInspectionLatencyEvent : public Event<HttpInspectionLatencyEvent>
+{
+public:
+    HttpInspectionLatencyEvent(const std::string &_stage, const std::string &_security_app, uint64_t _latency)
+            :
+        stage(_stage),
+        security_app(_security_app),
+        latency(_latency)
+    {
+    }
+
+    const std::string & getStage() const { return stage; }
+    const std::string & getSecurityApp() const { return security_app; }
+    uint64_t getLatency() const { return latency; }
+
+private:
+    const std::string &stage;
+    const std::string &security_app;
+    uint64_t latency;
+};
+
+class HttpInspectionLatencyMetric
+        :
+    public GenericMetric,
+    public Listener<HttpInspectionLatencyEvent>
+{
+public:
+    void
+    upon(const HttpInspectionLatencyEvent &event) override
+    {
+        if (event.getSecurityApp().empty()) {
+            stage_latency.report(event.getStage(), event.getLatency());
+        } else {
+            security_app_latency.report(event.getSecurityApp(), event.getStage(), event.getLatency());
+        }
+    }
+
+private:
+    MetricCalculations::MetricMap<std::string, MetricCalculations::Histogram> stage_latency{
+        MetricCalculations::Histogram(nullptr, ""),
+        this,
+        "stage",
+        "inspectionStageLatencyUsec"
+    };
+    MetricCalculations::MetricMap<
+        std::string,
+        MetricCalculations::MetricMap<std::string, MetricCalculations::Histogram>
+    > security_app_latency{
+        MetricCalculations::MetricMap<std::string, MetricCalculations::Histogram>(
+            MetricCalculations::Histogram(nullptr, ""),
+            nullptr,
+            "stage",
+            ""
+        ),
+        this,
+        "securityApp",
+        "securityAppRespondLatencyUsec"
+    };
+};
+
+#endif // __HTTP_MANAGER_METRIC_H__
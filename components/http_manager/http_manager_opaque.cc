@@ -98,9 +98,8 @@ HttpManagerOpaque::getCurrentDropVerdictCausers() const
 }
 
 void
-HttpManagerOpaque::saveCurrentDataToCache(const Buffer &full_data)
+HttpManagerOpaque::saveCurrentDataToCache(const Buffer &full_data, uint data_cache_size)
 {
-    uint data_cache_size = getConfigurationWithDefault<uint>(0, "HTTP manager", "Previous Buffer Cache size");
     if (data_cache_size == 0) {
         prev_data_cache.clear();
         return;
@@ -33,7 +33,7 @@ public:
     ngx_http_cp_verdict_e getManagerVerdict() const { return manager_verdict; }
     ngx_http_cp_verdict_e getCurrVerdict() const;
     std::set<std::string> getCurrentDropVerdictCausers() const;
-    void saveCurrentDataToCache(const Buffer &full_data);
+    void saveCurrentDataToCache(const Buffer &full_data, uint data_cache_size);
     void setUserDefinedValue(const std::string &value) { user_defined_value = value; }
     Maybe<std::string> getUserDefinedValue() const { return user_defined_value; }
     const Buffer & getPreviousDataCache() const { return prev_data_cache; }
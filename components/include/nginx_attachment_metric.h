@@ -43,12 +43,26 @@ public:
 
     void addResponseInspectionCounter(uint64_t _counter);
 
+    void addTransactionCopiedBytes(uint64_t _copied_bytes);
+
+    void addIpcReadLatency(uint64_t _latency) { ipc_read_latency.report(_latency); }
+
+    void addVerdictLatency(uint64_t _latency) { verdict_latency.report(_latency); }
+
     uint64_t getNetworkingCounter(networkVerdict _verdict) const;
 
     uint64_t getTrafficVerdictCounter(trafficVerdict _verdict) const;
 
     uint64_t getResponseInspectionCounter() const;
 
+    uint64_t getCopiedBytesCounter() const;
+
+    uint64_t getCopiedBytesTransactionsCounter() const;
+
+    const MetricCalculations::Histogram & getIpcReadLatency() const { return ipc_read_latency; }
+
+    const MetricCalculations::Histogram & getVerdictLatency() const { return verdict_latency; }
+
 private:
     uint64_t successfull_registrations_counter = 0;
     uint64_t failed_registrations_counter = 0;
@@ -61,6 +75,10 @@ private:
     uint64_t reconf_verdict_counter = 0;
     uint64_t response_inspection_counter = 0;
     uint64_t wait_verdict_counter = 0;
+    uint64_t copied_bytes_counter = 0;
+    uint64_t copied_bytes_transactions_counter = 0;
+    MetricCalculations::Histogram ipc_read_latency{nullptr, ""};
+    MetricCalculations::Histogram verdict_latency{nullptr, ""};
 };
 
 class nginxAttachmentMetric
@@ -82,6 +100,10 @@ private:
     MetricCalculations::Counter irrelevant_verdict{this, "irrelevantVerdictSum"};
     MetricCalculations::Counter reconf_verdict{this, "reconfVerdictSum"};
     MetricCalculations::Counter response_inspection{this, "responseInspection"};
+    MetricCalculations::Counter copied_bytes{this, "intakeCopiedBytesSum"};
+    MetricCalculations::Average<double> copied_bytes_per_transaction{this, "intakeCopiedBytesPerTransactionAvg"};
+    MetricCalculations::Histogram ipc_read_latency{this, "ipcReadLatencyUsec"};
+    MetricCalculations::Histogram verdict_latency{this, "verdictLatencyUsec"};
 };
 
 #endif // __NGINX_ATTACHMENT_METRIC_H__
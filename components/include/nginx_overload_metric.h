@@ -0,0 +1,88 @@
+// Copyright (C) 2022 Check Point Software Technologies Ltd. All rights reserved.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __NGINX_OVERLOAD_METRIC_H__
+#define __NGINX_OVERLOAD_METRIC_H__
+
+#include "generic_metric.h"
+
+class NginxOverloadEvent : public Event<NginxOverloadEvent>
+{
+public:
+    void
+    resetAllCounters()
+    {
+        skipped_response_body_chunks = 0;
+        capped_request_body_chunks = 0;
+        fail_open_verdicts = 0;
+    }
+
+    void setDegradationLevel(uint64_t _level) { degradation_level = _level; }
+    void setQueueUsage(uint64_t _queue_usage) { queue_usage = _queue_usage; }
+    void setVerdictLatency(double _verdict_latency) { verdict_latency = _verdict_latency; }
+    void setCPUUsage(double _cpu_usage) { cpu_usage = _cpu_usage; }
+    void addSkippedResponseBodyChunk() { skipped_response_body_chunks++; }
+    void addCappedRequestBodyChunk() { capped_request_body_chunks++; }
+    void addFailOpenVerdict() { fail_open_verdicts++; }
+
+    uint64_t getDegradationLevel() const { return degradation_level; }
+    uint64_t getQueueUsage() const { return queue_usage; }
+    double getVerdictLatency() const { return verdict_latency; }
+    double getCPUUsage() const { return cpu_usage; }
+    uint64_t getSkippedResponseBodyChunks() const { return skipped_response_body_chunks; }
+    uint64_t getCappedRequestBodyChunks() const { return capped_request_body_chunks; }
+    uint64_t getFailOpenVerdicts() const { return fail_open_verdicts; }
+
+private:
+    uint64_t degradation_level = 0;
+    uint64_t queue_usage = 0;
+    double verdict_latency = 0;
+    double cpu_usage = 0;
+    uint64_t skipped_response_body_chunks = 0;
+    uint64_t capped_request_body_chunks = 0;
+    uint64_t fail_open_verdicts = 0;
+};
+
+class NginxOverloadMetric
+        :
+    public GenericMetric,
+    public Listener<NginxOverloadEvent>
+{
+public:
+    void
+    upon(const NginxOverloadEvent &event) override
+    {
+        last_degradation_level.report(event.getDegradationLevel());
+        max_degradation_level.report(event.getDegradationLevel());
+        max_queue_usage.report(event.getQueueUsage());
+        max_verdict_latency.report(event.getVerdictLatency());
+        avg_verdict_latency.report(event.getVerdictLatency());
+        last_cpu_usage.report(event.getCPUUsage());
+        skipped_response_body_chunks.report(event.getSkippedResponseBodyChunks());
+        capped_request_body_chunks.report(event.getCappedRequestBodyChunks());
+        fail_open_verdicts.report(event.getFailOpenVerdicts());
+    }
+
+private:
+    MetricCalculations::LastReportedValue<uint64_t> last_degradation_level{this, "overloadDegradationLevelSample"};
+    MetricCalculations::Max<uint64_t> max_degradation_level{this, "overloadMaxDegradationLevelSample", 0};
+    MetricCalculations::Max<uint64_t> max_queue_usage{this, "overloadMaxQueueUsageSample", 0};
+    MetricCalculations::Max<double> max_verdict_latency{this, "overloadMaxVerdictLatencyUsecSample", 0};
+    MetricCalculations::Average<double> avg_verdict_latency{this, "overloadAverageVerdictLatencyUsecSample"};
+    MetricCalculations::LastReportedValue<double> last_cpu_usage{this, "overloadCpuSample"};
+    MetricCalculations::Counter skipped_response_body_chunks{this, "overloadSkippedResponseBodyChunksSum"};
+    MetricCalculations::Counter capped_request_body_chunks{this, "overloadCappedRequestBodyChunksSum"};
+    MetricCalculations::Counter fail_open_verdicts{this, "overloadFailOpenVerdictsSum"};
+};
+
+#endif // __NGINX_OVERLOAD_METRIC_H__
@@ -16,13 +16,92 @@
 
 #include <memory>
 #include <string>
+#include <functional>
+#include <algorithm>
 #include <map>
 #include <unordered_set>
+#include <vector>
 #include <sys/types.h>
 #include "i_pm_scan.h"
 
 class KissThinNFA;
 
+// Where a stream that is scanned chunk by chunk stands: the automaton state that the last chunk ended at, and
+// the number of bytes scanned so far. A state is resumable only by a PMHook prepared with the same patterns.
+class PMScanState
+{
+public:
+    // Number of bytes of the stream scanned so far, match offsets are relative to the stream start
+    uint getStreamOffset() const { return stream_offset; }
+
+    template <typename T>
+    void
+    serialize(T &ar)
+    {
+        ar(patterns_hash, bnfa_offset, stream_offset);
+    }
+
+private:
+    friend class PMHook;
+
+    size_t patterns_hash = 0;
+    int bnfa_offset = 0;
+    uint stream_offset = 0;
+};
+
+// The dense IDs of the patterns that matched, as a bitmap. The bitmap is allocated on the first match and kept by
+// clear(), so scanning clean buffers, or reusing the object, does not allocate.
+class PMMatchIds
+{
+public:
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+
+    bool
+    contains(uint id) const
+    {
+        return id / 64 < bits.size() && (bits[id / 64] & (uint64_t(1) << (id % 64))) != 0;
+    }
+
+    void
+    insert(uint id)
+    {
+        if (id / 64 >= bits.size()) bits.resize(id / 64 + 1, 0);
+        uint64_t &word = bits[id / 64];
+        uint64_t bit = uint64_t(1) << (id % 64);
+        if ((word & bit) != 0) return;
+        word |= bit;
+        count++;
+    }
+
+    void
+    clear()
+    {
+        if (count == 0) return;
+        std::fill(bits.begin(), bits.end(), 0);
+        count = 0;
+    }
+
+    // Calls func with each of the IDs, in ascending order
+    template <typename Func>
+    void
+    forEach(Func func) const
+    {
+        for (uint word_index = 0; word_index < bits.size(); word_index++) {
+            for (uint64_t word = bits[word_index]; word != 0; word &= word - 1) {
+                func(word_index * 64 + __builtin_ctzll(word));
+            }
+        }
+    }
+
+private:
+    friend class PMHook;
+
+    std::vector<uint64_t> bits;
+    size_t count = 0;
+    std::vector<std::pair<uint, uint>> raw_matches; // Reused by the scans, to avoid allocating on every match
+};
+
 class PMHook final : public I_PMScan
 {
 public:
@@ -30,17 +109,48 @@ public:
     ~PMHook();
 
     Maybe<void> prepare(const std::set<PMPattern> &patterns);
+    // Pattern IDs are the positions in the vector, starting at 1, so a caller that only appends patterns between
+    // preparations keeps the IDs it already has.
+    Maybe<void> prepare(const std::vector<PMPattern> &patterns);
     std::set<PMPattern> scanBuf(const Buffer &buf) const override;
+    // Adds the IDs of the patterns that matched to ids, without allocating when nothing matches
+    void scanBufIds(const Buffer &buf, PMMatchIds &ids) const;
     std::set<std::pair<uint, uint>> scanBufWithOffset(const Buffer &buf) const override;
     void scanBufWithOffsetLambda(const Buffer &buf, I_PMScan::CBFunction cb) const override;
 
+    // Scans the next chunk of a stream, starting at the state where the previous chunk ended, so patterns that
+    // span chunks are found without scanning earlier chunks again. The callback gets the stream offset of the
+    // last byte of each match and the ID of its pattern. A new state, or one that is not resumable by this hook,
+    // starts from the initial state at its current stream offset.
+    void scanStream(
+        const Buffer &buf,
+        PMScanState &state,
+        const std::function<void(uint, uint)> &cb
+    ) const;
+    bool isResumable(const PMScanState &state) const;
+
+    // IDs are dense, from 1 to getPatternsCount()
+    uint getPatternsCount() const { return patterns.size(); }
+    const PMPattern & getPattern(uint id) const { return patterns[id - 1]; }
+    Maybe<uint> getPatternId(const PMPattern &pattern) const;
+
+    // Keeps compiled pattern matchers in dir, by the patterns they are compiled from. prepare() maps the file it
+    // finds there instead of compiling, so processes that prepare the same patterns share one read-only copy.
+    // Files that were not prepared for a while are evicted. An empty dir turns this off. Without a call to this,
+    // the dir is data/pm_cache under the filesystem path, unless the patternMatcher.compiledCache.enabled agent
+    // setting is false.
+    static void setCompiledCacheDir(const std::string &dir);
+
     // Line may begin with ^ or $ sign to mark LSS is at begin/end of buffer.
     static Maybe<PMPattern> lineToPattern(const std::string &line);
     bool ok() const { return static_cast<bool>(handle); }
 
 private:
     std::shared_ptr<KissThinNFA> handle;
-    std::map<int, PMPattern> patterns;
+    std::vector<PMPattern> patterns; // Pattern ID n is at n - 1
+    std::map<PMPattern, uint> pattern_ids;
+    // Identifies the compiled patterns in the scan states of streams, never 0
+    size_t patterns_hash = 0;
 };
 
 #endif // __PM_HOOK_H__
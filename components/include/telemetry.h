@@ -204,4 +204,51 @@ private:
     MetricCalculations::LastReportedValue<int> all_assets{this, "numberOfProtectedAssetsSample"};
 };
 
+class WaapScanLatencyEvent : public Event<WaapScanLatencyEvent>
+{
+public:
+    enum class Stage { URL, HEADERS, REQUEST_BODY, ERROR_DISCLOSURE };
+
+    WaapScanLatencyEvent(Stage _stage, uint64_t _latency) : stage(_stage), latency(_latency) {};
+    Stage getStage() const { return stage; }
+    uint64_t getLatency() const { return latency; }
+private:
+    Stage stage;
+    uint64_t latency;
+};
+
+class WaapScanLatencyMetric : public GenericMetric, Listener<WaapScanLatencyEvent>
+{
+public:
+    void upon(const WaapScanLatencyEvent &event) override;
+private:
+    MetricCalculations::MetricMap<std::string, MetricCalculations::Histogram> scan_stage_latency{
+        MetricCalculations::Histogram(nullptr, ""),
+        this,
+        "scanStage",
+        "waapScanStageLatencyUsec"
+    };
+};
+
+class WaapValueCacheEvent : public Event<WaapValueCacheEvent>
+{
+public:
+    enum class Result { LOCAL_HIT, SHARED_HIT, MISS };
+
+    WaapValueCacheEvent(Result _result) : result(_result) {};
+    Result getResult() const { return result; }
+private:
+    Result result;
+};
+
+class WaapValueCacheMetric : public GenericMetric, Listener<WaapValueCacheEvent>
+{
+public:
+    void upon(const WaapValueCacheEvent &event) override;
+private:
+    MetricCalculations::Counter local_hits{this, "waapValueCacheLocalHitSum"};
+    MetricCalculations::Counter shared_hits{this, "waapValueCacheSharedHitSum"};
+    MetricCalculations::Counter misses{this, "waapValueCacheMissSum"};
+};
+
 #endif // __TELEMETRY_H__
@@ -16,6 +16,7 @@
 
 #include <vector>
 #include <string>
+#include <unordered_map>
 
 #include "http_inspection_events.h"
 #include "cereal/archives/json.hpp"
@@ -40,6 +41,7 @@ private:
         bool operator==(const UsersIdentifiersConfig &other) const;
         void load(cereal::JSONInputArchive &ar);
         bool isEqualSourceIdentifier(const std::string &other) const;
+        bool isEqualSourceIdentifier(const Buffer &other) const;
         const std::string & getSourceIdentifier() const { return source_identifier; }
         const std::vector<std::string> & getIdentifierValues() const { return identifier_values; }
 
@@ -48,7 +50,9 @@ private:
         std::vector<std::string> identifier_values;
     };
 
-    bool isHigherPriority(const std::string &current_identifier, const std::string &header_key) const;
+    // The index of the identifier in the priority order, or -1 if it is not a source identifier
+    int getIdentifierPriority(const std::string &identifier) const;
+    int getIdentifierPriority(const Buffer &header_key) const;
     void setIdentifierTopaqueCtx(const HttpHeader &header) const;
     void setCookieValuesToOpaqueCtx(const HttpHeader &header) const;
     void setJWTValuesToOpaqueCtx(const HttpHeader &header) const;
@@ -60,7 +64,11 @@ private:
     Buffer extractKeyValueFromCookie(const std::string &cookie_value, const std::string &key) const;
     Maybe<std::string> parseXForwardedFor(const std::string &str, ExtractType type) const;
 
+    void buildIdentifierPriorities();
+
     std::vector<UsersIdentifiersConfig> user_identifiers;
+    // Priorities of the identifiers, keyed by the hash of their lowercase names
+    std::unordered_multimap<size_t, uint> identifier_priorities;
 };
 
 #endif // __USER_IDENTIFIERS_CONFIG_H__
@@ -4,12 +4,27 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "pm_hook.h"
 
+// First tier matches of a context whose buffer is the kept tail of a stream followed by its new chunk.
+// Only the new chunk is scanned, resuming from where the previous chunk ended, and matches are carried for as long
+// as they are within the kept tail.
+class FirstTierStream
+{
+public:
+    void scan(const PMHook &hook, const Buffer &context_buffer, uint chunk_size, PMMatchIds &ids);
+
+private:
+    PMScanState scan_state;
+    std::vector<std::pair<uint, uint>> matches; // Stream offset of the first byte and pattern ID of each match
+};
+
 class I_FirstTierAgg
 {
 public:
+    // The hook may be prepared again when more patterns are added, keeping the IDs of the patterns it has
     virtual std::shared_ptr<PMHook> getHook(const std::string &context_name, const std::set<PMPattern> &patterns) = 0;
 
 protected:
@@ -8,6 +8,12 @@
 #include "parsed_context.h"
 #include "buffer.h"
 #include "context.h"
+#include "config.h"
+#include "ips_configuration.h"
+#include "i_first_tier_agg.h"
+
+class IPSSignatures;
+class SnortSignatures;
 
 class IPSEntry : public TableOpaqueSerialize<IPSEntry>, public Listener<ParsedContext>
 {
@@ -43,14 +49,26 @@ public:
     void setDrop() { is_drop = true; }
     bool isDrop() const { return is_drop; }
 
+    // The configuration handles are shared by all the entries. They're registered once, when the IPS component
+    // is initialized, and an entry gets the default configuration while they're not.
+    static void registerConfigHandles();
+    static void unregisterConfigHandles();
+
 private:
+
     std::map<std::string, Buffer> past_contexts;
+    std::map<std::string, FirstTierStream> ips_first_tier_streams; // Also used when the first tiers are shared
+    std::map<std::string, FirstTierStream> snort_first_tier_streams;
     std::set<std::string> flags;
     Context ctx;
     std::map<Buffer, Buffer> transaction_data;
     std::vector<std::pair<std::string, Buffer>> pending_contexts;
 
     bool is_drop = false;
+
+    static ConfigHandle<IPSConfiguration> ips_configurations;
+    static ConfigHandle<IPSSignatures> ips_protections;
+    static ConfigHandle<SnortSignatures> snort_protections;
 };
 
 #endif // __IPS_ENTRY_H__
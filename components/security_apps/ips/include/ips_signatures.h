@@ -419,18 +419,33 @@ public:
 
     /// \brief Check if the context is matched for prevention.
     /// \param context_buffer The context buffer.
-    bool isMatchedPrevent(const Buffer &context_buffer) const;
+    /// \param stream The first tier state of the stream, if the context buffer ends with its new chunk.
+    /// \param chunk_size The size of the new chunk.
+    bool isMatchedPrevent(const Buffer &context_buffer, FirstTierStream *stream = nullptr, uint chunk_size = 0) const;
+
+    /// \brief Check if the context is matched for prevention, given the first tier matches of its buffer.
+    /// \param context_buffer The context buffer.
+    /// \param first_tier_ids The IDs of the patterns of the first tier hook that matched the buffer.
+    bool isMatchedPrevent(const Buffer &context_buffer, const PMMatchIds &first_tier_ids) const;
 
     /// \brief Calculate the first tier for the given context name.
     /// \param ctx_name The context name.
     void calcFirstTier(const std::string &ctx_name);
 
-private:
     /// \brief Get the first tier matches for the buffer.
     /// \param buffer The buffer to match.
-    std::set<PMPattern> getFirstTierMatches(const Buffer &buffer) const;
+    /// \param stream The first tier state of the stream, if the buffer ends with its new chunk.
+    /// \param chunk_size The size of the new chunk.
+    /// \param ids The IDs of the first tier patterns that matched.
+    void getFirstTierMatches(const Buffer &buffer, FirstTierStream *stream, uint chunk_size, PMMatchIds &ids) const;
+
+    /// \brief Get the first tier hook. It is shared with the other signatures of the context.
+    const std::shared_ptr<PMHook> & getFirstTier() const { return first_tier; }
 
-    std::map<PMPattern, std::vector<IPSSignatureSubTypes::SignatureAndAction>> signatures_per_lss;
+private:
+    std::vector<IPSSignatureSubTypes::SignatureAndAction> signatures_with_lss;
+    std::map<PMPattern, std::vector<uint>> signatures_per_lss;
+    std::vector<std::vector<uint>> signatures_per_id; // Indexes of the signatures by first tier pattern ID
     std::vector<IPSSignatureSubTypes::SignatureAndAction> signatures_without_lss;
     std::shared_ptr<PMHook> first_tier;
 };
@@ -527,7 +542,43 @@ public:
     /// \brief Check if the context is matched for prevention.
     /// \param context_name The name of the context.
     /// \param context_buffer The context buffer.
-    bool isMatchedPrevent(const std::string &context_name, const Buffer &context_buffer) const;
+    /// \param stream The first tier state of the stream, if the context buffer ends with its new chunk.
+    /// \param chunk_size The size of the new chunk.
+    bool isMatchedPrevent(
+        const std::string &context_name,
+        const Buffer &context_buffer,
+        FirstTierStream *stream = nullptr,
+        uint chunk_size = 0
+    ) const;
+
+    /// \brief Check if the context is matched for prevention, given the first tier matches of its buffer.
+    /// \param context_name The name of the context.
+    /// \param context_buffer The context buffer.
+    /// \param first_tier_ids The IDs of the patterns of the context's first tier hook that matched the buffer.
+    bool isMatchedPrevent(
+        const std::string &context_name,
+        const Buffer &context_buffer,
+        const PMMatchIds &first_tier_ids
+    ) const;
+
+    /// \brief Get the first tier matches of the context buffer.
+    /// \param context_name The name of the context.
+    /// \param context_buffer The context buffer.
+    /// \param stream The first tier state of the stream, if the context buffer ends with its new chunk.
+    /// \param chunk_size The size of the new chunk.
+    /// \param ids The IDs of the first tier patterns that matched.
+    void getFirstTierMatches(
+        const std::string &context_name,
+        const Buffer &context_buffer,
+        FirstTierStream *stream,
+        uint chunk_size,
+        PMMatchIds &ids
+    ) const;
+
+    /// \brief Get the first tier hook of the context.
+    /// \param context_name The name of the context.
+    /// \return The hook, or nullptr if there are no signatures for the context.
+    std::shared_ptr<PMHook> getFirstTier(const std::string &context_name) const;
 
     /// \brief Check if the IPS signatures are empty.
     /// \return True if the signatures are empty, otherwise false.
@@ -605,7 +656,43 @@ public:
     /// \brief Check if the context is matched for prevention.
     /// \param context_name The name of the context.
     /// \param context_buffer The context buffer.
-    bool isMatchedPrevent(const std::string &context_name, const Buffer &context_buffer) const;
+    /// \param stream The first tier state of the stream, if the context buffer ends with its new chunk.
+    /// \param chunk_size The size of the new chunk.
+    bool isMatchedPrevent(
+        const std::string &context_name,
+        const Buffer &context_buffer,
+        FirstTierStream *stream = nullptr,
+        uint chunk_size = 0
+    ) const;
+
+    /// \brief Check if the context is matched for prevention, given the first tier matches of its buffer.
+    /// \param context_name The name of the context.
+    /// \param context_buffer The context buffer.
+    /// \param first_tier_ids The IDs of the patterns of the context's first tier hook that matched the buffer.
+    bool isMatchedPrevent(
+        const std::string &context_name,
+        const Buffer &context_buffer,
+        const PMMatchIds &first_tier_ids
+    ) const;
+
+    /// \brief Get the first tier matches of the context buffer.
+    /// \param context_name The name of the context.
+    /// \param context_buffer The context buffer.
+    /// \param stream The first tier state of the stream, if the context buffer ends with its new chunk.
+    /// \param chunk_size The size of the new chunk.
+    /// \param ids The IDs of the first tier patterns that matched.
+    void getFirstTierMatches(
+        const std::string &context_name,
+        const Buffer &context_buffer,
+        FirstTierStream *stream,
+        uint chunk_size,
+        PMMatchIds &ids
+    ) const;
+
+    /// \brief Get the first tier hook of the context.
+    /// \param context_name The name of the context.
+    /// \return The hook, or nullptr if there are no signatures for the context.
+    std::shared_ptr<PMHook> getFirstTier(const std::string &context_name) const;
 
     /// \brief Check if the Snort signatures are empty.
     /// \return True if the signatures are empty, otherwise false.
@@ -53,14 +53,17 @@ class IPSComp::Impl
     class SigsFirstTierAgg
     {
     public:
+        // New patterns are appended, so the pattern IDs that the hook already gave stay the same
         const shared_ptr<PMHook> &
         getHook(const set<PMPattern> &new_pat)
         {
             auto old_size = pats.size();
-            pats.insert(new_pat.begin(), new_pat.end());
+            for (auto &pat : new_pat) {
+                if (pats.insert(pat).second) pats_by_id.push_back(pat);
+            }
 
             if (pats.size() != old_size) {
-                if (!hook->prepare(pats).ok()) {
+                if (!hook->prepare(pats_by_id).ok()) {
                     reportConfigurationError("failed to compile first tier");
                 }
             }
@@ -70,6 +73,7 @@ class IPSComp::Impl
 
     private:
         set<PMPattern> pats;
+        vector<PMPattern> pats_by_id;
         shared_ptr<PMHook> hook = make_shared<PMHook>();
     };
 
@@ -98,12 +102,14 @@ public:
         registerListener();
         table = Singleton::Consume<I_Table>::by<IPSComp>();
         env = Singleton::Consume<I_Environment>::by<IPSComp>();
+        IPSEntry::registerConfigHandles();
     }
 
     void
     fini()
     {
         unregisterListener();
+        IPSEntry::unregisterConfigHandles();
     }
 
     void
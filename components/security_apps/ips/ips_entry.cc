@@ -29,6 +29,10 @@ static const IPSConfiguration default_conf(default_conf_mapping);
 static const IPSSignatures default_ips_sigs;
 static const SnortSignatures default_snort_sigs;
 
+ConfigHandle<IPSConfiguration> IPSEntry::ips_configurations;
+ConfigHandle<IPSSignatures> IPSEntry::ips_protections;
+ConfigHandle<SnortSignatures> IPSEntry::snort_protections;
+
 IPSEntry::IPSEntry() : TableOpaqueSerialize<IPSEntry>(this) {}
 
 void
@@ -45,18 +49,35 @@ IPSEntry::respond(const ParsedContext &parsed)
     dbgDebug(D_IPS) << "Entrying context " << name;
     dbgTrace(D_IPS) << "Context Content " << dumpHex(buf);
 
-    auto config = getConfigurationWithDefault(default_conf, "IPS", "IpsConfigurations").getContext(name);
+    auto config = ips_configurations.getWithDefault(default_conf).getContext(name);
+    uint chunk_size = buf.size();
+    FirstTierStream *ips_stream = nullptr;
+    FirstTierStream *snort_stream = nullptr;
     if (config.getType() == IPSConfiguration::ContextType::HISTORY) {
         buf = past_contexts[name] + buf;
+        // The first tier scans only the new chunk, continuing from where the previous chunks ended
+        ips_stream = &ips_first_tier_streams[name];
+        snort_stream = &snort_first_tier_streams[name];
     }
     ctx.registerValue(I_KeywordsRule::getKeywordsRuleTag(), name);
     ctx.registerValue(name, buf);
 
     ctx.activate();
-    auto &signatures = getConfigurationWithDefault(default_ips_sigs, "IPS", "IpsProtections");
-    bool should_drop = signatures.isMatchedPrevent(parsed.getName(), buf);
-    auto &snort_signatures = getConfigurationWithDefault(default_snort_sigs, "IPSSnortSigs", "SnortProtections");
-    should_drop |= snort_signatures.isMatchedPrevent(parsed.getName(), buf);
+    auto &signatures = ips_protections.getWithDefault(default_ips_sigs);
+    auto &snort_signatures = snort_protections.getWithDefault(default_snort_sigs);
+    bool should_drop;
+    auto first_tier = signatures.getFirstTier(name);
+    if (first_tier != nullptr && first_tier == snort_signatures.getFirstTier(name)) {
+        // The first tiers of both signature sets were aggregated into one hook - scan the buffer once, and give
+        // both sets the same matches
+        PMMatchIds first_tier_ids;
+        signatures.getFirstTierMatches(name, buf, ips_stream, chunk_size, first_tier_ids);
+        should_drop = signatures.isMatchedPrevent(name, buf, first_tier_ids);
+        should_drop |= snort_signatures.isMatchedPrevent(name, buf, first_tier_ids);
+    } else {
+        should_drop = signatures.isMatchedPrevent(name, buf, ips_stream, chunk_size);
+        should_drop |= snort_signatures.isMatchedPrevent(name, buf, snort_stream, chunk_size);
+    }
     ctx.deactivate();
 
     switch(config.getType()) {
@@ -82,6 +103,22 @@ IPSEntry::respond(const ParsedContext &parsed)
     return should_drop ? ParsedContextReply::DROP : ParsedContextReply::ACCEPT;
 }
 
+void
+IPSEntry::registerConfigHandles()
+{
+    ips_configurations = getConfigurationHandle<IPSConfiguration>("IPS", "IpsConfigurations");
+    ips_protections = getConfigurationHandle<IPSSignatures>("IPS", "IpsProtections");
+    snort_protections = getConfigurationHandle<SnortSignatures>("IPSSnortSigs", "SnortProtections");
+}
+
+void
+IPSEntry::unregisterConfigHandles()
+{
+    ips_configurations = ConfigHandle<IPSConfiguration>();
+    ips_protections = ConfigHandle<IPSSignatures>();
+    snort_protections = ConfigHandle<SnortSignatures>();
+}
+
 Buffer
 IPSEntry::getBuffer(const string &name) const
 {
@@ -658,8 +658,9 @@ IPSSignaturesPerContext::addSignature(const IPSSignatureSubTypes::SignatureAndAc
     }
 
     for (auto &pat : patterns) {
-        signatures_per_lss[pat].push_back(sig);
+        signatures_per_lss[pat].push_back(signatures_with_lss.size());
     }
+    signatures_with_lss.push_back(sig);
 }
 
 void
@@ -671,26 +672,97 @@ IPSSignaturesPerContext::calcFirstTier(const string &ctx_name)
     }
 
     first_tier = Singleton::Consume<I_FirstTierAgg>::by<IPSSignaturesPerContext>()->getHook(ctx_name, patterns);
+
+    signatures_per_id.clear();
+    for (const auto &lss_to_sig : signatures_per_lss) {
+        auto id = first_tier->getPatternId(lss_to_sig.first);
+        if (!id.ok()) continue;
+        if (*id >= signatures_per_id.size()) signatures_per_id.resize(*id + 1);
+        signatures_per_id[*id] = lss_to_sig.second;
+    }
 }
 
-set<PMPattern>
-IPSSignaturesPerContext::getFirstTierMatches(const Buffer &buffer) const
+void
+FirstTierStream::scan(const PMHook &hook, const Buffer &context_buffer, uint chunk_size, PMMatchIds &ids)
 {
-    return first_tier->ok() ? first_tier->scanBuf(buffer) : set<PMPattern>();
+    uint tail_size = context_buffer.size() - chunk_size;
+    auto add_match = [&] (uint offset, uint id) { matches.emplace_back(offset + 1 - hook.getPattern(id).size(), id); };
+
+    if (hook.isResumable(scan_state) && scan_state.getStreamOffset() >= tail_size) {
+        auto chunk = context_buffer;
+        chunk.keepTail(chunk_size);
+        hook.scanStream(chunk, scan_state, add_match);
+    } else {
+        // The kept tail was scanned by other patterns (or not at all) - scan it together with the chunk
+        dbgTrace(D_IPS) << "Scanning the kept tail of the stream, size " << tail_size;
+        scan_state = PMScanState();
+        matches.clear();
+        hook.scanStream(context_buffer, scan_state, add_match);
+    }
+
+    uint tail_start = scan_state.getStreamOffset() - context_buffer.size();
+    matches.erase(
+        remove_if(
+            matches.begin(),
+            matches.end(),
+            [tail_start] (const pair<uint, uint> &match) { return match.first < tail_start; }
+        ),
+        matches.end()
+    );
+
+    for (auto &match : matches) {
+        ids.insert(match.second);
+    }
+}
+
+void
+IPSSignaturesPerContext::getFirstTierMatches(
+    const Buffer &buffer,
+    FirstTierStream *stream,
+    uint chunk_size,
+    PMMatchIds &ids
+) const
+{
+    if (!first_tier->ok()) return;
+    if (stream != nullptr) {
+        stream->scan(*first_tier, buffer, chunk_size, ids);
+    } else {
+        first_tier->scanBufIds(buffer, ids);
+    }
+}
+
+bool
+IPSSignaturesPerContext::isMatchedPrevent(const Buffer &context_buffer, FirstTierStream *stream, uint chunk_size) const
+{
+    PMMatchIds first_tier_ids;
+    getFirstTierMatches(context_buffer, stream, chunk_size, first_tier_ids);
+    return isMatchedPrevent(context_buffer, first_tier_ids);
 }
 
 bool
-IPSSignaturesPerContext::isMatchedPrevent(const Buffer &context_buffer) const
+IPSSignaturesPerContext::isMatchedPrevent(const Buffer &context_buffer, const PMMatchIds &first_tier_ids) const
 {
-    auto first_tier_res = getFirstTierMatches(context_buffer);
+    // The hook is shared with other signatures of the context, only their own patterns are given to the signatures
+    auto has_signatures = [&] (uint id) { return id < signatures_per_id.size() && !signatures_per_id[id].empty(); };
+    set<PMPattern> first_tier_res;
+    first_tier_ids.forEach(
+        [&] (uint id) { if (has_signatures(id)) first_tier_res.insert(first_tier->getPattern(id)); }
+    );
 
-    for (auto &pat : first_tier_res) {
-        auto find = signatures_per_lss.find(pat);
-        if (find == signatures_per_lss.end()) continue;
-        for (auto &sig : find->second) {
-            if (sig.isMatchedPrevent(context_buffer, first_tier_res)) return true;
+    bool is_matched = false;
+    first_tier_ids.forEach(
+        [&] (uint id)
+        {
+            if (is_matched || !has_signatures(id)) return;
+            for (uint sig_index : signatures_per_id[id]) {
+                if (signatures_with_lss[sig_index].isMatchedPrevent(context_buffer, first_tier_res)) {
+                    is_matched = true;
+                    return;
+                }
+            }
         }
-    }
+    );
+    if (is_matched) return true;
 
     for (auto &sig : signatures_without_lss) {
         if (sig.isMatchedPrevent(context_buffer, first_tier_res)) return true;
@@ -753,7 +825,46 @@ IPSSignatures::load(cereal::JSONInputArchive &ar)
 }
 
 bool
-IPSSignatures::isMatchedPrevent(const string &context_name, const Buffer &context_buffer) const
+IPSSignatures::isMatchedPrevent(
+    const string &context_name,
+    const Buffer &context_buffer,
+    FirstTierStream *stream,
+    uint chunk_size
+) const
+{
+    PMMatchIds first_tier_ids;
+    getFirstTierMatches(context_name, context_buffer, stream, chunk_size, first_tier_ids);
+    return isMatchedPrevent(context_name, context_buffer, first_tier_ids);
+}
+
+void
+IPSSignatures::getFirstTierMatches(
+    const string &context_name,
+    const Buffer &context_buffer,
+    FirstTierStream *stream,
+    uint chunk_size,
+    PMMatchIds &ids
+) const
+{
+    auto curr_sig = signatures_per_context.find(context_name);
+    if (curr_sig == signatures_per_context.end()) return;
+    curr_sig->second.getFirstTierMatches(context_buffer, stream, chunk_size, ids);
+}
+
+shared_ptr<PMHook>
+IPSSignatures::getFirstTier(const string &context_name) const
+{
+    auto curr_sig = signatures_per_context.find(context_name);
+    if (curr_sig == signatures_per_context.end()) return nullptr;
+    return curr_sig->second.getFirstTier();
+}
+
+bool
+IPSSignatures::isMatchedPrevent(
+    const string &context_name,
+    const Buffer &context_buffer,
+    const PMMatchIds &first_tier_ids
+) const
 {
     auto curr_sig = signatures_per_context.find(context_name);
 
@@ -770,7 +881,7 @@ IPSSignatures::isMatchedPrevent(const string &context_name, const Buffer &contex
         ctx.registerValue<string>("practiceId", (*config).getPracticeId(), SOURCE);
     }
     ctx.registerValue<string>("practiceSubType", "Web IPS", SOURCE);
-    auto is_matched = curr_sig->second.isMatchedPrevent(context_buffer);
+    auto is_matched = curr_sig->second.isMatchedPrevent(context_buffer, first_tier_ids);
 
     return is_matched;
 }
@@ -835,7 +946,46 @@ SnortSignatures::load(cereal::JSONInputArchive &ar)
 }
 
 bool
-SnortSignatures::isMatchedPrevent(const string &context_name, const Buffer &context_buffer) const
+SnortSignatures::isMatchedPrevent(
+    const string &context_name,
+    const Buffer &context_buffer,
+    FirstTierStream *stream,
+    uint chunk_size
+) const
+{
+    PMMatchIds first_tier_ids;
+    getFirstTierMatches(context_name, context_buffer, stream, chunk_size, first_tier_ids);
+    return isMatchedPrevent(context_name, context_buffer, first_tier_ids);
+}
+
+void
+SnortSignatures::getFirstTierMatches(
+    const string &context_name,
+    const Buffer &context_buffer,
+    FirstTierStream *stream,
+    uint chunk_size,
+    PMMatchIds &ids
+) const
+{
+    auto curr_sig = signatures_per_context.find(context_name);
+    if (curr_sig == signatures_per_context.end()) return;
+    curr_sig->second.getFirstTierMatches(context_buffer, stream, chunk_size, ids);
+}
+
+shared_ptr<PMHook>
+SnortSignatures::getFirstTier(const string &context_name) const
+{
+    auto curr_sig = signatures_per_context.find(context_name);
+    if (curr_sig == signatures_per_context.end()) return nullptr;
+    return curr_sig->second.getFirstTier();
+}
+
+bool
+SnortSignatures::isMatchedPrevent(
+    const string &context_name,
+    const Buffer &context_buffer,
+    const PMMatchIds &first_tier_ids
+) const
 {
     auto curr_sig = signatures_per_context.find(context_name);
 
@@ -854,7 +1004,7 @@ SnortSignatures::isMatchedPrevent(const string &context_name, const Buffer &cont
         ctx.registerValue<string>("practiceId", (*config).getPracticeId(), SOURCE);
     }
     ctx.registerValue<string>("practiceSubType", "Web Snort", SOURCE);
-    auto is_matched = curr_sig->second.isMatchedPrevent(context_buffer);
+    auto is_matched = curr_sig->second.isMatchedPrevent(context_buffer, first_tier_ids);
 
     return is_matched;
 }
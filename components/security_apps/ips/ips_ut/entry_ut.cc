@@ -24,15 +24,26 @@ operator<<(ostream &os, const ParsedContextReply &action)
     return os << (action==ParsedContextReply::ACCEPT ? "ACCEPT" : "DROP");
 }
 
-class MockAgg : Singleton::Provide<I_FirstTierAgg>::SelfInterface
+// Like the component, aggregates the patterns of all the signatures of a context into one hook
+class MockFirstTierAgg : Singleton::Provide<I_FirstTierAgg>::SelfInterface
 {
     shared_ptr<PMHook>
-    getHook(const string &, const set<PMPattern> &pats) override
+    getHook(const string &context_name, const set<PMPattern> &pats) override
     {
-        auto hook = make_shared<PMHook>();
-        hook->prepare(pats);
+        auto &pats_by_id = patterns[context_name];
+        auto &hook = hooks[context_name];
+        if (hook == nullptr) hook = make_shared<PMHook>();
+
+        auto old_size = pats_by_id.size();
+        for (auto &pat : pats) {
+            if (find(pats_by_id.begin(), pats_by_id.end(), pat) == pats_by_id.end()) pats_by_id.push_back(pat);
+        }
+        if (pats_by_id.size() != old_size) hook->prepare(pats_by_id);
         return hook;
     }
+
+    map<string, vector<PMPattern>> patterns;
+    map<string, shared_ptr<PMHook>> hooks;
 };
 
 class EntryTest : public Test
@@ -41,6 +52,12 @@ public:
     EntryTest()
     {
         ON_CALL(table, getState(_)).WillByDefault(Return(ptr));
+        IPSEntry::registerConfigHandles();
+    }
+
+    ~EntryTest()
+    {
+        IPSEntry::unregisterConfigHandles();
     }
 
     void
@@ -131,7 +148,7 @@ private:
     AgentDetails details;
     NiceMock<MockLogging> logs;
     NiceMock<MockTable> table;
-    MockAgg mock_agg;
+    MockFirstTierAgg mock_agg;
 };
 
 TEST_F(EntryTest, basic_inherited_functions)
@@ -240,6 +257,95 @@ TEST_F(EntryTest, check_snort_signature_invoking)
     EXPECT_EQ(repondToContext("ddd", "HTTP_RESPONSE_BODY"), ParsedContextReply::ACCEPT);
 }
 
+TEST_F(EntryTest, check_signature_across_body_chunks)
+{
+    string signature =
+        "{"
+            "\"protectionMetadata\": {"
+                "\"protectionName\": \"Test1\","
+                "\"maintrainId\": \"101\","
+                "\"severity\": \"Medium High\","
+                "\"confidenceLevel\": \"Low\","
+                "\"performanceImpact\": \"Medium High\","
+                "\"lastUpdate\": \"20210420\","
+                "\"tags\": [],"
+                "\"cveList\": []"
+            "},"
+            "\"detectionRules\": {"
+                "\"type\": \"simple\","
+                "\"SSM\": \"\","
+                "\"keywords\": \"data: \\\"ddd\\\";\","
+                "\"context\": [\"HTTP_REQUEST_BODY\"]"
+            "}"
+        "}";
+    loadSignatures(signature);
+
+    // The signature is evaluated on the kept history of the body followed by its new chunk
+    auto respond_to_chunk = [&] (const string &chunk)
+    {
+        Buffer buf(chunk);
+        ScopedContext ctx;
+        ctx.registerValue("HTTP_REQUEST_BODY", entry.getBuffer("HTTP_REQUEST_BODY") + buf);
+        return entry.respond(ParsedContext(buf, "HTTP_REQUEST_BODY", 0));
+    };
+
+    EXPECT_EQ(respond_to_chunk("xxdd"), ParsedContextReply::ACCEPT);
+    // The pattern spans the chunks
+    EXPECT_EQ(respond_to_chunk("dyy"), ParsedContextReply::DROP);
+    // The match is still in the kept history of the body
+    EXPECT_EQ(respond_to_chunk("zzz"), ParsedContextReply::DROP);
+    EXPECT_EQ(respond_to_chunk(string(1000, 'z')), ParsedContextReply::DROP);
+    // The match is out of the kept history
+    EXPECT_EQ(respond_to_chunk("zzz"), ParsedContextReply::ACCEPT);
+}
+
+TEST_F(EntryTest, check_signatures_of_both_sets_across_body_chunks)
+{
+    auto signature = [] (const string &name, const string &data)
+    {
+        return
+            "{"
+                "\"protectionMetadata\": {"
+                    "\"protectionName\": \"" + name + "\","
+                    "\"maintrainId\": \"101\","
+                    "\"severity\": \"Medium High\","
+                    "\"confidenceLevel\": \"Low\","
+                    "\"performanceImpact\": \"Medium High\","
+                    "\"lastUpdate\": \"20210420\","
+                    "\"tags\": [],"
+                    "\"cveList\": []"
+                "},"
+                "\"detectionRules\": {"
+                    "\"type\": \"simple\","
+                    "\"SSM\": \"\","
+                    "\"keywords\": \"data: \\\"" + data + "\\\";\","
+                    "\"context\": [\"HTTP_REQUEST_BODY\"]"
+                "}"
+            "}";
+    };
+    // The IPS and Snort signatures share the first tier of the context, so each chunk is scanned once for both
+    loadSignatures(signature("IPS sig", "ddd"));
+    loadSnortSignatures(signature("Snort sig", "jjj"));
+
+    auto respond_to_chunk = [&] (const string &chunk)
+    {
+        Buffer buf(chunk);
+        ScopedContext ctx;
+        ctx.registerValue("HTTP_REQUEST_BODY", entry.getBuffer("HTTP_REQUEST_BODY") + buf);
+        return entry.respond(ParsedContext(buf, "HTTP_REQUEST_BODY", 0));
+    };
+
+    EXPECT_EQ(respond_to_chunk("xxjj"), ParsedContextReply::ACCEPT);
+    // The Snort pattern spans the chunks
+    EXPECT_EQ(respond_to_chunk("jyy"), ParsedContextReply::DROP);
+    EXPECT_EQ(respond_to_chunk(string(1000, 'z')), ParsedContextReply::DROP);
+    // The Snort match is out of the kept history
+    EXPECT_EQ(respond_to_chunk("zzz"), ParsedContextReply::ACCEPT);
+    EXPECT_EQ(respond_to_chunk("dd"), ParsedContextReply::ACCEPT);
+    // The IPS pattern spans the chunks
+    EXPECT_EQ(respond_to_chunk("dzz"), ParsedContextReply::DROP);
+}
+
 TEST_F(EntryTest, flags_test)
 {
     EXPECT_FALSE(entry.isFlagSet("CONTEXT_A"));
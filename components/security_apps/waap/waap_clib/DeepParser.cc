@@ -36,6 +36,7 @@
 #include "debug.h"
 #include "i_transaction.h"
 #include "agent_core_utilities.h"
+#include <array>
 
 USE_DEBUG_FLAG(D_WAAP_DEEP_PARSER);
 USE_DEBUG_FLAG(D_WAAP_ULIMITS);
@@ -47,9 +48,43 @@ USE_DEBUG_FLAG(D_OA_SCHEMA_UPDATER);
 #define CONTINUE_PARSING 1
 #define MAX_DEPTH        7
 
+// Parsers that can only apply to values that start with specific bytes. Looked up by the first byte of a value
+// to skip the detection of parsers that cannot apply to it.
+enum FirstByteParserCandidate
+{
+    FIRST_BYTE_JSON = 1,                // JSON, confluence macro and sensor data: '{' or '['
+    FIRST_BYTE_XML = 2,                 // '<'
+    FIRST_BYTE_SCREENED_JSON = 4,       // '"' (see Waap::Util::isScreenedJson())
+    FIRST_BYTE_PHP_SERIALIZED = 8       // first bytes of the php_serialize_identifier signature
+};
+
+static std::array<uint8_t, 256>
+buildFirstByteParserCandidates()
+{
+    std::array<uint8_t, 256> candidates{};
+    candidates['{'] |= FIRST_BYTE_JSON;
+    candidates['['] |= FIRST_BYTE_JSON;
+    candidates['<'] |= FIRST_BYTE_XML;
+    candidates['"'] |= FIRST_BYTE_SCREENED_JSON;
+    for (unsigned char ch : std::string("NibdsOoCcRra")) {
+        candidates[ch] |= FIRST_BYTE_PHP_SERIALIZED;
+    }
+    return candidates;
+}
+
+static uint8_t
+getFirstByteParserCandidates(const std::string &value)
+{
+    static const std::array<uint8_t, 256> candidates = buildFirstByteParserCandidates();
+    return value.empty() ? 0 : candidates[static_cast<unsigned char>(value[0])];
+}
+
 DeepParser::DeepParser(
     std::shared_ptr<WaapAssetState> pWaapAssetState, IParserReceiver &receiver, IWaf2Transaction *pTransaction
 ) :
+    m_arena(),
+    kv_pairs(&m_arena),
+    m_keywordInfo(&m_arena),
     m_key("deep_parser"),
     m_pWaapAssetState(pWaapAssetState),
     m_pTransaction(pTransaction),
@@ -57,7 +92,8 @@ DeepParser::DeepParser(
     m_depth(0),
     m_splitRefs(0),
     m_deepParserFlag(false),
-    m_splitTypesStack(),
+    m_splitTypesStack(SplitTypesDeque(&m_arena)),
+    m_parsersDeque(&m_arena),
     m_multipart_boundary(""),
     m_globalMaxObjectDepth(std::numeric_limits<size_t>::max()),
     m_localMaxObjectDepth(0),
@@ -186,13 +222,14 @@ DeepParser::onKv(const char *k, size_t k_len, const char *v, size_t v_len, int f
     }
     // Maintain dot-delimited key stack
 
-    bool isUrlParamPayload = (m_key.first().size() == 9 && m_key.first() == "url_param");
-    bool isRefererParamPayload = (m_key.first().size() == 13 && m_key.first() == "referer_param");
-    bool isRefererPayload = (m_key.first().size() == 7 && m_key.first().find("referer") == 0);
-    bool isUrlPayload = (m_key.first().size() == 3 && m_key.first().find("url") == 0);
-    bool isHeaderPayload = (m_key.first().size() == 6 && m_key.first() == "header");
-    bool isCookiePayload = (m_key.first().size() == 6 && m_key.first() == "cookie");
-    bool isBodyPayload = (m_key.first().size() == 4 && m_key.first() == "body");
+    ScanStage scanStage = m_key.firstStage();
+    bool isUrlParamPayload = (scanStage == ScanStage::URL_PARAM);
+    bool isRefererParamPayload = (scanStage == ScanStage::REFERER_PARAM);
+    bool isRefererPayload = (scanStage == ScanStage::REFERER);
+    bool isUrlPayload = (scanStage == ScanStage::URL);
+    bool isHeaderPayload = (scanStage == ScanStage::HEADER);
+    bool isCookiePayload = (scanStage == ScanStage::COOKIE);
+    bool isBodyPayload = (scanStage == ScanStage::BODY);
 
 
     // If csrf/antibot cookie - send to Waf2Transaction for collection of cookie value.
@@ -268,7 +305,11 @@ DeepParser::onKv(const char *k, size_t k_len, const char *v, size_t v_len, int f
         if ((k_len > 0 || v_len > 0) && !isHeaderPayload && !isUrlPayload && !isRefererPayload &&
             !isRefererParamPayload && !isCookiePayload) {
             dbgTrace(D_WAAP_DEEP_PARSER) << " kv_pairs.push_back";
-            kv_pairs.push_back(std::make_pair(std::string(k, k_len), std::string(v, v_len)));
+            kv_pairs.emplace_back(
+                std::piecewise_construct,
+                std::forward_as_tuple(k, k_len),
+                std::forward_as_tuple(v, v_len)
+            );
         }
     }
 
@@ -445,7 +486,7 @@ DeepParser::onKv(const char *k, size_t k_len, const char *v, size_t v_len, int f
     }
 
     if (flags & BUFFERED_RECEIVER_F_FIRST && offset < 0 && valueStats.hasPercent &&
-        m_key.first().size() == 6 && m_key.first() == "cookie") {
+        m_key.firstStage() == ScanStage::COOKIE) {
         dbgTrace(D_WAAP_DEEP_PARSER)
             << "1st pass of createInternalParser() failed. "
             << "Will try to decode percent-encoded data and repeate search for parser";
@@ -997,7 +1038,7 @@ size_t parser_depth
         dbgTrace(D_WAAP_DEEP_PARSER)
             << "Detected param=JSON,"
             << " still starting to parse an Url-encoded-like data due to possible tail";
-        m_parsersDeque.push_back(std::make_shared<BufferedParser<ParserPairs>>(*this, parser_depth + 1));
+        m_parsersDeque.push_back(createParser<ParserPairs>(*this, parser_depth + 1));
         ret_val = 0;
     }
     return ret_val;
@@ -1114,9 +1155,11 @@ DeepParser::createInternalParser(
         }
     }
 
-    if (Waap::Util::isScreenedJson(cur_val)) {
+    uint8_t firstByteCandidates = getFirstByteParserCandidates(cur_val);
+
+    if ((firstByteCandidates & FIRST_BYTE_SCREENED_JSON) && Waap::Util::isScreenedJson(cur_val)) {
         dbgTrace(D_WAAP_DEEP_PARSER) << "Starting to parse screened JSON";
-        m_parsersDeque.push_back(std::make_shared<BufferedParser<ParserScreenedJson>>(*this, parser_depth + 1));
+        m_parsersDeque.push_back(createParser<ParserScreenedJson>(*this, parser_depth + 1));
         offset = 0;
         return offset;
     }
@@ -1131,9 +1174,10 @@ DeepParser::createInternalParser(
     //Detect sensor_data format in body and just use dedicated filter for it
     if ((m_depth == 1)
         && isBodyPayload
+        && (firstByteCandidates & FIRST_BYTE_JSON)
         && Waap::Util::detectKnownSource(cur_val) ==  Waap::Util::SOURCE_TYPE_SENSOR_DATA) {
         m_parsersDeque.push_back(
-            std::make_shared<BufferedParser<ParserKnownBenignSkipper>>(
+            createParser<ParserKnownBenignSkipper>(
                 *this,
                 parser_depth + 1,
                 Waap::Util::SOURCE_TYPE_SENSOR_DATA
@@ -1150,7 +1194,7 @@ DeepParser::createInternalParser(
         offset = Waap::Util::definePrefixedJson(cur_val);
         if (offset >= 0) {
             m_parsersDeque.push_back(
-                std::make_shared<BufferedParser<ParserJson>>(
+                createParser<ParserJson>(
                     *this,
                     parser_depth + 1,
                     m_pTransaction
@@ -1226,12 +1270,13 @@ DeepParser::createInternalParser(
         ) {
         // HTML detected
         dbgTrace(D_WAAP_DEEP_PARSER) << "Starting to parse an HTML file";
-        m_parsersDeque.push_back(std::make_shared<BufferedParser<ParserHTML>>(*this, parser_depth + 1));
+        m_parsersDeque.push_back(createParser<ParserHTML>(*this, parser_depth + 1));
         offset = 0;
-    } else if (cur_val.size() > 0 && signatures->php_serialize_identifier.hasMatch(cur_val)) {
+    } else if ((firstByteCandidates & FIRST_BYTE_PHP_SERIALIZED)
+        && signatures->php_serialize_identifier.hasMatch(cur_val)) {
         // PHP value detected
         dbgTrace(D_WAAP_DEEP_PARSER) << "Starting to parse phpSerializedData";
-        m_parsersDeque.push_back(std::make_shared<BufferedParser<PHPSerializedDataParser>>(*this, parser_depth + 1));
+        m_parsersDeque.push_back(createParser<PHPSerializedDataParser>(*this, parser_depth + 1));
         offset = 0;
     } else if (isPotentialGqlQuery
         && cur_val.size() > 0
@@ -1240,20 +1285,18 @@ DeepParser::createInternalParser(
         // Graphql value detected
         dbgTrace(D_WAAP_DEEP_PARSER) << "Starting to parse graphql";
 
-        m_parsersDeque.push_back(std::make_shared<BufferedParser<ParserGql>>(
+        m_parsersDeque.push_back(createParser<ParserGql>(
             *this,
             parser_depth + 1,
             m_pTransaction));
 
         offset = 0;
-    } else if (cur_val.length() > 0
-        && (cur_val[0] == '[' || cur_val[0] == '{')
-        ) {
+    } else if (firstByteCandidates & FIRST_BYTE_JSON) {
         boost::smatch confulence_match;
         dbgTrace(D_WAAP_DEEP_PARSER) << "attempt to find confluence of JSON by '{' or '['";
         if (NGEN::Regex::regexMatch(__FILE__, __LINE__, cur_val, confulence_match, signatures->confluence_macro_re)) {
             dbgTrace(D_WAAP_DEEP_PARSER) << "Starting to parse a confluence macro";
-            m_parsersDeque.push_back(std::make_shared<BufferedParser<ParserConfluence>>(*this, parser_depth + 1));
+            m_parsersDeque.push_back(createParser<ParserConfluence>(*this, parser_depth + 1));
             offset = 0;
         } else {
             dbgTrace(D_WAAP_DEEP_PARSER) << "attempt to find JSON by '{' or '['";
@@ -1263,7 +1306,7 @@ DeepParser::createInternalParser(
                     // We have JSOn but it %-encoded, first start percent decoding for it. Very narrow case
                     dbgTrace(D_WAAP_DEEP_PARSER) << "Starting to parse a JSON file from percent decoding";
                     m_parsersDeque.push_back(
-                        std::make_shared<BufferedParser<ParserPercentEncode>>(*this, parser_depth + 1)
+                        createParser<ParserPercentEncode>(*this, parser_depth + 1)
                     );
                     offset = 0;
                 } else {
@@ -1272,7 +1315,7 @@ DeepParser::createInternalParser(
                     // but only if the JSON is passed in body and on the top level.
                     bool should_collect_for_oa_schema_updater = false;
 
-                    m_parsersDeque.push_back(std::make_shared<BufferedParser<ParserJson>>(
+                    m_parsersDeque.push_back(createParser<ParserJson>(
                         *this,
                         parser_depth + 1,
                         m_pTransaction,
@@ -1285,7 +1328,7 @@ DeepParser::createInternalParser(
     }
     if (offset < 0) {
         if (cur_val.length() > 4
-            && (cur_val[0] == '<')
+            && (firstByteCandidates & FIRST_BYTE_XML)
             && !isRefererPayload
             && !isRefererParamPayload
             && !isUrlPayload
@@ -1296,53 +1339,53 @@ DeepParser::createInternalParser(
             // Also, XML is not scanned in payload coming from URL or URL parameters, or if the
             // payload starts with one of known HTML tags.
             dbgTrace(D_WAAP_DEEP_PARSER) << "Starting to parse an XML file";
-            m_parsersDeque.push_back(std::make_shared<BufferedParser<ParserXML>>(*this, parser_depth + 1));
+            m_parsersDeque.push_back(createParser<ParserXML>(*this, parser_depth + 1));
             offset = 0;
         } else if (m_depth == 1 && isBodyPayload && !m_multipart_boundary.empty()) {
             dbgTrace(D_WAAP_DEEP_PARSER) << "Starting to parse a multipart file";
-            m_parsersDeque.push_back(std::make_shared<BufferedParser<ParserMultipartForm>>(
+            m_parsersDeque.push_back(createParser<ParserMultipartForm>(
                 *this, parser_depth + 1, m_multipart_boundary.c_str(), m_multipart_boundary.length()
             ));
             offset = 0;
         } else if (isTopData && (isBinaryType || m_pWaapAssetState->isBinarySampleType(cur_val))) {
             if (isPDFDetected(cur_val)) {
                 dbgTrace(D_WAAP_DEEP_PARSER) << "Starting to parse a PDF file";
-                m_parsersDeque.push_back(std::make_shared<BufferedParser<ParserPDF>>(*this, parser_depth + 1));
+                m_parsersDeque.push_back(createParser<ParserPDF>(*this, parser_depth + 1));
                 offset = 0;
             } else {
                 Waap::Util::BinaryFileType fileType = ParserBinaryFile::detectBinaryFileHeader(cur_val);
                 if (fileType != Waap::Util::BinaryFileType::FILE_TYPE_NONE) {
                     dbgTrace(D_WAAP_DEEP_PARSER) << "Starting to parse a known binary file (type=" << fileType << ")";
                     m_parsersDeque.push_back(
-                        std::make_shared<BufferedParser<ParserBinaryFile>>(*this, parser_depth + 1, false, fileType)
+                        createParser<ParserBinaryFile>(*this, parser_depth + 1, false, fileType)
                     );
                     offset = 0;
                 } else {
                     dbgTrace(D_WAAP_DEEP_PARSER) << "Starting to parse a binary file";
-                    m_parsersDeque.push_back(std::make_shared<BufferedParser<ParserBinary>>(*this, parser_depth + 1));
+                    m_parsersDeque.push_back(createParser<ParserBinary>(*this, parser_depth + 1));
                     offset = 0;
                 }
             }
         } else if (b64FileType != Waap::Util::BinaryFileType::FILE_TYPE_NONE) {
             dbgTrace(D_WAAP_DEEP_PARSER) << "Starting to parse a known binary file, base64 encoded";
             m_parsersDeque.push_back(
-                std::make_shared<BufferedParser<ParserBinaryFile>>(*this, parser_depth + 1, true, b64FileType)
+                createParser<ParserBinaryFile>(*this, parser_depth + 1, true, b64FileType)
             );
             offset = 0;
         }
     }
-    bool isCockiePapameter = m_key.depth() == 2 && m_key.first().size() == 6 && m_key.first() == "cookie";
+    bool isCockiePapameter = m_key.depth() == 2 && m_key.firstStage() == ScanStage::COOKIE;
     if (offset < 0) {
         if (isPipesType) {
             dbgTrace(D_WAAP_DEEP_PARSER) << "Starting to parse pipes, positional: " << isKeyValDelimited;
             if (isKeyValDelimited) {
                 m_parsersDeque.push_back(
-                    std::make_shared<BufferedParser<ParserUrlEncode>>(*this, parser_depth + 1, '|')
+                    createParser<ParserUrlEncode>(*this, parser_depth + 1, '|')
                 );
                 offset = 0;
             } else {
                 m_parsersDeque.push_back(
-                    std::make_shared<BufferedParser<ParserDelimiter>>(*this, parser_depth + 1, '|', "pipe")
+                    createParser<ParserDelimiter>(*this, parser_depth + 1, '|', "pipe")
                 );
                 offset = 0;
             }
@@ -1350,12 +1393,12 @@ DeepParser::createInternalParser(
             dbgTrace(D_WAAP_DEEP_PARSER) << "Starting to parse a semicolon, positional: " << isKeyValDelimited;
             if (isKeyValDelimited) {
                 m_parsersDeque.push_back(
-                    std::make_shared<BufferedParser<ParserUrlEncode>>(*this, parser_depth + 1, ';')
+                    createParser<ParserUrlEncode>(*this, parser_depth + 1, ';')
                 );
                 offset = 0;
             } else {
                 m_parsersDeque.push_back(
-                    std::make_shared<BufferedParser<ParserDelimiter>>(*this, parser_depth + 1, ';', "sem")
+                    createParser<ParserDelimiter>(*this, parser_depth + 1, ';', "sem")
                 );
                 offset = 0;
             }
@@ -1363,12 +1406,12 @@ DeepParser::createInternalParser(
             dbgTrace(D_WAAP_DEEP_PARSER) << "Starting to parse an asterisk, positional: " << isKeyValDelimited;
             if (isKeyValDelimited) {
                 m_parsersDeque.push_back(
-                    std::make_shared<BufferedParser<ParserUrlEncode>>(*this, parser_depth + 1, '*')
+                    createParser<ParserUrlEncode>(*this, parser_depth + 1, '*')
                 );
                 offset = 0;
             } else {
                 m_parsersDeque.push_back(
-                    std::make_shared<BufferedParser<ParserDelimiter>>(*this, parser_depth + 1, '*', "asterisk")
+                    createParser<ParserDelimiter>(*this, parser_depth + 1, '*', "asterisk")
                 );
                 offset = 0;
             }
@@ -1376,12 +1419,12 @@ DeepParser::createInternalParser(
             dbgTrace(D_WAAP_DEEP_PARSER) << "Starting to parse a comma, positional: " << isKeyValDelimited;
             if (isKeyValDelimited) {
                 m_parsersDeque.push_back(
-                    std::make_shared<BufferedParser<ParserUrlEncode>>(*this, parser_depth + 1, ',')
+                    createParser<ParserUrlEncode>(*this, parser_depth + 1, ',')
                 );
                 offset = 0;
             } else {
                 m_parsersDeque.push_back(
-                    std::make_shared<BufferedParser<ParserDelimiter>>(*this, parser_depth + 1, ',', "comma")
+                    createParser<ParserDelimiter>(*this, parser_depth + 1, ',', "comma")
                 );
                 offset = 0;
             }
@@ -1389,12 +1432,12 @@ DeepParser::createInternalParser(
             dbgTrace(D_WAAP_DEEP_PARSER) << "Starting to parse a ampersand, positional: " << isKeyValDelimited;
             if (isKeyValDelimited) {
                 m_parsersDeque.push_back(
-                    std::make_shared<BufferedParser<ParserUrlEncode>>(*this, parser_depth + 1, '&')
+                    createParser<ParserUrlEncode>(*this, parser_depth + 1, '&')
                 );
                 offset = 0;
             } else {
                 m_parsersDeque.push_back(
-                    std::make_shared<BufferedParser<ParserDelimiter>>(*this, parser_depth + 1, '&', "amp")
+                    createParser<ParserDelimiter>(*this, parser_depth + 1, '&', "amp")
                 );
                 offset = 0;
             }
@@ -1420,7 +1463,7 @@ DeepParser::createInternalParser(
             if (offset >= 0 && delta <= 0) {
                 dbgTrace(D_WAAP_DEEP_PARSER) << " Starting to parse an Url-encoded data after removing prefix";
                 m_parsersDeque.push_back(
-                    std::make_shared<BufferedParser<ParserUrlEncode>>(
+                    createParser<ParserUrlEncode>(
                         *this,
                         parser_depth + 1,
                         '&',
@@ -1435,7 +1478,7 @@ DeepParser::createInternalParser(
                 ) {
                     dbgTrace(D_WAAP_DEEP_PARSER) << " Starting to parse an Url-encoded data - pairs detected";
                     m_parsersDeque.push_back(
-                        std::make_shared<BufferedParser<ParserUrlEncode>>(
+                        createParser<ParserUrlEncode>(
                             *this,
                             parser_depth + 1,
                             '&',
@@ -1446,7 +1489,7 @@ DeepParser::createInternalParser(
                 } else if (valueStats.isUrlEncoded && !Waap::Util::testUrlBadUtf8Evasion(cur_val)) {
                     dbgTrace(D_WAAP_DEEP_PARSER) << "Starting to parse an percent decoding";
                     m_parsersDeque.push_back(
-                        std::make_shared<BufferedParser<ParserPercentEncode>>(*this, parser_depth + 1)
+                        createParser<ParserPercentEncode>(*this, parser_depth + 1)
                     );
                     offset = 0;
                     return offset;
@@ -1461,7 +1504,7 @@ DeepParser::createInternalParser(
             ) {
                 dbgTrace(D_WAAP_DEEP_PARSER) << " Starting to parse an Url-encoded data - pairs detected";
                 m_parsersDeque.push_back(
-                    std::make_shared<BufferedParser<ParserUrlEncode>>(
+                    createParser<ParserUrlEncode>(
                         *this,
                         parser_depth + 1,
                         '&',
@@ -1472,7 +1515,7 @@ DeepParser::createInternalParser(
             } else if (valueStats.isUrlEncoded && !Waap::Util::testUrlBadUtf8Evasion(cur_val)) {
                 dbgTrace(D_WAAP_DEEP_PARSER) << "Starting to parse an percent decoding";
                 m_parsersDeque.push_back(
-                    std::make_shared<BufferedParser<ParserPercentEncode>>(*this, parser_depth + 1)
+                    createParser<ParserPercentEncode>(*this, parser_depth + 1)
                 );
                 offset = 0;
                 return offset;
@@ -1509,7 +1552,7 @@ DeepParser::apiProcessKey(const char *v, size_t v_len)
         return;
     }
 
-    m_keywordInfo.push_back(KeywordInfo(kwType, kwFullName, v, v_len));
+    m_keywordInfo.push_back(KeywordInfo(kwType, kwFullName, v, v_len, &m_arena));
 }
 
 // TODO:: maybe convert this splitter to Parser-derived class?
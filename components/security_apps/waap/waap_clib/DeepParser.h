@@ -20,11 +20,16 @@
 #include "Waf2Regex.h"
 #include "Waf2Util.h"
 #include "maybe_res.h"
+#include "TransactionArena.h"
 #include <deque>
+#include <stack>
 
 // Deep (recursively) parses/dissects parameters based on input stream
 class DeepParser : public IParserReceiver
 {
+    // Short-lived allocations of the transaction. Declared first, so it outlives every member that allocates from it.
+    Waap::TransactionArena m_arena;
+
 public:
     DeepParser(std::shared_ptr<WaapAssetState> pWaapAssetState, IParserReceiver &receiver,
         IWaf2Transaction* pTransaction);
@@ -48,24 +53,26 @@ public:
     const std::string getActualParser(size_t parser_depth) const;
     bool isWBXmlData() const;
     Maybe<std::string> getSplitType() const;
-    std::vector<std::pair<std::string, std::string> > kv_pairs;
+    typedef std::pmr::vector<std::pair<std::pmr::string, std::pmr::string>> KvPairs;
+    KvPairs kv_pairs;
 
     // Represents information stored per-keyword
     struct KeywordInfo
     {
-        std::string type;
-        std::string name;
-        std::string val;
+        std::pmr::string type;
+        std::pmr::string name;
+        std::pmr::string val;
         KeywordInfo() {}
 
         KeywordInfo(
             const std::string &type,
             const std::string &name,
             const char *v,
-            size_t v_len) :
-                type(type),
-                name(name),
-                val(std::string(v, v_len))
+            size_t v_len,
+            std::pmr::memory_resource *resource) :
+                type(type.data(), type.size(), resource),
+                name(name.data(), name.size(), resource),
+                val(v, v_len, resource)
         {
         }
 
@@ -74,25 +81,26 @@ public:
             return val.size();
         }
 
-        const std::string &getName() const
+        const std::pmr::string &getName() const
         {
             return name;
         }
 
-        const std::string &getType() const
+        const std::pmr::string &getType() const
         {
             return type;
         }
 
         // Return the value itself
-        const std::string &getValue() const
+        const std::pmr::string &getValue() const
         {
             return val;
         }
     };
 
     // KeywordInfo maintained for each keyword name
-    std::vector<KeywordInfo> m_keywordInfo;
+    typedef std::pmr::vector<KeywordInfo> KeywordInfos;
+    KeywordInfos m_keywordInfo;
 
     KeyStack m_key;
     int getShiftInUrlEncodedBuffer(const ValueStatsAnalyzer &valueStats, std::string &cur_val);
@@ -180,9 +188,24 @@ private:
     void setLocalMaxObjectDepth(size_t depth) { m_localMaxObjectDepth = depth; }
     void setGlobalMaxObjectDepthReached() { m_globalMaxObjectDepthReached = true; }
     bool isPDFDetected(const std::string &cur_val) const;
+
+    // Creates a parser, allocated together with its reference count from the transaction arena
+    template<typename ParserType, typename ...Args>
+    std::shared_ptr<ParserBase> createParser(Args &&...args)
+    {
+        return std::allocate_shared<BufferedParser<ParserType>>(
+            std::pmr::polymorphic_allocator<ParserBase>(&m_arena),
+            std::forward<Args>(args)...
+        );
+    }
+
+    typedef std::tuple<size_t, size_t, std::string> SplitType; // depth, splitIndex, splitType
+    typedef std::pmr::deque<SplitType> SplitTypesDeque;
+    typedef std::pmr::deque<std::shared_ptr<ParserBase>> ParsersDeque;
+
     bool m_deepParserFlag;
-    std::stack<std::tuple<size_t, size_t, std::string>> m_splitTypesStack; // depth, splitIndex, splitType
-    std::deque<std::shared_ptr<ParserBase>> m_parsersDeque;
+    std::stack<SplitType, SplitTypesDeque> m_splitTypesStack;
+    ParsersDeque m_parsersDeque;
     std::string m_multipart_boundary;
     size_t m_globalMaxObjectDepth;
     size_t m_localMaxObjectDepth;
@@ -20,10 +20,13 @@
 USE_DEBUG_FLAG(D_WAAP);
 
 KeyStack::KeyStack(const char* name)
-    :m_name(name), m_nameDepth(0) {
+    :m_name(name), m_nameDepth(0), m_firstStage(ScanStage::OTHER) {
 }
 
 void KeyStack::push(const char* subkey, size_t subkeySize, bool countDepth) {
+    if (m_stack.empty()) {
+        m_firstStage = getScanStage(subkey, subkeySize);
+    }
     m_stack.push_back(m_key.size());
 
     // Prefix all subkeys (except the first) with '.'
@@ -65,6 +68,9 @@ void KeyStack::pop(const char* log, bool countDepth) {
     // Remove last subkey.
     m_key.erase(m_stack.back());
     m_stack.pop_back();
+    if (m_stack.empty()) {
+        m_firstStage = ScanStage::OTHER;
+    }
     dbgTrace(D_WAAP)
         << "KeyStack("
         << m_name
@@ -18,6 +18,8 @@
 #include <string>
 #include <vector>
 
+#include "ScanStage.h"
+
 // Represent string (key) that is concatenation of  substrings (subkeys) separated by '.' character.
 // Mostly emulates API of C++ std::string class, with addition of push() and pop() methods
 // that append individual subkey and delete last subkey from the string efficiently.
@@ -27,7 +29,7 @@ public:
     void push(const char *subkey, size_t subkeySize, bool countDepth=true);
     void pop(const char* log, bool countDepth=true);
     bool empty() const { return m_key.empty(); }
-    void clear() { m_key.clear(); m_stack.clear(); }
+    void clear() { m_key.clear(); m_stack.clear(); m_firstStage = ScanStage::OTHER; }
     void print(std::ostream &os) const;
     size_t depth() const { return m_nameDepth; }
     size_t size() const {
@@ -59,6 +61,8 @@ public:
 
         return m_key.substr(m_stack[1] + 1);
     }
+    // The scan stage of the first subkey, classified once when it is pushed
+    ScanStage firstStage() const { return m_firstStage; }
     const std::string first() const {
         if (m_stack.size() == 0) {
             return "";
@@ -77,6 +81,7 @@ private:
     std::vector<size_t> m_stack;    // position of individual key name starts in m_key,
                                     // used to backtrack 1 key at a time.
     int m_nameDepth;
+    ScanStage m_firstStage;
 };
 
 #endif // __KEYSTACK_H__0a8039e6
@@ -47,7 +47,7 @@ int BufferedReceiver::onKey(const char *k, size_t k_len)
         << "\n\t parser_depth = "
         << m_parser_depth;
     if (m_key.size() + k_len < MAX_KEY_SIZE) {
-        m_key += std::string(k, k_len);
+        m_key.append(k, k_len);
     }
 
     return 0;
@@ -71,7 +71,7 @@ int BufferedReceiver::onValue(const char *v, size_t v_len)
     while (v_len > 0) {
         // Move data from buffer v to accumulated m_value string in an attempt to fill m_value to its max size
         size_t bytesToFill = std::min(v_len, MAX_PROCESSING_BUFFER_SIZE - m_value.size());
-        m_value += std::string(v, bytesToFill);
+        m_value.append(v, bytesToFill);
         // Update v and v_len (input buffer) to reflect that we already consumed part (or all) of it
         v += bytesToFill;
         v_len -= bytesToFill;
@@ -13,6 +13,45 @@
 
 #include "ScanResult.h"
 
+#include <unordered_map>
+
+// Process-wide pool of the strings referenced by cached scan results. It is never cleared, since cached results
+// may reference any of its strings, so its size is capped against values that generate unique keywords.
+class ScanStringPool
+{
+public:
+    static const uint32_t max_size = 64 * 1024;
+
+    static ScanStringPool &
+    getInstance()
+    {
+        static ScanStringPool instance;
+        return instance;
+    }
+
+    // Returns the id of the string, or max_size if the pool is full
+    uint32_t
+    getId(const std::string &str)
+    {
+        auto found = ids.find(str);
+        if (found != ids.end()) return found->second;
+        if (strings.size() >= max_size) return max_size;
+
+        strings.push_back(str);
+        ids.emplace(str, strings.size() - 1);
+        return strings.size() - 1;
+    }
+
+    const std::string & getString(uint32_t id) const { return strings[id]; }
+
+private:
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<std::string> strings;
+};
+
+// Ids of strings kept in the entry itself have this bit set
+static const uint32_t uninterned_id_flag = 0x80000000;
+
 Waf2ScanResult::Waf2ScanResult()
 :
 keyword_matches(),
@@ -83,3 +122,58 @@ void Waf2ScanResult::mergeFrom(const Waf2ScanResult& other)
 
     attack_types.insert(other.attack_types.begin(), other.attack_types.end());
 }
+
+CompactScanResult::CompactScanResult(const Waf2ScanResult &res)
+        :
+    unescaped_line(res.unescaped_line)
+{
+    fillIds(res.keyword_matches, keyword_matches);
+    fillIds(res.regex_matches, regex_matches);
+    found_patterns.reserve(res.found_patterns.size());
+    for (const auto &pattern : res.found_patterns) {
+        found_patterns.emplace_back(getId(pattern.first), std::vector<StringId>());
+        fillIds(pattern.second, found_patterns.back().second);
+    }
+}
+
+void CompactScanResult::materialize(Waf2ScanResult &res) const
+{
+    res.clear();
+    fillStrings(keyword_matches, res.keyword_matches);
+    fillStrings(regex_matches, res.regex_matches);
+    for (const auto &pattern : found_patterns) {
+        fillStrings(pattern.second, res.found_patterns[getString(pattern.first)]);
+    }
+    res.unescaped_line = unescaped_line;
+}
+
+CompactScanResult::StringId CompactScanResult::getId(const std::string &str)
+{
+    StringId id = ScanStringPool::getInstance().getId(str);
+    if (id < ScanStringPool::max_size) return id;
+
+    uninterned.push_back(str);
+    return (uninterned.size() - 1) | uninterned_id_flag;
+}
+
+const std::string & CompactScanResult::getString(StringId id) const
+{
+    if (id & uninterned_id_flag) return uninterned[id & ~uninterned_id_flag];
+    return ScanStringPool::getInstance().getString(id);
+}
+
+void CompactScanResult::fillIds(const std::vector<std::string> &strings, std::vector<StringId> &ids)
+{
+    ids.reserve(strings.size());
+    for (const std::string &str : strings) {
+        ids.push_back(getId(str));
+    }
+}
+
+void CompactScanResult::fillStrings(const std::vector<StringId> &ids, std::vector<std::string> &strings) const
+{
+    strings.reserve(ids.size());
+    for (StringId id : ids) {
+        strings.push_back(getString(id));
+    }
+}
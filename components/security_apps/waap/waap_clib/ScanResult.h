@@ -15,6 +15,7 @@
 #define __SCAN_RESULT_H__
 
 #include "Waf2Util.h"
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <set>
@@ -42,4 +43,30 @@ struct Waf2ScanResult {
     void mergeFrom(const Waf2ScanResult& other);
 };
 
+// The parts of a Waf2ScanResult that WaapAssetState::apply() fills, as kept in its suspicious values cache.
+// Keywords and pattern names mostly come from the signatures vocabulary, so they are interned in a process-wide
+// pool and referenced by id. Strings that do not fit in the (bounded) pool are kept in the entry itself.
+class CompactScanResult {
+public:
+    CompactScanResult() {}
+    explicit CompactScanResult(const Waf2ScanResult &res);
+
+    // Clears the result and fills it with the stored matches
+    void materialize(Waf2ScanResult &res) const;
+
+private:
+    typedef uint32_t StringId;
+
+    StringId getId(const std::string &str);
+    const std::string & getString(StringId id) const;
+    void fillIds(const std::vector<std::string> &strings, std::vector<StringId> &ids);
+    void fillStrings(const std::vector<StringId> &ids, std::vector<std::string> &strings) const;
+
+    std::vector<StringId> keyword_matches;
+    std::vector<StringId> regex_matches;
+    std::vector<std::pair<StringId, std::vector<StringId>>> found_patterns;
+    std::vector<std::string> uninterned;
+    std::string unescaped_line;
+};
+
 #endif // __SCAN_RESULT_H__
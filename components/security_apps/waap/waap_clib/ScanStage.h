@@ -0,0 +1,92 @@
+// Copyright (C) 2022 Check Point Software Technologies Ltd. All rights reserved.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __SCAN_STAGE_H__
+#define __SCAN_STAGE_H__
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// The location a scanned value was taken from: the first key of the deep parser key stack, or a response part.
+// Locations that the scanner does not handle specifically are all mapped to OTHER.
+enum class ScanStage : uint8_t
+{
+    OTHER,
+    URL,
+    URL_PARAM,
+    REFERER,
+    REFERER_PARAM,
+    HEADER,
+    COOKIE,
+    BODY,
+    RESP_HEADER,
+    RESP_BODY
+};
+
+inline ScanStage
+getScanStage(const char *name, size_t name_size)
+{
+    switch (name_size) {
+        case 3:
+            if (memcmp(name, "url", 3) == 0) return ScanStage::URL;
+            break;
+        case 4:
+            if (memcmp(name, "body", 4) == 0) return ScanStage::BODY;
+            break;
+        case 6:
+            if (memcmp(name, "header", 6) == 0) return ScanStage::HEADER;
+            if (memcmp(name, "cookie", 6) == 0) return ScanStage::COOKIE;
+            break;
+        case 7:
+            if (memcmp(name, "referer", 7) == 0) return ScanStage::REFERER;
+            break;
+        case 9:
+            if (memcmp(name, "url_param", 9) == 0) return ScanStage::URL_PARAM;
+            if (memcmp(name, "resp_body", 9) == 0) return ScanStage::RESP_BODY;
+            break;
+        case 11:
+            if (memcmp(name, "resp_header", 11) == 0) return ScanStage::RESP_HEADER;
+            break;
+        case 13:
+            if (memcmp(name, "referer_param", 13) == 0) return ScanStage::REFERER_PARAM;
+            break;
+    }
+    return ScanStage::OTHER;
+}
+
+inline ScanStage
+getScanStage(const std::string &name)
+{
+    return getScanStage(name.data(), name.size());
+}
+
+inline const char *
+scanStageToString(ScanStage stage)
+{
+    switch (stage) {
+        case ScanStage::URL: return "url";
+        case ScanStage::URL_PARAM: return "url_param";
+        case ScanStage::REFERER: return "referer";
+        case ScanStage::REFERER_PARAM: return "referer_param";
+        case ScanStage::HEADER: return "header";
+        case ScanStage::COOKIE: return "cookie";
+        case ScanStage::BODY: return "body";
+        case ScanStage::RESP_HEADER: return "resp_header";
+        case ScanStage::RESP_BODY: return "resp_body";
+        case ScanStage::OTHER: break;
+    }
+    return "other";
+}
+
+#endif // __SCAN_STAGE_H__
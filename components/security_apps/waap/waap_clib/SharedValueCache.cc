@@ -0,0 +1,268 @@
+// Copyright (C) 2022 Check Point Software Technologies Ltd. All rights reserved.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "SharedValueCache.h"
+
+#include <ctime>
+#include <random>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <boost/interprocess/shared_memory_object.hpp>
+
+#include "config.h"
+#include "debug.h"
+#include "version.h"
+
+USE_DEBUG_FLAG(D_WAAP);
+
+namespace bip = boost::interprocess;
+
+static const char *shared_value_cache_name = "cp-waap-shared-value-cache";
+// Changes with the layout of the table
+static const uint64_t shared_value_cache_magic = 0x57414150564332ULL;
+static const uint ways_per_bucket = 4;
+// A table whose creator did not complete its header by then is taken to be left by a creator that died
+static const time_t stale_initialization_seconds = 10;
+
+// The fingerprints are keyed with a random per-host secret. The table is readable only by its owner, so the secret
+// is known only to the agent processes, and values that collide with a cached clean value cannot be crafted by
+// anyone else.
+// The engine version identifies the build that created the table, since a verdict also depends on the code that
+// scanned the value. A process of another build replaces the table rather than sharing its verdicts.
+struct SharedValueCache::Header
+{
+    std::atomic<uint64_t> magic;
+    uint64_t engineVersion;
+    uint64_t key0;
+    uint64_t key1;
+    uint64_t numOfBuckets;
+};
+
+static inline uint64_t
+rotl(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+#define SIPROUND                                                \
+    do {                                                        \
+        v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32); \
+        v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;                  \
+        v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;                  \
+        v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32); \
+    } while (0)
+
+// SipHash-2-4
+static uint64_t
+sipHash(uint64_t key0, uint64_t key1, const char *data, size_t size)
+{
+    uint64_t v0 = key0 ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = key1 ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = key0 ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = key1 ^ 0x7465646279746573ULL;
+
+    const unsigned char *pos = reinterpret_cast<const unsigned char *>(data);
+    const unsigned char *end = pos + (size & ~size_t(7));
+    for (; pos != end; pos += 8) {
+        uint64_t word = 0;
+        for (int index = 7; index >= 0; index--) {
+            word = (word << 8) | pos[index];
+        }
+        v3 ^= word;
+        SIPROUND;
+        SIPROUND;
+        v0 ^= word;
+    }
+
+    uint64_t last = uint64_t(size) << 56;
+    for (int index = (size & 7) - 1; index >= 0; index--) {
+        last |= uint64_t(pos[index]) << (index * 8);
+    }
+    v3 ^= last;
+    SIPROUND;
+    SIPROUND;
+    v0 ^= last;
+
+    v2 ^= 0xff;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+#undef SIPROUND
+
+SharedValueCache &
+SharedValueCache::getInstance()
+{
+    static SharedValueCache instance;
+    return instance;
+}
+
+SharedValueCache::SharedValueCache()
+{
+    if (!getProfileAgentSettingWithDefault<bool>(true, "appsec.sharedValueCache.enabled")) {
+        dbgInfo(D_WAAP) << "Shared value cache is disabled";
+        return;
+    }
+
+    // The capacity is applied when the table is created. An existing table keeps its size until it is replaced.
+    uint64_t capacity = getProfileAgentSettingWithDefault<uint>(256 * 1024, "appsec.sharedValueCache.capacity");
+    uint64_t requestedBuckets = std::max<uint64_t>(capacity / ways_per_bucket, 1);
+    engineVersion = std::hash<std::string>()(Version::getFullVersion() + "@" + Version::getTimestamp());
+
+    try {
+        // A table that cannot be used is replaced once. If the new one cannot be used either, the cache is disabled.
+        for (uint attempt = 0; attempt < 2; attempt++) {
+            if (openTable(requestedBuckets)) return;
+
+            region.reset();
+            bip::shared_memory_object::remove(shared_value_cache_name);
+        }
+        dbgWarning(D_WAAP) << "Failed to replace the shared value cache, it will not be used";
+    } catch (const bip::interprocess_exception &e) {
+        dbgWarning(D_WAAP) << "Failed to open the shared value cache, it will not be used. Error: " << e.what();
+        region.reset();
+        header = nullptr;
+    }
+}
+
+bool
+SharedValueCache::openTable(uint64_t requestedBuckets)
+{
+    size_t size = sizeof(Header) + requestedBuckets * ways_per_bucket * sizeof(std::atomic<uint64_t>);
+
+    bool isCreator = false;
+    std::unique_ptr<bip::shared_memory_object> shm;
+    try {
+        bip::permissions ownerOnly;
+        ownerOnly.set_permissions(0600);
+        shm.reset(
+            new bip::shared_memory_object(bip::create_only, shared_value_cache_name, bip::read_write, ownerOnly)
+        );
+        shm->truncate(size);
+        isCreator = true;
+    } catch (const bip::interprocess_exception &) {
+        shm.reset(new bip::shared_memory_object(bip::open_only, shared_value_cache_name, bip::read_write));
+    }
+
+    struct stat shmStat;
+    if (fstat(shm->get_mapping_handle().handle, &shmStat) != 0) {
+        dbgWarning(D_WAAP) << "Failed to check the shared value cache, it will not be used";
+        return true;
+    }
+    if (shmStat.st_uid != geteuid() || (shmStat.st_mode & 077) != 0) {
+        dbgInfo(D_WAAP) << "The shared value cache is accessible by others, replacing it";
+        return false;
+    }
+    bool isInitializationStale = time(nullptr) - shmStat.st_ctime > stale_initialization_seconds;
+
+    region.reset(new bip::mapped_region(*shm, bip::read_write));
+    if (region->get_size() < sizeof(Header)) {
+        region.reset();
+        if (isInitializationStale) {
+            dbgInfo(D_WAAP) << "The shared value cache was left uninitialized, replacing it";
+            return false;
+        }
+        dbgWarning(D_WAAP) << "Shared value cache is not initialized yet, it will not be used by this process";
+        return true;
+    }
+
+    Header *mappedHeader = static_cast<Header *>(region->get_address());
+    if (isCreator) {
+        std::random_device random;
+        mappedHeader->engineVersion = engineVersion;
+        mappedHeader->key0 = (uint64_t(random()) << 32) | random();
+        mappedHeader->key1 = (uint64_t(random()) << 32) | random();
+        mappedHeader->numOfBuckets = requestedBuckets;
+        mappedHeader->magic.store(shared_value_cache_magic, std::memory_order_release);
+    } else {
+        uint64_t magic = mappedHeader->magic.load(std::memory_order_acquire);
+        if (magic == 0 && isInitializationStale) {
+            dbgInfo(D_WAAP) << "The shared value cache was left uninitialized, replacing it";
+            return false;
+        }
+        if (magic != 0 && (magic != shared_value_cache_magic || mappedHeader->engineVersion != engineVersion)) {
+            dbgInfo(D_WAAP) << "The shared value cache was created by another engine version, replacing it";
+            return false;
+        }
+    }
+
+    header = mappedHeader;
+    buckets = reinterpret_cast<std::atomic<uint64_t> *>(static_cast<char *>(region->get_address()) + sizeof(Header));
+    return true;
+}
+
+// A process that opened the table while its creator was still initializing it only starts using it once the
+// header is complete.
+bool
+SharedValueCache::isReady() const
+{
+    if (header == nullptr) return false;
+    if (numOfBuckets != 0) return true;
+    if (header->magic.load(std::memory_order_acquire) != shared_value_cache_magic) return false;
+    if (header->engineVersion != engineVersion) return false;
+
+    uint64_t mapped_buckets = (region->get_size() - sizeof(Header)) / (ways_per_bucket * sizeof(uint64_t));
+    numOfBuckets = std::min(header->numOfBuckets, mapped_buckets);
+    return numOfBuckets != 0;
+}
+
+uint64_t
+SharedValueCache::getFingerprint(
+    uint64_t sigsVersion,
+    const std::string &line,
+    ScanStage scanStage,
+    bool isBinaryData,
+    const std::string &splitType) const
+{
+    if (!isReady()) return 0;
+
+    uint64_t parameters = static_cast<uint64_t>(scanStage) | (uint64_t(isBinaryData) << 8);
+    parameters ^= sipHash(header->key0, header->key1, splitType.data(), splitType.size()) << 16;
+    uint64_t fingerprint = sipHash(header->key0 ^ sigsVersion, header->key1 ^ parameters, line.data(), line.size());
+    // Zero marks an empty slot
+    return fingerprint != 0 ? fingerprint : 1;
+}
+
+bool
+SharedValueCache::exist(uint64_t fingerprint) const
+{
+    if (fingerprint == 0 || !isReady()) return false;
+
+    const std::atomic<uint64_t> *bucket = buckets + (fingerprint % numOfBuckets) * ways_per_bucket;
+    for (uint way = 0; way < ways_per_bucket; way++) {
+        if (bucket[way].load(std::memory_order_relaxed) == fingerprint) return true;
+    }
+    return false;
+}
+
+void
+SharedValueCache::insert(uint64_t fingerprint)
+{
+    if (fingerprint == 0 || !isReady()) return;
+
+    std::atomic<uint64_t> *bucket = buckets + (fingerprint % numOfBuckets) * ways_per_bucket;
+    for (uint way = 0; way < ways_per_bucket; way++) {
+        uint64_t current = bucket[way].load(std::memory_order_relaxed);
+        if (current == fingerprint) return;
+        if (current == 0) {
+            if (bucket[way].compare_exchange_strong(current, fingerprint, std::memory_order_relaxed)) return;
+            if (current == fingerprint) return;
+        }
+    }
+    // The bucket is full, replace one of its entries. The way is taken from bits that are not used by the
+    // bucket index, so it is spread over the bucket.
+    bucket[(fingerprint >> 32) % ways_per_bucket].store(fingerprint, std::memory_order_relaxed);
+}
@@ -0,0 +1,67 @@
+// Copyright (C) 2022 Check Point Software Technologies Ltd. All rights reserved.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __SHARED_VALUE_CACHE_H__
+#define __SHARED_VALUE_CACHE_H__
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "ScanStage.h"
+
+// Host-wide cache of values that WaapAssetState::apply() found clean.
+// Values are stored as keyed 64-bit fingerprints in a shared memory table, so every WAAP process on the host,
+// and every asset in it, benefits from values scanned by the others. The signatures version is a part of the
+// fingerprint, so entries of older signatures are never hit again and are gradually overwritten.
+// The table is a set-associative array of atomic slots, accessed without locks.
+// Its size is set by appsec.sharedValueCache.capacity when it is created. A table that already exists keeps its
+// size, until it is replaced by an agent of another version or removed on a host restart.
+class SharedValueCache
+{
+public:
+    struct Header;
+
+    // Returns the process-wide cache, opening the shared table on first use
+    static SharedValueCache & getInstance();
+
+    bool isEnabled() const { return header != nullptr; }
+
+    uint64_t getFingerprint(
+        uint64_t sigsVersion,
+        const std::string &line,
+        ScanStage scanStage,
+        bool isBinaryData,
+        const std::string &splitType
+    ) const;
+    bool exist(uint64_t fingerprint) const;
+    void insert(uint64_t fingerprint);
+
+private:
+    SharedValueCache();
+
+    // Opens or creates the table. Returns false when an existing table cannot be used and should be replaced.
+    bool openTable(uint64_t requestedBuckets);
+    bool isReady() const;
+
+    std::unique_ptr<boost::interprocess::mapped_region> region;
+    Header *header = nullptr;
+    std::atomic<uint64_t> *buckets = nullptr;
+    mutable uint64_t numOfBuckets = 0;
+    uint64_t engineVersion = 0;
+};
+
+#endif // __SHARED_VALUE_CACHE_H__
@@ -233,6 +233,7 @@ picojson::value::object Signatures::loadSource(const std::string& waapDataFileNa
 {
     picojson::value doc;
     std::ifstream f(waapDataFileName);
+    version = 0;
 
     if (f.fail()) {
         dbgError(D_WAAP) << "Failed to open json data file '" << waapDataFileName << "'!";
@@ -252,6 +253,8 @@ picojson::value::object Signatures::loadSource(const std::string& waapDataFileNa
 
     delete[] buffer;
 
+    version = std::hash<std::string>()(dataObfuscated);
+
 
     std::stringstream ss(dataObfuscated);
 
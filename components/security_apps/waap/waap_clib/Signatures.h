@@ -20,6 +20,8 @@
 
 class Signatures {
 private:
+    // hash of the signatures file contents, set while the sources are loaded
+    uint64_t version;
     // json parsed sources (not really needed once data is loaded)
     picojson::value::object sigsSource;
     bool error;
@@ -28,6 +30,8 @@ public:
     ~Signatures();
 
     bool fail();
+    // Identifies the signatures file contents, so processes that loaded the same signatures share cached verdicts
+    uint64_t getVersion() const { return version; }
 
     std::shared_ptr<Waap::RegexPreconditions> m_regexPreconditions;
 
@@ -333,3 +333,38 @@ AssetsMetric::upon(const AssetCountEvent &event)
         }
     }
 }
+
+void
+WaapScanLatencyMetric::upon(const WaapScanLatencyEvent &event)
+{
+    switch (event.getStage()) {
+        case WaapScanLatencyEvent::Stage::URL:
+            scan_stage_latency.report("url", event.getLatency());
+            break;
+        case WaapScanLatencyEvent::Stage::HEADERS:
+            scan_stage_latency.report("headers", event.getLatency());
+            break;
+        case WaapScanLatencyEvent::Stage::REQUEST_BODY:
+            scan_stage_latency.report("requestBody", event.getLatency());
+            break;
+        case WaapScanLatencyEvent::Stage::ERROR_DISCLOSURE:
+            scan_stage_latency.report("errorDisclosure", event.getLatency());
+            break;
+    }
+}
+
+void
+WaapValueCacheMetric::upon(const WaapValueCacheEvent &event)
+{
+    switch (event.getResult()) {
+        case WaapValueCacheEvent::Result::LOCAL_HIT:
+            local_hits.report(1);
+            break;
+        case WaapValueCacheEvent::Result::SHARED_HIT:
+            shared_hits.report(1);
+            break;
+        case WaapValueCacheEvent::Result::MISS:
+            misses.report(1);
+            break;
+    }
+}
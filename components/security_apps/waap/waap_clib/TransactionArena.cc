@@ -0,0 +1,114 @@
+// Copyright (C) 2022 Check Point Software Technologies Ltd. All rights reserved.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TransactionArena.h"
+#include <new>
+
+namespace Waap {
+
+// Upper bound on the number of released blocks kept for reuse by later transactions
+static const size_t maxPooledBlocks = 64;
+
+// Intentionally never destroyed: arenas of transactions that are still alive during process exit return their
+// blocks to it from their own destructors, which may run after the destructors of static objects.
+static std::vector<char *> &
+getBlocksPool()
+{
+    static std::vector<char *> *pool = new std::vector<char *>();
+    return *pool;
+}
+
+TransactionArena::TransactionArena()
+:
+    m_pos(nullptr),
+    m_end(nullptr),
+    m_blocks(),
+    m_freeLists(),
+    m_allocationsCount(0)
+{
+}
+
+TransactionArena::~TransactionArena()
+{
+    std::vector<char *> &pool = getBlocksPool();
+    for (char *block : m_blocks) {
+        if (pool.size() < maxPooledBlocks) {
+            pool.push_back(block);
+        } else {
+            ::operator delete(block);
+        }
+    }
+}
+
+bool
+TransactionArena::isPassedToHeap(size_t size, size_t alignment)
+{
+    return size > maxChunkSize || alignment > granularity;
+}
+
+void *
+TransactionArena::do_allocate(size_t size, size_t alignment)
+{
+    m_allocationsCount++;
+    size = size == 0 ? granularity : roundUp(size);
+    if (isPassedToHeap(size, alignment)) return ::operator new(size, std::align_val_t(alignment));
+
+    void *&freeList = m_freeLists[size / granularity];
+    if (freeList != nullptr) {
+        void *chunk = freeList;
+        freeList = *static_cast<void **>(chunk);
+        return chunk;
+    }
+
+    if (static_cast<size_t>(m_end - m_pos) < size) return allocateFromNewBlock(size);
+
+    void *chunk = m_pos;
+    m_pos += size;
+    return chunk;
+}
+
+void
+TransactionArena::do_deallocate(void *ptr, size_t size, size_t alignment)
+{
+    if (ptr == nullptr) return;
+    size = size == 0 ? granularity : roundUp(size);
+    if (isPassedToHeap(size, alignment)) {
+        ::operator delete(ptr, std::align_val_t(alignment));
+        return;
+    }
+
+    void *&freeList = m_freeLists[size / granularity];
+    *static_cast<void **>(ptr) = freeList;
+    freeList = ptr;
+}
+
+void *
+TransactionArena::allocateFromNewBlock(size_t size)
+{
+    std::vector<char *> &pool = getBlocksPool();
+    char *block;
+    if (!pool.empty()) {
+        block = pool.back();
+        pool.pop_back();
+    } else {
+        block = static_cast<char *>(::operator new(blockSize));
+    }
+    m_blocks.push_back(block);
+
+    // The rest of the previous block is dropped, it is smaller than the chunk that did not fit into it
+    m_pos = block + size;
+    m_end = block + blockSize;
+    return block;
+}
+
+} // namespace Waap
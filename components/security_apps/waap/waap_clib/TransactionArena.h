@@ -0,0 +1,71 @@
+// Copyright (C) 2022 Check Point Software Technologies Ltd. All rights reserved.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __TRANSACTION_ARENA_H__7c2e91d4
+#define __TRANSACTION_ARENA_H__7c2e91d4
+
+#include <stddef.h>
+#include <array>
+#include <memory_resource>
+#include <vector>
+
+namespace Waap {
+
+// Memory resource for the short-lived objects of a single transaction (parsers, their containers and the collected
+// keys, values and keywords).
+// Small allocations are carved from fixed size blocks. Freed chunks are kept on per-size free lists and reused by
+// later allocations of the same size, and all blocks are released together when the arena is destroyed.
+// Released blocks are kept in a process wide pool, so that a steady stream of transactions does not go back to the
+// heap for them.
+// Allocations larger than a quarter of a block, or with an alignment above the chunk granularity, are passed through
+// to the heap.
+//
+// std::pmr::monotonic_buffer_resource is not used since it never reuses a freed chunk: nested parsers and their
+// deque nodes are created and destroyed many times during one transaction, so its footprint would grow with the
+// number of values parsed. std::pmr::unsynchronized_pool_resource does reuse chunks, but returns its memory to the
+// upstream resource on destruction, so every transaction would go back to the heap for its blocks.
+class TransactionArena : public std::pmr::memory_resource
+{
+public:
+    TransactionArena();
+    ~TransactionArena();
+    TransactionArena(const TransactionArena &) = delete;
+    TransactionArena & operator=(const TransactionArena &) = delete;
+
+    size_t getAllocationsCount() const { return m_allocationsCount; }
+    size_t getBlocksCount() const { return m_blocks.size(); }
+
+    static const size_t blockSize = 8192;
+
+private:
+    static const size_t granularity = 16;
+    static const size_t maxChunkSize = blockSize / 4;
+
+    void * do_allocate(size_t size, size_t alignment) override;
+    void do_deallocate(void *ptr, size_t size, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+    static size_t roundUp(size_t size) { return (size + granularity - 1) & ~(granularity - 1); }
+    static bool isPassedToHeap(size_t size, size_t alignment);
+    void * allocateFromNewBlock(size_t size);
+
+    char *m_pos;
+    char *m_end;
+    std::vector<char *> m_blocks;
+    std::array<void *, maxChunkSize / granularity + 1> m_freeLists;
+    size_t m_allocationsCount;
+};
+
+} // namespace Waap
+
+#endif // __TRANSACTION_ARENA_H__7c2e91d4
@@ -16,10 +16,14 @@
 #include "Waf2Regex.h"
 #include "debug.h"
 #include "Waf2Util.h"
+#include "WaapCharClass.h"
 #include "maybe_res.h"
 #include "picojson.h"
 #include "agent_core_utilities.h"
+#include "SharedValueCache.h"
+#include "telemetry.h"
 #include <algorithm>
+#include <array>
 #include <fstream>
 #include <boost/regex.hpp>
 
@@ -422,18 +426,120 @@ WaapAssetState::WaapAssetState(std::shared_ptr<Signatures> signatures,
         }
     }
 
+    // Classes of characters that trigger the decoding stages of unescape(). Every stage leaves a string that has
+    // none of its trigger characters unchanged, so a stage only runs when one of them is present.
+    enum UnescapeTrigger {
+        TRIGGER_PLUS = 1,
+        TRIGGER_PERCENT = 2,
+        TRIGGER_AMPERSAND = 4,
+        TRIGGER_BACKSLASH = 8,
+        TRIGGER_NON_ASCII = 16
+    };
+
+    static const Waap::CharClass::Table
+    buildUnescapeTriggersTable()
+    {
+        Waap::CharClass::Table table;
+        for (uint code = 0; code < table.size(); code++) {
+            table[code] = code > 127 ? TRIGGER_NON_ASCII : 0;
+        }
+        table['+'] = TRIGGER_PLUS;
+        table['%'] = TRIGGER_PERCENT;
+        table['&'] = TRIGGER_AMPERSAND;
+        table['\\'] = TRIGGER_BACKSLASH;
+        return table;
+    }
+
+    static uint8_t
+    getUnescapeTriggers(const std::string &text)
+    {
+        static const Waap::CharClass::Table triggers_table = buildUnescapeTriggersTable();
+        return Waap::CharClass::classify(text.data(), text.size(), triggers_table);
+    }
+
+    // The last stages of unescape(): trimSpaces() followed by tolower(), in a single pass
+    static void
+    trimSpacesAndLowercase(std::string &text)
+    {
+        size_t result_position = 0;
+        space_stage state = NO_SPACES;
+
+        for (size_t position = 0; position < text.size(); position++) {
+            char code = text[position];
+            switch (code) {
+                case '\t':
+                case ' ':
+                case '\f':
+                case '\v':
+                    if (state == NO_SPACES) {
+                        state = SPACE_SYNBOL;
+                        text[result_position++] = code;
+                    }
+                    break;
+                case '\r':
+                    switch (state) {
+                        case (SPACE_SYNBOL):
+                            text[result_position - 1] = code;
+                            state = BR_SYMBOL;
+                            break;
+                        case (NO_SPACES):
+                            text[result_position++] = code;
+                            state = BR_SYMBOL;
+                            break;
+                        case (BN_SYMBOL):
+                            text[result_position++] = code;
+                            state = BNR_SEQUENCE;
+                            break;
+                        default:
+                            break;
+                    }
+                    break;
+                case '\n':
+                    switch (state) {
+                        case (SPACE_SYNBOL):
+                            text[result_position - 1] = code;
+                            state = BN_SYMBOL;
+                            break;
+                        case (NO_SPACES):
+                            text[result_position++] = code;
+                            state = BN_SYMBOL;
+                            break;
+                        case (BR_SYMBOL):
+                            text[result_position++] = code;
+                            state = BRN_SEQUENCE;
+                            break;
+                        default:
+                            break;
+                    }
+                    break;
+                default:
+                    text[result_position++] = tolower(code);
+                    state = NO_SPACES;
+            }
+        }
+        text.erase(result_position);
+    }
+
+    // Runs the same stages as the original multi-pass unescape, in the same order, but a stage is skipped when the
+    // current text has none of its trigger characters. Most values have no escapes at all, and are normalized with
+    // one classification pass and one pass that trims spaces and lowercases them.
     std::string unescape(const std::string & s) {
         std::string text = s;
         size_t orig_size = text.size();
         size_t orig_capacity = text.capacity();
         dbgTrace(D_WAAP_SAMPLE_PREPROCESS) << "unescape: (0) '" << text << "'";
 
-        fixBreakingSpace(text);
+        uint8_t triggers = getUnescapeTriggers(text);
+
         // 1. remove all unicode characters from string. Basically,
         // remove all characters whose ASCII code is >=128.
         // Python equivalent: text.encode('ascii',errors='ignore')
-        filterUnicode(text);
-        dbgTrace(D_WAAP_SAMPLE_PREPROCESS) << "unescape: (1) '" << text << "'";
+        if (triggers & TRIGGER_NON_ASCII) {
+            fixBreakingSpace(text);
+            filterUnicode(text);
+            triggers = getUnescapeTriggers(text);
+            dbgTrace(D_WAAP_SAMPLE_PREPROCESS) << "unescape: (1) '" << text << "'";
+        }
 
         // inplace unescaping must result in a string of the same size or smaller
         dbgAssertOpt(text.size() <= orig_size && text.size() <= text.capacity() && text.capacity() <= orig_capacity)
@@ -442,56 +548,81 @@ WaapAssetState::WaapAssetState(std::shared_ptr<Signatures> signatures,
             << " new size=" << text.size() << " capacity=" << text.capacity()
             << " text='" << text << "'";
 
-        text = filterUTF7(text);
-        // update orig_size and orig_capacity after string copy
-        orig_size = text.size();
-        orig_capacity = text.capacity();
-        dbgTrace(D_WAAP_SAMPLE_PREPROCESS) << "unescape: (1) (after filterUTF7) '" << text << "'";
+        if (triggers & TRIGGER_PLUS) {
+            text = filterUTF7(text);
+            // update orig_size and orig_capacity after string copy
+            orig_size = text.size();
+            orig_capacity = text.capacity();
+            triggers = getUnescapeTriggers(text);
+            dbgTrace(D_WAAP_SAMPLE_PREPROCESS) << "unescape: (1) (after filterUTF7) '" << text << "'";
+        }
 
         // 2. Replace %xx sequences by their single-character equivalents.
         // Also replaces '+' symbol by space character.
         // Python equivalent: text = urllib.unquote_plus(text)
-        text.erase(unquote_plus(text.begin(), text.end()), text.end());
-        dbgTrace(D_WAAP_SAMPLE_PREPROCESS) << "unescape: (2) '" << text << "'";
-
-        fixBreakingSpace(text);
+        if (triggers & (TRIGGER_PLUS | TRIGGER_PERCENT)) {
+            text.erase(unquote_plus(text.begin(), text.end()), text.end());
+            triggers = getUnescapeTriggers(text);
+            dbgTrace(D_WAAP_SAMPLE_PREPROCESS) << "unescape: (2) '" << text << "'";
+        }
 
         // 3. remove all unicode characters from string. Basically,
         // remove all characters whose ASCII code is >=128.
         // Python equivalent: text.encode('ascii',errors='ignore')
-        filterUnicode(text);
-        dbgTrace(D_WAAP_SAMPLE_PREPROCESS) << "unescape: (3) '" << text << "'";
+        if (triggers & TRIGGER_NON_ASCII) {
+            fixBreakingSpace(text);
+            filterUnicode(text);
+            triggers = getUnescapeTriggers(text);
+            dbgTrace(D_WAAP_SAMPLE_PREPROCESS) << "unescape: (3) '" << text << "'";
+        }
 
         // 4. oh shi?... should I handle unicode html entities (python's htmlentitydefs module)???
         // Python equivalent: text = HTMLParser.HTMLParser().unescape(text)
-        text.erase(escape_html(text.begin(), text.end()), text.end());
-        dbgTrace(D_WAAP_SAMPLE_PREPROCESS) << "unescape: (4) '" << text << "'";
+        if (triggers & TRIGGER_AMPERSAND) {
+            text.erase(escape_html(text.begin(), text.end()), text.end());
+            triggers = getUnescapeTriggers(text);
+            dbgTrace(D_WAAP_SAMPLE_PREPROCESS) << "unescape: (4) '" << text << "'";
+        }
 
         // 5. Apply backslash escaping (like in C)
         // Python equivalent: text = text.decode('string_escape')
-        text.erase(escape_backslashes(text.begin(), text.end()), text.end());
-        dbgTrace(D_WAAP_SAMPLE_PREPROCESS) << "unescape: (5) '" << text << "'";
+        if (triggers & TRIGGER_BACKSLASH) {
+            text.erase(escape_backslashes(text.begin(), text.end()), text.end());
+            triggers = getUnescapeTriggers(text);
+            dbgTrace(D_WAAP_SAMPLE_PREPROCESS) << "unescape: (5) '" << text << "'";
+        }
 
         // 6. remove all unicode characters from string. Basically,
         // remove all characters whose ASCII code is >=128.
         // Python equivalent: text.encode('ascii',errors='ignore')
-        filterUnicode(text);
-        dbgTrace(D_WAAP_SAMPLE_PREPROCESS) << "unescape: (6) '" << text << "'";
+        if (triggers & TRIGGER_NON_ASCII) {
+            filterUnicode(text);
+            triggers = getUnescapeTriggers(text);
+            dbgTrace(D_WAAP_SAMPLE_PREPROCESS) << "unescape: (6) '" << text << "'";
+        }
 
         // 7. Replace %xx sequences by their single-character equivalents.
         // Also replaces '+' symbol by space character.
         // Python equivalent: text = urllib.unquote_plus(text)
-        text.erase(unquote_plus(text.begin(), text.end()), text.end());
-        dbgTrace(D_WAAP_SAMPLE_PREPROCESS) << "unescape: (7) '" << text << "'";
+        if (triggers & (TRIGGER_PLUS | TRIGGER_PERCENT)) {
+            text.erase(unquote_plus(text.begin(), text.end()), text.end());
+            triggers = getUnescapeTriggers(text);
+            dbgTrace(D_WAAP_SAMPLE_PREPROCESS) << "unescape: (7) '" << text << "'";
+        }
 
-        unescapeUnicode(text);
-        dbgTrace(D_WAAP_SAMPLE_PREPROCESS) << "after unescapeUnicode '" << text << "'";
+        if (triggers & TRIGGER_BACKSLASH) {
+            unescapeUnicode(text);
+            triggers = getUnescapeTriggers(text);
+            dbgTrace(D_WAAP_SAMPLE_PREPROCESS) << "after unescapeUnicode '" << text << "'";
+        }
 
         // 8. remove all unicode characters from string. Basically,
         // remove all characters whose ASCII code is >=128.
         // Python equivalent: text.encode('ascii',errors='ignore')
-        filterUnicode(text);
-        dbgTrace(D_WAAP_SAMPLE_PREPROCESS) << "unescape: (8) '" << text << "'";
+        if (triggers & TRIGGER_NON_ASCII) {
+            filterUnicode(text);
+            dbgTrace(D_WAAP_SAMPLE_PREPROCESS) << "unescape: (8) '" << text << "'";
+        }
 
         // 9. ???
         //
@@ -504,7 +635,7 @@ WaapAssetState::WaapAssetState(std::shared_ptr<Signatures> signatures,
         // Python equivalent: text = re.sub(r'[^\x00-\x7F]+',' ', text)
         // TODO:: actually, in python Pavel do this:
         // text = re.sub(r'[^\x00-\x7F]+',' ', text).encode("ascii","ignore")
-        replaceUnicodeSequence(text, ' ');
+        // Nothing is left to replace here, since step 8 leaves only ASCII characters in the text.
 
 #if 0 // Removed Aug 25 2018. Reason for removal - breaks input containing ASCII zeros.
         // 11. remove all unicode characters from string.
@@ -513,15 +644,8 @@ WaapAssetState::WaapAssetState(std::shared_ptr<Signatures> signatures,
         filterUnicode(text);
 #endif
 
-        dbgTrace(D_WAAP_SAMPLE_PREPROCESS) << "unescape: (11) '" << text << "'";
-
-        trimSpaces(text);
-
-        // 12. finally, apply tolower() to all characters of a string
-        // std::for_each(text.begin(), text.end(), [](char &c) { c = tolower(c); });
-        for (std::string::iterator pC = text.begin(); pC != text.end(); ++pC) {
-            *pC = tolower(*pC);
-        }
+        // 12. finally, trim spaces and apply tolower() to all characters of a string
+        trimSpacesAndLowercase(text);
 
         dbgTrace(D_WAAP_SAMPLE_PREPROCESS) << "unescape: (12) '" << text << "'";
 
@@ -889,7 +1013,7 @@ bool
 WaapAssetState::apply(
     const std::string &line,
     Waf2ScanResult &res,
-    const std::string &scanStage,
+    ScanStage scanStage,
     bool isBinaryData,
     const Maybe<std::string> splitType) const
 {
@@ -897,13 +1021,13 @@ WaapAssetState::apply(
         << "WaapAssetState::apply('"
         << line
         << "', scanStage="
-        << scanStage
+        << scanStageToString(scanStage)
         << ", splitType='"
         << (splitType.ok() ? *splitType: "")
         << "'";
 
     // Handle response scan stages
-    if (scanStage == "resp_body") {
+    if (scanStage == ScanStage::RESP_BODY) {
         res.clear();
         SampleValue sample(line, nullptr);
         checkRegex(sample,
@@ -923,7 +1047,7 @@ WaapAssetState::apply(
         return !res.keyword_matches.empty();
     }
 
-    if (scanStage == "resp_header") {
+    if (scanStage == ScanStage::RESP_HEADER) {
         res.clear();
         SampleValue sample(line, nullptr);
         checkRegex(sample,
@@ -946,17 +1070,23 @@ WaapAssetState::apply(
     // Only cache values less or equal than MAX_CACHE_VALUE_SIZE
     bool shouldCache = (line.size() <= MAX_CACHE_VALUE_SIZE);
 
+    // Fingerprint of the value in the shared value cache, zero if the value is not cached there
+    uint64_t sharedCacheFingerprint = 0;
+
     if (shouldCache) {
         // Handle cached clean values
         CacheKey cache_key(line, scanStage, isBinaryData, splitType.ok() ? *splitType : "");
         if (m_cleanValuesCache.exist(cache_key)) {
             dbgTrace(D_WAAP_SAMPLE_SCAN) << "WaapAssetState::apply('" << line << "'): not suspicious (cache)";
+            WaapValueCacheEvent(WaapValueCacheEvent::Result::LOCAL_HIT).notify();
             res.clear();
             return false;
         }
 
         // Handle cached suspicious values (if found - fills out the "res" structure)
-        if (m_suspiciousValuesCache.get(cache_key, res)) {
+        CompactScanResult cachedResult;
+        if (m_suspiciousValuesCache.get(cache_key, cachedResult)) {
+            cachedResult.materialize(res);
             dbgTrace(D_WAAP_SAMPLE_SCAN) << "WaapAssetState::apply('" << line << "'): suspicious (cache)";
 
 #ifdef WAF2_LOGGING_ENABLE
@@ -965,8 +1095,27 @@ WaapAssetState::apply(
             print_filtered("patterns", std::set<std::string>(), res.regex_matches);
             print_found_patterns(res.found_patterns);
 #endif
+            WaapValueCacheEvent(WaapValueCacheEvent::Result::LOCAL_HIT).notify();
             return true;
         }
+
+        // Handle clean values cached by other assets and processes
+        SharedValueCache &sharedCache = SharedValueCache::getInstance();
+        sharedCacheFingerprint = sharedCache.getFingerprint(
+            m_Signatures->getVersion(),
+            line,
+            scanStage,
+            isBinaryData,
+            cache_key.splitType
+        );
+        if (sharedCache.exist(sharedCacheFingerprint)) {
+            dbgTrace(D_WAAP_SAMPLE_SCAN) << "WaapAssetState::apply('" << line << "'): not suspicious (shared cache)";
+            WaapValueCacheEvent(WaapValueCacheEvent::Result::SHARED_HIT).notify();
+            m_cleanValuesCache.insert(cache_key);
+            res.clear();
+            return false;
+        }
+        WaapValueCacheEvent(WaapValueCacheEvent::Result::MISS).notify();
     }
 
     dbgTrace(D_WAAP_SAMPLE_SCAN) << "WaapAssetState::apply('" << line << "'): passed the cache check.";
@@ -976,12 +1125,15 @@ WaapAssetState::apply(
     bool isUrlScanStage = false;
     bool isHeaderScanStage = false;
 
-    if ((scanStage.size() == 3 && scanStage == "url") || (scanStage.size() == 7 && scanStage == "referer")) {
+    if (scanStage == ScanStage::URL || scanStage == ScanStage::REFERER) {
         if (m_Signatures->url_ignored_re.hasMatch(line)) {
             dbgTrace(D_WAAP_SAMPLE_SCAN) << "WaapAssetState::apply('" << line << "'): ignored for URL.";
 
             if (shouldCache) {
-                m_cleanValuesCache.insert(CacheKey(line, scanStage, isBinaryData, splitType.ok() ? *splitType : ""));
+                cacheCleanValue(
+                    CacheKey(line, scanStage, isBinaryData, splitType.ok() ? *splitType : ""),
+                    sharedCacheFingerprint
+                );
             }
 
             res.clear();
@@ -992,13 +1144,15 @@ WaapAssetState::apply(
         ignored_patterns = &m_Signatures->url_ignored_patterns;
         isUrlScanStage = true;
     }
-    else if ((scanStage.size() == 6 && scanStage == "header") ||
-        (scanStage.size() == 6 && scanStage == "cookie")) {
+    else if (scanStage == ScanStage::HEADER || scanStage == ScanStage::COOKIE) {
         if (m_Signatures->header_ignored_re.hasMatch(line)) {
             dbgTrace(D_WAAP_SAMPLE_SCAN) << "WaapAssetState::apply('" << line << "'): ignored for header.";
 
             if (shouldCache) {
-                m_cleanValuesCache.insert(CacheKey(line, scanStage, isBinaryData, splitType.ok() ? *splitType : ""));
+                cacheCleanValue(
+                    CacheKey(line, scanStage, isBinaryData, splitType.ok() ? *splitType : ""),
+                    sharedCacheFingerprint
+                );
             }
 
             res.clear();
@@ -1036,7 +1190,10 @@ WaapAssetState::apply(
                 "'): skipping: did not pass the length check.";
 
             if (shouldCache) {
-                m_cleanValuesCache.insert(CacheKey(line, scanStage, isBinaryData, splitType.ok() ? *splitType : ""));
+                cacheCleanValue(
+                    CacheKey(line, scanStage, isBinaryData, splitType.ok() ? *splitType : ""),
+                    sharedCacheFingerprint
+                );
             }
 
             res.clear();
@@ -1055,7 +1212,10 @@ WaapAssetState::apply(
 
         if (allAlNum) {
             if (shouldCache) {
-                m_cleanValuesCache.insert(CacheKey(line, scanStage, isBinaryData, splitType.ok() ? *splitType : ""));
+                cacheCleanValue(
+                    CacheKey(line, scanStage, isBinaryData, splitType.ok() ? *splitType : ""),
+                    sharedCacheFingerprint
+                );
             }
 
             res.clear();
@@ -1071,8 +1231,9 @@ WaapAssetState::apply(
                     "'): matched on allowed_text - ignoring.";
 
                 if (shouldCache) {
-                    m_cleanValuesCache.insert(
-                        CacheKey(line, scanStage, isBinaryData, splitType.ok() ? *splitType : "")
+                    cacheCleanValue(
+                        CacheKey(line, scanStage, isBinaryData, splitType.ok() ? *splitType : ""),
+                        sharedCacheFingerprint
                     );
                 }
 
@@ -1137,7 +1298,7 @@ WaapAssetState::apply(
     // Handle semicolon and pipe-split values.
     // Specifically exclude split cookie values to avoid high-probability high-impact false positives.
     // note: All-digits values triggers fp when prepended with separator, so they are excluded
-    if (scanStage != "cookie" && splitType.ok() && !Waap::Util::isAllDigits(res.unescaped_line)) {
+    if (scanStage != ScanStage::COOKIE && splitType.ok() && !Waap::Util::isAllDigits(res.unescaped_line)) {
         dbgTrace(D_WAAP_EVASIONS) << "split value detected type='" << *splitType << "' value='" << line << "'";
 
         // Split value detected eligible for special handling. Scan it after prepending the appropriate prefix
@@ -1955,9 +2116,10 @@ WaapAssetState::apply(
             dbgTrace(D_WAAP_SAMPLE_SCAN) << "apply(): suspicion found (score=" << score << ").";
 
             if (shouldCache) {
-                m_suspiciousValuesCache.insert(
-                    {CacheKey(line, scanStage, isBinaryData, splitType.ok() ? *splitType : ""), res}
-                );
+                m_suspiciousValuesCache.insert({
+                    CacheKey(line, scanStage, isBinaryData, splitType.ok() ? *splitType : ""),
+                    CompactScanResult(res)
+                });
             }
 
             return true; // suspicion found
@@ -1969,13 +2131,23 @@ WaapAssetState::apply(
     dbgTrace(D_WAAP_SAMPLE_SCAN) << "apply(): not suspicious.";
 
     if (shouldCache) {
-        m_cleanValuesCache.insert(CacheKey(line, scanStage, isBinaryData, splitType.ok() ? *splitType : ""));
+        cacheCleanValue(
+            CacheKey(line, scanStage, isBinaryData, splitType.ok() ? *splitType : ""),
+            sharedCacheFingerprint
+        );
     }
 
     res.clear();
     return false;
 }
 
+void
+WaapAssetState::cacheCleanValue(const CacheKey &cacheKey, uint64_t sharedCacheFingerprint) const
+{
+    m_cleanValuesCache.insert(cacheKey);
+    SharedValueCache::getInstance().insert(sharedCacheFingerprint);
+}
+
 void WaapAssetState::updateScores()
 {
     scoreBuilder.snap();
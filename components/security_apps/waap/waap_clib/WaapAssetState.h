@@ -32,6 +32,7 @@
 #include "WaapKeywords.h"
 #include "KeywordTypeValidator.h"
 #include "ScanResult.h"
+#include "ScanStage.h"
 #include "WaapSampleValue.h"
 #include "RequestsMonitor.h"
 
@@ -77,7 +78,7 @@ public:
     std::shared_ptr<IndicatorsFiltersManager> m_filtersMngr;
     KeywordTypeValidator m_typeValidator;
 
-    bool apply(const std::string &v, Waf2ScanResult &res, const std::string &scanStage, bool isBinaryData=false,
+    bool apply(const std::string &v, Waf2ScanResult &res, ScanStage scanStage, bool isBinaryData=false,
         const Maybe<std::string> splitType=genError("not splitted")) const;
 
     virtual void updateScores();
@@ -119,12 +120,12 @@ public:
     // Key for the caches includes input values passed to the WaapAssetState::apply()
     struct CacheKey {
         std::string line;
-        std::string scanStage;
+        ScanStage scanStage;
         bool isBinaryData;
         std::string splitType;
         CacheKey(
             const std::string &line,
-            const std::string &scanStage,
+            ScanStage scanStage,
             bool isBinaryData,
             const std::string &splitType)
                 :
@@ -146,9 +147,12 @@ public:
         }
     };
 
+    // Caches a clean value locally, and in the shared value cache when its fingerprint is given
+    void cacheCleanValue(const CacheKey &cacheKey, uint64_t sharedCacheFingerprint) const;
+
     // LRU caches are used to increase performance of apply() method for most frequent values
     mutable LruCacheSet<CacheKey> m_cleanValuesCache;
-    mutable LruCacheMap<CacheKey, Waf2ScanResult> m_suspiciousValuesCache;
+    mutable LruCacheMap<CacheKey, CompactScanResult> m_suspiciousValuesCache;
     mutable LruCacheSet<std::string> m_sampleTypeCache;
 };
 
@@ -157,7 +161,7 @@ inline std::size_t hash_value(WaapAssetState::CacheKey const &cacheKey)
 {
     std::size_t hash = 0;
     boost::hash_combine(hash, cacheKey.line);
-    boost::hash_combine(hash, cacheKey.scanStage);
+    boost::hash_combine(hash, static_cast<uint8_t>(cacheKey.scanStage));
     return hash;
 }
 
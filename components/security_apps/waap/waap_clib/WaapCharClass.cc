@@ -0,0 +1,245 @@
+// Copyright (C) 2022 Check Point Software Technologies Ltd. All rights reserved.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "WaapCharClass.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define WAAP_CHAR_CLASS_X86
+#endif
+
+namespace Waap {
+namespace CharClass {
+
+static inline bool
+isAlnum(unsigned char ch)
+{
+    return ((unsigned int)ch | 32) - 'a' < 26 || (unsigned int)ch - '0' < 10;
+}
+
+static inline bool
+isNonPrintable(unsigned char ch)
+{
+    return (ch < 0x20 || ch >= 0x7f) && ch != '\t' && ch != '\n';
+}
+
+static inline uint32_t
+classifyScalar(const char *data, size_t len, const Table &table)
+{
+    uint32_t classes = 0;
+    for (size_t i = 0; i < len; ++i) {
+        classes |= table[(unsigned char)data[i]];
+    }
+    return classes;
+}
+
+static size_t
+findFirstNonAlnumScalar(const char *data, size_t len)
+{
+    for (size_t i = 0; i < len; ++i) {
+        if (!isAlnum(data[i])) return i;
+    }
+    return len;
+}
+
+static size_t
+countNonPrintableScalar(const char *data, size_t len)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < len; ++i) {
+        count += isNonPrintable(data[i]);
+    }
+    return count;
+}
+
+#ifdef WAAP_CHAR_CLASS_X86
+
+// Signed byte compares are enough for the ASCII ranges below: bytes >= 0x80 are negative and fall outside all of them
+
+static inline __m128i
+alnumMaskSse2(__m128i bytes)
+{
+    __m128i lower = _mm_or_si128(bytes, _mm_set1_epi8(0x20));
+    __m128i letter = _mm_and_si128(
+        _mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+        _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1))
+    );
+    __m128i digit = _mm_and_si128(
+        _mm_cmpgt_epi8(bytes, _mm_set1_epi8('0' - 1)),
+        _mm_cmplt_epi8(bytes, _mm_set1_epi8('9' + 1))
+    );
+    return _mm_or_si128(letter, digit);
+}
+
+static uint32_t
+classifySse2(const char *data, size_t len, const Table &table)
+{
+    uint32_t classes = 0;
+    bool has_space = false;
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        __m128i space = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' '));
+        if (_mm_movemask_epi8(_mm_or_si128(alnumMaskSse2(bytes), space)) == 0xffff) {
+            has_space |= _mm_movemask_epi8(space) != 0;
+            continue;
+        }
+        classes |= classifyScalar(data + i, 16, table);
+    }
+
+    if (has_space) classes |= table[' '];
+    return classes | classifyScalar(data + i, len - i, table);
+}
+
+static size_t
+findFirstNonAlnumSse2(const char *data, size_t len)
+{
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        uint32_t other = ~_mm_movemask_epi8(alnumMaskSse2(bytes)) & 0xffff;
+        if (other != 0) return i + __builtin_ctz(other);
+    }
+    return i + findFirstNonAlnumScalar(data + i, len - i);
+}
+
+static size_t
+countNonPrintableSse2(const char *data, size_t len)
+{
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        __m128i printable = _mm_and_si128(
+            _mm_cmpgt_epi8(bytes, _mm_set1_epi8(0x1f)),
+            _mm_cmplt_epi8(bytes, _mm_set1_epi8(0x7f))
+        );
+        printable = _mm_or_si128(printable, _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\t')));
+        printable = _mm_or_si128(printable, _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')));
+        count += __builtin_popcount(~_mm_movemask_epi8(printable) & 0xffff);
+    }
+    return count + countNonPrintableScalar(data + i, len - i);
+}
+
+__attribute__((target("avx2"))) static inline __m256i
+alnumMaskAvx2(__m256i bytes)
+{
+    __m256i lower = _mm256_or_si256(bytes, _mm256_set1_epi8(0x20));
+    __m256i letter = _mm256_and_si256(
+        _mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower)
+    );
+    __m256i digit = _mm256_and_si256(
+        _mm256_cmpgt_epi8(bytes, _mm256_set1_epi8('0' - 1)),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), bytes)
+    );
+    return _mm256_or_si256(letter, digit);
+}
+
+__attribute__((target("avx2"))) static uint32_t
+classifyAvx2(const char *data, size_t len, const Table &table)
+{
+    uint32_t classes = 0;
+    bool has_space = false;
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        __m256i space = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' '));
+        if (_mm256_movemask_epi8(_mm256_or_si256(alnumMaskAvx2(bytes), space)) == -1) {
+            has_space |= _mm256_movemask_epi8(space) != 0;
+            continue;
+        }
+        classes |= classifyScalar(data + i, 32, table);
+    }
+
+    if (has_space) classes |= table[' '];
+    return classes | classifySse2(data + i, len - i, table);
+}
+
+__attribute__((target("avx2"))) static size_t
+findFirstNonAlnumAvx2(const char *data, size_t len)
+{
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        uint32_t other = ~static_cast<uint32_t>(_mm256_movemask_epi8(alnumMaskAvx2(bytes)));
+        if (other != 0) return i + __builtin_ctz(other);
+    }
+    return i + findFirstNonAlnumSse2(data + i, len - i);
+}
+
+__attribute__((target("avx2,popcnt"))) static size_t
+countNonPrintableAvx2(const char *data, size_t len)
+{
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        __m256i printable = _mm256_and_si256(
+            _mm256_cmpgt_epi8(bytes, _mm256_set1_epi8(0x1f)),
+            _mm256_cmpgt_epi8(_mm256_set1_epi8(0x7f), bytes)
+        );
+        printable = _mm256_or_si256(printable, _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\t')));
+        printable = _mm256_or_si256(printable, _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n')));
+        count += __builtin_popcount(~static_cast<uint32_t>(_mm256_movemask_epi8(printable)));
+    }
+    return count + countNonPrintableSse2(data + i, len - i);
+}
+
+#endif // WAAP_CHAR_CLASS_X86
+
+std::vector<Kernels>
+getSupportedKernels()
+{
+    std::vector<Kernels> kernels = {
+        { "scalar", classifyScalar, findFirstNonAlnumScalar, countNonPrintableScalar }
+    };
+#ifdef WAAP_CHAR_CLASS_X86
+    kernels.push_back({ "sse2", classifySse2, findFirstNonAlnumSse2, countNonPrintableSse2 });
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+        kernels.push_back({ "avx2", classifyAvx2, findFirstNonAlnumAvx2, countNonPrintableAvx2 });
+    }
+#endif
+    return kernels;
+}
+
+static const Kernels &
+getKernels()
+{
+    static const Kernels kernels = getSupportedKernels().back();
+    return kernels;
+}
+
+uint32_t
+classify(const char *data, size_t len, const Table &table)
+{
+    return getKernels().classify(data, len, table);
+}
+
+size_t
+findFirstNonAlnum(const char *data, size_t len)
+{
+    return getKernels().findFirstNonAlnum(data, len);
+}
+
+size_t
+countNonPrintable(const char *data, size_t len)
+{
+    return getKernels().countNonPrintable(data, len);
+}
+
+} // namespace CharClass
+} // namespace Waap
@@ -0,0 +1,53 @@
+// Copyright (C) 2022 Check Point Software Technologies Ltd. All rights reserved.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Byte scanning kernels used by the value pre-filters.
+// On x86-64 they run on AVX2 or SSE2 (selected once at runtime, based on the CPU), elsewhere a scalar
+// implementation is used. All implementations return the same results.
+namespace Waap {
+namespace CharClass {
+
+// Class mask of every byte value. The masks of ASCII letters and digits must be 0: runs of letters, digits and
+// spaces are recognized without looking at the table.
+typedef std::array<uint32_t, 256> Table;
+
+// Returns the OR of the class masks of all bytes in the buffer
+uint32_t classify(const char *data, size_t len, const Table &table);
+
+// Returns the offset of the first byte that is not an ASCII letter or digit, or len if there is none
+size_t findFirstNonAlnum(const char *data, size_t len);
+
+// Returns the number of bytes that are not printable ASCII characters, not counting '\t' and '\n'
+size_t countNonPrintable(const char *data, size_t len);
+
+// One implementation of the kernels above
+struct Kernels
+{
+    const char *name;
+    uint32_t (*classify)(const char *data, size_t len, const Table &table);
+    size_t (*findFirstNonAlnum)(const char *data, size_t len);
+    size_t (*countNonPrintable)(const char *data, size_t len);
+};
+
+// Returns the implementations the running CPU supports, from the scalar one to the one that is used.
+// Exposed for the unit tests.
+std::vector<Kernels> getSupportedKernels();
+
+} // namespace CharClass
+} // namespace Waap
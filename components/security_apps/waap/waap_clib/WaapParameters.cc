@@ -12,6 +12,9 @@
 // limitations under the License.
 
 #include "WaapParameters.h"
+#include "debug.h"
+
+USE_DEBUG_FLAG(D_WAAP);
 
 using namespace Waap::Parameters;
 
@@ -33,3 +36,20 @@ Value WaapParameters::getParamVal(Parameter key, Value defaultVal)
     }
     return m_paramMap[key];
 }
+
+void WaapParameters::parseScanParameters()
+{
+    auto maxBodySize = m_paramMap.find("max_body_size");
+    if (maxBodySize != m_paramMap.end() && !maxBodySize->second.empty()) {
+        try {
+            m_scanParameters.maxBodySize = std::stoul(maxBodySize->second);
+            m_scanParameters.hasMaxBodySize = true;
+        } catch (const std::exception &e) {
+            dbgWarning(D_WAAP) << "Ignoring invalid max_body_size parameter '" << maxBodySize->second << "': " <<
+                e.what();
+        }
+    }
+
+    auto filtersVerbose = m_paramMap.find("filtersVerbose");
+    m_scanParameters.filtersVerbose = filtersVerbose != m_paramMap.end() && filtersVerbose->second == "true";
+}
@@ -24,6 +24,18 @@ namespace Waap {
         typedef std::string Value;
         typedef std::unordered_map<Parameter, Value> ParamMap;
 
+        // Parameters that are read while traffic is inspected, parsed once when the policy is loaded
+        struct ScanParameters
+        {
+            ScanParameters() : hasMaxBodySize(false), maxBodySize(0), filtersVerbose(false) {}
+
+            // "max_body_size": request body bytes to scan. No limit when absent or invalid.
+            bool hasMaxBodySize;
+            size_t maxBodySize;
+            // "filtersVerbose": report the keywords removed by the learned filters
+            bool filtersVerbose;
+        };
+
         class WaapParameters
         {
         public:
@@ -31,14 +43,19 @@ namespace Waap {
             WaapParameters(_A& ar)
             {
                 ar(cereal::make_nvp("waapParameters", m_paramMap));
+                parseScanParameters();
             }
 
             bool operator==(const WaapParameters &other) const;
 
             ParamMap getParamsMap() const;
             Value getParamVal(Parameter key, Value defaultVal);
+            const ScanParameters &getScanParameters() const { return m_scanParameters; }
         private:
+            void parseScanParameters();
+
             ParamMap m_paramMap;
+            ScanParameters m_scanParameters;
         };
 
     }
@@ -128,7 +128,7 @@ std::string buildWaapResultJson(Waf2ScanResult *m_scanResult, const Waf2Transact
             root.gen_key("k_api");
             {
                 Waap::Util::Yajl::Array k_api(y);
-                for (std::vector<DeepParser::KeywordInfo>::const_iterator it = keywordInfo.begin();
+                for (DeepParser::KeywordInfos::const_iterator it = keywordInfo.begin();
                     it != keywordInfo.end();
                     ++it) {
                     const DeepParser::KeywordInfo& keywordInfo = *it;
@@ -142,16 +142,19 @@ std::string buildWaapResultJson(Waf2ScanResult *m_scanResult, const Waf2Transact
             root.gen_key("x_kvs");
             {
                 Waap::Util::Yajl::Map x_kvs(y);
-                for (std::vector<std::pair<std::string, std::string> >::iterator it = kvPairs.begin();
+                for (DeepParser::KvPairs::iterator it = kvPairs.begin();
                     it != kvPairs.end();
                     ++it) {
-                    std::string& k = it->first;
-                    std::string& v = it->second;
+                    std::pmr::string& k = it->first;
+                    std::pmr::string& v = it->second;
                     x_kvs.gen_str(k, v);
                 }
             }
 
-            root.gen_str("x_body", t.getRequestBody());
+            // The raw body is only kept when the log trigger includes the web body, the same rule as the log itself
+            if (t.isRequestBodyCollected()) {
+                root.gen_str("x_body", t.getRequestBody());
+            }
             if (!notes.empty()) {
                 root.gen_key("notes");
                 Waap::Util::Yajl::Array jsNotes(y);
@@ -214,7 +217,7 @@ std::string buildWaapResultJson(Waf2ScanResult *m_scanResult, const Waf2Transact
             root.gen_key("k_api");
             {
                 Waap::Util::Yajl::Array k_api(y);
-                for (std::vector<DeepParser::KeywordInfo>::const_iterator it = keywordInfo.begin();
+                for (DeepParser::KeywordInfos::const_iterator it = keywordInfo.begin();
                     it != keywordInfo.end();
                     ++it) {
                     const DeepParser::KeywordInfo& keywordInfo = *it;
@@ -228,16 +231,19 @@ std::string buildWaapResultJson(Waf2ScanResult *m_scanResult, const Waf2Transact
             root.gen_key("x_kvs");
             {
                 Waap::Util::Yajl::Map x_kvs(y);
-                for (std::vector<std::pair<std::string, std::string> >::iterator it = kvPairs.begin();
+                for (DeepParser::KvPairs::iterator it = kvPairs.begin();
                     it != kvPairs.end();
                     ++it) {
-                    std::string& k = it->first;
-                    std::string& v = it->second;
+                    std::pmr::string& k = it->first;
+                    std::pmr::string& v = it->second;
                     x_kvs.gen_str(k, v);
                 }
             }
 
-            root.gen_str("x_body", t.getRequestBody());
+            // The raw body is only kept when the log trigger includes the web body, the same rule as the log itself
+            if (t.isRequestBodyCollected()) {
+                root.gen_str("x_body", t.getRequestBody());
+            }
             if (!notes.empty()) {
                 root.gen_key("notes");
                 Waap::Util::Yajl::Array jsNotes(y);
@@ -43,8 +43,8 @@ double Waap::Scanner::getScoreData(Waf2ScanResult& res, const std::string &poolN
         m_transaction->getAssetState()->filterKeywords(param_name, keywordsSet, res.filtered_keywords);
         if (m_transaction->getSiteConfig() != nullptr)
         {
-            auto waapParams = m_transaction->getSiteConfig()->get_WaapParametersPolicy();
-            if (waapParams != nullptr && waapParams->getParamVal("filtersVerbose", "false") == "true") {
+            const auto &waapParams = m_transaction->getSiteConfig()->get_WaapParametersPolicy();
+            if (waapParams != nullptr && waapParams->getScanParameters().filtersVerbose) {
                 m_transaction->getAssetState()->filterVerbose(param_name, res.filtered_keywords);
             }
         }
@@ -60,7 +60,7 @@ double Waap::Scanner::getScoreData(Waf2ScanResult& res, const std::string &poolN
     // Filter keywords due to wbxml data format
     DeepParser &dp = m_transaction->getDeepParser();
     bool isBrokenWBXML = (m_transaction->getContentType() == Waap::Util::CONTENT_TYPE_WBXML) && (dp.depth() == 0) &&
-        (dp.m_key.first().size() == 4 && dp.m_key.first() == "body" && !dp.isWBXmlData());
+        (dp.m_key.firstStage() == ScanStage::BODY && !dp.isWBXmlData());
 
     // If wbxml data detected heuristically, or if not detected but declared by content-type in header
     if (dp.isWBXmlData() || isBrokenWBXML) {
@@ -216,15 +216,13 @@ int Waap::Scanner::onKv(const char* k, size_t k_len, const char* v, size_t v_len
     res.clear();
     dbgTrace(D_WAAP_SCANNER) << "Waap::Scanner::onKv: k='" << key <<
         "' v='" << value << "'";
-    bool isCookiePayload = dp.m_key.first().size() == 6 && dp.m_key.first() == "cookie";
-    bool isUrlParamPayload = dp.m_key.first().size() == 9 && dp.m_key.first() == "url_param";
-    bool isSplitUrl = dp.m_key.first().size() == 3 &&
-        dp.m_key.first() == "url" &&
-        dp.m_key.str() != "";
-    bool isHeaderPayload = dp.m_key.first().size() == 6 && dp.m_key.first() == "header";
-    bool isRefererParamPayload =
-        (dp.m_key.first().size() == 13 && dp.m_key.first() == "referer_param");
-    bool isBodyPayload = dp.m_key.first().size() == 4 && dp.m_key.first() == "body";
+    ScanStage scanStage = dp.m_key.firstStage();
+    bool isCookiePayload = scanStage == ScanStage::COOKIE;
+    bool isUrlParamPayload = scanStage == ScanStage::URL_PARAM;
+    bool isSplitUrl = scanStage == ScanStage::URL && dp.m_key.str() != "";
+    bool isHeaderPayload = scanStage == ScanStage::HEADER;
+    bool isRefererParamPayload = scanStage == ScanStage::REFERER_PARAM;
+    bool isBodyPayload = scanStage == ScanStage::BODY;
     dbgTrace(D_WAAP_SCANNER) << "Waap::Scanner::onKv: depth=" <<
         dp.depth() << "; first='" << dp.m_key.first().c_str() << "'; key='" <<
         dp.m_key.str().c_str() << "'";
@@ -338,7 +336,7 @@ int Waap::Scanner::onKv(const char* k, size_t k_len, const char* v, size_t v_len
         dbgTrace(D_WAAP_SCANNER) << "Waap::Scanner::onKv: candidate to scan parameter names";
 
         // Deep-scan parameter names
-        if (m_transaction->getAssetState()->apply(key, res, dp.m_key.first())) {
+        if (m_transaction->getAssetState()->apply(key, res, scanStage)) {
             if (suspiciousHit(res, dp, dp.m_key.first(), dp.m_key.str(), key)) {
                 // Scanner found enough evidence to report this res
                 dbgTrace(D_WAAP_SCANNER) << "Waap::Scanner::onKv: SUSPICIOUS PARAM NAME: k='" <<
@@ -361,7 +359,7 @@ int Waap::Scanner::onKv(const char* k, size_t k_len, const char* v, size_t v_len
     res.clear();
 
     // Scan parameter value
-    if (m_transaction->getAssetState()->apply(value, res, dp.m_key.first(), dp.isBinaryData(),
+    if (m_transaction->getAssetState()->apply(value, res, scanStage, dp.isBinaryData(),
         dp.getSplitType()))
     {
         if (!param_name_res.keyword_matches.empty() && !res.keyword_matches.empty() &&
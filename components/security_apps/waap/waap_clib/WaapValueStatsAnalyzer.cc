@@ -14,8 +14,10 @@
 #include "WaapValueStatsAnalyzer.h"
 #include <string>
 #include <ctype.h>
+#include <string.h>
 #include "debug.h"
 #include "Waf2Util.h"
+#include "WaapCharClass.h"
 
 USE_DEBUG_FLAG(D_WAAP);
 
@@ -80,6 +82,59 @@ bool checkUrlEncoded(const char *buf, size_t len)
     return has_encoded_value;
 }
 
+// Byte classes computed by ValueStatsAnalyzer. Letters and digits have no class.
+enum ValueStatsClass : uint32_t
+{
+    VALUE_CLASS_SLASH = 1 << 0,
+    VALUE_CLASS_COLON = 1 << 1,
+    VALUE_CLASS_AMPERSAND = 1 << 2,
+    VALUE_CLASS_EQUAL = 1 << 3,
+    VALUE_CLASS_SEMICOLON = 1 << 4,
+    VALUE_CLASS_PIPE = 1 << 5,
+    VALUE_CLASS_LESS = 1 << 6,
+    VALUE_CLASS_DOUBLE_QUOTE = 1 << 7,
+    VALUE_CLASS_PERCENT = 1 << 8,
+    VALUE_CLASS_SPACE = 1 << 9,
+    VALUE_CLASS_NUL = 1 << 10,
+    VALUE_CLASS_NO_SEMICOLON_SPLIT = 1 << 11,
+    VALUE_CLASS_NO_PIPE_SPLIT = 1 << 12
+};
+
+static Waap::CharClass::Table
+buildValueStatsTable()
+{
+    Waap::CharClass::Table table{};
+    const std::string semicolonSplitChars = ".-_=,();";
+    const std::string pipeSplitChars = ":?.-_=,[]/ \f\v\t\r\n()|";
+
+    table['/'] |= VALUE_CLASS_SLASH;
+    table[':'] |= VALUE_CLASS_COLON;
+    table['&'] |= VALUE_CLASS_AMPERSAND;
+    table['='] |= VALUE_CLASS_EQUAL;
+    table[';'] |= VALUE_CLASS_SEMICOLON;
+    table['|'] |= VALUE_CLASS_PIPE;
+    table['<'] |= VALUE_CLASS_LESS;
+    table['\"'] |= VALUE_CLASS_DOUBLE_QUOTE;
+    table['%'] |= VALUE_CLASS_PERCENT;
+    table[0] |= VALUE_CLASS_NUL;
+
+    for (int ch = 0; ch < 256; ++ch) {
+        if (isspace(ch)) table[ch] |= VALUE_CLASS_SPACE;
+        if (Waap::Util::isAlphaAsciiFast(ch) || isdigit(ch)) continue;
+        if (semicolonSplitChars.find(ch) == std::string::npos) table[ch] |= VALUE_CLASS_NO_SEMICOLON_SPLIT;
+        if (pipeSplitChars.find(ch) == std::string::npos) table[ch] |= VALUE_CLASS_NO_PIPE_SPLIT;
+    }
+
+    return table;
+}
+
+static const Waap::CharClass::Table &
+getValueStatsTable()
+{
+    static const Waap::CharClass::Table table = buildValueStatsTable();
+    return table;
+}
+
 ValueStatsAnalyzer::ValueStatsAnalyzer(const std::string &cur_val)
     :
     hasCharSlash(false),
@@ -109,54 +164,38 @@ ValueStatsAnalyzer::ValueStatsAnalyzer(const std::string &cur_val)
         return;
     }
 
+    uint32_t classes = Waap::CharClass::classify(cur_val.data(), curValLength, getValueStatsTable());
+
+    hasCharSlash = (classes & VALUE_CLASS_SLASH) != 0;
+    hasCharColon = (classes & VALUE_CLASS_COLON) != 0;
+    hasCharAmpersand = (classes & VALUE_CLASS_AMPERSAND) != 0;
+    hasCharEqual = (classes & VALUE_CLASS_EQUAL) != 0;
+    hasCharSemicolon = (classes & VALUE_CLASS_SEMICOLON) != 0;
+    hasCharPipe = (classes & VALUE_CLASS_PIPE) != 0;
+    hasCharLess = (classes & VALUE_CLASS_LESS) != 0;
+    hasDoubleQuote = (classes & VALUE_CLASS_DOUBLE_QUOTE) != 0;
+    hasPercent = (classes & VALUE_CLASS_PERCENT) != 0;
+    hasSpace = (classes & VALUE_CLASS_SPACE) != 0;
+    // Only alphanumeric characters and characters listed in the table are allowed, anything else disables split
+    canSplitSemicolon = (classes & VALUE_CLASS_NO_SEMICOLON_SPLIT) == 0;
+    canSplitPipe = (classes & VALUE_CLASS_NO_PIPE_SPLIT) == 0;
+
+    if (hasCharEqual) {
+        const char *firstEqual = static_cast<const char *>(memchr(cur_val.data(), '=', curValLength));
+        size_t restLength = curValLength - (firstEqual + 1 - cur_val.data());
+        hasTwoCharsEqual = memchr(firstEqual + 1, '=', restLength) != nullptr;
+    }
+
     // Decide the input is candidate for UTF16 if all the following rules apply:
     // 1. Input buffer length is longer than 2 bytes
     // 2. Input buffer length is divisible by 2
     isUTF16 = (curValLength > 2) && (curValLength % 2 == 0);
 
-    for (size_t i = 0; i < curValLength; ++i)
+    // Without ASCII NUL bytes the longest zeros sequences stay 0, so there is nothing to count
+    for (size_t i = 0; (classes & VALUE_CLASS_NUL) && i < curValLength; ++i)
     {
         unsigned char ch = (unsigned char)cur_val[i];
 
-        switch(ch) {
-            case '/':
-                hasCharSlash = true;
-                break;
-            case ':':
-                hasCharColon = true;
-                break;
-            case '&':
-                hasCharAmpersand = true;
-                break;
-            case '=':
-                if (!hasTwoCharsEqual) {
-                    if (hasCharEqual) {
-                        hasTwoCharsEqual = true;
-                    }
-                    hasCharEqual = true;
-                }
-                break;
-            case ';':
-                hasCharSemicolon = true;
-                break;
-            case '|':
-                hasCharPipe = true;
-                break;
-            case '<':
-                hasCharLess = true;
-                break;
-            case '\"':
-                hasDoubleQuote = true;
-                break;
-            case '%':
-                hasPercent = true;
-                break;
-        }
-
-        if (isspace(ch)) {
-            hasSpace = true;
-        }
-
         // The index will be 0 for even, and 1 for odd offsets
         int index = i % 2;
 
@@ -188,53 +227,6 @@ ValueStatsAnalyzer::ValueStatsAnalyzer(const std::string &cur_val)
             zerosSeq[index] = 0;
             lastNul = false;
         }
-
-        bool isAlphaNumeric = Waap::Util::isAlphaAsciiFast(ch) || isdigit(ch);
-
-        if (canSplitSemicolon && !isAlphaNumeric) {
-            switch (ch) {
-                case '.':
-                case '-':
-                case '_':
-                case '=':
-                case ',':
-                case '(':
-                case ')':
-                case ';':
-                    break;
-                default:
-                    // Only alphanumeric characters and characters listed above are allowed, anything else disables
-                    canSplitSemicolon = false;
-            }
-        }
-
-        if (canSplitPipe && !isAlphaNumeric) {
-            switch (ch) {
-                case ':':
-                case '?':
-                case '.':
-                case '-':
-                case '_':
-                case '=':
-                case ',':
-                case '[':
-                case ']':
-                case '/' :
-                case ' ':
-                case '\f':
-                case '\v':
-                case '\t':
-                case '\r':
-                case '\n':
-                case '(':
-                case ')':
-                case '|':
-                    break;
-                default:
-                    // Only alphanumeric characters and characters listed above are allowed, anything else disables
-                    canSplitPipe = false;
-            }
-        }
     }
 
     // Only decode UTF16 if at least one longest zero bytes sequence (computed over odd
@@ -243,8 +235,8 @@ ValueStatsAnalyzer::ValueStatsAnalyzer(const std::string &cur_val)
     if (longestZerosSeq[0] <= 2 && longestZerosSeq[1] <= 2) {
         isUTF16 = false;
     }
-    // Detect URLEncode value
-    isUrlEncoded = checkUrlEncoded(cur_val.data(), cur_val.size());
+    // Detect URLEncode value (an URL encoded value must have at least one '%')
+    isUrlEncoded = hasPercent && checkUrlEncoded(cur_val.data(), cur_val.size());
 
     textual.clear();
     textual.append("hasCharSlash = ");
@@ -17,7 +17,7 @@
 bool checkUrlEncoded(const char *buf, size_t len);
 
 // Process value (buffer) and calculate some statistics/insights over it, for use in later processing.
-// The insights are computed in te same for loop for performance reasons.
+// The insights are computed in a single pass over the buffer for performance reasons.
 struct ValueStatsAnalyzer
 {
     ValueStatsAnalyzer(const std::string &cur_val);
@@ -72,6 +72,31 @@ using namespace std;
 // Score threshold below which the match won't be considered
 #define SCORE_THRESHOLD (1.4f)
 
+namespace {
+
+// Reports the time spent in a scan stage to the WAAP scan latency metric once it goes out of scope
+class ScanStageLatency
+{
+public:
+    ScanStageLatency(WaapScanLatencyEvent::Stage _stage)
+            :
+        stage(_stage),
+        start_time(Singleton::Consume<I_TimeGet>::by<WaapComponent>()->getMonotonicTime())
+    {}
+
+    ~ScanStageLatency()
+    {
+        auto latency = Singleton::Consume<I_TimeGet>::by<WaapComponent>()->getMonotonicTime() - start_time;
+        WaapScanLatencyEvent(stage, chrono::duration_cast<chrono::microseconds>(latency).count()).notify();
+    }
+
+private:
+    WaapScanLatencyEvent::Stage stage;
+    chrono::microseconds start_time;
+};
+
+} // namespace
+
 void Waf2Transaction::learnScore(ScoreBuilderData& data, const std::string &poolName)
 {
     m_pWaapAssetState->scoreBuilder.analyzeFalseTruePositive(data, poolName, !m_ignoreScore);
@@ -160,7 +185,7 @@ void Waf2Transaction::add_response_hdr(const char* name, int name_len, const cha
         if (errorDisclosurePolicy && errorDisclosurePolicy->enable) {
             // Scan response header values
             Waf2ScanResult res;
-            if (m_pWaapAssetState->apply(std::string(value, value_len), res, "resp_header")) {
+            if (m_pWaapAssetState->apply(std::string(value, value_len), res, ScanStage::RESP_HEADER)) {
                 // Found some signatures in response!
                 delete m_scanResult;
                 m_scanResult = new Waf2ScanResult(res);
@@ -250,10 +275,11 @@ void Waf2Transaction::scanErrDisclosureBuffer()
     if (m_responseStatus >= 400 && m_responseStatus <= 599) {
         auto errorDisclosurePolicy = m_siteConfig ? m_siteConfig->get_ErrorDisclosurePolicy() : NULL;
         if (errorDisclosurePolicy && errorDisclosurePolicy->enable) {
+                ScanStageLatency scan_latency(WaapScanLatencyEvent::Stage::ERROR_DISCLOSURE);
                 // Scan response body chunks.
                 Waf2ScanResult res;
                 if (m_pWaapAssetState->apply(std::string(m_response_body_err_disclosure.data(),
-                    m_response_body_err_disclosure.size()), res, "resp_body")) {
+                    m_response_body_err_disclosure.size()), res, ScanStage::RESP_BODY)) {
                     // Found some signatures in response!
                     delete m_scanResult;
                     m_scanResult = new Waf2ScanResult(res);
@@ -321,6 +347,9 @@ Waf2Transaction::Waf2Transaction() :
     m_processedHeaders(false),
     m_isHeaderOverrideScanRequired(false),
     m_isScanningRequired(false),
+    m_isScanResultUpdated(false),
+    m_collectRequestBody(false),
+    m_isRequestBodyEarlyVerdictEnabled(false),
     m_responseStatus(0),
     m_responseInspectReasons(),
     m_responseInjectReasons(),
@@ -360,6 +389,9 @@ Waf2Transaction::Waf2Transaction(std::shared_ptr<WaapAssetState> pWaapAssetState
     m_processedHeaders(false),
     m_isHeaderOverrideScanRequired(false),
     m_isScanningRequired(false),
+    m_isScanResultUpdated(false),
+    m_collectRequestBody(false),
+    m_isRequestBodyEarlyVerdictEnabled(false),
     m_responseStatus(0),
     m_responseInspectReasons(),
     m_responseInjectReasons(),
@@ -1110,10 +1142,12 @@ void Waf2Transaction::end_request_hdrs() {
     }
     // Scan URL and url query
     if (m_isScanningRequired && !m_processedUri) {
+        ScanStageLatency scan_latency(WaapScanLatencyEvent::Stage::URL);
         processUri(m_uriStr, "url");
     }
     // Scan relevant headers for attacks
     if (m_isScanningRequired && !m_processedHeaders) {
+        ScanStageLatency scan_latency(WaapScanLatencyEvent::Stage::HEADERS);
         scanHeaders();
     }
 
@@ -1164,6 +1198,26 @@ void Waf2Transaction::start_request_body() {
 
     m_request_body_bytes_received = 0;
     m_request_body.clear();
+    m_collectRequestBody = shouldCollectRequestBody();
+    m_isRequestBodyEarlyVerdictEnabled =
+        getProfileAgentSettingWithDefault<bool>(true, "appsec.requestBody.earlyVerdict");
+    // Findings of the URL and headers were already decided on after the headers
+    m_isScanResultUpdated = false;
+}
+
+bool Waf2Transaction::shouldCollectRequestBody()
+{
+    if (m_siteConfig == NULL) {
+        return false;
+    }
+
+    const std::shared_ptr<Waap::Trigger::Policy> triggerPolicy = m_siteConfig->get_TriggerPolicy();
+    if (!triggerPolicy) {
+        return false;
+    }
+
+    const std::shared_ptr<Waap::Trigger::Log> triggerLog = getTriggerLog(triggerPolicy);
+    return triggerLog && triggerLog->webBody;
 }
 
 void Waf2Transaction::add_request_body_chunk(const char* data, int data_len) {
@@ -1179,20 +1233,17 @@ void Waf2Transaction::add_request_body_chunk(const char* data, int data_len) {
 
     if (m_siteConfig != NULL)
     {
-        auto waapParams = m_siteConfig->get_WaapParametersPolicy();
-        if (waapParams != nullptr)
+        const auto &waapParams = m_siteConfig->get_WaapParametersPolicy();
+        if (waapParams != nullptr && waapParams->getScanParameters().hasMaxBodySize)
         {
-            std::string maxSizeToScanStr = waapParams->getParamVal("max_body_size", "");
-            if (maxSizeToScanStr != "")
-            {
-                maxSizeToScan = std::stoul(maxSizeToScanStr.c_str());
-            }
+            maxSizeToScan = waapParams->getScanParameters().maxBodySize;
         }
     }
 
     if (m_isScanningRequired && m_request_body_bytes_received <= maxSizeToScan)
     {
         if (m_requestBodyParser != NULL) {
+            ScanStageLatency scan_latency(WaapScanLatencyEvent::Stage::REQUEST_BODY);
             m_requestBodyParser->push(data, data_len);
             if (isObjectDepthLimitReached(m_deepParser.getLocalMaxObjectDepth())) {
                 dbgTrace(D_WAAP_ULIMITS) << "[USER LIMITS] Object depth limit exceeded";
@@ -1206,7 +1257,10 @@ void Waf2Transaction::add_request_body_chunk(const char* data, int data_len) {
         }
     }
 
-    // Collect up to MAX_REQUEST_BODY_SIZE of input data for each request
+    // Collect up to MAX_REQUEST_BODY_SIZE of input data for each request, only when it is going to be logged
+    if (!m_collectRequestBody) {
+        return;
+    }
     if (m_request_body.length() + data_len <= MAX_REQUEST_BODY_SIZE) {
         m_request_body.append(data, (size_t)data_len);
     }
@@ -1221,12 +1275,13 @@ void Waf2Transaction::end_request_body() {
     dbgTrace(D_WAAP) << "[transaction:" << this << "] end_request_body";
 
     if (m_requestBodyParser != NULL) {
+        ScanStageLatency scan_latency(WaapScanLatencyEvent::Stage::REQUEST_BODY);
         m_requestBodyParser->finish();
         if (isObjectDepthLimitReached(m_deepParser.getLocalMaxObjectDepth())) {
             dbgTrace(D_WAAP_ULIMITS) << "[USER LIMITS] Object depth limit exceeded";
         }
 
-        if (m_contentType != Waap::Util::CONTENT_TYPE_UNKNOWN && m_request_body.length() > 0) {
+        if (m_contentType != Waap::Util::CONTENT_TYPE_UNKNOWN && m_request_body_bytes_received > 0) {
             m_deepParser.m_key.pop("body");
         }
     }
@@ -1511,27 +1566,52 @@ bool
 Waf2Transaction::decideAfterHeaders()
 {
     dbgFlow(D_WAAP) << "Waf2Transaction::decideAfterHeaders()";
+    return decideBeforeRequestEnd(true);
+}
 
+// Called after each request body chunk. The values of the chunk were already scanned while it was parsed, so a
+// prevent decision can be taken as soon as the score crosses the threshold, without waiting for the body to end.
+bool
+Waf2Transaction::decideAfterRequestBodyChunk()
+{
+    if (!m_isScanResultUpdated) {
+        return false;
+    }
+    m_isScanResultUpdated = false;
+
+    if (!m_isRequestBodyEarlyVerdictEnabled) {
+        return false;
+    }
+
+    dbgFlow(D_WAAP) << "Waf2Transaction::decideAfterRequestBodyChunk()";
+    return decideBeforeRequestEnd(false);
+}
+
+bool
+Waf2Transaction::decideBeforeRequestEnd(bool afterHeaders)
+{
     WaapConfigAPI ngenAPIConfig;
     WaapConfigApplication ngenSiteConfig;
     IWaapConfig *sitePolicy = NULL; // will be NULL or point to either API or SITE config.
 
     if (WaapConfigAPI::getWaapAPIConfig(ngenAPIConfig)) {
-        dbgTrace(D_WAAP) << "Waf2Transaction::decideAfterHeaders(): got relevant API configuration from the I/S";
+        dbgTrace(D_WAAP) << "Waf2Transaction::decideBeforeRequestEnd(): got relevant API configuration from the I/S";
         sitePolicy = &ngenAPIConfig;
     }
     else if (WaapConfigApplication::getWaapSiteConfig(ngenSiteConfig)) {
         dbgTrace(D_WAAP) <<
-            "Waf2Transaction::decideAfterHeaders(): got relevant Application configuration from the I/S";
+            "Waf2Transaction::decideBeforeRequestEnd(): got relevant Application configuration from the I/S";
         sitePolicy = &ngenSiteConfig;
     }
 
     if (!sitePolicy) {
-        dbgTrace(D_WAAP) << "Waf2Transaaction::decideAfterHeaders(): no policy - do not block";
+        dbgTrace(D_WAAP) << "Waf2Transaction::decideBeforeRequestEnd(): no policy - do not block";
         return false;
     }
 
-    m_isHeaderOverrideScanRequired = true;
+    if (afterHeaders) {
+        m_isHeaderOverrideScanRequired = true;
+    }
     m_overrideState = getOverrideState(sitePolicy);
 
     // Select scores pool by location (but use forced pool when forced)
@@ -1541,6 +1621,7 @@ Waf2Transaction::decideAfterHeaders()
             KEYWORDS_SCORE_POOL_BASE;
 
     // Autonomus Security
+    // Until the request ends the score is only learned when the request is blocked
     AnalysisResult analysisResult;
     bool shouldBlock = decideAutonomousSecurity(
         *sitePolicy,
@@ -2339,6 +2420,7 @@ Waf2Transaction::reportScanResult(const Waf2ScanResult &res) {
         // Forget any previous scan result and replace wit, h new
         delete m_scanResult;
         m_scanResult = new Waf2ScanResult(res);
+        m_isScanResultUpdated = true;
         return true;
     }
 
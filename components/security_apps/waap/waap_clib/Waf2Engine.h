@@ -94,8 +94,8 @@ public:
     const std::map<std::string, std::vector<std::string>> getFilteredVerbose() const;
     virtual const std::vector<std::string> getKeywordsCombinations() const;
     virtual const std::vector<std::string> getKeywordsAfterFilter() const;
-    const std::vector<DeepParser::KeywordInfo>& getKeywordInfo() const;
-    const std::vector<std::pair<std::string, std::string> >& getKvPairs() const;
+    const DeepParser::KeywordInfos& getKeywordInfo() const;
+    const DeepParser::KvPairs& getKvPairs() const;
     const std::string getKeywordMatchesStr() const;
     const std::string getFilteredKeywordsStr() const;
     const std::string getSample() const;
@@ -123,6 +123,7 @@ public:
     std::vector<std::pair<std::string, std::string> > getHdrPairs() const;
     virtual const std::string getHdrContent(std::string hdrName) const;
     const std::string getRequestBody() const;
+    bool isRequestBodyCollected() const;
     const std::string getTransactionIdStr() const;
     const WaapDecision &getWaapDecision() const;
     virtual std::shared_ptr<WaapAssetState> getAssetState();
@@ -173,6 +174,7 @@ public:
         bool& bForceException,
         int mode);
     bool decideAfterHeaders();
+    bool decideAfterRequestBodyChunk();
     int decideFinal(
         int mode,
         AnalysisResult &transactionResult,
@@ -234,7 +236,9 @@ public:
     // LCOV_EXCL_STOP
 
 private:
+    bool decideBeforeRequestEnd(bool afterHeaders);
     int finalizeDecision(IWaapConfig *sitePolicy, bool shouldBlock);
+    bool shouldCollectRequestBody();
     const std::shared_ptr<Waap::Trigger::Log> getTriggerLog(const std::shared_ptr<Waap::Trigger::Policy>&
         triggerPolicy) const;
     bool isTriggerReportExists(const std::shared_ptr<Waap::Trigger::Policy> &triggerPolicy);
@@ -356,6 +360,12 @@ private:
     bool m_processedHeaders;
     bool m_isHeaderOverrideScanRequired;
     bool m_isScanningRequired;
+    // Set when a scan result with a higher score is reported, so the decision is re-evaluated mid-body only then
+    bool m_isScanResultUpdated;
+    // The raw request body is kept only when the log trigger asks for it
+    bool m_collectRequestBody;
+    // The appsec.requestBody.earlyVerdict profile setting, read once when the request body starts
+    bool m_isRequestBodyEarlyVerdictEnabled;
     int m_responseStatus;
     Waap::ResponseInspectReasons m_responseInspectReasons;
     Waap::ResponseInjectReasons m_responseInjectReasons;
@@ -198,11 +198,11 @@ const std::vector<std::string> Waf2Transaction::getKeywordsAfterFilter() const
     return std::vector<std::string>();
 }
 
-const std::vector<DeepParser::KeywordInfo>& Waf2Transaction::getKeywordInfo() const
+const DeepParser::KeywordInfos& Waf2Transaction::getKeywordInfo() const
 {
     return m_deepParser.m_keywordInfo;
 }
-const std::vector<std::pair<std::string, std::string> >& Waf2Transaction::getKvPairs() const
+const DeepParser::KvPairs& Waf2Transaction::getKvPairs() const
 {
     return m_deepParser.kv_pairs;
 }
@@ -326,6 +326,10 @@ const std::string Waf2Transaction::getRequestBody() const
 {
     return m_request_body;
 }
+bool Waf2Transaction::isRequestBodyCollected() const
+{
+    return m_collectRequestBody;
+}
 const std::string Waf2Transaction::getTransactionIdStr() const
 {
     return boost::uuids::to_string(m_transaction_id);
@@ -20,6 +20,35 @@
 
 USE_DEBUG_FLAG(D_WAAP_REGEX);
 
+// SubjectBytes
+
+SubjectBytes::SubjectBytes() : m_size(std::string::npos)
+{
+    m_bits.fill(~uint64_t(0));
+}
+
+void SubjectBytes::collect(const std::string &s)
+{
+    m_bits.fill(0);
+    for (unsigned char c : s) {
+        m_bits[c >> 6] |= uint64_t(1) << (c & 63);
+    }
+    m_size = s.size();
+}
+
+bool SubjectBytes::hasAny(const std::array<uint64_t, 4> &bits) const
+{
+    return ((m_bits[0] & bits[0]) | (m_bits[1] & bits[1]) | (m_bits[2] & bits[2]) | (m_bits[3] & bits[3])) != 0;
+}
+
+// Patterns are compiled without locale tables, so only ASCII letters have another case
+static uint8_t otherAsciiCase(uint8_t c)
+{
+    if (c >= 'a' && c <= 'z') return c - 'a' + 'A';
+    if (c >= 'A' && c <= 'Z') return c - 'A' + 'a';
+    return c;
+}
+
 // SingleRegex
 
 SingleRegex::SingleRegex(
@@ -35,7 +64,11 @@ SingleRegex::SingleRegex(
     m_regexName(regexName),
     m_noRegex(bNoRegex),
     m_regexMatchName(regexMatchName),
-    m_regexMatchValue(regexMatchValue)
+    m_regexMatchValue(regexMatchValue),
+    m_minLength(0),
+    m_hasFirstCodeUnit(false),
+    m_hasRequiredCodeUnit(false),
+    m_hasStartBitmap(false)
     {
     dbgTrace(D_WAAP_REGEX) << "Create SingleRegex '" << m_regexName << "' PATTERN: '" <<
         std::string(pattern.data(), pattern.size()) << "'";
@@ -105,6 +138,69 @@ SingleRegex::SingleRegex(
         // After the index comes zero-terminated capture name. Consume it too.
         m_captureNames[captureIndex] = (char*)nameTableEntry;
     }
+
+    loadMatchRequirements();
+}
+
+void SingleRegex::loadMatchRequirements()
+{
+    // These are the same facts pcre2_match() checks before scanning, so skipping a pattern that fails them
+    // never changes the result.
+    pcre2_pattern_info(m_re, PCRE2_INFO_MINLENGTH, &m_minLength);
+
+    uint32_t codeType;
+    uint32_t codeUnit;
+    pcre2_pattern_info(m_re, PCRE2_INFO_FIRSTCODETYPE, &codeType);
+    if (codeType == 1) {
+        pcre2_pattern_info(m_re, PCRE2_INFO_FIRSTCODEUNIT, &codeUnit);
+        m_hasFirstCodeUnit = true;
+        m_firstCodeUnit[0] = codeUnit;
+        m_firstCodeUnit[1] = otherAsciiCase(codeUnit);
+    }
+
+    pcre2_pattern_info(m_re, PCRE2_INFO_LASTCODETYPE, &codeType);
+    if (codeType == 1) {
+        pcre2_pattern_info(m_re, PCRE2_INFO_LASTCODEUNIT, &codeUnit);
+        m_hasRequiredCodeUnit = true;
+        m_requiredCodeUnit[0] = codeUnit;
+        m_requiredCodeUnit[1] = otherAsciiCase(codeUnit);
+    }
+
+    const uint8_t *startBitmap = NULL;
+    pcre2_pattern_info(m_re, PCRE2_INFO_FIRSTBITMAP, &startBitmap);
+    if (startBitmap != NULL) {
+        m_hasStartBitmap = true;
+        for (size_t i = 0; i < m_startBitmap.size(); ++i) {
+            m_startBitmap[i] = 0;
+            for (size_t byte = 0; byte < sizeof(uint64_t); ++byte) {
+                m_startBitmap[i] |= uint64_t(startBitmap[i * sizeof(uint64_t) + byte]) << (byte * 8);
+            }
+        }
+    }
+}
+
+bool SingleRegex::mayMatch(const SubjectBytes &subjectBytes) const
+{
+    // The "noRegex" patterns always report a match without scanning
+    if (m_noRegex || m_re == NULL) {
+        return true;
+    }
+
+    if (subjectBytes.size() < m_minLength) {
+        return false;
+    }
+
+    if (m_hasFirstCodeUnit && !subjectBytes.has(m_firstCodeUnit[0]) && !subjectBytes.has(m_firstCodeUnit[1])) {
+        return false;
+    }
+
+    if (m_hasRequiredCodeUnit &&
+        !subjectBytes.has(m_requiredCodeUnit[0]) &&
+        !subjectBytes.has(m_requiredCodeUnit[1])) {
+        return false;
+    }
+
+    return !m_hasStartBitmap || subjectBytes.hasAny(m_startBitmap);
 }
 
 SingleRegex::~SingleRegex() {
@@ -287,7 +383,8 @@ size_t SingleRegex::findMatchRanges(const std::string& s, std::vector<RegexMatch
 Regex::Regex(const std::string& pattern, bool &error, const std::string& regexName)
 :
 m_regexName(regexName),
-m_regexPreconditions(nullptr) // no need for preconditions for single regex mode
+m_regexPreconditions(nullptr), // no need for preconditions for single regex mode
+m_useBytePrefilter(false)
 {
     if (error) {
         // Skip initialization if already in error condition
@@ -308,7 +405,8 @@ Regex::Regex(
     std::shared_ptr<Waap::RegexPreconditions> regexPreconditions)
 :
 m_regexName(regexName),
-m_regexPreconditions(regexPreconditions)
+m_regexPreconditions(regexPreconditions),
+m_useBytePrefilter(false)
 {
     if (error) {
         // Skip initialization if already in error condition
@@ -387,6 +485,8 @@ m_regexPreconditions(regexPreconditions)
         assert(false); // this should never happen anymore.
         m_sre.push_back(new SingleRegex(acc + ")", error, m_regexName));
     }
+
+    m_useBytePrefilter = m_sre.size() > 1;
 }
 
 Regex::~Regex() {
@@ -402,12 +502,17 @@ Regex::~Regex() {
 }
 
 bool Regex::hasMatch(const std::string& s) const {
+    SubjectBytes subjectBytes;
+    if (m_useBytePrefilter) {
+        subjectBytes.collect(s);
+    }
+
     for (std::vector<SingleRegex*>::const_iterator ppSingleRegex = m_sre.begin();
         ppSingleRegex != m_sre.end();
         ++ppSingleRegex) {
         SingleRegex* pSingleRegex = *ppSingleRegex;
 
-        if (pSingleRegex->hasMatch(s)) {
+        if (pSingleRegex->mayMatch(subjectBytes) && pSingleRegex->hasMatch(s)) {
             dbgTrace(D_WAAP_REGEX) << "Regex['" << m_regexName << "']['" << pSingleRegex->getName() <<
                 "']::hasMatch() found!";
             return true;
@@ -421,6 +526,12 @@ size_t Regex::findAllMatches(const std::string& s, std::vector<RegexMatch>& matc
     const Waap::RegexPreconditions::PmWordSet *pmWordSet, size_t maxMatches) const {
     matches.clear();
 
+    // One pass over the value rules out most patterns of a large bundle without calling pcre2 for each of them
+    SubjectBytes subjectBytes;
+    if (m_useBytePrefilter) {
+        subjectBytes.collect(s);
+    }
+
     if (m_regexPreconditions && pmWordSet) {
         // If preconditions are enabled on this regex - execute them to make scanning more efficient
         std::unordered_set<size_t> dupIndices;
@@ -440,19 +551,25 @@ size_t Regex::findAllMatches(const std::string& s, std::vector<RegexMatch>& matc
                     // Avoid scanning the same regex index twice (in case it is registered for more than one wordIndex)
                     continue;
                 }
+                dupIndices.insert(regexIndex);
+
+                if (!m_sre[regexIndex]->mayMatch(subjectBytes)) {
+                    continue;
+                }
 
                 // Scan only regexes that are enabled by aho-corasick scan
                 m_sre[regexIndex]->findAllMatches(s, matches, maxMatches);
                 dbgTrace(D_WAAP_REGEX) << "Regex['" << m_sre[regexIndex]->getName() <<
                     "',index=" << regexIndex << "]::findAllMatches(): " << matches.size() << " matches found (so far)";
-
-                dupIndices.insert(regexIndex);
             }
         }
     }
     else {
         // When optimization is disabled - scan all regexes
         for (SingleRegex* pSingleRegex : m_sre) {
+            if (!pSingleRegex->mayMatch(subjectBytes)) {
+                continue;
+            }
             pSingleRegex->findAllMatches(s, matches, maxMatches);
             dbgTrace(D_WAAP_REGEX) << "Regex['" << m_regexName << "']['" << pSingleRegex->getName() <<
                 "']::findAllMatches(): " << matches.size() << " matches found (so far)";
@@ -651,3 +768,8 @@ const std::string &Regex::getName() const
 {
     return m_regexName;
 }
+
+void Regex::setBytePrefilter(bool enabled)
+{
+    m_useBytePrefilter = enabled && m_sre.size() > 1;
+}
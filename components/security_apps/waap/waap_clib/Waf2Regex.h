@@ -21,6 +21,7 @@
 #include "Waf2Util.h"
 #include "WaapRegexPreconditions.h"
 #include <pcre2.h>
+#include <array>
 #include <string>
 #include <vector>
 #include <boost/noncopyable.hpp>
@@ -48,6 +49,22 @@ struct RegexMatchRange {
     RegexMatchRange(PCRE2_SIZE start, PCRE2_SIZE end):start(start), end(end) {}
 };
 
+// Set of byte values that occur in a scanned string, for the pcre2 start-up-fact prefilter. It is collected in one
+// pass over the string and then checked against the start-up facts of each SingleRegex of a Regex in turn; it is not
+// a multi-pattern matcher, every pattern that is not ruled out still runs through pcre2 on its own.
+// Until collect() is called it holds every byte value, so no pattern is ruled out.
+class SubjectBytes {
+public:
+    SubjectBytes();
+    void collect(const std::string &s);
+    bool has(uint8_t c) const { return (m_bits[c >> 6] >> (c & 63)) & 1; }
+    bool hasAny(const std::array<uint64_t, 4> &bits) const;
+    size_t size() const { return m_size; }
+private:
+    std::array<uint64_t, 4> m_bits;
+    size_t m_size;
+};
+
 class SingleRegex : public boost::noncopyable {
 friend class Regex;
 public:
@@ -59,7 +76,12 @@ public:
             size_t max_matches = std::string::npos) const;
     size_t findMatchRanges(const std::string &s, std::vector<RegexMatchRange> &matchRanges) const;
     const std::string &getName() const;
+    // Returns false when the pattern can not match a string with these bytes, based on the pcre2 start-up facts
+    // (minimal length, first code unit, required code unit and first code unit bitmap) of the compiled pattern.
+    bool mayMatch(const SubjectBytes &subjectBytes) const;
 private:
+    void loadMatchRequirements();
+
     pcre2_code *m_re;
     pcre2_match_data *m_matchData;
     uint32_t m_captureGroupsCount;
@@ -68,6 +90,13 @@ private:
     bool m_noRegex;
     std::string m_regexMatchName;
     std::string m_regexMatchValue;
+    uint32_t m_minLength;
+    bool m_hasFirstCodeUnit;
+    uint8_t m_firstCodeUnit[2]; // both ASCII cases, since pcre2 does not report whether the unit is caseless
+    bool m_hasRequiredCodeUnit;
+    uint8_t m_requiredCodeUnit[2];
+    bool m_hasStartBitmap;
+    std::array<uint64_t, 4> m_startBitmap;
 };
 
 class Regex : public boost::noncopyable {
@@ -91,11 +120,16 @@ public:
         int &deletedCount,
         std::string &outStr) const;
     const std::string &getName() const;
+    // The start-up-fact prefilter is on by default for multi-pattern instances. Turning it off runs every pattern
+    // through pcre2, which gives the same matches (see waap_ut) and is the baseline of the regex benchmark.
+    void setBytePrefilter(bool enabled);
 private:
     std::vector<SingleRegex*> m_sre;
     std::string m_regexName;
     std::shared_ptr<Waap::RegexPreconditions> m_regexPreconditions;
     std::unordered_map<Waap::RegexPreconditions::WordIndex, std::vector<size_t>> m_wordToRegexIndices;
+    // Collecting the subject bytes only pays off when the same string is scanned by several patterns
+    bool m_useBytePrefilter;
 };
 
 #endif // __WAF2_REGEX_H__c31bc34a
@@ -1213,14 +1213,6 @@ base64_decode_status decodeBase64Chunk(
                 acc &= mask;
                 acc_bits -= 8;
 
-                // Count non-printable characters seen
-                if (!isprint(code) && (code != '\n') && (code != '\t')) {
-                    nonPrintableCharsCount++;
-                }
-                if (code == '\r') {
-                    spacer_count++;
-                }
-
                 decoded += (char)code;
                 decoded_occurences_counter[(char)code]++;
             }
@@ -1231,6 +1223,10 @@ base64_decode_status decodeBase64Chunk(
 
         // end of encoded sequence decoded.
 
+        // Count non-printable characters seen
+        nonPrintableCharsCount = Waap::CharClass::countNonPrintable(decoded.data(), decoded.size());
+        spacer_count = std::count(decoded.begin(), decoded.end(), '\r');
+
         dbgTrace(D_WAAP_BASE64)
             << "decoding done: decoded.size="
             << decoded.size()
@@ -15,6 +15,7 @@
 #define __WAF2_UTIL_H__148aa7e4
 
 #include "WaapValueStatsAnalyzer.h"
+#include "WaapCharClass.h"
 #include "log_generator.h"
 #include <assert.h>
 #include <memory.h>
@@ -24,6 +25,7 @@
 #include <vector>
 #include <set>
 #include <string>
+#include <string_view>
 #include <algorithm>
 #include <iomanip>
 #include <sstream>
@@ -980,13 +982,7 @@ namespace Util {
     }
 
     inline bool str_isalnum(const std::string & value) {
-        for (std::string::const_iterator pC = value.begin(); pC != value.end(); ++pC) {
-            if (!std::isalnum(*pC)) {
-                return false; // at least one non alphanumeric character detected
-            }
-        }
-
-        return true;
+        return Waap::CharClass::findFirstNonAlnum(value.data(), value.size()) == value.size();
     }
 
     inline bool isAllDigits(const std::string & value) {
@@ -1024,7 +1020,7 @@ namespace Util {
             {
                 yajl_gen_string(g, (unsigned char*)k.data(), k.size()); yajl_gen_null(g);
             }
-            void gen_str(const std::string& k, const std::string& v)
+            void gen_str(std::string_view k, std::string_view v)
             {
                 yajl_gen_string(g, (unsigned char*)k.data(), k.size());
                 yajl_gen_string(g, (unsigned char*)v.data(), v.size());
@@ -77,6 +77,24 @@ WaapComponent::Impl::init()
         ReportIS::Audience::INTERNAL
     );
     assets_metric.registerListener();
+    scan_latency_metric.init(
+        "WAAP scan latency",
+        ReportIS::AudienceTeam::WAAP,
+        ReportIS::IssuingEngine::AGENT_CORE,
+        std::chrono::minutes(10),
+        true,
+        ReportIS::Audience::INTERNAL
+    );
+    scan_latency_metric.registerListener();
+    value_cache_metric.init(
+        "WAAP value cache",
+        ReportIS::AudienceTeam::WAAP,
+        ReportIS::IssuingEngine::AGENT_CORE,
+        std::chrono::minutes(10),
+        true,
+        ReportIS::Audience::INTERNAL
+    );
+    value_cache_metric.registerListener();
     registerListener();
     waap_metric.registerListener();
 
@@ -283,6 +301,11 @@ WaapComponent::Impl::respond(const HttpRequestBodyEvent &event)
     waf2Transaction.add_request_body_chunk(dataBuf, dataBufLen);
 
     ngx_http_cp_verdict_e verdict = waf2Transaction.getUserLimitVerdict();
+    if (verdict == ngx_http_cp_verdict_e::TRAFFIC_VERDICT_INSPECT && waf2Transaction.decideAfterRequestBodyChunk()) {
+        // The values parsed so far are enough to block, no need to wait for the rest of the body
+        dbgTrace(D_WAAP) << "WaapComponent::Impl::respond(HttpRequestBodyEvent): returning DROP response.";
+        verdict = ngx_http_cp_verdict_e::TRAFFIC_VERDICT_DROP;
+    }
     if (verdict != ngx_http_cp_verdict_e::TRAFFIC_VERDICT_INSPECT) {
         finishTransaction(waf2Transaction);
     }
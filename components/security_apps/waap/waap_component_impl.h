@@ -75,6 +75,8 @@ private:
     EventVerdict drop_response;
     WaapMetricWrapper waap_metric;
     AssetsMetric assets_metric;
+    WaapScanLatencyMetric scan_latency_metric;
+    WaapValueCacheMetric value_cache_metric;
     I_Table* waapStateTable;
     // Count of transactions processed by this WaapComponent instance
     uint64_t transactionsCount;
@@ -0,0 +1,126 @@
+#include "WaapCharClass.h"
+
+#include <cctype>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cptest.h"
+
+using namespace std;
+using namespace testing;
+using namespace Waap::CharClass;
+
+static const size_t max_len = 100;
+static const size_t max_offset = 32;
+
+// Bytes around the boundaries of the ranges the kernels compare against
+static const string edge_bytes(
+    "\x00\x01\t\n\x0b\r\x1f \x21/0" "9:@AZ[`az{~\x7f\x80\x81\x9f\xa0\xc0\xdf\xe0\xfe\xff",
+    32
+);
+
+class WaapCharClassTest : public Test
+{
+public:
+    WaapCharClassTest() : kernels(getSupportedKernels()), buffer(max_offset + max_len + 64)
+    {
+        // Letters and digits must have no class, every other byte gets one of the bits, space its own bit
+        for (int ch = 0; ch < 256; ++ch) {
+            table[ch] = isalnum(ch) ? 0 : 1u << (ch % 30);
+        }
+        table[' '] = 1u << 31;
+    }
+
+    // Copies the data to the given offset and fills everything around it with bytes that would change the results
+    // if a kernel read outside of the buffer
+    const char *
+    place(const string &data, size_t offset)
+    {
+        fill(buffer.begin(), buffer.end(), '\x01');
+        copy(data.begin(), data.end(), buffer.begin() + offset);
+        return buffer.data() + offset;
+    }
+
+    void
+    expectSameAsScalar(const string &data)
+    {
+        const Kernels &scalar = kernels.front();
+        for (size_t offset = 0; offset < max_offset; ++offset) {
+            const char *start = place(data, offset);
+            uint32_t classes = scalar.classify(start, data.size(), table);
+            size_t first_non_alnum = scalar.findFirstNonAlnum(start, data.size());
+            size_t non_printable = scalar.countNonPrintable(start, data.size());
+
+            for (const Kernels &impl : kernels) {
+                SCOPED_TRACE(string(impl.name) + " offset " + to_string(offset) + " len " + to_string(data.size()));
+                EXPECT_EQ(impl.classify(start, data.size(), table), classes);
+                EXPECT_EQ(impl.findFirstNonAlnum(start, data.size()), first_non_alnum);
+                EXPECT_EQ(impl.countNonPrintable(start, data.size()), non_printable);
+            }
+        }
+    }
+
+    vector<Kernels> kernels;
+    vector<char> buffer;
+    Table table;
+    mt19937 random{12345};
+};
+
+TEST_F(WaapCharClassTest, scalar_results)
+{
+    const Kernels &scalar = kernels.front();
+    string data = "abc 1\t\n\x7f\x80";
+
+    EXPECT_EQ(string(scalar.name), "scalar");
+    EXPECT_EQ(scalar.classify(data.data(), data.size(), table), table[' '] | table['\t'] | table['\n'] |
+        table[0x7f] | table[0x80]);
+    EXPECT_EQ(scalar.findFirstNonAlnum(data.data(), data.size()), 3u);
+    EXPECT_EQ(scalar.countNonPrintable(data.data(), data.size()), 2u);
+    EXPECT_EQ(scalar.findFirstNonAlnum(data.data(), 0), 0u);
+}
+
+TEST_F(WaapCharClassTest, random_bytes)
+{
+    uniform_int_distribution<int> byte(0, 255);
+    for (size_t len = 0; len <= max_len; ++len) {
+        string data(len, '\0');
+        for (char &ch : data) ch = byte(random);
+        expectSameAsScalar(data);
+    }
+}
+
+TEST_F(WaapCharClassTest, random_edge_bytes)
+{
+    uniform_int_distribution<size_t> index(0, edge_bytes.size() - 1);
+    for (size_t len = 0; len <= max_len; ++len) {
+        string data(len, '\0');
+        for (char &ch : data) ch = edge_bytes[index(random)];
+        expectSameAsScalar(data);
+    }
+}
+
+TEST_F(WaapCharClassTest, alnum_and_spaces)
+{
+    uniform_int_distribution<size_t> index(0, 62);
+    const string chars = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 ";
+    for (size_t len = 0; len <= max_len; ++len) {
+        string data(len, '\0');
+        for (char &ch : data) ch = chars[index(random)];
+        expectSameAsScalar(data);
+        expectSameAsScalar(string(len, 'z'));
+    }
+}
+
+TEST_F(WaapCharClassTest, single_edge_byte_in_alnum_run)
+{
+    for (size_t len : {1, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100}) {
+        for (size_t pos = 0; pos < len; ++pos) {
+            for (char ch : edge_bytes) {
+                string data(len, 'a');
+                data[pos] = ch;
+                expectSameAsScalar(data);
+            }
+        }
+    }
+}
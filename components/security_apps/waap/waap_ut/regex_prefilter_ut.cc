@@ -0,0 +1,98 @@
+#include "Waf2Regex.h"
+
+#include <random>
+#include <sstream>
+
+#include "cptest.h"
+
+using namespace std;
+using namespace testing;
+
+// Patterns with different pcre2 start-up facts: first code unit, required code unit, caseless units, a first code
+// unit bitmap, a minimal length, and none at all.
+static const vector<string> prefilter_patterns = {
+    "union\\s+select",
+    "(?i)select\\s+\\w+\\s+from",
+    "<script",
+    "(?i:alert)\\s*\\(",
+    "[a-f0-9]{32}",
+    "%[0-9a-fA-F]{2}",
+    "\\.\\./",
+    "x{5,}",
+    "\\bor\\b\\s*\\d+=\\d+",
+    "^abc$",
+    "(?i)\\bjavascript:",
+    "(?P<quote>['\"])\\s*--",
+    "(?:.)+"
+};
+
+static const vector<string> subject_fragments = {
+    "union", "UNION", "select", "SeLeCt", " ", "\t", "from", "users", "<script", "<SCRIPT", "alert", "ALERT", "(",
+    "0123456789abcdef", "0123456789ABCDEF", "%2f", "%", "../", "..", "/", "xxxxx", "xx", "or", " 1=1", "abc",
+    "javascript:", "'", "\"", "--", "a", "Z", "-", "="
+};
+
+static string
+describeMatches(const vector<RegexMatch> &matches)
+{
+    stringstream description;
+    for (const RegexMatch &match : matches) {
+        description << "{";
+        for (const RegexMatch::MatchGroup &group : match.groups) {
+            description << group.index << ":" << group.name << "=" << group.value << ";";
+        }
+        description << "}";
+    }
+    return description.str();
+}
+
+TEST(WaapRegexPrefilter, same_matches_as_running_every_pattern)
+{
+    bool error = false;
+    Regex regex(prefilter_patterns, error, "prefilter_test", nullptr);
+    ASSERT_FALSE(error);
+
+    // A fixed seed, so a failure can be reproduced
+    mt19937 random_engine(20240612);
+    uniform_int_distribution<size_t> fragment_count(0, 10);
+    uniform_int_distribution<size_t> fragment_index(0, subject_fragments.size() - 1);
+
+    for (uint iteration = 0; iteration < 20000; iteration++) {
+        string subject;
+        for (size_t count = fragment_count(random_engine); count > 0; count--) {
+            subject += subject_fragments[fragment_index(random_engine)];
+        }
+
+        vector<RegexMatch> baseline_matches;
+        vector<RegexMatch> filtered_matches;
+
+        regex.setBytePrefilter(false);
+        bool baseline_has_match = regex.hasMatch(subject);
+        regex.findAllMatches(subject, baseline_matches);
+
+        regex.setBytePrefilter(true);
+        EXPECT_EQ(regex.hasMatch(subject), baseline_has_match) << "Subject: " << subject;
+        regex.findAllMatches(subject, filtered_matches);
+        ASSERT_EQ(describeMatches(filtered_matches), describeMatches(baseline_matches)) << "Subject: " << subject;
+    }
+}
+
+TEST(WaapRegexPrefilter, rules_out_patterns_by_start_up_facts)
+{
+    SubjectBytes subject_bytes;
+    subject_bytes.collect("UNION all SELECT");
+
+    bool error = false;
+    SingleRegex first_unit("union\\s+select", error, "first_unit");
+    SingleRegex caseless("(?i)union\\s+select", error, "caseless");
+    SingleRegex required_unit("\\w+<", error, "required_unit");
+    SingleRegex min_length("[a-z]{20}", error, "min_length");
+    ASSERT_FALSE(error);
+
+    // Both ASCII cases of a code unit are accepted, since pcre2 does not report whether the unit is caseless
+    EXPECT_TRUE(first_unit.mayMatch(subject_bytes));
+    EXPECT_TRUE(caseless.mayMatch(subject_bytes));
+    EXPECT_FALSE(required_unit.mayMatch(subject_bytes));
+    EXPECT_FALSE(min_length.mayMatch(subject_bytes));
+    EXPECT_TRUE(min_length.mayMatch(SubjectBytes()));
+}
@@ -0,0 +1,43 @@
+#include "ScanResult.h"
+
+#include "cptest.h"
+
+using namespace std;
+using namespace testing;
+
+TEST(CompactScanResult, materializes_the_stored_matches)
+{
+    Waf2ScanResult res;
+    res.unescaped_line = "1' union select password from users--";
+    res.keyword_matches = {"union", "select", "from", "'", "--"};
+    res.regex_matches = {"union select", "' union"};
+    res.found_patterns["sqli_fast_reg"] = {"union select", "select password"};
+    res.found_patterns["comment_ev_fast_reg"] = {"--"};
+    res.param_name = "id";
+    res.score = 7.5;
+
+    CompactScanResult compact(res);
+
+    Waf2ScanResult restored;
+    restored.location = "url";
+    compact.materialize(restored);
+
+    EXPECT_EQ(restored.unescaped_line, res.unescaped_line);
+    EXPECT_EQ(restored.keyword_matches, res.keyword_matches);
+    EXPECT_EQ(restored.regex_matches, res.regex_matches);
+    EXPECT_EQ(restored.found_patterns, res.found_patterns);
+    // Only the parts that the scan fills are kept, the rest is cleared
+    EXPECT_EQ(restored.param_name, "");
+    EXPECT_EQ(restored.location, "");
+}
+
+TEST(CompactScanResult, empty_result)
+{
+    Waf2ScanResult restored;
+    restored.keyword_matches = {"union"};
+    CompactScanResult().materialize(restored);
+
+    EXPECT_THAT(restored.keyword_matches, IsEmpty());
+    EXPECT_THAT(restored.found_patterns, IsEmpty());
+    EXPECT_EQ(restored.unescaped_line, "");
+}
@@ -0,0 +1,52 @@
+#include "TransactionArena.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "cptest.h"
+
+using namespace std;
+using namespace testing;
+
+TEST(WaapTransactionArena, pmr_containers_allocate_from_arena)
+{
+    Waap::TransactionArena arena;
+    pmr::vector<pair<pmr::string, pmr::string>> pairs(&arena);
+
+    pairs.emplace_back(
+        piecewise_construct,
+        forward_as_tuple("a key that is too long for the small string buffer"),
+        forward_as_tuple("a value that is too long for the small string buffer")
+    );
+
+    // The vector storage and both strings
+    EXPECT_EQ(arena.getAllocationsCount(), 3u);
+    EXPECT_EQ(arena.getBlocksCount(), 1u);
+    EXPECT_EQ(pairs[0].first.get_allocator().resource(), &arena);
+}
+
+TEST(WaapTransactionArena, freed_chunks_are_reused)
+{
+    Waap::TransactionArena arena;
+
+    void *first = arena.allocate(48);
+    arena.deallocate(first, 48);
+    EXPECT_EQ(arena.allocate(40), first);
+
+    void *large = arena.allocate(Waap::TransactionArena::blockSize);
+    arena.deallocate(large, Waap::TransactionArena::blockSize);
+    EXPECT_EQ(arena.getBlocksCount(), 1u);
+}
+
+TEST(WaapTransactionArena, released_blocks_are_reused_by_next_arena)
+{
+    char *block;
+    {
+        Waap::TransactionArena arena;
+        block = static_cast<char *>(arena.allocate(64));
+    }
+
+    Waap::TransactionArena arena;
+    EXPECT_EQ(arena.allocate(64), block);
+}
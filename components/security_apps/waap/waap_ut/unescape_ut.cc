@@ -0,0 +1,86 @@
+#include "WaapAssetState.h"
+
+#include <random>
+
+#include "cptest.h"
+#include "Waf2Util.h"
+
+using namespace std;
+using namespace testing;
+
+// The multi-pass unescape() as it was before its stages were made to skip text without their trigger characters.
+// Every stage runs on every value, so this is the reference that the current unescape() must match.
+static string
+legacyUnescape(const string &s)
+{
+    auto fix_breaking_space = [] (string &line) {
+        for (char &c : line) {
+            if (c == (char)0xA0) c = ' ';
+        }
+    };
+
+    string text = s;
+    fix_breaking_space(text);
+    filterUnicode(text);
+    text = filterUTF7(text);
+    text.erase(unquote_plus(text.begin(), text.end()), text.end());
+    fix_breaking_space(text);
+    filterUnicode(text);
+    text.erase(escape_html(text.begin(), text.end()), text.end());
+    text.erase(escape_backslashes(text.begin(), text.end()), text.end());
+    filterUnicode(text);
+    text.erase(unquote_plus(text.begin(), text.end()), text.end());
+    unescapeUnicode(text);
+    filterUnicode(text);
+    replaceUnicodeSequence(text, ' ');
+    trimSpaces(text);
+    for (char &c : text) {
+        c = tolower(c);
+    }
+    return text;
+}
+
+// Pieces that trigger the decoding stages, alone and combined: URL, UTF-7, HTML and backslash escapes, broken and
+// overlong UTF-8, non-breaking spaces and the whitespace sequences that trimSpaces() folds.
+static const vector<string> unescape_fragments = {
+    "%", "%2", "%25", "%41", "%2b", "%5C", "%26", "%c0%af", "%C2%A0", "%e2%80%8b", "%u0041", "%%41",
+    "+", "++", "+ADw-", "+AGEAYgBj-", "+-", "+ZGVm",
+    "&", "&lt;", "&GT;", "&amp;", "&#65;", "&#x41;", "&#x;", "&#1234567;", "&quot", "&nbsp;",
+    "\\", "\\\\", "\\x41", "\\x4", "\\u0041", "\\u00e9", "\\n", "\\t", "\\'", "\\101", "\\%41",
+    "\xc2\xa0", "\xa0", "\xc0\xaf", "\xe2\x80\x8b", "\xef\xbc\x9c", "\xf0\x9f\x98\x80", "\xff", "\xc3",
+    " ", "  ", "\t", "\r", "\n", "\r\n", "\n\r", " \r\n ", "\f\v",
+    "a", "Z", "Select", "<script>", "../", "'", "\"", "0x41", "="
+};
+
+TEST(WaapUnescape, plain_values)
+{
+    EXPECT_EQ(unescape(""), "");
+    EXPECT_EQ(unescape("Hello World"), "hello world");
+    EXPECT_EQ(unescape("a   b\t\tc"), "a b\tc");
+    EXPECT_EQ(unescape("%3Cscript%3E"), "<script>");
+    EXPECT_EQ(unescape("&lt;Script&gt;"), "<script>");
+    EXPECT_EQ(unescape("a+b"), "a b");
+}
+
+TEST(WaapUnescape, matches_multi_pass_pipeline_on_random_values)
+{
+    // A fixed seed, so a failure can be reproduced
+    mt19937 random_engine(20240611);
+    uniform_int_distribution<size_t> fragment_count(0, 12);
+    uniform_int_distribution<size_t> fragment_index(0, unescape_fragments.size() - 1);
+    uniform_int_distribution<int> raw_byte(0, 255);
+    bernoulli_distribution use_raw_byte(0.15);
+
+    for (uint iteration = 0; iteration < 200000; iteration++) {
+        string value;
+        for (size_t count = fragment_count(random_engine); count > 0; count--) {
+            if (use_raw_byte(random_engine)) {
+                value += static_cast<char>(raw_byte(random_engine));
+            } else {
+                value += unescape_fragments[fragment_index(random_engine)];
+            }
+        }
+
+        ASSERT_EQ(unescape(value), legacyUnescape(value)) << "Iteration " << iteration << ", value: " << dumpHex(value);
+    }
+}
@@ -27,6 +27,8 @@
 //  and serialization/deserialization. All objects which are part of the comipled automaton are created here.
 // kiss_thin_nfa_compile.c - compilation code. Contains the logic that converts a set of strings into an automaton.
 // kiss_thin_nfa_analyze.c - Validation and dump. Code that reads the BNFA and tries to make sense of it.
+// kiss_thin_nfa_prefilter.cc - Literal prefilter. Finds the positions patterns may begin at, so execution can
+//  skip the bytes where the automaton would stay at the root.
 // kiss_thin_nfa_impl.h - internal header file. APIs and definitions between the different source files.
 
 
@@ -268,6 +270,19 @@ calc_head_buf_range(const u_char *buffer, u_int len, const u_char **head_start_p
     }
 }
 
+// The root state, where the automaton is when no pattern has begun
+static CP_INLINE kiss_bnfa_comp_offset_t
+kiss_thin_nfa_root_offset(const KissThinNFA *nfa_h)
+{
+    kiss_bnfa_comp_offset_t init_off = kiss_bnfa_offset_compress(nfa_h->min_bnfa_offset);
+
+    if (nfa_h->flags & KISS_THIN_NFA_HAS_ANCHOR) {
+        // The root is the next full state after the anchored root
+        init_off++;
+    }
+    return init_off;
+}
+
 // Set the initial BNFA offset for each head
 static void
 set_head_bnfa_offset(
@@ -277,15 +292,10 @@ set_head_bnfa_offset(
     const u_char *buffer
 )
 {
-    const KissThinNFA *nfa_h = runtime->nfa_h;
-    kiss_bnfa_comp_offset_t init_off = kiss_bnfa_offset_compress(nfa_h->min_bnfa_offset);
+    // Start from the root
+    kiss_bnfa_comp_offset_t init_off = kiss_thin_nfa_root_offset(runtime->nfa_h);
     u_int i;
 
-    if (nfa_h->flags & KISS_THIN_NFA_HAS_ANCHOR) {
-        // Start from the root (next full state after the anchored root)
-        init_off++;
-    }
-
     // Heads that scan from the beginning of the buffer, will start at previous buffer's ending state.
     // The rest start anew.
     // Several scanning heads will start at buffer's beginning when buffer's size is less than PARALLEL_SCANS_NUM
@@ -420,13 +430,165 @@ kiss_thin_nfa_exec_one_buf_parallel_ex(
 }
 
 
-// Execute a thin NFA on a buffer.
+// Run Thin NFA with a single head on a range of a buffer, starting at the state runtime->last_bnfa_offset.
+// Match positions are relative to the whole buffer, so matches are handled as if the whole buffer was scanned.
+static CP_INLINE void
+kiss_thin_nfa_exec_one_range(
+    struct kiss_bnfa_runtime_s *runtime,
+    const u_char *buffer,
+    u_int start, u_int end,
+    u_int len, u_int flags,
+    BOOL do_char_trans,
+    u_char *char_trans_table
+)
+{
+    const kiss_bnfa_state_t *bnfa = runtime->nfa_h->bnfa;
+    kiss_bnfa_comp_offset_t bnfa_offset = runtime->last_bnfa_offset;
+    u_int pos;
+
+    for (pos = start; pos < end; pos++) {
+        if (kiss_bnfa_state_type(bnfa, bnfa_offset) == KISS_BNFA_STATE_MATCH) {
+            // Handle a match
+            kiss_thin_nfa_handle_match_state(runtime, bnfa_offset, pos, len, flags);
+            bnfa_offset = kiss_thin_nfa_get_next_offset_match(bnfa, bnfa_offset);
+        }
+        // Advance to the next state
+        bnfa_offset = parallel_scan_advance_one(bnfa, bnfa_offset,
+            TRANSLATE_CHAR_IF_NEEED(do_char_trans, char_trans_table, buffer[pos]));
+    }
+
+    // We may have stopped on a match state. If so - handle and advance
+    if (kiss_bnfa_state_type(bnfa, bnfa_offset) == KISS_BNFA_STATE_MATCH) {
+        kiss_thin_nfa_handle_match_state(runtime, bnfa_offset, end, len, flags);
+        bnfa_offset = kiss_thin_nfa_get_next_offset_match(bnfa, bnfa_offset);
+    }
+
+    runtime->last_bnfa_offset = bnfa_offset;
+}
+
+
+// Run Thin NFA on a single buffer, only in windows around the positions the prefilter finds.
+// Each candidate position is followed by the automaton for the length of the longest pattern, so every pattern
+// that begins there is found. Outside the windows no pattern is in progress, so the automaton would be at the root:
+// skipping these bytes and starting the next window at the root gives the same matches.
+static void
+kiss_thin_nfa_exec_one_buf_prefiltered(
+    struct kiss_bnfa_runtime_s *runtime,
+    const u_char *buffer,
+    u_int len, u_int flags,
+    BOOL do_char_trans,
+    u_char *char_trans_table
+)
+{
+    const KissThinNFA *nfa_h = runtime->nfa_h;
+    const kiss_thin_nfa_prefilter_t *prefilter = nfa_h->prefilter;
+    kiss_bnfa_comp_offset_t root_off = kiss_thin_nfa_root_offset(nfa_h);
+    u_int scanned_bytes = 0;
+    u_int pos = 0;            // The bytes before pos were scanned or skipped
+    u_int candidate;
+
+    // A pattern that began in the previous buffer has to be followed from this buffer's start
+    if (runtime->last_bnfa_offset == root_off || runtime->last_bnfa_offset == kiss_thin_nfa_initial_offset(nfa_h)) {
+        candidate = kiss_thin_nfa_prefilter_find(prefilter, buffer, 0, len);
+    } else {
+        candidate = 0;
+    }
+
+    while (candidate < len) {
+        u_int start = candidate;
+        u_int end;
+
+        // The window continues the previous one, or starts after skipped bytes, at the root
+        if (start != pos) runtime->last_bnfa_offset = root_off;
+
+        if (start >= KISS_THIN_NFA_PREFILTER_WARMUP && scanned_bytes > start / KISS_THIN_NFA_PREFILTER_MAX_SHARE) {
+            // Candidates are dense in this buffer - scan the rest in parallel, rather than pay for the prefilter
+            u_int buf_start_offset = runtime->scanned_so_far;
+            runtime->scanned_so_far += start;
+            kiss_thin_nfa_exec_one_buf_parallel_ex(
+                runtime,
+                buffer + start,
+                len - start,
+                flags,
+                do_char_trans,
+                char_trans_table
+            );
+            runtime->scanned_so_far = buf_start_offset;
+            scanned_bytes += len - start;
+            pos = len;
+            break;
+        }
+
+        // Extend the window as long as it holds more candidates
+        end = MIN(len, start + prefilter->window_len);
+        candidate = kiss_thin_nfa_prefilter_find(prefilter, buffer, start + 1, len);
+        while (candidate < end) {
+            end = MIN(len, candidate + prefilter->window_len);
+            candidate = kiss_thin_nfa_prefilter_find(prefilter, buffer, candidate + 1, len);
+        }
+
+        kiss_thin_nfa_exec_one_range(runtime, buffer, start, end, len, flags, do_char_trans, char_trans_table);
+        scanned_bytes += end - start;
+        pos = end;
+    }
+
+    if (pos < len) runtime->last_bnfa_offset = root_off;
+    thinnfa_debug_perf(("%s: Prefilter let through %u of %u bytes\n", FILE_LINE, scanned_bytes, len));
+}
+
+
+// Run Thin NFA on a single buffer, using the prefilter if there is one.
+static CP_INLINE void
+kiss_thin_nfa_exec_one_buf(
+    struct kiss_bnfa_runtime_s *runtime,
+    const u_char *buffer,
+    u_int len, u_int flags,
+    BOOL do_char_trans,
+    u_char *char_trans_table
+)
+{
+    if (runtime->nfa_h->prefilter != NULL) {
+        kiss_thin_nfa_exec_one_buf_prefiltered(runtime, buffer, len, flags, do_char_trans, char_trans_table);
+    } else {
+        kiss_thin_nfa_exec_one_buf_parallel_ex(runtime, buffer, len, flags, do_char_trans, char_trans_table);
+    }
+}
+
+
+// The state a scan of a new stream starts from.
+kiss_bnfa_comp_offset_t
+kiss_thin_nfa_initial_offset(const KissThinNFA *nfa_h)
+{
+    return kiss_bnfa_offset_compress(nfa_h->min_bnfa_offset);
+}
+
+
+// Check that a state, e.g. one kept by a caller between calls to kiss_thin_nfa_exec_resume, is within the BNFA.
+BOOL
+kiss_thin_nfa_is_valid_offset(const KissThinNFA *nfa_h, kiss_bnfa_comp_offset_t bnfa_offset)
+{
+    kiss_bnfa_offset_t offset = kiss_bnfa_offset_decompress(bnfa_offset);
+    return (offset >= nfa_h->min_bnfa_offset && offset < nfa_h->max_bnfa_offset) ? TRUE : FALSE;
+}
+
+
+// Execute a thin NFA on a buffer, which continues a stream that was scanned so far.
 // Parameters:
 //   nfa_h             - the NFA handle
 //   buf        - a buffer to scan.
-//   matches        - output - will be filled with a kiss_pmglob_match_data element for each match.
+//   matches        - output - will be filled with a pattern ID and stream offset for each match.
+//   last_bnfa_offset - input/output - the state the previous buffer of the stream ended at, or the initial state.
+//     Set to the state this buffer ended at.
+//   scanned_so_far - input/output - the length of the stream before this buffer. Match offsets are relative to
+//     the beginning of the stream. Advanced by the length of this buffer.
 void
-kiss_thin_nfa_exec(KissThinNFA *nfa_h, const Buffer& buf, std::vector<std::pair<uint, uint>> &matches)
+kiss_thin_nfa_exec_resume(
+    KissThinNFA *nfa_h,
+    const Buffer &buf,
+    std::vector<std::pair<uint, uint>> &matches,
+    kiss_bnfa_comp_offset_t &last_bnfa_offset,
+    u_int &scanned_so_far
+)
 {
     struct kiss_bnfa_runtime_s bnfa_runtime;
 
@@ -440,9 +602,9 @@ kiss_thin_nfa_exec(KissThinNFA *nfa_h, const Buffer& buf, std::vector<std::pair<
 
     // Set the runtime status structure
     bnfa_runtime.nfa_h = nfa_h;
-    bnfa_runtime.last_bnfa_offset = kiss_bnfa_offset_compress(nfa_h->min_bnfa_offset); // The initial state
+    bnfa_runtime.last_bnfa_offset = last_bnfa_offset;
     bnfa_runtime.matches = &matches;
-    bnfa_runtime.scanned_so_far = 0;
+    bnfa_runtime.scanned_so_far = scanned_so_far;
 
     auto segments = buf.segRange();
     for( auto iter = segments.begin(); iter != segments.end(); iter++ ) {
@@ -450,12 +612,32 @@ kiss_thin_nfa_exec(KissThinNFA *nfa_h, const Buffer& buf, std::vector<std::pair<
         u_int len = iter->size();
         u_int flags = ((iter+1)==segments.end()) ? KISS_PM_EXEC_LAST_BUFF : 0;
         if (nfa_h->flags & KISS_THIN_NFA_USE_CHAR_XLATION) {
-            kiss_thin_nfa_exec_one_buf_parallel_ex(&bnfa_runtime, data, len, flags, TRUE, nfa_h->xlation_tab);
+            kiss_thin_nfa_exec_one_buf(&bnfa_runtime, data, len, flags, TRUE, nfa_h->xlation_tab);
         } else {
-            kiss_thin_nfa_exec_one_buf_parallel_ex(&bnfa_runtime, data, len, flags, FALSE, nullptr);
+            kiss_thin_nfa_exec_one_buf(&bnfa_runtime, data, len, flags, FALSE, nullptr);
         }
         bnfa_runtime.scanned_so_far += len;
     }
 
+    last_bnfa_offset = bnfa_runtime.last_bnfa_offset;
+    scanned_so_far = bnfa_runtime.scanned_so_far;
     return;
 }
+
+
+// Execute a thin NFA on a buffer.
+// Parameters:
+//   nfa_h             - the NFA handle
+//   buf        - a buffer to scan.
+//   matches        - output - will be filled with a kiss_pmglob_match_data element for each match.
+void
+kiss_thin_nfa_exec(KissThinNFA *nfa_h, const Buffer& buf, std::vector<std::pair<uint, uint>> &matches)
+{
+    dbgAssert(nfa_h != nullptr)
+        << AlertInfo(AlertTeam::CORE, "pattern matcher")
+        << "kiss_thin_nfa_exec() was called with null handle";
+
+    kiss_bnfa_comp_offset_t last_bnfa_offset = kiss_thin_nfa_initial_offset(nfa_h);
+    u_int scanned_so_far = 0;
+    kiss_thin_nfa_exec_resume(nfa_h, buf, matches, last_bnfa_offset, scanned_so_far);
+}
@@ -17,6 +17,14 @@
 // The functions here may be called from compilation, serialization and de-serialization contexts.
 // The code allows allocating and releasing the Thin NFA structure, as well as serializing and deserializing it.
 
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "kiss_thin_nfa_impl.h"
 
 // Allocate and fill in a pattern ID structure
@@ -167,20 +175,28 @@ KissThinNFA::~KissThinNFA()
     thinnfa_debug_major(("%s: Destroying Thin NFA %p, bnfa size=%d\n", rname,
         this, bnfa_size));
 
+    kiss_thin_nfa_stats_free(&stats);
+
+    if (mapped_file != NULL) {
+        // The arrays are in the file - nothing to free
+        munmap(mapped_file, mapped_size);
+        mapped_file = NULL;
+        return;
+    }
+
     if(bnfa_start != NULL) {
         kiss_pmglob_memory_kfree(bnfa_start, bnfa_size, rname);
         bnfa_start = NULL;
         bnfa = NULL;
     }
 
-    kiss_thin_nfa_stats_free(&stats);
-
     if (pattern_arrays != NULL) {
         kiss_pmglob_memory_kfree(pattern_arrays, pattern_arrays_size, rname);
         pattern_arrays = NULL;
     }
 
     kiss_thin_nfa_destroy_depth_map(this);
+    kiss_thin_nfa_prefilter_free(this);
 }
 
 
@@ -237,3 +253,259 @@ kiss_thin_nfa_create(u_int match_state_num, kiss_bnfa_offset_t min_offset, kiss_
 
     return nfa;
 }
+
+
+static u_int
+kiss_thin_nfa_file_align(u_int pos)
+{
+    return (pos + KISS_THIN_NFA_FILE_ALIGN - 1) & ~(KISS_THIN_NFA_FILE_ALIGN - 1);
+}
+
+
+// Copy an array into the file image, at the next aligned position. Returns the position.
+static u_int
+kiss_thin_nfa_file_append(std::string &image, const void *data, u_int size)
+{
+    u_int pos = kiss_thin_nfa_file_align(image.size());
+
+    image.resize(pos);
+    image.append((const char *)data, size);
+    return pos;
+}
+
+
+// Add data to a checksum, 8 bytes at a time
+static u_int64
+kiss_thin_nfa_checksum_add(u_int64 checksum, const u_char *data, size_t size)
+{
+    static const u_int64 multiplier = 0x9e3779b97f4a7c15ULL;
+    size_t pos;
+
+    for (pos = 0; pos < size; pos += sizeof(u_int64)) {
+        u_int64 word = 0;
+        if (size - pos >= sizeof(word)) {
+            bcopy(data + pos, &word, sizeof(word));
+        } else {
+            bcopy(data + pos, &word, size - pos);
+        }
+        checksum = (checksum ^ word) * multiplier;
+        checksum ^= checksum >> 32;
+    }
+    return checksum;
+}
+
+
+// Checksum of a Thin NFA file image, taking the checksum field in its header as 0
+static u_int64
+kiss_thin_nfa_file_checksum(const u_char *file, size_t size)
+{
+    struct kiss_thin_nfa_file_header_s header;
+
+    bcopy(file, &header, sizeof(header));
+    header.checksum = 0;
+    return kiss_thin_nfa_checksum_add(
+        kiss_thin_nfa_checksum_add(size, (const u_char *)&header, sizeof(header)),
+        file + sizeof(header),
+        size - sizeof(header)
+    );
+}
+
+
+// Write a compiled Thin NFA to a file. It's written to a temporary file, which then replaces the file,
+// so a process that maps the file concurrently sees either the old or the new one.
+kiss_ret_val
+kiss_thin_nfa_write_file(const KissThinNFA *nfa_h, const std::string &path, const std::string &key)
+{
+    static const char rname[] = "kiss_thin_nfa_write_file";
+    struct kiss_thin_nfa_file_header_s header;
+    std::string image;
+    std::string tmp_path = path + ".tmp." + std::to_string(getpid());
+    size_t written = 0;
+    int fd;
+
+    bzero(&header, sizeof(header));
+    header.magic = KISS_THIN_NFA_FILE_MAGIC;
+    header.version = KISS_THIN_NFA_FILE_VERSION;
+    header.header_size = sizeof(header);
+    header.min_bnfa_offset = nfa_h->min_bnfa_offset;
+    header.max_bnfa_offset = nfa_h->max_bnfa_offset;
+    header.flags = nfa_h->flags;
+    header.match_state_num = nfa_h->match_state_num;
+    header.max_pat_len = nfa_h->max_pat_len;
+    header.specific_stats = nfa_h->stats.specific;
+    bcopy(nfa_h->xlation_tab, header.xlation_tab, sizeof(header.xlation_tab));
+
+    // The header is filled in last, when the positions are known
+    image.resize(sizeof(header));
+    header.bnfa_pos = kiss_thin_nfa_file_append(
+        image,
+        nfa_h->bnfa_start,
+        nfa_h->max_bnfa_offset - nfa_h->min_bnfa_offset
+    );
+    header.pattern_arrays_size = nfa_h->pattern_arrays_size;
+    header.pattern_arrays_pos = kiss_thin_nfa_file_append(image, nfa_h->pattern_arrays, nfa_h->pattern_arrays_size);
+    header.depth_map_size = nfa_h->depth_map.size;
+    header.depth_map_pos = kiss_thin_nfa_file_append(image, nfa_h->depth_map.mem_start, nfa_h->depth_map.size);
+    if (nfa_h->prefilter != NULL) {
+        header.prefilter_pos = kiss_thin_nfa_file_append(image, nfa_h->prefilter, sizeof(*(nfa_h->prefilter)));
+    }
+    header.key_size = key.size();
+    header.key_pos = kiss_thin_nfa_file_append(image, key.data(), key.size());
+    header.file_size = image.size();
+    bcopy(&header, &image[0], sizeof(header));
+    header.checksum = kiss_thin_nfa_file_checksum((const u_char *)image.data(), image.size());
+    bcopy(&header, &image[0], sizeof(header));
+
+    fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        thinnfa_debug_err(("%s: Failed to create %s - %s\n", rname, tmp_path.c_str(), strerror(errno)));
+        return KISS_ERROR;
+    }
+    while (written < image.size()) {
+        ssize_t res = write(fd, image.data() + written, image.size() - written);
+        if (res < 0) {
+            if (errno == EINTR) continue;
+            thinnfa_debug_err(("%s: Failed to write %s - %s\n", rname, tmp_path.c_str(), strerror(errno)));
+            close(fd);
+            unlink(tmp_path.c_str());
+            return KISS_ERROR;
+        }
+        written += res;
+    }
+    close(fd);
+
+    if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+        thinnfa_debug_err(("%s: Failed to rename %s - %s\n", rname, tmp_path.c_str(), strerror(errno)));
+        unlink(tmp_path.c_str());
+        return KISS_ERROR;
+    }
+
+    thinnfa_debug_major(("%s: Wrote Thin NFA %p to %s, size=%u\n", rname, nfa_h, path.c_str(), header.file_size));
+    return KISS_OK;
+}
+
+
+// Check that an array is inside the file
+static BOOL
+kiss_thin_nfa_file_has(const struct kiss_thin_nfa_file_header_s *header, u_int pos, u_int size)
+{
+    return pos >= header->header_size && pos <= header->file_size && size <= header->file_size - pos;
+}
+
+
+// Check that a mapped file holds a Thin NFA of this version, compiled from key
+static BOOL
+kiss_thin_nfa_file_is_valid(const u_char *file, size_t file_size, const std::string &key)
+{
+    static const char rname[] = "kiss_thin_nfa_file_is_valid";
+    const struct kiss_thin_nfa_file_header_s *header = (const struct kiss_thin_nfa_file_header_s *)file;
+    kiss_bnfa_comp_offset_t min_comp_off, max_comp_off;
+
+    if (file_size < sizeof(*header) ||
+        header->magic != KISS_THIN_NFA_FILE_MAGIC ||
+        header->version != KISS_THIN_NFA_FILE_VERSION ||
+        header->header_size != sizeof(*header) ||
+        header->file_size != file_size) {
+        thinnfa_debug(("%s: Not a Thin NFA file of version %d\n", rname, KISS_THIN_NFA_FILE_VERSION));
+        return FALSE;
+    }
+
+    if (header->key_size != key.size() ||
+        !kiss_thin_nfa_file_has(header, header->key_pos, header->key_size) ||
+        memcmp(file + header->key_pos, key.data(), key.size()) != 0) {
+        thinnfa_debug(("%s: The Thin NFA was compiled from other patterns\n", rname));
+        return FALSE;
+    }
+
+    min_comp_off = kiss_bnfa_offset_compress(header->min_bnfa_offset);
+    max_comp_off = kiss_bnfa_offset_compress(header->max_bnfa_offset);
+    if (header->min_bnfa_offset > 0 ||
+        header->max_bnfa_offset < 0 ||
+        !kiss_thin_nfa_file_has(header, header->bnfa_pos, header->max_bnfa_offset - header->min_bnfa_offset) ||
+        !kiss_thin_nfa_file_has(header, header->pattern_arrays_pos, header->pattern_arrays_size) ||
+        header->depth_map_size != (u_int)(max_comp_off - min_comp_off) ||
+        !kiss_thin_nfa_file_has(header, header->depth_map_pos, header->depth_map_size) ||
+        (header->prefilter_pos != 0 &&
+            !kiss_thin_nfa_file_has(header, header->prefilter_pos, sizeof(kiss_thin_nfa_prefilter_t)))) {
+        thinnfa_debug_err(("%s: The Thin NFA file is corrupted\n", rname));
+        return FALSE;
+    }
+
+    if (kiss_thin_nfa_file_checksum(file, file_size) != header->checksum) {
+        thinnfa_debug_err(("%s: The Thin NFA file was changed after it was written\n", rname));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+// Map a Thin NFA file. The Thin NFA points into the mapping, and unmaps it when destroyed.
+std::unique_ptr<KissThinNFA>
+kiss_thin_nfa_map_file(const std::string &path, const std::string &key)
+{
+    static const char rname[] = "kiss_thin_nfa_map_file";
+    const struct kiss_thin_nfa_file_header_s *header;
+    struct stat file_stat;
+    u_char *file;
+    int fd;
+
+    fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        thinnfa_debug(("%s: Failed to open %s - %s\n", rname, path.c_str(), strerror(errno)));
+        return nullptr;
+    }
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size < (off_t)sizeof(*header)) {
+        thinnfa_debug_err(("%s: %s is too short for a Thin NFA file\n", rname, path.c_str()));
+        close(fd);
+        return nullptr;
+    }
+    file = (u_char *)mmap(NULL, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (file == MAP_FAILED) {
+        thinnfa_debug_err(("%s: Failed to map %s - %s\n", rname, path.c_str(), strerror(errno)));
+        return nullptr;
+    }
+
+    if (!kiss_thin_nfa_file_is_valid(file, file_stat.st_size, key)) {
+        munmap(file, file_stat.st_size);
+        return nullptr;
+    }
+    header = (const struct kiss_thin_nfa_file_header_s *)file;
+
+    // From here on, the Thin NFA owns the mapping
+    auto nfa = std::make_unique<KissThinNFA>();
+    void *nfa_ptr = nfa.get();
+    bzero(nfa_ptr, sizeof(*nfa));
+    nfa->mapped_file = file;
+    nfa->mapped_size = file_stat.st_size;
+
+    if (kiss_thin_nfa_stats_init(&(nfa->stats)) != KISS_OK) {
+        thinnfa_debug_err(("%s: Error initializing statistics structure\n", rname));
+        return nullptr;
+    }
+    nfa->stats.specific = header->specific_stats;
+
+    nfa->min_bnfa_offset = header->min_bnfa_offset;
+    nfa->max_bnfa_offset = header->max_bnfa_offset;
+    nfa->flags = (enum kiss_thin_nfa_flags_e)header->flags;
+    nfa->match_state_num = header->match_state_num;
+    nfa->max_pat_len = header->max_pat_len;
+    bcopy(header->xlation_tab, nfa->xlation_tab, sizeof(nfa->xlation_tab));
+
+    // The arrays are used in place. bnfa_start is at offset min_bnfa_offset, like in kiss_thin_nfa_create().
+    nfa->bnfa_start = (kiss_bnfa_state_t *)(file + header->bnfa_pos);
+    nfa->bnfa = (kiss_bnfa_state_t *)((char *)nfa->bnfa_start - nfa->min_bnfa_offset);
+    nfa->pattern_arrays = (kiss_thin_nfa_pattern_array_t *)(file + header->pattern_arrays_pos);
+    nfa->pattern_arrays_size = header->pattern_arrays_size;
+    nfa->depth_map.mem_start = file + header->depth_map_pos;
+    nfa->depth_map.size = header->depth_map_size;
+    nfa->depth_map.offset0 = nfa->depth_map.mem_start - kiss_bnfa_offset_compress(nfa->min_bnfa_offset);
+    if (header->prefilter_pos != 0) {
+        nfa->prefilter = (kiss_thin_nfa_prefilter_t *)(file + header->prefilter_pos);
+    }
+
+    thinnfa_debug_major(("%s: Mapped Thin NFA %p from %s, size=%u\n", rname, nfa.get(), path.c_str(),
+        header->file_size));
+    return nfa;
+}
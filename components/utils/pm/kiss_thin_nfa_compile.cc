@@ -2216,6 +2216,11 @@ kiss_thin_nfa_compile(const std::list<kiss_pmglob_string_s> &patterns, u_int com
         goto finish;
     }
 
+    // The prefilter only speeds up the execution - if it can't be built, the automaton is used alone
+    if (kiss_thin_nfa_prefilter_build(nfa_comp->runtime_nfa.get(), patterns) != KISS_OK) {
+        thinnfa_debug_err(("%s: Function kiss_thin_nfa_prefilter_build() failed\n", rname));
+    }
+
     // Get the resulting NFA (set NULL to protect from free)
     nfa = std::move(nfa_comp->runtime_nfa);
     thinnfa_debug_major(("%s: Successfully compiled the Thin NFA %p\n", rname, nfa.get()));
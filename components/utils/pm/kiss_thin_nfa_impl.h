@@ -23,6 +23,7 @@
 #include <list>
 #include <vector>
 #include <memory>
+#include <string>
 
 #include "i_pm_scan.h"
 #include "kiss_patterns.h"
@@ -87,6 +88,17 @@ struct kiss_thin_nfa_depth_map_s {
 
 #define KISS_THIN_NFA_MAX_ENCODABLE_DEPTH 255        // Fit in u_char
 
+// Literal prefilter - finds the positions a pattern may begin at (see kiss_thin_nfa_prefilter.cc)
+#define KISS_THIN_NFA_PREFILTER_BYTES 3             // Pattern bytes checked at each position
+#define KISS_THIN_NFA_PREFILTER_WARMUP 256          // Bytes passed before the prefilter may give up on a buffer
+#define KISS_THIN_NFA_PREFILTER_MAX_SHARE 4         // Give up if more than 1/4 of the bytes are let through
+
+typedef struct kiss_thin_nfa_prefilter_s {
+    u_char lo[KISS_THIN_NFA_PREFILTER_BYTES][16];   // Buckets of each pattern byte, by its low nibble
+    u_char hi[KISS_THIN_NFA_PREFILTER_BYTES][16];   // Buckets of each pattern byte, by its high nibble
+    u_int window_len;                               // Bytes the automaton scans from each candidate position
+} kiss_thin_nfa_prefilter_t;
+
 // A Compiled Thin NFA, used at runtime
 class KissThinNFA {
 public:
@@ -104,6 +116,40 @@ public:
     u_int max_pat_len;                              // Length of the longest string
     u_char xlation_tab[KISS_PM_ALPHABET_SIZE];      // For caseless/digitless
     struct kiss_thin_nfa_depth_map_s depth_map;     // State -> Depth mapping
+    kiss_thin_nfa_prefilter_t *prefilter;           // NULL if the patterns are too common to prefilter
+    void *mapped_file;                              // If mapped from a file, the arrays are in it (else NULL)
+    size_t mapped_size;
+};
+
+// A compiled Thin NFA file - this header, then the BNFA, pattern arrays, depth map, prefilter and the key,
+// each at a KISS_THIN_NFA_FILE_ALIGN aligned position. The arrays are used in place, so the file is only
+// good for a machine (and build) with the same layout - any layout change must bump the version.
+// The checksum covers the whole file, so a file that was changed after it was written is not mapped.
+#define KISS_THIN_NFA_FILE_MAGIC 0x4146544e         // "NTFA"
+#define KISS_THIN_NFA_FILE_VERSION 2
+#define KISS_THIN_NFA_FILE_ALIGN 64
+
+struct kiss_thin_nfa_file_header_s {
+    u_int magic;
+    u_int version;
+    u_int header_size;                              // sizeof(struct kiss_thin_nfa_file_header_s)
+    u_int file_size;
+    u_int64 checksum;                               // Of the file, with this field as 0
+    kiss_bnfa_offset_t min_bnfa_offset;
+    kiss_bnfa_offset_t max_bnfa_offset;
+    u_int flags;
+    u_int match_state_num;
+    u_int max_pat_len;
+    u_int bnfa_pos;
+    u_int pattern_arrays_pos;
+    u_int pattern_arrays_size;
+    u_int depth_map_pos;
+    u_int depth_map_size;
+    u_int prefilter_pos;                            // 0 if there's no prefilter
+    u_int key_pos;
+    u_int key_size;
+    struct kiss_thin_nfa_specific_stats_s specific_stats;
+    u_char xlation_tab[KISS_PM_ALPHABET_SIZE];
 };
 
 static CP_INLINE u_int
@@ -138,6 +184,14 @@ kiss_thin_nfa_create(
     kiss_bnfa_offset_t max_offset
 );
 
+// Write a compiled Thin NFA to a file, for kiss_thin_nfa_map_file() to use instead of compiling it again.
+// key identifies what the Thin NFA was compiled from. The file is replaced atomically.
+kiss_ret_val kiss_thin_nfa_write_file(const KissThinNFA *nfa_h, const std::string &path, const std::string &key);
+
+// Map a Thin NFA written by kiss_thin_nfa_write_file(), if it has the same key and file version.
+// The mapping is read-only and shared, so all the processes that map the file share its memory.
+std::unique_ptr<KissThinNFA> kiss_thin_nfa_map_file(const std::string &path, const std::string &key);
+
 
 // Add a pattern (with given id, flags and length) to a list.
 // pat_list should point to the head of the list, *pat_list may be modified.
@@ -162,9 +216,35 @@ kiss_thin_nfa_compile(
 // Validate Thin NFA
 BOOL kiss_thin_nfa_is_valid(const KissThinNFA *nfa_h);
 
+// Build the literal prefilter of a compiled Thin NFA, if it would be selective enough
+kiss_ret_val kiss_thin_nfa_prefilter_build(KissThinNFA *nfa_h, const std::list<kiss_pmglob_string_s> &patterns);
+
+// Free the literal prefilter, if any
+void kiss_thin_nfa_prefilter_free(KissThinNFA *nfa_h);
+
+// Find the first position in buf, starting at from, where a pattern may begin. Returns len if there is none.
+u_int
+kiss_thin_nfa_prefilter_find(const kiss_thin_nfa_prefilter_t *prefilter, const u_char *buf, u_int from, u_int len);
+
 void
 kiss_thin_nfa_exec(KissThinNFA *nfa_h, const Buffer &buffer, std::vector<std::pair<uint, uint>> &matches);
 
+// Execute a Thin NFA on the next buffer of a stream, starting at the state where the previous buffer ended.
+void
+kiss_thin_nfa_exec_resume(
+    KissThinNFA *nfa_h,
+    const Buffer &buffer,
+    std::vector<std::pair<uint, uint>> &matches,
+    kiss_bnfa_comp_offset_t &last_bnfa_offset,
+    u_int &scanned_so_far
+);
+
+// The state to start scanning a new stream from
+kiss_bnfa_comp_offset_t kiss_thin_nfa_initial_offset(const KissThinNFA *nfa_h);
+
+// Check that a BNFA offset is a within the Thin NFA
+BOOL kiss_thin_nfa_is_valid_offset(const KissThinNFA *nfa_h, kiss_bnfa_comp_offset_t bnfa_offset);
+
 // Dump a PM
 kiss_ret_val kiss_thin_nfa_dump(const KissThinNFA *nfa_h, enum kiss_pm_dump_format_e format);
 
@@ -0,0 +1,308 @@
+// Copyright (C) 2022 Check Point Software Technologies Ltd. All rights reserved.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Thin NFA literal prefilter
+// --------------------------
+// A pattern can only begin at a position whose first bytes (KISS_THIN_NFA_PREFILTER_BYTES of them) are the first
+// bytes of some pattern. The prefilter finds such candidate positions, 16 or 32 at a time, so the automaton only
+// runs on the bytes that follow them.
+//
+// The patterns are split into 8 buckets by their first byte. For each bucket and each of the first pattern bytes,
+// we keep the set of bytes its patterns have there, in the "shufti" form: a byte is in bucket k's set if bit k is
+// set both in the table entry of its low nibble and in the table entry of its high nibble. This is a superset of
+// the real set, so the prefilter may report positions no pattern begins at, but never misses one.
+// A position is a candidate if some bucket has each of the bytes there in its set. Patterns shorter than the
+// checked bytes, and positions too close to the buffer end (the pattern may continue in the next buffer), accept
+// any byte after their end.
+
+#include "kiss_thin_nfa_impl.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define KISS_THIN_NFA_PREFILTER_X86
+#endif
+
+#define PREFILTER_BUCKETS_NUM 8
+// Build the prefilter only if, on random bytes, it lets through at most 1 position of 64. Otherwise, on most
+// traffic, the automaton would run on nearly every byte anyway, and the prefilter would only add work.
+#define PREFILTER_MAX_CANDIDATES_SHARE 64
+
+typedef u_char prefilter_byte_set_t[KISS_PM_ALPHABET_SIZE];
+
+static CP_INLINE u_char
+prefilter_xlate_char(const KissThinNFA *nfa_h, u_char ch)
+{
+    return (nfa_h->flags & KISS_THIN_NFA_USE_CHAR_XLATION) ? nfa_h->xlation_tab[ch] : ch;
+}
+
+// Add to a set all the bytes that the automaton treats like ch
+static void
+prefilter_add_char(const KissThinNFA *nfa_h, u_char ch, prefilter_byte_set_t set)
+{
+    u_char canonic = prefilter_xlate_char(nfa_h, ch);
+    u_int i;
+
+    for (i = 0; i < KISS_PM_ALPHABET_SIZE; i++) {
+        if (prefilter_xlate_char(nfa_h, i) == canonic) set[i] = 1;
+    }
+}
+
+// Set bucket's bit in the nibble tables, for each byte in the set
+static void
+prefilter_set_bucket_tables(const prefilter_byte_set_t set, u_int bucket, u_char *lo, u_char *hi)
+{
+    u_int i;
+
+    for (i = 0; i < KISS_PM_ALPHABET_SIZE; i++) {
+        if (!set[i]) continue;
+        lo[i & 0xf] |= (1 << bucket);
+        hi[i >> 4] |= (1 << bucket);
+    }
+}
+
+static CP_INLINE u_char
+prefilter_buckets_of(const kiss_thin_nfa_prefilter_t *prefilter, u_int byte_index, u_char ch)
+{
+    return prefilter->lo[byte_index][ch & 0xf] & prefilter->hi[byte_index][ch >> 4];
+}
+
+// The share of random byte sequences that the prefilter reports as candidates is at most this sum, over the
+// buckets, of the product of the sizes of the bucket's byte sets (as the nibble tables represent them).
+static double
+prefilter_candidates_share(const kiss_thin_nfa_prefilter_t *prefilter)
+{
+    double share = 0;
+    u_int bucket, byte_index, ch;
+
+    for (bucket = 0; bucket < PREFILTER_BUCKETS_NUM; bucket++) {
+        double bucket_share = 1;
+        for (byte_index = 0; byte_index < KISS_THIN_NFA_PREFILTER_BYTES; byte_index++) {
+            u_int set_size = 0;
+            for (ch = 0; ch < KISS_PM_ALPHABET_SIZE; ch++) {
+                if (prefilter_buckets_of(prefilter, byte_index, ch) & (1 << bucket)) set_size++;
+            }
+            bucket_share *= (double)set_size / KISS_PM_ALPHABET_SIZE;
+        }
+        share += bucket_share;
+    }
+    return share;
+}
+
+
+// Build the prefilter of a compiled Thin NFA, from the patterns it was compiled from.
+// Leaves nfa_h->prefilter NULL if the prefilter would not be selective enough to be worth running.
+kiss_ret_val
+kiss_thin_nfa_prefilter_build(KissThinNFA *nfa_h, const std::list<kiss_pmglob_string_s> &patterns)
+{
+    static const char rname[] = "kiss_thin_nfa_prefilter_build";
+    prefilter_byte_set_t sets[KISS_THIN_NFA_PREFILTER_BYTES][PREFILTER_BUCKETS_NUM];
+    u_char bucket_of_first[KISS_PM_ALPHABET_SIZE];
+    u_char is_first[KISS_PM_ALPHABET_SIZE];
+    kiss_thin_nfa_prefilter_t *prefilter;
+    u_int n_first = 0;
+    u_int rank = 0;
+    double candidates_share;
+    u_int i, bucket;
+
+    nfa_h->prefilter = NULL;
+    if (patterns.empty()) return KISS_OK;
+
+    // The canonic first bytes are spread over the buckets in ascending order, so each bucket holds close byte
+    // values. These tend to share their high nibble, which keeps the nibble tables tight.
+    bzero(is_first, sizeof(is_first));
+    for (auto &pattern : patterns) {
+        if (pattern.buf.empty()) return KISS_OK;
+        u_char canonic = prefilter_xlate_char(nfa_h, pattern.buf[0]);
+        if (!is_first[canonic]) n_first++;
+        is_first[canonic] = 1;
+    }
+    for (i = 0; i < KISS_PM_ALPHABET_SIZE; i++) {
+        if (!is_first[i]) continue;
+        bucket_of_first[i] = (rank * PREFILTER_BUCKETS_NUM) / n_first;
+        rank++;
+    }
+
+    bzero(sets, sizeof(sets));
+    for (auto &pattern : patterns) {
+        bucket = bucket_of_first[prefilter_xlate_char(nfa_h, pattern.buf[0])];
+        for (i = 0; i < KISS_THIN_NFA_PREFILTER_BYTES; i++) {
+            if (i < pattern.buf.size()) {
+                prefilter_add_char(nfa_h, pattern.buf[i], sets[i][bucket]);
+            } else {
+                // The pattern has ended, anything may follow it
+                memset(sets[i][bucket], 1, sizeof(sets[i][bucket]));
+            }
+        }
+    }
+
+    prefilter = (kiss_thin_nfa_prefilter_t *)kiss_pmglob_memory_kmalloc(sizeof(*prefilter), rname);
+    if (!prefilter) {
+        thinnfa_debug_err(("%s: Failed to allocate the prefilter\n", rname));
+        return KISS_ERROR;
+    }
+    bzero(prefilter, sizeof(*prefilter));
+    for (i = 0; i < KISS_THIN_NFA_PREFILTER_BYTES; i++) {
+        for (bucket = 0; bucket < PREFILTER_BUCKETS_NUM; bucket++) {
+            prefilter_set_bucket_tables(sets[i][bucket], bucket, prefilter->lo[i], prefilter->hi[i]);
+        }
+    }
+    prefilter->window_len = nfa_h->max_pat_len;
+
+    candidates_share = prefilter_candidates_share(prefilter);
+    if (candidates_share * PREFILTER_MAX_CANDIDATES_SHARE > 1) {
+        thinnfa_debug_major((
+            "%s: Not using a prefilter, it passes %u of 10000 positions\n",
+            rname,
+            (u_int)(candidates_share * 10000)
+        ));
+        kiss_pmglob_memory_kfree(prefilter, sizeof(*prefilter), rname);
+        return KISS_OK;
+    }
+
+    thinnfa_debug_major((
+        "%s: Using a prefilter for %u first bytes, passing %u of 10000 positions, window %u\n",
+        rname,
+        n_first,
+        (u_int)(candidates_share * 10000),
+        prefilter->window_len
+    ));
+    nfa_h->prefilter = prefilter;
+    return KISS_OK;
+}
+
+
+void
+kiss_thin_nfa_prefilter_free(KissThinNFA *nfa_h)
+{
+    static const char rname[] = "kiss_thin_nfa_prefilter_free";
+
+    if (nfa_h->prefilter == NULL) return;
+    kiss_pmglob_memory_kfree(nfa_h->prefilter, sizeof(*(nfa_h->prefilter)), rname);
+    nfa_h->prefilter = NULL;
+}
+
+
+static u_int
+prefilter_find_scalar(const kiss_thin_nfa_prefilter_t *prefilter, const u_char *buf, u_int from, u_int len)
+{
+    u_int pos, i;
+
+    for (pos = from; pos < len; pos++) {
+        u_char buckets = prefilter_buckets_of(prefilter, 0, buf[pos]);
+        for (i = 1; i < KISS_THIN_NFA_PREFILTER_BYTES && buckets && pos + i < len; i++) {
+            buckets &= prefilter_buckets_of(prefilter, i, buf[pos + i]);
+        }
+        if (buckets) return pos;
+    }
+    return len;
+}
+
+#ifdef KISS_THIN_NFA_PREFILTER_X86
+
+// Buckets of 16 bytes, looked up by their nibbles with pshufb
+__attribute__((target("ssse3"))) static CP_INLINE __m128i
+prefilter_buckets_ssse3(__m128i bytes, __m128i lo_tab, __m128i hi_tab)
+{
+    __m128i nibble_mask = _mm_set1_epi8(0xf);
+    __m128i lo = _mm_shuffle_epi8(lo_tab, _mm_and_si128(bytes, nibble_mask));
+    __m128i hi = _mm_shuffle_epi8(hi_tab, _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble_mask));
+    return _mm_and_si128(lo, hi);
+}
+
+__attribute__((target("ssse3"))) static u_int
+prefilter_find_ssse3(const kiss_thin_nfa_prefilter_t *prefilter, const u_char *buf, u_int from, u_int len)
+{
+    __m128i lo[KISS_THIN_NFA_PREFILTER_BYTES];
+    __m128i hi[KISS_THIN_NFA_PREFILTER_BYTES];
+    u_int pos = from;
+    u_int i;
+
+    for (i = 0; i < KISS_THIN_NFA_PREFILTER_BYTES; i++) {
+        lo[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(prefilter->lo[i]));
+        hi[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(prefilter->hi[i]));
+    }
+
+    // The bytes after the last of the 16 positions are needed too
+    for (; pos + 16 + KISS_THIN_NFA_PREFILTER_BYTES - 1 <= len; pos += 16) {
+        __m128i buckets = _mm_set1_epi8(-1);
+        for (i = 0; i < KISS_THIN_NFA_PREFILTER_BYTES; i++) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + pos + i));
+            buckets = _mm_and_si128(buckets, prefilter_buckets_ssse3(bytes, lo[i], hi[i]));
+        }
+        u_int candidates = ~_mm_movemask_epi8(_mm_cmpeq_epi8(buckets, _mm_setzero_si128())) & 0xffff;
+        if (candidates != 0) return pos + __builtin_ctz(candidates);
+    }
+    return prefilter_find_scalar(prefilter, buf, pos, len);
+}
+
+__attribute__((target("avx2"))) static CP_INLINE __m256i
+prefilter_buckets_avx2(__m256i bytes, __m256i lo_tab, __m256i hi_tab)
+{
+    __m256i nibble_mask = _mm256_set1_epi8(0xf);
+    __m256i lo = _mm256_shuffle_epi8(lo_tab, _mm256_and_si256(bytes, nibble_mask));
+    __m256i hi = _mm256_shuffle_epi8(hi_tab, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble_mask));
+    return _mm256_and_si256(lo, hi);
+}
+
+__attribute__((target("avx2"))) static u_int
+prefilter_find_avx2(const kiss_thin_nfa_prefilter_t *prefilter, const u_char *buf, u_int from, u_int len)
+{
+    __m256i lo[KISS_THIN_NFA_PREFILTER_BYTES];
+    __m256i hi[KISS_THIN_NFA_PREFILTER_BYTES];
+    u_int pos = from;
+    u_int i;
+
+    // vpshufb looks up each 128 bit lane separately, so both lanes get the tables
+    for (i = 0; i < KISS_THIN_NFA_PREFILTER_BYTES; i++) {
+        lo[i] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(prefilter->lo[i])));
+        hi[i] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(prefilter->hi[i])));
+    }
+
+    for (; pos + 32 + KISS_THIN_NFA_PREFILTER_BYTES - 1 <= len; pos += 32) {
+        __m256i buckets = _mm256_set1_epi8(-1);
+        for (i = 0; i < KISS_THIN_NFA_PREFILTER_BYTES; i++) {
+            __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(buf + pos + i));
+            buckets = _mm256_and_si256(buckets, prefilter_buckets_avx2(bytes, lo[i], hi[i]));
+        }
+        u_int candidates = ~static_cast<u_int>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(buckets, _mm256_setzero_si256()))
+        );
+        if (candidates != 0) return pos + __builtin_ctz(candidates);
+    }
+    return prefilter_find_ssse3(prefilter, buf, pos, len);
+}
+
+#endif // KISS_THIN_NFA_PREFILTER_X86
+
+typedef u_int (*prefilter_find_func_t)(const kiss_thin_nfa_prefilter_t *, const u_char *, u_int, u_int);
+
+static prefilter_find_func_t
+prefilter_select_find()
+{
+#ifdef KISS_THIN_NFA_PREFILTER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return prefilter_find_avx2;
+    if (__builtin_cpu_supports("ssse3")) return prefilter_find_ssse3;
+#endif
+    return prefilter_find_scalar;
+}
+
+
+// Find the first candidate position in buf, starting at from. Returns len if there is none.
+// Runs on AVX2 or SSSE3 when the CPU has them (selected once), and on a scalar loop otherwise.
+u_int
+kiss_thin_nfa_prefilter_find(const kiss_thin_nfa_prefilter_t *prefilter, const u_char *buf, u_int from, u_int len)
+{
+    static const prefilter_find_func_t find = prefilter_select_find();
+    return find(prefilter, buf, from, len);
+}
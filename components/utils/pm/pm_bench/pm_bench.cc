@@ -0,0 +1,121 @@
+// Copyright (C) 2022 Check Point Software Technologies Ltd. All rights reserved.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the Thin NFA scan throughput, with and without the literal prefilter, on clean traffic and on traffic
+// full of attack strings. The same automaton is used by both engines; the prefilter is dropped for the second one.
+//
+// Usage: pm_bench [megabytes per run]
+
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "kiss_thin_nfa_impl.h"
+#include "pm_adaptor.h"
+
+using namespace std;
+
+// First tier strings of the kind web attack signatures use
+static const vector<string> attack_patterns = {
+    "<script", "javascript:", "onerror=", "union select", "../..", "/etc/passwd", "cmd.exe", "${jndi:",
+    "xp_cmdshell", "<?php", "eval(", "base64_decode", "document.cookie", "sleep(", "waitfor delay", "<iframe"
+};
+
+static const vector<string> clean_words = {
+    "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog", "user", "session", "page", "sort",
+    "price", "currency", "filter", "status", "open", "owner", "tags", "red", "shoes", "size", "delivery",
+    "address", "street", "city", "country", "phone", "email", "order", "item", "quantity", "total"
+};
+
+static string
+makeCorpus(size_t size, bool with_attacks)
+{
+    string corpus;
+    corpus.reserve(size + 64);
+    srand(1);
+    while (corpus.size() < size) {
+        if (with_attacks && rand() % 4 == 0) {
+            corpus += attack_patterns[rand() % attack_patterns.size()];
+        } else {
+            corpus += clean_words[rand() % clean_words.size()];
+        }
+        corpus += " &=:,\"{}"[rand() % 8];
+    }
+    corpus.resize(size);
+    return corpus;
+}
+
+static unique_ptr<KissThinNFA>
+compile(const vector<string> &patterns, bool use_prefilter)
+{
+    list<kiss_pmglob_string_s> kiss_pats;
+    int id = 0;
+    for (auto &pattern : patterns) {
+        kiss_pats.emplace_back(pattern.data(), pattern.size(), ++id, 0);
+    }
+
+    KissPMError error;
+    auto nfa = kiss_thin_nfa_compile(kiss_pats, KISS_PM_COMP_CASELESS, &error);
+    if (nfa == nullptr) {
+        cerr << "Failed to compile the patterns" << endl;
+        exit(1);
+    }
+    if (!use_prefilter) kiss_thin_nfa_prefilter_free(nfa.get());
+    return nfa;
+}
+
+static void
+run(const string &name, KissThinNFA *nfa, const string &corpus, size_t total_bytes)
+{
+    Buffer buf(corpus);
+    vector<pair<uint, uint>> matches;
+    size_t scanned = 0;
+    size_t matches_count = 0;
+
+    auto start = chrono::steady_clock::now();
+    while (scanned < total_bytes) {
+        matches.clear();
+        kiss_thin_nfa_exec(nfa, buf, matches);
+        matches_count += matches.size();
+        scanned += corpus.size();
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    cout << name
+        << ": " << scanned / elapsed.count() / 1e9 << " GB/s, "
+        << matches_count / (scanned / corpus.size()) << " matches/buffer" << endl;
+}
+
+int
+main(int argc, char **argv)
+{
+    size_t megabytes = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000;
+    size_t total_bytes = megabytes << 20;
+
+    auto with_prefilter = compile(attack_patterns, true);
+    auto without_prefilter = compile(attack_patterns, false);
+    if (with_prefilter->prefilter == nullptr) cout << "The prefilter was not built for these patterns" << endl;
+
+    // Buffers the size of a request body chunk
+    string clean = makeCorpus(16 << 10, false);
+    string attacks = makeCorpus(16 << 10, true);
+
+    run("clean,   automaton", without_prefilter.get(), clean, total_bytes);
+    run("clean,   prefilter", with_prefilter.get(), clean, total_bytes);
+    run("attacks, automaton", without_prefilter.get(), attacks, total_bytes);
+    run("attacks, prefilter", with_prefilter.get(), attacks, total_bytes);
+    return 0;
+}
@@ -13,11 +13,20 @@
 
 #include "pm_hook.h"
 #include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
 #include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
 #include <fstream>
 #include <algorithm>
+#include <iomanip>
+#include <sstream>
 #include <string>
 #include <unordered_map>
+#include "config.h"
 #include "kiss_patterns.h"
 #include "kiss_thin_nfa_impl.h"
 
@@ -42,17 +51,122 @@ pm_pattern_to_kiss_pat_flags(const PMPattern &pat)
 
 
 static list<kiss_pmglob_string_s>
-convert_patt_map_to_kiss_list(const map<int, PMPattern> &patt_map)
+convert_patt_vector_to_kiss_list(const vector<PMPattern> &patt_vector)
 {
     list<kiss_pmglob_string_s> kiss_pats;
-    for (auto &pair : patt_map) {
-        auto &id = pair.first;
-        auto &pattern = pair.second;
-        kiss_pats.emplace_back(pattern.data(), pattern.size(), id, pm_pattern_to_kiss_pat_flags(pattern));
+    int id = 0;
+    for (auto &pattern : patt_vector) {
+        kiss_pats.emplace_back(pattern.data(), pattern.size(), ++id, pm_pattern_to_kiss_pat_flags(pattern));
     }
     return kiss_pats;
 }
 
+// Identifies what an automaton is compiled from: the compile flags and the patterns, with their IDs and flags
+static string
+calc_patterns_key(const vector<PMPattern> &patt_vector)
+{
+    string key = to_string(KISS_PM_COMP_CASELESS) + ';';
+    int id = 0;
+    for (auto &pattern : patt_vector) {
+        key += to_string(++id) + ':' + to_string(pm_pattern_to_kiss_pat_flags(pattern)) + ':';
+        key += to_string(pattern.size()) + ':';
+        key.append(reinterpret_cast<const char *>(pattern.data()), pattern.size());
+    }
+    return key;
+}
+
+// Identifies a compiled pattern set. Compiling the same patterns builds the same automaton, so the scan state of
+// a stream can be resumed by any hook (in any process) that has the same hash.
+static size_t
+calc_patterns_hash(const string &key)
+{
+    size_t hash = std::hash<string>()(key);
+    return hash != 0 ? hash : 1;
+}
+
+// Where compiled automatons are kept, by the hash of what they're compiled from, if setCompiledCacheDir() was called
+static bool is_compiled_cache_dir_set = false;
+static string compiled_cache_dir;
+
+// The directory is looked up whenever patterns are prepared, so every hook of the process follows the agent settings,
+// whichever component prepares it and whenever it does. Empty if compiled automatons are not kept.
+static string
+get_compiled_cache_dir()
+{
+    if (is_compiled_cache_dir_set) return compiled_cache_dir;
+    if (!Singleton::exists<Config::I_Config>()) return "";
+    if (!getProfileAgentSettingWithDefault<bool>(true, "patternMatcher.compiledCache.enabled")) return "";
+
+    static string created_dir;
+    string dir = getFilesystemPathConfig() + "/data/pm_cache";
+    if (dir != created_dir) {
+        if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+            dbgDebug(D_PM_COMP) << "Compiled pattern matchers are not kept, failed to create " << dir;
+            return "";
+        }
+        created_dir = dir;
+    }
+    return dir;
+}
+
+static string
+compiled_cache_path(const string &dir, size_t hash)
+{
+    stringstream path;
+    path << dir << "/pm_" << hex << setw(16) << setfill('0') << hash << ".tnfa";
+    return path.str();
+}
+
+// Compiled files that no process prepared for a week are removed, and then the least recently prepared ones, while
+// the rest take more than the size limit. Mapped files stay usable after they're removed. Temporary files are left
+// by writers that died before renaming them.
+static const time_t compiled_cache_max_age = 7 * 24 * 60 * 60;
+static const off_t compiled_cache_max_size = 256 * 1024 * 1024;
+static const time_t compiled_cache_tmp_max_age = 10 * 60;
+
+static bool
+has_suffix(const string &str, const string &suffix)
+{
+    return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static void
+evict_compiled_cache_files(const string &dir)
+{
+    DIR *dir_handle = opendir(dir.c_str());
+    if (dir_handle == nullptr) return;
+
+    time_t now = time(nullptr);
+    vector<pair<time_t, pair<string, off_t>>> compiled_files;
+    for (struct dirent *entry = readdir(dir_handle); entry != nullptr; entry = readdir(dir_handle)) {
+        string name = entry->d_name;
+        if (name.compare(0, 3, "pm_") != 0) continue;
+        bool is_tmp = name.find(".tnfa.tmp.") != string::npos;
+        if (!is_tmp && !has_suffix(name, ".tnfa")) continue;
+
+        string path = dir + "/" + name;
+        struct stat file_stat;
+        if (stat(path.c_str(), &file_stat) != 0) continue;
+
+        if (now - file_stat.st_mtime > (is_tmp ? compiled_cache_tmp_max_age : compiled_cache_max_age)) {
+            dbgDebug(D_PM_COMP) << "Removing an unused compiled pattern matcher file: " << path;
+            unlink(path.c_str());
+        } else if (!is_tmp) {
+            compiled_files.emplace_back(file_stat.st_mtime, make_pair(path, file_stat.st_size));
+        }
+    }
+    closedir(dir_handle);
+
+    sort(compiled_files.rbegin(), compiled_files.rend());
+    off_t total_size = 0;
+    for (auto &file : compiled_files) {
+        total_size += file.second.second;
+        if (total_size <= compiled_cache_max_size) continue;
+        dbgDebug(D_PM_COMP) << "Removing a compiled pattern matcher file over the size limit: " << file.second.first;
+        unlink(file.second.first.c_str());
+    }
+}
+
 // Explicit empty ctor and dtor needed due to incomplete definition of class used in unique_ptr. Bummer...
 PMHook::PMHook()
 {
@@ -82,40 +196,101 @@ PMHook::lineToPattern(const string &line)
 Maybe<void>
 PMHook::prepare(const set<PMPattern> &inputs)
 {
-    map<int, PMPattern> tmp;
-    int index = 0;
-    for (auto &pat : inputs) {
-        tmp.emplace(++index, pat);
-    }
+    return prepare(vector<PMPattern>(inputs.begin(), inputs.end()));
+}
 
-    if (Debug::isFlagAtleastLevel(D_PM_COMP, Debug::DebugLevel::DEBUG)) kiss_debug_start();
-    KissPMError pm_err;
-    handle = kiss_thin_nfa_compile(convert_patt_map_to_kiss_list(tmp), KISS_PM_COMP_CASELESS, &pm_err);
-    if (Debug::isFlagAtleastLevel(D_PM_COMP, Debug::DebugLevel::DEBUG)) kiss_debug_stop();
+void
+PMHook::setCompiledCacheDir(const string &dir)
+{
+    dbgDebug(D_PM_COMP) << "Compiled pattern matchers are kept in: " << (dir.empty() ? "(none)" : dir);
+    is_compiled_cache_dir_set = true;
+    compiled_cache_dir = dir;
+}
+
+Maybe<void>
+PMHook::prepare(const vector<PMPattern> &inputs)
+{
+    auto key = calc_patterns_key(inputs);
+    auto hash = calc_patterns_hash(key);
+    string cache_dir = get_compiled_cache_dir();
+    string cache_path = cache_dir.empty() ? "" : compiled_cache_path(cache_dir, hash);
+
+    handle = nullptr;
+    if (!cache_path.empty()) {
+        handle = kiss_thin_nfa_map_file(cache_path, key);
+        if (handle != nullptr) {
+            dbgDebug(D_PM_COMP) << "Using the compiled pattern matcher in " << cache_path;
+            // Marks the file as recently prepared, so it is not evicted
+            utimes(cache_path.c_str(), nullptr);
+        }
+    }
 
     if (handle == nullptr) {
-        dbgError(D_PM_COMP) << "PMHook::prepare() failed" << pm_err;
-        return genError(pm_err.error_string);
+        if (Debug::isFlagAtleastLevel(D_PM_COMP, Debug::DebugLevel::DEBUG)) kiss_debug_start();
+        KissPMError pm_err;
+        handle = kiss_thin_nfa_compile(convert_patt_vector_to_kiss_list(inputs), KISS_PM_COMP_CASELESS, &pm_err);
+        if (Debug::isFlagAtleastLevel(D_PM_COMP, Debug::DebugLevel::DEBUG)) kiss_debug_stop();
+
+        if (handle == nullptr) {
+            dbgError(D_PM_COMP) << "PMHook::prepare() failed" << pm_err;
+            return genError(pm_err.error_string);
+        }
+
+        // Keeping the compiled pattern matcher is only an optimization - it is fine if that fails
+        if (!cache_path.empty()) {
+            if (kiss_thin_nfa_write_file(handle.get(), cache_path, key) != KISS_OK) {
+                dbgDebug(D_PM_COMP) << "Failed to keep the compiled pattern matcher in " << cache_path;
+            }
+            evict_compiled_cache_files(cache_dir);
+        }
     }
 
-    patterns = tmp;
+    patterns_hash = hash;
+    patterns = inputs;
+    pattern_ids.clear();
+    uint id = 0;
+    for (auto &pat : patterns) {
+        pattern_ids.emplace(pat, ++id);
+    }
     return Maybe<void>();
 }
 
+Maybe<uint>
+PMHook::getPatternId(const PMPattern &pattern) const
+{
+    auto id = pattern_ids.find(pattern);
+    if (id == pattern_ids.end()) return genError("Pattern is not in the pattern matcher");
+    return id->second;
+}
+
 set<PMPattern>
 PMHook::scanBuf(const Buffer &buf) const
+{
+    PMMatchIds ids;
+    scanBufIds(buf, ids);
+
+    set<PMPattern> res;
+    ids.forEach([&] (uint id) { res.insert(getPattern(id)); });
+    return res;
+}
+
+void
+PMHook::scanBufIds(const Buffer &buf, PMMatchIds &ids) const
 {
     dbgAssert(handle != nullptr) << AlertInfo(AlertTeam::CORE, "pattern matcher") << "Unusable Pattern Matcher";
-    vector<pair<uint, uint>> pm_matches;
+
+    auto &pm_matches = ids.raw_matches;
+    pm_matches.clear();
     kiss_thin_nfa_exec(handle.get(), buf, pm_matches);
     dbgTrace(D_PM) << pm_matches.size() << " raw matches found";
+    if (pm_matches.empty()) return;
 
-    set<PMPattern> res;
+    // Size the bitmap once for all the patterns, instead of growing it by the IDs that matched
+    ids.bits.resize((patterns.size() + 1 + 63) / 64, 0);
     for (auto &match : pm_matches) {
-        res.insert(patterns.at(match.first));
+        ids.insert(match.first);
     }
-    dbgTrace(D_PM) << res.size() << " matches found after removing the duplicates";
-    return res;
+    dbgTrace(D_PM) << ids.size() << " matches found after removing the duplicates";
 }
 
 set<pair<uint, uint>>
@@ -145,10 +320,21 @@ PMHook::scanBufWithOffsetLambda(const Buffer &buf, I_PMScan::CBFunction cb) cons
     kiss_thin_nfa_exec(handle.get(), buf, pm_matches);
     dbgTrace(D_PM) << pm_matches.size() << " raw matches found";
 
+    // The parallel scan reports matches out of buffer order, and the prefiltered scan reports them in order. Sort
+    // them, so the callback limit below always keeps the first occurrences of a pattern, whichever scan was used.
+    sort(
+        pm_matches.begin(),
+        pm_matches.end(),
+        [] (const pair<uint, uint> &a, const pair<uint, uint> &b)
+        {
+            return a.second != b.second ? a.second < b.second : a.first < b.first;
+        }
+    );
+
     for (auto &res : pm_matches) {
         uint patIndex = res.first;
         uint cbCount = match_counts[patIndex];
-        const PMPattern &pat = patterns.at(patIndex);
+        const PMPattern &pat = getPattern(patIndex);
         bool noRegex = pat.isNoRegex();
         bool isShort = (pat.size() == 1);
 
@@ -170,6 +356,37 @@ PMHook::scanBufWithOffsetLambda(const Buffer &buf, I_PMScan::CBFunction cb) cons
     dbgTrace(D_PM) << totalCount << " filtered matches found";
 }
 
+bool
+PMHook::isResumable(const PMScanState &state) const
+{
+    return
+        handle != nullptr &&
+        state.patterns_hash == patterns_hash &&
+        kiss_thin_nfa_is_valid_offset(handle.get(), state.bnfa_offset);
+}
+
+void
+PMHook::scanStream(const Buffer &buf, PMScanState &state, const function<void(uint, uint)> &cb) const
+{
+    dbgAssert(handle != nullptr) << AlertInfo(AlertTeam::CORE, "pattern matcher") << "Unusable Pattern Matcher";
+
+    if (!isResumable(state)) {
+        dbgTrace(D_PM) << "Starting a stream scan at offset " << state.stream_offset;
+        state.patterns_hash = patterns_hash;
+        state.bnfa_offset = kiss_thin_nfa_initial_offset(handle.get());
+    }
+
+    vector<pair<uint, uint>> pm_matches;
+    kiss_bnfa_comp_offset_t bnfa_offset = state.bnfa_offset;
+    kiss_thin_nfa_exec_resume(handle.get(), buf, pm_matches, bnfa_offset, state.stream_offset);
+    state.bnfa_offset = bnfa_offset;
+    dbgTrace(D_PM) << pm_matches.size() << " raw matches found, stream offset " << state.stream_offset;
+
+    for (auto &match : pm_matches) {
+        cb(match.second, match.first);
+    }
+}
+
 bool
 PMPattern::operator<(const PMPattern &other) const
 {
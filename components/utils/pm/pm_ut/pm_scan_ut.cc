@@ -1,4 +1,11 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdlib.h>
 #include <string>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <fstream>
 
 #include "cptest.h"
 #include "pm_hook.h"
@@ -484,7 +491,42 @@ TEST(pm_scan, pm_offsets_lambda_test_pat_getIndex_method)
         {20, {"DCB", false, false, 0}},
         {26, {"DCB", false, false, 0}},
         {32, {"DCB", false, false, 0}},
-        {22, {"*", false, false, 0}}
+        {16, {"*", false, false, 0}}
+    };
+
+    EXPECT_EQ(results, expected);
+}
+
+TEST(pm_scan, pm_offsets_lambda_test_pat_limit_without_prefilter)
+{
+    set<PMPattern> initPatts;
+
+    initPatts.insert(PMPattern("ABC", false, false));
+    initPatts.insert(PMPattern("ABCD", false, false, 4));
+    initPatts.insert(PMPattern("CDE", false, false, 7));
+    initPatts.insert(PMPattern("DCB", false, false));
+    initPatts.insert(PMPattern("*", false, false));
+    // Too many single byte patterns for a prefilter to be selective, so the buffer is scanned in parallel
+    for (char c : string("!#%&+/:;<=>?@")) {
+        initPatts.insert(PMPattern(string(1, c), false, false));
+    }
+
+    PMHook pm;
+    EXPECT_TRUE(pm.prepare(initPatts).ok());
+
+    Buffer buf("12345ABCDEF5678 * DCB * DCB * DCB * DCB");
+    std::set<std::pair<u_int, PMPattern>> results;
+    pm.scanBufWithOffsetLambda(buf, [&] (uint offset, const PMPattern &pat, bool) { results.emplace(offset, pat); });
+
+    // Same as with a prefilter: the callback limit keeps the first occurrences in the buffer
+    std::set<std::pair<uint, PMPattern>> expected{
+        {8, {"ABCD", false, false, 4}},
+        {7, {"ABC", false, false, 0}},
+        {9, {"CDE", false, false, 7}},
+        {20, {"DCB", false, false, 0}},
+        {26, {"DCB", false, false, 0}},
+        {32, {"DCB", false, false, 0}},
+        {16, {"*", false, false, 0}}
     };
 
     EXPECT_EQ(results, expected);
@@ -528,3 +570,418 @@ TEST(pm_scan, pm_offsets_lambda_test_pat_limit_noregex)
 
     EXPECT_EQ(results, expected);
 }
+
+static set<pair<uint, PMPattern>>
+scan_stream(const PMHook &pm, PMScanState &state, const string &chunk)
+{
+    set<pair<uint, PMPattern>> results;
+    pm.scanStream(Buffer(chunk), state, [&] (uint offset, uint id) { results.emplace(offset, pm.getPattern(id)); });
+    return results;
+}
+
+TEST(pm_scan, stream_finds_matches_across_chunks)
+{
+    PMHook pm;
+    ASSERT_TRUE(pm.prepare(getPatternSet("ABCDEF", "XYZ")).ok());
+
+    PMScanState state;
+    EXPECT_EQ(scan_stream(pm, state, "12345ABC"), (set<pair<uint, PMPattern>>()));
+    EXPECT_EQ(state.getStreamOffset(), 8u);
+
+    set<pair<uint, PMPattern>> expected{ {10, PMPattern("ABCDEF", false, false)} };
+    EXPECT_EQ(scan_stream(pm, state, "DEF"), expected);
+
+    expected = { {13, PMPattern("XYZ", false, false)} };
+    EXPECT_EQ(scan_stream(pm, state, "XYZ-----XY"), expected);
+
+    expected = { {21, PMPattern("XYZ", false, false)} };
+    EXPECT_EQ(scan_stream(pm, state, "Z"), expected);
+    EXPECT_EQ(state.getStreamOffset(), 22u);
+}
+
+TEST(pm_scan, stream_matches_like_whole_buffer)
+{
+    auto pats = getPatternSet("he", "ex", "hex", "(", ")", "^he", "x)$");
+    PMHook pm;
+    ASSERT_TRUE(pm.prepare(pats).ok());
+
+    string stream = "hex(hex)hexhex(he)x)";
+    auto whole_buffer = pm.scanBufWithOffset(Buffer(stream));
+    // '$' matches at the end of every chunk, so it is only compared on the last one
+    auto end_match = make_pair(get_index_in_set(pats, PMPattern("x)", false, true)), uint(stream.size() - 1));
+    EXPECT_EQ(whole_buffer.count(end_match), 1u);
+
+    for (uint chunk_size = 1; chunk_size <= stream.size(); chunk_size++) {
+        PMScanState state;
+        set<pair<uint, uint>> chunks;
+        for (uint pos = 0; pos < stream.size(); pos += chunk_size) {
+            for (auto &match : scan_stream(pm, state, stream.substr(pos, chunk_size))) {
+                auto chunk_match = make_pair(get_index_in_set(pats, match.second), match.first);
+                if (chunk_match.first == end_match.first && chunk_match != end_match) continue;
+                chunks.insert(chunk_match);
+            }
+        }
+        EXPECT_THAT(chunks, ContainerEq(whole_buffer)) << "chunk size " << chunk_size;
+    }
+}
+
+TEST(pm_scan, stream_state_resumable_by_same_patterns)
+{
+    PMHook pm;
+    ASSERT_TRUE(pm.prepare(getPatternSet("ABCDEF")).ok());
+    PMHook same_pm;
+    ASSERT_TRUE(same_pm.prepare(getPatternSet("ABCDEF")).ok());
+    PMHook other_pm;
+    ASSERT_TRUE(other_pm.prepare(getPatternSet("ABCDEG")).ok());
+
+    PMScanState state;
+    EXPECT_FALSE(pm.isResumable(state));
+    scan_stream(pm, state, "ABC");
+    EXPECT_TRUE(pm.isResumable(state));
+    EXPECT_TRUE(same_pm.isResumable(state));
+    EXPECT_FALSE(other_pm.isResumable(state));
+
+    set<pair<uint, PMPattern>> expected{ {5, PMPattern("ABCDEF", false, false)} };
+    PMScanState same_state = state;
+    EXPECT_EQ(scan_stream(same_pm, same_state, "DEF"), expected);
+
+    // A state of other patterns starts over from the initial state, keeping the stream offset
+    EXPECT_EQ(scan_stream(other_pm, state, "DEG"), (set<pair<uint, PMPattern>>()));
+    EXPECT_EQ(state.getStreamOffset(), 6u);
+    expected = { {11, PMPattern("ABCDEG", false, false)} };
+    EXPECT_EQ(scan_stream(other_pm, state, "ABCDEG"), expected);
+}
+
+TEST(pm_scan, ids_of_matched_patterns)
+{
+    auto pats = getPatternSet("he", "ex", "hex", "^ex", "abc");
+    PMHook pm;
+    ASSERT_TRUE(pm.prepare(pats).ok());
+    EXPECT_EQ(pm.getPatternsCount(), 5u);
+
+    PMMatchIds ids;
+    pm.scanBufIds(Buffer("hexhex"), ids);
+    EXPECT_EQ(ids.size(), 3u);
+
+    set<PMPattern> matched;
+    ids.forEach([&] (uint id) { matched.insert(pm.getPattern(id)); });
+    EXPECT_EQ(matched, getPatternSet("he", "ex", "hex"));
+    EXPECT_EQ(matched, pm.scanBuf(Buffer("hexhex")));
+
+    auto abc_id = pm.getPatternId(PMHook::lineToPattern("abc").unpackMove());
+    ASSERT_TRUE(abc_id.ok());
+    EXPECT_EQ(pm.getPattern(*abc_id), PMHook::lineToPattern("abc").unpackMove());
+    EXPECT_FALSE(ids.contains(*abc_id));
+    EXPECT_FALSE(pm.getPatternId(PMHook::lineToPattern("xyz").unpackMove()).ok());
+
+    ids.clear();
+    EXPECT_TRUE(ids.empty());
+    pm.scanBufIds(Buffer("--abc--"), ids);
+    EXPECT_EQ(ids.size(), 1u);
+    EXPECT_TRUE(ids.contains(*abc_id));
+
+    ids.clear();
+    pm.scanBufIds(Buffer("nothing to see"), ids);
+    EXPECT_TRUE(ids.empty());
+}
+
+TEST(pm_scan, ids_kept_when_patterns_are_appended)
+{
+    vector<PMPattern> pats = { PMPattern("ABC", false, false), PMPattern("XYZ", false, false) };
+    PMHook pm;
+    ASSERT_TRUE(pm.prepare(pats).ok());
+    EXPECT_EQ(pm.getPatternId(PMPattern("XYZ", false, false)).unpack(), 2u);
+
+    pats.push_back(PMPattern("AAA", false, false));
+    ASSERT_TRUE(pm.prepare(pats).ok());
+    EXPECT_EQ(pm.getPatternId(PMPattern("ABC", false, false)).unpack(), 1u);
+    EXPECT_EQ(pm.getPatternId(PMPattern("XYZ", false, false)).unpack(), 2u);
+    EXPECT_EQ(pm.getPatternId(PMPattern("AAA", false, false)).unpack(), 3u);
+
+    PMMatchIds ids;
+    pm.scanBufIds(Buffer("AAAXYZ"), ids);
+    vector<uint> matched;
+    ids.forEach([&] (uint id) { matched.push_back(id); });
+    EXPECT_EQ(matched, vector<uint>({ 2, 3 }));
+}
+
+// Finds the matches of caseless patterns by comparing them at every position of the buffer
+static set<pair<uint, uint>>
+naive_scan(const set<PMPattern> &pats, const string &buf)
+{
+    set<pair<uint, uint>> res;
+    uint id = 0;
+    for (auto &pat : pats) {
+        id++;
+        for (uint end = pat.size(); end <= buf.size(); end++) {
+            uint start = end - pat.size();
+            if (pat.isStartMatch() && start != 0) continue;
+            if (pat.isEndMatch() && end != buf.size()) continue;
+            bool is_match = true;
+            for (uint i = 0; i < pat.size() && is_match; i++) {
+                is_match = tolower(buf[start + i]) == tolower(pat.data()[i]);
+            }
+            if (is_match) res.emplace(id, end - 1);
+        }
+    }
+    return res;
+}
+
+TEST(pm_scan, prefiltered_scan_matches_naive_scan)
+{
+    // Pattern bytes are rare in the buffers, so most of each buffer is skipped by the prefilter
+    static const string pattern_chars = "abAB()";
+    static const string buffer_chars = "abAB()------------------------------------zzzzzzzzzzzzzzzzzzzzzzzzzzzzz..\n";
+    srand(0);
+
+    for (int round = 0; round < 200; round++) {
+        set<PMPattern> pats;
+        int pats_num = 1 + rand() % 4;
+        for (int i = 0; i < pats_num; i++) {
+            string pat;
+            int pat_len = 1 + rand() % 5;
+            for (int j = 0; j < pat_len; j++) {
+                pat += pattern_chars[rand() % pattern_chars.size()];
+            }
+            pats.insert(PMPattern(pat, rand() % 8 == 0, rand() % 8 == 0));
+        }
+
+        string buf;
+        int buf_len = rand() % 300;
+        for (int i = 0; i < buf_len; i++) {
+            buf += buffer_chars[rand() % buffer_chars.size()];
+        }
+
+        PMHook pm;
+        ASSERT_TRUE(pm.prepare(pats).ok());
+        EXPECT_EQ(pm.scanBufWithOffset(Buffer(buf)), naive_scan(pats, buf)) << "round " << round << ": " << buf;
+
+        // A buffer of several segments is scanned segment by segment
+        uint split = buf.empty() ? 0 : rand() % buf.size();
+        Buffer segmented = Buffer(buf.substr(0, split)) + Buffer(buf.substr(split));
+        EXPECT_EQ(pm.scanBufWithOffset(segmented), naive_scan(pats, buf)) << "round " << round << ": " << buf;
+    }
+}
+
+TEST(pm_scan, prefiltered_scan_of_long_buffer)
+{
+    auto pats = getPatternSet("attack", "^GET", "evil$");
+    PMHook pm;
+    ASSERT_TRUE(pm.prepare(pats).ok());
+
+    string buf = "get " + string(5000, '-') + "ATTACK" + string(3000, '=') + "attac" + string(100, ' ') + "EviL";
+    set<pair<uint, uint>> expected{
+        { get_index_in_set(pats, PMHook::lineToPattern("^GET").unpackMove()), 2 },
+        { get_index_in_set(pats, PMHook::lineToPattern("attack").unpackMove()), 5009 },
+        { get_index_in_set(pats, PMHook::lineToPattern("evil$").unpackMove()), buf.size() - 1 }
+    };
+    EXPECT_EQ(pm.scanBufWithOffset(Buffer(buf)), expected);
+    EXPECT_EQ(pm.scanBufWithOffset(Buffer(buf)), naive_scan(pats, buf));
+}
+
+TEST(pm_scan, prefiltered_scan_of_dense_buffer)
+{
+    auto pats = getPatternSet("attack", "tack", "evil$");
+    PMHook pm;
+    ASSERT_TRUE(pm.prepare(pats).ok());
+
+    // Candidates are dense from the start, so the rest of the buffer is scanned without the prefilter
+    string buf;
+    for (int i = 0; i < 100; i++) {
+        buf += (i % 3 == 0) ? "attack " : "tacky= ";
+    }
+    buf += "evil";
+    EXPECT_EQ(pm.scanBufWithOffset(Buffer(buf)), naive_scan(pats, buf));
+
+    // A window that is in progress when the first segment ends goes on in the second
+    Buffer segmented = Buffer(buf.substr(0, 302)) + Buffer(buf.substr(302));
+    EXPECT_EQ(pm.scanBufWithOffset(segmented), naive_scan(pats, buf));
+}
+
+class PMCompiledCacheTest : public Test
+{
+public:
+    PMCompiledCacheTest()
+    {
+        char dir_template[] = "/tmp/pm_cache_ut.XXXXXX";
+        dir = mkdtemp(dir_template);
+        PMHook::setCompiledCacheDir(dir);
+    }
+
+    ~PMCompiledCacheTest()
+    {
+        PMHook::setCompiledCacheDir("");
+        for (auto &file : getFiles()) unlink(file.c_str());
+        rmdir(dir.c_str());
+    }
+
+    vector<string>
+    getFiles() const
+    {
+        vector<string> files;
+        DIR *dir_handle = opendir(dir.c_str());
+        if (dir_handle == nullptr) return files;
+        for (struct dirent *entry = readdir(dir_handle); entry != nullptr; entry = readdir(dir_handle)) {
+            string name = entry->d_name;
+            if (name != "." && name != "..") files.push_back(dir + "/" + name);
+        }
+        closedir(dir_handle);
+        return files;
+    }
+
+    static string
+    getContents(const string &file)
+    {
+        ifstream stream(file);
+        return string(istreambuf_iterator<char>(stream), istreambuf_iterator<char>());
+    }
+
+    static void
+    createFile(const string &file, time_t age)
+    {
+        ofstream(file) << "not a compiled pattern matcher";
+        struct timeval times[2];
+        gettimeofday(&times[0], nullptr);
+        times[0].tv_sec -= age;
+        times[1] = times[0];
+        EXPECT_EQ(utimes(file.c_str(), times), 0);
+    }
+
+    static ino_t
+    getInode(const string &file)
+    {
+        struct stat file_stat;
+        EXPECT_EQ(stat(file.c_str(), &file_stat), 0);
+        return file_stat.st_ino;
+    }
+
+    string dir;
+};
+
+TEST_F(PMCompiledCacheTest, compiled_patterns_are_mapped_on_next_prepare)
+{
+    auto pats = getPatternSet("attack", "^GET", "evil$", "ab");
+    string buf = "get " + string(500, '-') + "ATTACK" + string(300, '=') + "abab" + string(100, ' ') + "EviL";
+
+    PMHook compiled;
+    ASSERT_TRUE(compiled.prepare(pats).ok());
+    auto files = getFiles();
+    ASSERT_EQ(files.size(), 1u);
+    auto inode = getInode(files[0]);
+
+    // The second hook maps the file, rather than compiling and writing it again
+    PMHook mapped;
+    ASSERT_TRUE(mapped.prepare(pats).ok());
+    EXPECT_EQ(getFiles(), files);
+    EXPECT_EQ(getInode(files[0]), inode);
+
+    EXPECT_EQ(mapped.scanBufWithOffset(Buffer(buf)), compiled.scanBufWithOffset(Buffer(buf)));
+    EXPECT_EQ(mapped.scanBufWithOffset(Buffer(buf)), naive_scan(pats, buf));
+
+    // A stream started by one hook is resumed by the other
+    PMScanState state;
+    set<pair<uint, uint>> stream_matches;
+    auto cb = [&] (uint offset, uint id) { stream_matches.emplace(id, offset); };
+    compiled.scanStream(Buffer(buf.substr(0, 503)), state, cb);
+    EXPECT_TRUE(mapped.isResumable(state));
+    mapped.scanStream(Buffer(buf.substr(503)), state, cb);
+    stream_matches.insert({ get_index_in_set(pats, PMHook::lineToPattern("evil$").unpackMove()), buf.size() - 1 });
+    EXPECT_EQ(stream_matches, naive_scan(pats, buf));
+
+    // Other patterns are kept in a file of their own
+    PMHook other;
+    ASSERT_TRUE(other.prepare(getPatternSet("other")).ok());
+    EXPECT_EQ(getFiles().size(), 2u);
+}
+
+TEST_F(PMCompiledCacheTest, bad_compiled_file_is_replaced)
+{
+    auto pats = getPatternSet("attack", "evil");
+    string buf = "an attack of evil";
+
+    PMHook compiled;
+    ASSERT_TRUE(compiled.prepare(pats).ok());
+    auto files = getFiles();
+    ASSERT_EQ(files.size(), 1u);
+
+    // A truncated file is not mapped - the patterns are compiled and the file is written again
+    ASSERT_EQ(truncate(files[0].c_str(), 100), 0);
+    PMHook recompiled;
+    ASSERT_TRUE(recompiled.prepare(pats).ok());
+    EXPECT_EQ(recompiled.scanBufWithOffset(Buffer(buf)), naive_scan(pats, buf));
+    auto inode = getInode(files[0]);
+
+    PMHook mapped;
+    ASSERT_TRUE(mapped.prepare(pats).ok());
+    EXPECT_EQ(getInode(files[0]), inode);
+    EXPECT_EQ(mapped.scanBufWithOffset(Buffer(buf)), naive_scan(pats, buf));
+}
+
+TEST_F(PMCompiledCacheTest, changed_compiled_file_is_replaced)
+{
+    auto pats = getPatternSet("attack", "evil");
+    string buf = "an attack of evil";
+
+    PMHook compiled;
+    ASSERT_TRUE(compiled.prepare(pats).ok());
+    auto files = getFiles();
+    ASSERT_EQ(files.size(), 1u);
+    auto contents = getContents(files[0]);
+
+    // A file of the right size, with a changed byte in the automaton, fails the checksum and is written again
+    int fd = open(files[0].c_str(), O_WRONLY);
+    ASSERT_GE(fd, 0);
+    char changed = contents[contents.size() / 2] ^ 0x5a;
+    EXPECT_EQ(pwrite(fd, &changed, 1, contents.size() / 2), 1);
+    close(fd);
+    EXPECT_NE(getContents(files[0]), contents);
+
+    PMHook recompiled;
+    ASSERT_TRUE(recompiled.prepare(pats).ok());
+    EXPECT_EQ(recompiled.scanBufWithOffset(Buffer(buf)), naive_scan(pats, buf));
+    EXPECT_EQ(getContents(files[0]), contents);
+}
+
+TEST_F(PMCompiledCacheTest, unused_compiled_files_are_evicted)
+{
+    static const time_t day = 24 * 60 * 60;
+    auto pats = getPatternSet("attack", "evil");
+
+    PMHook compiled;
+    ASSERT_TRUE(compiled.prepare(pats).ok());
+    auto files = getFiles();
+    ASSERT_EQ(files.size(), 1u);
+    string used_file = files[0];
+
+    string unused_file = dir + "/pm_0000000000000001.tnfa";
+    string stale_tmp_file = dir + "/pm_0000000000000002.tnfa.tmp.12345";
+    string fresh_tmp_file = dir + "/pm_0000000000000003.tnfa.tmp.12346";
+    string other_file = dir + "/other.tnfa";
+    createFile(unused_file, 8 * day);
+    createFile(stale_tmp_file, day);
+    createFile(fresh_tmp_file, 0);
+    createFile(other_file, 8 * day);
+
+    // A file that was written long ago, but is prepared again, is marked as used
+    struct timeval times[2];
+    gettimeofday(&times[0], nullptr);
+    times[0].tv_sec -= 8 * day;
+    times[1] = times[0];
+    ASSERT_EQ(utimes(used_file.c_str(), times), 0);
+    PMHook mapped;
+    ASSERT_TRUE(mapped.prepare(pats).ok());
+
+    // Writing a new file evicts the files that were not used for long, and the stale temporary files
+    PMHook other;
+    ASSERT_TRUE(other.prepare(getPatternSet("other")).ok());
+    files = getFiles();
+    set<string> remaining(files.begin(), files.end());
+    EXPECT_EQ(remaining.count(unused_file), 0u);
+    EXPECT_EQ(remaining.count(stale_tmp_file), 0u);
+    EXPECT_EQ(remaining.count(fresh_tmp_file), 1u);
+    EXPECT_EQ(remaining.count(other_file), 1u);
+    EXPECT_EQ(remaining.count(used_file), 1u);
+    EXPECT_EQ(remaining.size(), 4u);
+
+    EXPECT_EQ(mapped.scanBufWithOffset(Buffer("an attack of evil")), naive_scan(pats, "an attack of evil"));
+}
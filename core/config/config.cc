@@ -104,11 +104,20 @@ class ConfigComponent::Impl : public Singleton::Provide<I_Config>::From<ConfigCo
 {
     using PerContextValue = vector<pair<shared_ptr<EnvironmentEvaluator<bool>>, TypeWrapper>>;
 
+    // The configuration values of a registered path, for a specific tenant and profile
+    struct ResolvedConfigHandle
+    {
+        const PerContextValue *tenant_values = nullptr;
+        const PerContextValue *global_values = nullptr;
+    };
+
 public:
     void preload();
     void init();
 
     const TypeWrapper & getConfiguration(const vector<string> &paths) const override;
+    const TypeWrapper & getConfiguration(uint handle_id) const override;
+    const TypeWrapper & getConfiguration(uint handle_id, ConfigHandleCache &cache) const override;
     PerContextValue getAllConfiguration(const std::vector<std::string> &paths) const;
     const TypeWrapper & getResource(const vector<string> &paths) const override;
     const TypeWrapper & getSetting(const vector<string> &paths) const override;
@@ -126,6 +135,7 @@ public:
         const string &tenant = "",
         const string &profile = "") const override;
 
+    uint registerConfigurationHandle(const std::vector<std::string> &paths) override;
     bool setConfiguration(TypeWrapper &&value, const std::vector<std::string> &paths) override;
     bool setResource(TypeWrapper &&value, const std::vector<std::string> &paths) override;
     bool setSetting(TypeWrapper &&value, const std::vector<std::string> &paths) override;
@@ -159,6 +169,12 @@ private:
     vector<string> fillMultiTenantExpectedConfigFiles(const map<string, set<string>> &tenants);
     map<string, string> getProfileAgentSetting() const;
     void resolveVsId() const;
+    const vector<ResolvedConfigHandle> & getResolvedConfigHandles(const TenantProfilePair &tenant_profile) const;
+    void invalidateConfigHandles();
+    const PerContextValue * findConfiguration(
+        const TenantProfilePair &tenant_profile,
+        const vector<string> &paths
+    ) const;
 
     string
     getActiveTenant() const
@@ -290,6 +306,13 @@ private:
     unordered_map<TenantProfilePair, map<vector<string>, TypeWrapper>> new_settings_nodes;
     unordered_map<string, string> new_config_flags;
 
+    map<vector<string>, uint> config_handle_ids;
+    vector<vector<string>> config_handle_paths;
+    // Pointers into configuration_nodes, so every change of the configuration nodes must clear it
+    mutable unordered_map<TenantProfilePair, vector<ResolvedConfigHandle>> resolved_config_handles;
+    // Changes with every change of the configuration nodes, so handles know when their cached values are stale
+    uint64_t config_generation = 1;
+
     set<unique_ptr<GenericConfig<true>>> expected_configs;
     set<unique_ptr<GenericConfig<false>>> expected_resources;
     set<unique_ptr<GenericConfig<false>>> expected_settings;
@@ -387,6 +410,86 @@ ConfigComponent::Impl::getConfiguration(const vector<string> &paths) const
     return empty;
 }
 
+const TypeWrapper &
+ConfigComponent::Impl::getConfiguration(uint handle_id) const
+{
+    if (handle_id >= config_handle_paths.size()) return empty;
+
+    const auto &resolved_handles = getResolvedConfigHandles(TenantProfilePair(getActiveTenant(), getActiveProfile()));
+    const ResolvedConfigHandle &resolved_handle = resolved_handles[handle_id];
+
+    if (resolved_handle.tenant_values != nullptr) {
+        for (auto &value : *resolved_handle.tenant_values) {
+            if (checkContext(value.first)) return value.second;
+        }
+    }
+
+    if (resolved_handle.global_values != nullptr) {
+        for (auto &value : *resolved_handle.global_values) {
+            if (checkContext(value.first)) return value.second;
+        }
+    }
+
+    return empty;
+}
+
+const TypeWrapper &
+ConfigComponent::Impl::getConfiguration(uint handle_id, ConfigHandleCache &cache) const
+{
+    if (handle_id >= config_handle_paths.size()) return empty;
+
+    if (cache.generation != config_generation) {
+        // With only the global configuration, every tenant and profile resolves to the global values
+        TenantProfilePair global_tenant_profile(default_tenant_id, default_profile_id);
+        cache.generation = config_generation;
+        cache.is_tenant_independent =
+            configuration_nodes.empty() ||
+            (configuration_nodes.size() == 1 && configuration_nodes.begin()->first == global_tenant_profile);
+        cache.values =
+            cache.is_tenant_independent ?
+            findConfiguration(global_tenant_profile, config_handle_paths[handle_id]) :
+            nullptr;
+    }
+
+    if (!cache.is_tenant_independent) return getConfiguration(handle_id);
+    if (cache.values == nullptr) return empty;
+
+    for (auto &value : *cache.values) {
+        if (checkContext(value.first)) return value.second;
+    }
+
+    return empty;
+}
+
+const vector<ConfigComponent::Impl::ResolvedConfigHandle> &
+ConfigComponent::Impl::getResolvedConfigHandles(const TenantProfilePair &tenant_profile) const
+{
+    TenantProfilePair global_tenant_profile(default_tenant_id, default_profile_id);
+    auto &resolved_handles = resolved_config_handles[tenant_profile];
+    while (resolved_handles.size() < config_handle_paths.size()) {
+        const vector<string> &paths = config_handle_paths[resolved_handles.size()];
+        ResolvedConfigHandle resolved_handle;
+        if (!(tenant_profile == global_tenant_profile)) {
+            resolved_handle.tenant_values = findConfiguration(tenant_profile, paths);
+        }
+        resolved_handle.global_values = findConfiguration(global_tenant_profile, paths);
+        resolved_handles.push_back(resolved_handle);
+    }
+    return resolved_handles;
+}
+
+const ConfigComponent::Impl::PerContextValue *
+ConfigComponent::Impl::findConfiguration(const TenantProfilePair &tenant_profile, const vector<string> &paths) const
+{
+    auto tenant_configs = configuration_nodes.find(tenant_profile);
+    if (tenant_configs == configuration_nodes.end()) return nullptr;
+
+    auto requested_config = tenant_configs->second.find(paths);
+    if (requested_config == tenant_configs->second.end()) return nullptr;
+
+    return &requested_config->second;
+}
+
 vector<pair<shared_ptr<EnvironmentEvaluator<bool>>, TypeWrapper>>
 ConfigComponent::Impl::getAllConfiguration(const vector<string> &paths) const
 {
@@ -505,9 +608,28 @@ ConfigComponent::Impl::getPolicyConfigPath(
     return "";
 }
 
+void
+ConfigComponent::Impl::invalidateConfigHandles()
+{
+    resolved_config_handles.clear();
+    ++config_generation;
+}
+
+uint
+ConfigComponent::Impl::registerConfigurationHandle(const vector<string> &paths)
+{
+    auto handle_id = config_handle_ids.find(paths);
+    if (handle_id != config_handle_ids.end()) return handle_id->second;
+
+    config_handle_paths.push_back(paths);
+    config_handle_ids.emplace(paths, config_handle_paths.size() - 1);
+    return config_handle_paths.size() - 1;
+}
+
 bool
 ConfigComponent::Impl::setConfiguration(TypeWrapper &&value, const vector<string> &paths)
 {
+    invalidateConfigHandles();
     for (auto &tenant : configuration_nodes) {
         tenant.second.erase(paths);
     }
@@ -671,6 +793,7 @@ ConfigComponent::Impl::registerConfigAbortCb(ConfigCb cb)
 void
 ConfigComponent::Impl::clearOldTenants()
 {
+    invalidateConfigHandles();
     for (
         auto iter = configuration_nodes.begin();
         iter != configuration_nodes.end();
@@ -783,6 +906,7 @@ bool
 ConfigComponent::Impl::commitSuccess()
 {
     new_resource_nodes.clear();
+    invalidateConfigHandles();
     configuration_nodes = move(new_configuration_nodes);
     settings_nodes = move(new_settings_nodes);
 
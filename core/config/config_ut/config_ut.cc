@@ -0,0 +1,120 @@
+#include "config.h"
+#include "config_component.h"
+
+#include <sstream>
+
+#include "cptest.h"
+#include "environment.h"
+#include "mock/mock_mainloop.h"
+
+using namespace std;
+using namespace testing;
+
+class ConfigHandleTest : public Test
+{
+public:
+    ConfigHandleTest()
+    {
+        config = Singleton::Consume<Config::I_Config>::from(conf);
+        registerExpectedConfiguration<int>("Test", "Int value");
+        registerExpectedConfiguration<string>("Test", "String value");
+    }
+
+    bool
+    loadConfiguration(const string &json)
+    {
+        istringstream json_stream(json);
+        return config->loadConfiguration(json_stream);
+    }
+
+    ::Environment env;
+    ConfigComponent conf;
+    NiceMock<MockMainLoop> mock_mainloop;
+    Config::I_Config *config = nullptr;
+};
+
+static const string int_and_string_config =
+    "{\n"
+    "    \"Test\": {\n"
+    "        \"Int value\": [ { \"value\": 5 } ],\n"
+    "        \"String value\": [ { \"value\": \"first\" } ]\n"
+    "    }\n"
+    "}\n";
+
+TEST_F(ConfigHandleTest, unregistered_handle)
+{
+    ConfigHandle<int> handle;
+    EXPECT_FALSE(handle.isRegistered());
+    EXPECT_THAT(handle.get(), IsError(Config::Errors::MISSING_TAG));
+    EXPECT_EQ(handle.getWithDefault(7), 7);
+}
+
+TEST_F(ConfigHandleTest, get_loaded_value)
+{
+    auto int_handle = getConfigurationHandle<int>("Test", "Int value");
+    auto string_handle = getConfigurationHandle<string>("Test", "String value");
+    auto missing_handle = getConfigurationHandle<int>("Test", "Missing value");
+    EXPECT_TRUE(int_handle.isRegistered());
+
+    EXPECT_THAT(int_handle.get(), IsError(Config::Errors::MISSING_TAG));
+    EXPECT_EQ(int_handle.getWithDefault(7), 7);
+
+    EXPECT_TRUE(loadConfiguration(int_and_string_config));
+
+    EXPECT_THAT(int_handle.get(), IsValue(5));
+    EXPECT_THAT(string_handle.get(), IsValue(string("first")));
+    EXPECT_EQ(missing_handle.getWithDefault(7), 7);
+    EXPECT_THAT(getConfigurationHandle<string>("Test", "Int value").get(), IsError(Config::Errors::BAD_NODE));
+}
+
+TEST_F(ConfigHandleTest, value_is_updated_on_new_configuration)
+{
+    auto int_handle = getConfigurationHandle<int>("Test", "Int value");
+    EXPECT_TRUE(loadConfiguration(int_and_string_config));
+    EXPECT_THAT(int_handle.get(), IsValue(5));
+
+    EXPECT_TRUE(loadConfiguration("{ \"Test\": { \"Int value\": [ { \"value\": 9 } ] } }"));
+    EXPECT_THAT(int_handle.get(), IsValue(9));
+
+    setConfiguration<int>(11, "Test", "Int value");
+    EXPECT_THAT(int_handle.get(), IsValue(11));
+    EXPECT_THAT(getConfiguration<int>("Test", "Int value"), IsValue(11));
+}
+
+TEST_F(ConfigHandleTest, handle_registered_after_load)
+{
+    EXPECT_TRUE(loadConfiguration(int_and_string_config));
+    auto int_handle = getConfigurationHandle<int>("Test", "Int value");
+    EXPECT_THAT(int_handle.get(), IsValue(5));
+
+    auto string_handle = getConfigurationHandle<string>("Test", "String value");
+    EXPECT_THAT(string_handle.get(), IsValue(string("first")));
+}
+
+TEST_F(ConfigHandleTest, active_tenant)
+{
+    setConfiguration<int>(3, "Test", "Int value");
+    auto int_handle = getConfigurationHandle<int>("Test", "Int value");
+    EXPECT_THAT(int_handle.get(), IsValue(3));
+
+    auto i_env = Singleton::Consume<I_Environment>::from(env);
+    i_env->registerValue<string>("ActiveTenantId", "tenant1");
+    i_env->registerValue<string>("ActiveProfileId", "profile1");
+    EXPECT_THAT(int_handle.get(), IsValue(3));
+}
+
+TEST_F(ConfigHandleTest, cached_value_is_dropped_on_new_configuration)
+{
+    auto int_handle = getConfigurationHandle<int>("Test", "Int value");
+    EXPECT_TRUE(loadConfiguration(int_and_string_config));
+    EXPECT_THAT(int_handle.get(), IsValue(5));
+    EXPECT_THAT(int_handle.get(), IsValue(5));
+
+    EXPECT_TRUE(loadConfiguration("{ \"Test\": { \"String value\": [ { \"value\": \"second\" } ] } }"));
+    EXPECT_THAT(int_handle.get(), IsError(Config::Errors::MISSING_TAG));
+
+    auto copied_handle = int_handle;
+    EXPECT_TRUE(loadConfiguration(int_and_string_config));
+    EXPECT_THAT(copied_handle.get(), IsValue(5));
+    EXPECT_THAT(int_handle.get(), IsValue(5));
+}
@@ -240,3 +240,26 @@ TEST(Event, dual_listener)
     EXPECT_THAT(event1.query(), ElementsAre());
     EXPECT_THAT(event2.performNamedQuery(), ElementsAre());
 }
+
+TEST(Event, named_query_with_respond_time)
+{
+    DualListener listen(15, "ther");
+    listen.registerListener();
+
+    chrono::microseconds now(100);
+    auto get_time = [&] () { now += chrono::microseconds(7); return now; };
+    vector<pair<string, chrono::microseconds>> timed_listeners;
+    auto report_respond_time = [&] (const string &name, chrono::microseconds time) {
+        timed_listeners.emplace_back(name, time);
+    };
+
+    IntEventReturnInt event(8);
+    EXPECT_THAT(event.performNamedQuery(get_time, report_respond_time), ElementsAre(Pair("DualListener", 15)));
+    EXPECT_EQ(listen.query_int, 8);
+    EXPECT_THAT(timed_listeners, ElementsAre(Pair("DualListener", chrono::microseconds(7))));
+
+    listen.unregisterListener();
+
+    EXPECT_THAT(event.performNamedQuery(get_time, report_respond_time), ElementsAre());
+    EXPECT_EQ(timed_listeners.size(), 1u);
+}
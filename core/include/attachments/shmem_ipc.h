@@ -25,6 +25,8 @@ extern "C"
 
 typedef struct SharedMemoryIPC SharedMemoryIPC;
 extern const int corrupted_shmem_error;
+// Returned by the send functions of version 2 queues for data that can never fit in the queue
+extern const int data_too_large_error;
 
 SharedMemoryIPC * initIpc(
     const char queue_name[32],
@@ -35,6 +37,29 @@ SharedMemoryIPC * initIpc(
     void (*debug_func)(int is_error, const char *func, const char *file, int line_num, const char *fmt, ...)
 );
 
+#define SHMEM_IPC_V1 1
+#define SHMEM_IPC_V2 2
+
+// The owner creates the queues in the requested version, where version 2 queues hold num_of_queue_elem KB of data
+// in a byte oriented ring. A user attaches to the queues in the version the owner created them, as long as it is not
+// newer than the requested version. initIpc creates version 1 queues, which all the attachments can use.
+SharedMemoryIPC * initIpcWithVersion(
+    const char queue_name[32],
+    const uint32_t user_id,
+    const uint32_t group_id,
+    int is_owner,
+    uint32_t num_of_queue_elem,
+    uint16_t version,
+    void (*debug_func)(int is_error, const char *func, const char *file, int line_num, const char *fmt, ...)
+);
+
+int getIpcVersion(SharedMemoryIPC *ipc);
+
+// For the owner of version 2 queues, returns 1 once the user attached to them. An attachment that knows only version
+// 1 queues cannot attach, so an owner that finds the queues unused when the attachment registers again can recreate
+// them in version 1. Version 1 queues do not record it, so 1 is returned for them.
+int isIpcUserAttached(SharedMemoryIPC *ipc);
+
 void destroyIpc(SharedMemoryIPC *ipc, int is_owner);
 
 int sendData(SharedMemoryIPC *ipc, const uint16_t data_to_send_size, const char *data_to_send);
@@ -51,14 +76,48 @@ int receiveData(SharedMemoryIPC *ipc, uint16_t *received_data_size, const char *
 
 int popData(SharedMemoryIPC *ipc);
 
+// The batch functions publish the queue position once for all the elements of the batch, and return the number of
+// elements sent/received/popped (or a negative value on error).
+int
+sendDataBatch(
+    SharedMemoryIPC *ipc,
+    const uint16_t *data_to_send_sizes,
+    const char **data_elem_to_send,
+    const uint16_t num_of_data_elem
+);
+
+int
+receiveDataBatch(
+    SharedMemoryIPC *ipc,
+    uint16_t *received_data_sizes,
+    const char **received_data,
+    const uint16_t max_num_of_data_elem
+);
+
+int popDataBatch(SharedMemoryIPC *ipc, const uint16_t num_of_data_elem);
+
 int isDataAvailable(SharedMemoryIPC *ipc);
 
+// Returns the percentage (0-100) of the receive queue that holds data that was not popped yet.
+int getRxQueueUsage(SharedMemoryIPC *ipc);
+
 void resetIpc(SharedMemoryIPC *ipc, uint16_t num_of_data_segments);
 
 void dumpIpcMemory(SharedMemoryIPC *ipc);
 
 int isCorruptedShmem(SharedMemoryIPC *ipc, int is_owner);
 
+// Doorbells coalesce the wakeups between the two sides of a version 2 IPC. A side arms its doorbell before it goes
+// idle (armDoorbell returns 1 if data arrived meanwhile and it should keep reading), and the other side rings it after
+// sending. ringDoorbell returns 1 only for the first ring after the peer went idle, which is when the peer has to be
+// signaled, and wakes the peer by itself if the peer waits in waitForDoorbell. With version 1 queues there is no
+// doorbell, and ringDoorbell always asks for a signal.
+int armDoorbell(SharedMemoryIPC *ipc);
+void disarmDoorbell(SharedMemoryIPC *ipc);
+int ringDoorbell(SharedMemoryIPC *ipc);
+int waitForDoorbell(SharedMemoryIPC *ipc, uint32_t timeout_msec);
+int isPeerWaitingOnDoorbell(SharedMemoryIPC *ipc);
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus
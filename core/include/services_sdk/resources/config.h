@@ -35,6 +35,12 @@ const ConfigurationType & getConfigurationWithDefault(const ConfigurationType &d
 template <typename ConfigurationType, typename ...Strings>
 Config::ConfigRange<ConfigurationType> getConfigurationMultimatch(const Strings & ... tags);
 
+template <typename ConfigurationType>
+class ConfigHandle;
+
+template <typename ConfigurationType, typename ... Strings>
+ConfigHandle<ConfigurationType> getConfigurationHandle(const Strings & ... tags);
+
 template <typename ResourceType, typename ... Strings>
 const Maybe<ResourceType, Config::Errors> & getResource(const Strings & ... tags);
 
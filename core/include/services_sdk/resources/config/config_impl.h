@@ -81,6 +81,48 @@ getConfigurationWithDefault(const ConfigurationType &deafult_val, const Strings
     return res.ok() ? res.unpack() : deafult_val;
 }
 
+// A configuration path that was looked up once, so getting its value does not build and search for the path again.
+// The values of the path are kept until the configuration changes, as long as they do not depend on the active tenant
+// and profile. The context of the values is still evaluated on every call.
+template <typename ConfigurationType>
+class ConfigHandle
+{
+public:
+    ConfigHandle() {}
+    ConfigHandle(Config::I_Config *_i_config, uint _handle_id) : i_config(_i_config), handle_id(_handle_id) {}
+
+    const Maybe<ConfigurationType, Config::Errors> &
+    get() const
+    {
+        if (i_config == nullptr) return TypeWrapper::failMissing<ConfigurationType>();
+        return i_config->getConfiguration(handle_id, cache).template getValue<ConfigurationType>();
+    }
+
+    const ConfigurationType &
+    getWithDefault(const ConfigurationType &deafult_val) const
+    {
+        auto &res = get();
+        return res.ok() ? res.unpack() : deafult_val;
+    }
+
+    bool isRegistered() const { return i_config != nullptr; }
+
+private:
+    Config::I_Config *i_config = nullptr;
+    uint handle_id = 0;
+    mutable Config::I_Config::ConfigHandleCache cache;
+};
+
+template <typename ConfigurationType, typename ... Strings>
+ConfigHandle<ConfigurationType>
+getConfigurationHandle(const Strings & ... strs)
+{
+    if (!Singleton::exists<Config::I_Config>()) return ConfigHandle<ConfigurationType>();
+    auto i_config = Singleton::Consume<Config::I_Config>::from<Config::MockConfigProvider>();
+    auto handle_id = i_config->registerConfigurationHandle(Config::getVector(strs ...));
+    return ConfigHandle<ConfigurationType>(i_config, handle_id);
+}
+
 template <typename ConfigurationType, typename ... Strings>
 Config::ConfigRange<ConfigurationType>
 getConfigurationMultimatch(const Strings & ... strs)
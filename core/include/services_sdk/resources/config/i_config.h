@@ -35,7 +35,18 @@ class I_Config
 public:
     enum class AsyncLoadConfigStatus { Success, Error, InProgress };
 
+    // The values that a configuration handle resolved to, valid only in the configuration generation they were
+    // resolved in. They are kept only when the value does not depend on the active tenant and profile.
+    struct ConfigHandleCache
+    {
+        uint64_t generation = 0;
+        const PerContextValue *values = nullptr;
+        bool is_tenant_independent = false;
+    };
+
     virtual const TypeWrapper & getConfiguration(const std::vector<std::string> &paths) const = 0;
+    virtual const TypeWrapper & getConfiguration(uint handle_id) const = 0;
+    virtual const TypeWrapper & getConfiguration(uint handle_id, ConfigHandleCache &cache) const = 0;
     virtual PerContextValue getAllConfiguration(const std::vector<std::string> &paths) const = 0;
     virtual const TypeWrapper & getResource(const std::vector<std::string> &paths) const = 0;
     virtual const TypeWrapper & getSetting(const std::vector<std::string> &paths) const = 0;
@@ -56,6 +67,9 @@ public:
         const string &tenant,
         const string &profile) const = 0;
 
+    // Returns the id of a configuration path, for lookups that do not need to search for the path again
+    virtual uint registerConfigurationHandle(const std::vector<std::string> &paths) = 0;
+
     virtual bool setConfiguration(TypeWrapper &&value, const std::vector<std::string> &paths) = 0;
     virtual bool setResource(TypeWrapper &&value, const std::vector<std::string> &paths) = 0;
     virtual bool setSetting(TypeWrapper &&value, const std::vector<std::string> &paths) = 0;
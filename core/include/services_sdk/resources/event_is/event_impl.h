@@ -34,6 +34,15 @@ public:
         return MyListener::performNamedQuery(dynamic_cast<const EventType *>(this));
     }
 
+    // Reports the time that every listener spent in its respond() call, as measured by the given clock
+    std::vector<std::pair<std::string, ReturnType>>
+    performNamedQuery(
+        const ListenerRespondTimeClock &get_time,
+        const ListenerRespondTimeReporter &report_respond_time) const
+    {
+        return MyListener::performNamedQuery(dynamic_cast<const EventType *>(this), get_time, report_respond_time);
+    }
+
 protected:
     virtual ~EventImpl() {} // Makes Event polimorphic, so dynamic_cast will work
 };
@@ -19,6 +19,8 @@
 #include <map>
 #include <vector>
 #include <string>
+#include <chrono>
+#include <functional>
 
 class BaseListener
 {
@@ -39,6 +41,9 @@ private:
     std::set<ActivationFunction> deactivate;
 };
 
+using ListenerRespondTimeClock = std::function<std::chrono::microseconds()>;
+using ListenerRespondTimeReporter = std::function<void(const std::string &, std::chrono::microseconds)>;
+
 template <typename EventType, typename ReturnType>
 class ListenerImpl : public ListenerImpl<EventType, void>
 {
@@ -68,6 +73,22 @@ public:
         }
         return responses;
     }
+
+    static std::vector<std::pair<std::string, ReturnType>>
+    performNamedQuery(
+        const EventType *event,
+        const ListenerRespondTimeClock &get_time,
+        const ListenerRespondTimeReporter &report_respond_time)
+    {
+        std::vector<std::pair<std::string, ReturnType>> responses;
+        for (auto &listener : ListenerImpl<EventType, void>::listeners) {
+            ListenerImpl *listener_impl = dynamic_cast<ListenerImpl *>(listener);
+            auto start_time = get_time();
+            responses.emplace_back(listener_impl->getListenerName(), listener_impl->respond(*event));
+            report_respond_time(responses.back().first, get_time() - start_time);
+        }
+        return responses;
+    }
 };
 
 template <typename EventType>
@@ -40,6 +40,7 @@ namespace MetricCalculations
     template <typename T> class Average;
     template <typename T> class LastReportedValue;
     template <typename T, uint N> class TopValues;
+    class Histogram;
     template <typename PrintableKey, typename Metric> class MetricMap;
 } // MetricCalculations
 
@@ -146,6 +147,7 @@ private:
 #include "metric/average.h"
 #include "metric/top_values.h"
 #include "metric/last_reported_value.h"
+#include "metric/histogram.h"
 #include "metric/metric_map.h"
 
 #endif // __GENERIC_METRIC_H__
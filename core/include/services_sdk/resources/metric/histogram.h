@@ -0,0 +1,237 @@
+// Copyright (C) 2022 Check Point Software Technologies Ltd. All rights reserved.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __HISTOGRAM_H__
+#define __HISTOGRAM_H__
+
+#ifndef __GENERIC_METRIC_H__
+#error metric/histogram.h should not be included directly
+#endif // __GENERIC_METRIC_H__
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+namespace MetricCalculations
+{
+
+// Log-linear histogram of non-negative integer values, such as latencies in microseconds.
+// Every power of two range is split into 8 equal buckets, so a reported percentile is at most 12.5% above the real
+// value. The histogram has a fixed size, reporting a value does not allocate, and histograms can be merged.
+class Histogram : public MetricCalc
+{
+    static const uint sub_bucket_bits = 3;
+    static const uint64_t num_of_sub_buckets = 1 << sub_bucket_bits;
+    static const uint num_of_buckets = num_of_sub_buckets * (64 - sub_bucket_bits + 1);
+
+public:
+    template <typename ... Args>
+    Histogram(GenericMetric *metric, const std::string &title, const Args & ... args)
+            :
+        MetricCalc(metric, title, args ...)
+    {
+        reset();
+    }
+
+    void
+    report(uint64_t new_value)
+    {
+        buckets[getBucketIndex(new_value)]++;
+        count++;
+        sum += new_value;
+        if (new_value < min) min = new_value;
+        if (new_value > max) max = new_value;
+    }
+
+    void
+    merge(const Histogram &other)
+    {
+        for (uint index = 0; index < num_of_buckets; index++) {
+            buckets[index] += other.buckets[index];
+        }
+        count += other.count;
+        sum += other.sum;
+        if (other.min < min) min = other.min;
+        if (other.max > max) max = other.max;
+    }
+
+    void
+    reset() override
+    {
+        buckets.fill(0);
+        count = 0;
+        sum = 0;
+        min = std::numeric_limits<uint64_t>::max();
+        max = 0;
+    }
+
+    uint64_t getCount() const { return count; }
+    uint64_t getSum() const { return sum; }
+    uint64_t getMin() const { return count > 0 ? min : 0; }
+    uint64_t getMax() const { return max; }
+
+    // Returns the upper bound of the bucket that holds the requested percentile (0-100) of the reported values
+    uint64_t
+    getPercentile(double percentile) const
+    {
+        if (count == 0) return 0;
+
+        uint64_t rank = std::ceil(count * percentile / 100);
+        if (rank == 0) rank = 1;
+
+        uint64_t accumulated = 0;
+        for (uint index = 0; index < num_of_buckets; index++) {
+            accumulated += buckets[index];
+            if (accumulated >= rank) return std::max(std::min(getBucketUpperBound(index), max), min);
+        }
+        return max;
+    }
+
+    float
+    getValue() const override
+    {
+        return std::nanf("");
+    }
+
+    void
+    save(cereal::JSONOutputArchive &ar) const override
+    {
+        ar(cereal::make_nvp(getMetricName(), getSummary()));
+    }
+
+    LogField
+    getLogField() const override
+    {
+        LogField field(getMetricName());
+        for (auto &value : getSummary()) {
+            field.addFields(LogField(value.first, value.second));
+        }
+        return field;
+    }
+
+    // Exported as a Prometheus histogram, with a cumulative bucket for every power of two up to the largest value
+    std::vector<PrometheusData>
+    getPrometheusMetrics(const std::string &metric_name, const std::string &asset_id) const override
+    {
+        if (count == 0) return {};
+
+        std::string name = getMetricDotName() != "" ? getMetricDotName() : getMetricName();
+        std::string labels = getPrometheusLabels(metric_name, asset_id);
+        std::vector<PrometheusData> res;
+
+        uint64_t accumulated = 0;
+        for (uint index = 0; index < num_of_buckets; index++) {
+            accumulated += buckets[index];
+            if (index >= num_of_sub_buckets && (index + 1) % num_of_sub_buckets != 0) continue;
+
+            uint64_t upper_bound = getBucketUpperBound(index);
+            std::string bucket_labels = labels + ",le=\"" + std::to_string(upper_bound) + "\"";
+            res.push_back(getPrometheusData(name + "_bucket", bucket_labels, accumulated));
+            if (upper_bound >= max) break;
+        }
+        res.push_back(getPrometheusData(name + "_bucket", labels + ",le=\"+Inf\"", count));
+        res.push_back(getPrometheusData(name + "_sum", labels, sum));
+        res.push_back(getPrometheusData(name + "_count", labels, count));
+
+        return res;
+    }
+
+    std::vector<AiopsMetricData>
+    getAiopsMetrics() const override
+    {
+        if (count == 0) return {};
+
+        std::string name = getMetricDotName() != "" ? getMetricDotName() : getMetricName();
+        std::vector<AiopsMetricData> res;
+        for (auto &value : getSummary()) {
+            res.emplace_back(
+                name + "." + value.first,
+                "Gauge",
+                getMetircUnits(),
+                getMetircDescription(),
+                getBasicLabels(getMetricName()),
+                value.second
+            );
+        }
+        return res;
+    }
+
+private:
+    static uint
+    getBucketIndex(uint64_t value)
+    {
+        if (value < num_of_sub_buckets) return value;
+
+        uint range = 63 - __builtin_clzll(value) - sub_bucket_bits;
+        return (range + 1) * num_of_sub_buckets + ((value >> range) & (num_of_sub_buckets - 1));
+    }
+
+    static uint64_t
+    getBucketUpperBound(uint index)
+    {
+        if (index < num_of_sub_buckets) return index;
+
+        uint range = index / num_of_sub_buckets - 1;
+        uint64_t lower_bound = (num_of_sub_buckets + index % num_of_sub_buckets) << range;
+        return lower_bound + ((uint64_t(1) << range) - 1);
+    }
+
+    std::map<std::string, uint64_t>
+    getSummary() const
+    {
+        return {
+            { "count", count },
+            { "max", getMax() },
+            { "p50", getPercentile(50) },
+            { "p90", getPercentile(90) },
+            { "p99", getPercentile(99) },
+            { "p999", getPercentile(99.9) }
+        };
+    }
+
+    std::string
+    getPrometheusLabels(const std::string &metric_name, const std::string &asset_id) const
+    {
+        std::stringstream labels;
+        bool first = true;
+        for (auto &pair : getBasicLabels(metric_name, asset_id)) {
+            if (!first) labels << ',';
+            labels << pair.first << "=\"" << pair.second << '"';
+            first = false;
+        }
+        return labels.str();
+    }
+
+    PrometheusData
+    getPrometheusData(const std::string &name, const std::string &labels, uint64_t value) const
+    {
+        PrometheusData res;
+        res.name = name;
+        res.type = "histogram";
+        res.description = getMetircDescription();
+        res.label = labels;
+        res.value = std::to_string(value);
+        return res;
+    }
+
+    std::array<uint64_t, num_of_buckets> buckets;
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+};
+
+} // namespace MetricCalculations
+
+#endif // __HISTOGRAM_H__
@@ -44,6 +44,8 @@ class MetricMap : public MetricCalc
             return inner_map.emplace(key, std::move(metric));
         }
 
+        typename std::map<std::string, Metric>::iterator find(const std::string &key) { return inner_map.find(key); }
+
         void clear() { inner_map.clear(); }
 
         MetricType
@@ -66,9 +68,15 @@ class MetricMap : public MetricCalc
 
             for (auto &metric : inner_map) {
                 auto sub_res =  metric.second.getPrometheusMetrics(metric_name, asset_id);
+                const std::string &sub_name =
+                    metric.second.getMetricDotName() != "" ?
+                    metric.second.getMetricDotName() :
+                    metric.second.getMetricName();
                 for (auto &sub_metric : sub_res) {
                     sub_metric.label += "," + label + "=\"" + metric.first + "\"";
-                    sub_metric.name = name;
+                    // Metrics that export several series (e.g. histogram buckets) keep the suffix of each series
+                    bool has_suffix = sub_metric.name.compare(0, sub_name.size(), sub_name) == 0;
+                    sub_metric.name = name + (has_suffix ? sub_metric.name.substr(sub_name.size()) : "");
                 }
                 res.insert(res.end(), sub_res.begin(), sub_res.end());
             }
@@ -141,9 +149,12 @@ public:
     {
         std::stringstream string_key;
         string_key << key;
-        auto new_metric = base_metric;
-        new_metric.setMetricName(string_key.str());
-        auto metric = metric_map.emplace(string_key.str(), std::move(new_metric)).first;
+        auto metric = metric_map.find(string_key.str());
+        if (metric == metric_map.end()) {
+            auto new_metric = base_metric;
+            new_metric.setMetricName(string_key.str());
+            metric = metric_map.emplace(string_key.str(), std::move(new_metric)).first;
+        }
         metric->second.report(new_values...);
     }
 
@@ -48,6 +48,12 @@ RoutineWrapper::shouldRun(const I_MainLoop::RoutineType &limit) const
     return !is_halt && pri<=limit;
 }
 
+bool
+RoutineWrapper::shouldRun(const I_MainLoop::RoutineType &limit, chrono::microseconds now) const
+{
+    return shouldRun(limit) && !is_waiting_for_fd && wake_time <= now;
+}
+
 void
 RoutineWrapper::run()
 {
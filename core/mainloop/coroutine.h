@@ -14,6 +14,7 @@
 #ifndef __COROUTINE_H__
 #define __COROUTINE_H__
 
+#include <chrono>
 #include <boost/coroutine2/all.hpp>
 
 #include "i_mainloop.h"
@@ -42,11 +43,22 @@ public:
     const std::string & getRoutineName() const { return routine_name; }
     bool isActive() const;
     bool shouldRun(const I_MainLoop::RoutineType &limit) const;
+    bool shouldRun(const I_MainLoop::RoutineType &limit, std::chrono::microseconds now) const;
+    I_MainLoop::RoutineType getPriority() const { return pri; }
     void run();
     void yield();
     void halt();
     void resume();
 
+    // Used by the event driven scheduler: a routine that waits for its file descriptor, or that sleeps until a
+    // certain time, is not scheduled until the event arrives.
+    bool isHalted() const { return is_halt; }
+    bool isWaitingForFd() const { return is_waiting_for_fd; }
+    void waitForFd() { is_waiting_for_fd = true; }
+    void fdReady() { is_waiting_for_fd = false; }
+    std::chrono::microseconds getWakeTime() const { return wake_time; }
+    void sleepUntil(std::chrono::microseconds time) { wake_time = time; }
+
 private:
     static void invoke(pull_type &pull, I_MainLoop::Routine func);
     static RoutineWrapper *active; // Used by `invoke` to set the value of `pull`
@@ -57,6 +69,8 @@ private:
     push_type routine;
     bool is_primary;
     bool is_halt = false;
+    bool is_waiting_for_fd = false;
+    std::chrono::microseconds wake_time = std::chrono::microseconds::zero();
     std::string routine_name;
 };
 
@@ -16,9 +16,12 @@
 #include <memory>
 #include <system_error>
 #include <map>
+#include <set>
 #include <sstream>
 #include <poll.h>
 #include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 
 #include "config.h"
 #include "coroutine.h"
@@ -36,6 +39,11 @@ bool fini_signal_flag = false;
 
 static const AlertInfo alert(AlertTeam::CORE, "mainloop i/s");
 
+// Routine IDs start from 1, so 0 is free to mark events of the scheduler's own timer.
+static const uint32_t timer_event_id = 0;
+static const int max_epoll_events = 64;
+static const chrono::milliseconds max_event_wait(100);
+
 class MainloopStop {};
 
 class MainloopComponent::Impl : Singleton::Provide<I_MainLoop>::From<MainloopComponent>
@@ -131,6 +139,14 @@ private:
     uint32_t getCurrentTimeSlice(uint32_t current_stress, int idle_time_slice, int busy_time_slice);
     RoutineID getNextID();
 
+    bool initEventLoop();
+    void finiEventLoop();
+    void registerFileRoutine(RoutineID id, int fd);
+    void unregisterFileRoutine(RoutineID id);
+    void waitForFileEvent();
+    bool hasRunnableRoutines(chrono::microseconds current_time, chrono::microseconds &next_wake_time) const;
+    uint64_t waitForEvents(chrono::microseconds slice_end, chrono::microseconds current_time);
+
     I_TimeGet *
     getTimer()
     {
@@ -156,6 +172,13 @@ private:
     chrono::microseconds stop_time;
     uint32_t current_stress = 0;
 
+    bool is_event_driven = false;
+    int epoll_fd = -1;
+    int timer_fd = -1;
+    map<RoutineID, int> file_routines;
+    set<RoutineID> watched_routines;
+    map<int, RoutineID> watched_fds;
+
     chrono::seconds metric_report_interval;
     MainloopEvent mainloop_event;
     MainloopMetric mainloop_metric;
@@ -249,6 +272,9 @@ MainloopComponent::Impl::run()
     int idle_time_slice = getConfigurationWithDefault<int>(1500, "Mainloop", "Idle routine time slice");
     int busy_time_slice = getConfigurationWithDefault<int>(100, "Mainloop", "Busy routine time slice");
     int exceed_warning_slice = getConfigurationWithDefault(100, "Mainloop", "Exceed Warning");
+    if (getConfigurationWithDefault<bool>(false, "Mainloop", "Event driven scheduler")) {
+        is_event_driven = initEventLoop();
+    }
 
     while (has_primary_routines) {
         mainloop_event.setStressValue(current_stress);
@@ -271,13 +297,27 @@ MainloopComponent::Impl::run()
                 break;
             }
             if (!curr_iter->second.isActive()) {
+                unregisterFileRoutine(curr_iter->first);
                 curr_iter = routines.erase(curr_iter);
                 continue;
             }
 
             if (curr_iter->second.isPrimary()) has_primary_routines = true;
 
-            if (curr_iter->second.shouldRun(rounds[round])) {
+            bool should_run = is_event_driven ?
+                curr_iter->second.shouldRun(rounds[round], start_time) :
+                curr_iter->second.shouldRun(rounds[round]);
+
+            if (
+                is_event_driven &&
+                curr_iter->second.isWaitingForFd() &&
+                curr_iter->second.getPriority() == RoutineType::RealTime
+            ) {
+                // A waiting file routine is idle - this stands for the empty poll of the legacy scheduler.
+                updateCurrentStress(false);
+            }
+
+            if (should_run) {
                 // Set the time upon which `hasAdditionalTime` will yield.
                 stop_time = getTimer()->getMonotonicTime() + basic_time_slice;
                 dbgTrace(D_MAINLOOP) <<
@@ -329,7 +369,12 @@ MainloopComponent::Impl::run()
 
         uint64_t signed_sleep_time = 0;
         chrono::microseconds current_time = getTimer()->getMonotonicTime();
-        if (start_time + basic_time_slice > current_time) {
+        if (is_event_driven) {
+            if (has_primary_routines) {
+                signed_sleep_time = waitForEvents(start_time + basic_time_slice, current_time);
+            }
+            sleep_count += signed_sleep_time;
+        } else if (start_time + basic_time_slice > current_time) {
             chrono::microseconds sleep_time = start_time + basic_time_slice - current_time;
             signed_sleep_time = sleep_time.count();
             sleep_count += signed_sleep_time;
@@ -355,6 +400,8 @@ MainloopComponent::Impl::run()
     dbgInfo(D_MAINLOOP) << "Mainloop ended - stopping all routines";
     stopAll();
     routines.clear();
+    file_routines.clear();
+    finiEventLoop();
 }
 
 string
@@ -446,12 +493,15 @@ MainloopComponent::Impl::addFileRoutine(
                 }
             } else {
                 if (priority == I_MainLoop::RoutineType::RealTime) updateCurrentStress(false);
+                waitForFileEvent();
             }
             yield(true);
         }
     };
 
-    return addOneTimeRoutine(priority, func_wrapper, routine_name, is_primary);
+    auto id = addOneTimeRoutine(priority, func_wrapper, routine_name, is_primary);
+    registerFileRoutine(id, fd);
+    return id;
 }
 
 bool
@@ -491,6 +541,7 @@ MainloopComponent::Impl::yield(chrono::microseconds time)
         return;
     }
     chrono::microseconds restart_time = getTimer()->getMonotonicTime() + time;
+    if (is_event_driven && curr_iter != routines.end()) curr_iter->second.sleepUntil(restart_time);
     while (getTimer()->getMonotonicTime() < restart_time) {
         yield(true);
     }
@@ -618,6 +669,178 @@ MainloopComponent::Impl::updateCurrentStress(bool is_busy)
     }
 }
 
+bool
+MainloopComponent::Impl::initEventLoop()
+{
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        dbgWarning(D_MAINLOOP) << "Failed to create epoll instance, using the polling scheduler. Errno: " << errno;
+        return false;
+    }
+
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd < 0) {
+        dbgWarning(D_MAINLOOP) << "Failed to create timer fd, using the polling scheduler. Errno: " << errno;
+        finiEventLoop();
+        return false;
+    }
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u64 = timer_event_id;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &event) != 0) {
+        dbgWarning(D_MAINLOOP) << "Failed to watch timer fd, using the polling scheduler. Errno: " << errno;
+        finiEventLoop();
+        return false;
+    }
+
+    for (auto &file_routine : file_routines) {
+        registerFileRoutine(file_routine.first, file_routine.second);
+    }
+
+    dbgInfo(D_MAINLOOP) << "Using the event driven scheduler";
+    return true;
+}
+
+void
+MainloopComponent::Impl::finiEventLoop()
+{
+    if (timer_fd >= 0) close(timer_fd);
+    if (epoll_fd >= 0) close(epoll_fd);
+    timer_fd = -1;
+    epoll_fd = -1;
+    is_event_driven = false;
+    watched_routines.clear();
+    watched_fds.clear();
+}
+
+void
+MainloopComponent::Impl::registerFileRoutine(RoutineID id, int fd)
+{
+    file_routines[id] = fd;
+    if (epoll_fd < 0) return;
+
+    // The registration is one-shot, and is re-armed by the routine when it finds no more data to read. This way
+    // a busy file routine costs no additional system calls.
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.u64 = id;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        dbgWarning(D_MAINLOOP)
+            << "Cannot watch fd "
+            << fd
+            << " of routine "
+            << id
+            << ", the routine will be polled. Errno: "
+            << errno;
+        return;
+    }
+
+    // Adding the fd succeeds only if it is not watched, so if another routine was registered on this fd number, its
+    // fd was closed (which removed it from epoll) and the number was reused. That routine must no longer touch the
+    // registration, which now belongs to this routine.
+    auto prev_owner = watched_fds.find(fd);
+    if (prev_owner != watched_fds.end()) watched_routines.erase(prev_owner->second);
+    watched_fds[fd] = id;
+    watched_routines.insert(id);
+}
+
+void
+MainloopComponent::Impl::unregisterFileRoutine(RoutineID id)
+{
+    auto file_routine = file_routines.find(id);
+    if (file_routine == file_routines.end()) return;
+
+    if (watched_routines.erase(id) > 0) {
+        // The fd might have already been closed by its owner, so failing here is expected
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, file_routine->second, nullptr);
+        watched_fds.erase(file_routine->second);
+    }
+    file_routines.erase(file_routine);
+}
+
+void
+MainloopComponent::Impl::waitForFileEvent()
+{
+    if (!is_event_driven || curr_iter == routines.end()) return;
+    if (watched_routines.find(curr_iter->first) == watched_routines.end()) return;
+
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.u64 = curr_iter->first;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, file_routines[curr_iter->first], &event) != 0) {
+        dbgWarning(D_MAINLOOP)
+            << "Failed to re-arm fd of routine "
+            << curr_iter->second.getRoutineName()
+            << ", the routine will be polled. Errno: "
+            << errno;
+        watched_routines.erase(curr_iter->first);
+        watched_fds.erase(file_routines[curr_iter->first]);
+        return;
+    }
+
+    curr_iter->second.waitForFd();
+}
+
+bool
+MainloopComponent::Impl::hasRunnableRoutines(
+    chrono::microseconds current_time,
+    chrono::microseconds &next_wake_time) const
+{
+    for (auto &routine : routines) {
+        // Finished routines are cleaned by the next round, which might end the mainloop - so there is no point in
+        // blocking before it.
+        if (!routine.second.isActive()) return true;
+        if (routine.second.isHalted() || routine.second.isWaitingForFd()) continue;
+        if (routine.second.getWakeTime() <= current_time) return true;
+        next_wake_time = min(next_wake_time, routine.second.getWakeTime());
+    }
+    return false;
+}
+
+uint64_t
+MainloopComponent::Impl::waitForEvents(chrono::microseconds slice_end, chrono::microseconds current_time)
+{
+    // If some routine can run, keep the time slice of the polling scheduler, but wake up as soon as a file routine
+    // has data. Otherwise, block until either a file routine has data or the next sleeping routine is due.
+    chrono::microseconds next_wake_time = current_time + max_event_wait;
+    chrono::microseconds timeout = chrono::microseconds::zero();
+    if (hasRunnableRoutines(current_time, next_wake_time)) {
+        if (slice_end > current_time) timeout = slice_end - current_time;
+    } else {
+        timeout = next_wake_time - current_time;
+    }
+
+    int epoll_timeout = 0;
+    if (timeout > chrono::microseconds::zero()) {
+        struct itimerspec timer_spec = {};
+        timer_spec.it_value.tv_sec = chrono::duration_cast<chrono::seconds>(timeout).count();
+        timer_spec.it_value.tv_nsec = (timeout.count() % 1000000) * 1000;
+        if (timerfd_settime(timer_fd, 0, &timer_spec, nullptr) == 0) {
+            epoll_timeout = -1;
+        } else {
+            epoll_timeout = chrono::duration_cast<chrono::milliseconds>(timeout).count();
+        }
+    }
+
+    struct epoll_event events[max_epoll_events];
+    int num_events = epoll_wait(epoll_fd, events, max_epoll_events, epoll_timeout);
+    for (int i = 0; i < num_events; i++) {
+        if (events[i].data.u64 == timer_event_id) {
+            uint64_t expirations;
+            if (read(timer_fd, &expirations, sizeof(expirations)) < 0) {
+                dbgTrace(D_MAINLOOP) << "Timer fd was already drained";
+            }
+            continue;
+        }
+
+        auto routine = routines.find(events[i].data.u64);
+        if (routine != routines.end()) routine->second.fdReady();
+    }
+
+    return timeout.count();
+}
+
 uint32_t
 MainloopComponent::Impl::getCurrentTimeSlice(uint32_t current_stress, int idle_time_slice, int busy_time_slice)
 {
@@ -642,5 +865,6 @@ MainloopComponent::preload()
     registerExpectedConfiguration<int>("Mainloop", "Busy routine time slice");
     registerExpectedConfiguration<uint>("Mainloop", "metric reporting interval");
     registerExpectedConfiguration<uint>("Mainloop", "Exceed Warning");
+    registerExpectedConfiguration<bool>("Mainloop", "Event driven scheduler");
     registerConfigLoadCb([&] () { pimpl->reloadConfigurationCb(); });
 }
@@ -532,3 +532,168 @@ TEST_F(MainloopTest, check_routine_name)
         HasSubstr("Starting execution of corutine. Routine named: check routine name test")
     );
 }
+
+TEST_F(MainloopTest, event_driven_file_cb)
+{
+    setConfiguration<bool>(true, string("Mainloop"), string("Event driven scheduler"));
+
+    int pipe_fds[2];
+    ASSERT_EQ(0, pipe(pipe_fds));
+    auto close_pipe = make_scope_exit([&] () { close(pipe_fds[0]); close(pipe_fds[1]); });
+
+    int num_called = 0;
+    auto cb = [&num_called, &pipe_fds, this] () {
+        char ch;
+        ASSERT_EQ(1, read(pipe_fds[0], &ch, 1));
+        num_called++;
+        if (ch == 'c') mainloop->stop();
+    };
+    mainloop->addFileRoutine(I_MainLoop::RoutineType::RealTime, pipe_fds[0], cb, "event driven file cb", true);
+
+    auto writer = [&pipe_fds, this] () {
+        for (char ch : { 'a', 'b', 'c' }) {
+            mainloop->yield(true);
+            ASSERT_EQ(1, write(pipe_fds[1], &ch, 1));
+        }
+    };
+    mainloop->addOneTimeRoutine(I_MainLoop::RoutineType::Timer, writer, "event driven writer");
+
+    mainloop->run();
+    EXPECT_EQ(3, num_called);
+}
+
+TEST_F(MainloopTest, event_driven_recurring_cb)
+{
+    setConfiguration<bool>(true, string("Mainloop"), string("Event driven scheduler"));
+
+    microseconds time(0);
+    EXPECT_CALL(mock_time, getMonotonicTime()).WillRepeatedly(InvokeWithoutArgs([&] () { return time; }));
+
+    int num_called = 0;
+    auto cb = [&num_called, this] () {
+        num_called++;
+        if (num_called == 3) mainloop->stop();
+    };
+    mainloop->addRecurringRoutine(I_MainLoop::RoutineType::Timer, microseconds(100), cb, "recurring cb", true);
+
+    int num_ticks = 0;
+    auto clock = [&num_ticks, &time, this] () {
+        while (true) {
+            num_ticks++;
+            time += microseconds(10);
+            mainloop->yield(true);
+        }
+    };
+    mainloop->addOneTimeRoutine(I_MainLoop::RoutineType::RealTime, clock, "clock");
+
+    mainloop->run();
+    EXPECT_EQ(3, num_called);
+    // The recurring routine is not called before it is due
+    EXPECT_LE(20, num_ticks);
+}
+
+TEST_F(MainloopTest, event_driven_wakes_up_on_write)
+{
+    setConfiguration<bool>(true, string("Mainloop"), string("Event driven scheduler"));
+
+    int num_time_queries = 0;
+    auto now = [&num_time_queries] () {
+        num_time_queries++;
+        return duration_cast<microseconds>(steady_clock::now().time_since_epoch());
+    };
+    EXPECT_CALL(mock_time, getMonotonicTime()).WillRepeatedly(InvokeWithoutArgs(now));
+
+    int pipe_fds[2];
+    ASSERT_EQ(0, pipe(pipe_fds));
+    auto close_pipe = make_scope_exit([&] () { close(pipe_fds[0]); close(pipe_fds[1]); });
+
+    const microseconds write_interval(50000);
+    vector<steady_clock::time_point> write_times;
+    vector<steady_clock::time_point> read_times;
+    auto cb = [&] () {
+        char ch;
+        ASSERT_EQ(1, read(pipe_fds[0], &ch, 1));
+        read_times.push_back(steady_clock::now());
+        if (ch == 'c') mainloop->stop();
+    };
+    mainloop->addFileRoutine(I_MainLoop::RoutineType::RealTime, pipe_fds[0], cb, "event driven reader", true);
+
+    auto writer = [&] () {
+        for (char ch : { 'a', 'b', 'c' }) {
+            mainloop->yield(write_interval);
+            write_times.push_back(steady_clock::now());
+            ASSERT_EQ(1, write(pipe_fds[1], &ch, 1));
+        }
+    };
+    mainloop->addOneTimeRoutine(I_MainLoop::RoutineType::RealTime, writer, "event driven writer");
+
+    mainloop->run();
+
+    ASSERT_EQ(3u, read_times.size());
+    ASSERT_EQ(3u, write_times.size());
+    for (uint i = 0; i < read_times.size(); i++) {
+        EXPECT_LE(write_times[i], read_times[i]);
+        // The reader is woken up by the write, rather than by the next time slice or the next write
+        EXPECT_GT(write_interval / 2, duration_cast<microseconds>(read_times[i] - write_times[i]));
+    }
+    // While waiting for the writer, the loop blocks instead of going over its routines every time slice
+    EXPECT_GT(100, num_time_queries);
+}
+
+TEST_F(MainloopTest, event_driven_reused_fd_stays_watched)
+{
+    setConfiguration<bool>(true, string("Mainloop"), string("Event driven scheduler"));
+
+    int old_pipe_fds[2];
+    ASSERT_EQ(0, pipe(old_pipe_fds));
+    auto old_reader = [] () { ADD_FAILURE() << "The old pipe is never written to"; };
+    auto old_id = mainloop->addFileRoutine(
+        I_MainLoop::RoutineType::RealTime,
+        old_pipe_fds[0],
+        old_reader,
+        "old reader",
+        false
+    );
+
+    int pipe_fds[2] = { -1, -1 };
+    auto close_pipe = make_scope_exit([&] () { close(pipe_fds[0]); close(pipe_fds[1]); });
+    bool is_read = false;
+    bool is_timed_out = false;
+    auto cb = [&] () {
+        char ch;
+        ASSERT_EQ(1, read(pipe_fds[0], &ch, 1));
+        is_read = true;
+        if (!is_timed_out) mainloop->stop();
+    };
+
+    I_MainLoop::RoutineID new_id = 0;
+    auto replace_pipe = [&] () {
+        // The old routine is stopped and its fd is closed, but the routine is only unregistered in the next round -
+        // after the new routine has taken over the same fd number.
+        mainloop->stop(old_id);
+        close(old_pipe_fds[0]);
+        close(old_pipe_fds[1]);
+        ASSERT_EQ(0, pipe(pipe_fds));
+        ASSERT_EQ(old_pipe_fds[0], pipe_fds[0]);
+        new_id = mainloop->addFileRoutine(I_MainLoop::RoutineType::RealTime, pipe_fds[0], cb, "new reader", true);
+
+        mainloop->yield(true);
+        mainloop->yield(true);
+        char ch = 'a';
+        ASSERT_EQ(1, write(pipe_fds[1], &ch, 1));
+    };
+    mainloop->addOneTimeRoutine(I_MainLoop::RoutineType::RealTime, replace_pipe, "replace pipe");
+
+    auto timeout = [&] () {
+        mainloop->yield(seconds(1));
+        is_timed_out = true;
+        mainloop->stop(new_id);
+    };
+    EXPECT_CALL(mock_time, getMonotonicTime()).WillRepeatedly(
+        InvokeWithoutArgs([] () { return duration_cast<microseconds>(steady_clock::now().time_since_epoch()); })
+    );
+    mainloop->addOneTimeRoutine(I_MainLoop::RoutineType::Timer, timeout, "timeout", false);
+
+    mainloop->run();
+    EXPECT_FALSE(is_timed_out) << "The new reader was not woken up";
+}
@@ -33,6 +33,42 @@ TEST(BaseMetric, generic_metadata)
     EXPECT_EQ(test.getMetircDescription(), "CPU utilization percentage");
 }
 
+TEST(BaseMetric, histogram_percentiles)
+{
+    Histogram histogram(nullptr, "latency");
+    EXPECT_EQ(histogram.getPercentile(50), 0u);
+
+    for (uint64_t value = 1; value <= 1000; value++) histogram.report(value);
+
+    EXPECT_EQ(histogram.getCount(), 1000u);
+    EXPECT_EQ(histogram.getSum(), 500500u);
+    EXPECT_EQ(histogram.getMin(), 1u);
+    EXPECT_EQ(histogram.getMax(), 1000u);
+    EXPECT_EQ(histogram.getPercentile(0), 1u);
+    EXPECT_EQ(histogram.getPercentile(50), 511u);
+    EXPECT_EQ(histogram.getPercentile(90), 959u);
+    EXPECT_EQ(histogram.getPercentile(99), 1000u);
+    EXPECT_EQ(histogram.getPercentile(100), 1000u);
+
+    Histogram small_values(nullptr, "smallValues");
+    for (uint64_t value = 0; value < 8; value++) small_values.report(value);
+    EXPECT_EQ(small_values.getPercentile(50), 3u);
+    EXPECT_EQ(small_values.getPercentile(100), 7u);
+
+    Histogram large_values(nullptr, "largeValues");
+    large_values.report(numeric_limits<uint64_t>::max());
+    EXPECT_EQ(large_values.getPercentile(50), numeric_limits<uint64_t>::max());
+
+    histogram.merge(small_values);
+    EXPECT_EQ(histogram.getCount(), 1008u);
+    EXPECT_EQ(histogram.getMin(), 0u);
+    EXPECT_EQ(histogram.getPercentile(0.5), 3u);
+
+    histogram.reset();
+    EXPECT_EQ(histogram.getCount(), 0u);
+    EXPECT_EQ(histogram.getMax(), 0u);
+}
+
 class CPUEvent : public Event<CPUEvent>
 {
 public:
@@ -186,6 +222,34 @@ private:
     };
 };
 
+class LatencyEvent : public Event<LatencyEvent>
+{
+public:
+    LatencyEvent(const string &_stage, uint64_t _latency) : stage(_stage), latency(_latency) {}
+
+    const string & getStage() const { return stage; }
+    uint64_t getLatency() const { return latency; }
+
+private:
+    string stage;
+    uint64_t latency;
+};
+
+class LatencyMetric : public GenericMetric, public Listener<LatencyEvent>
+{
+public:
+    void
+    upon(const LatencyEvent &event) override
+    {
+        total_latency.report(event.getLatency());
+        stage_latency.report(event.getStage(), event.getLatency());
+    }
+
+private:
+    Histogram total_latency{this, "latency"};
+    MetricMap<string, Histogram> stage_latency{Histogram{nullptr, ""}, this, "stage", "stageLatency"};
+};
+
 class MetricTest : public Test
 {
 public:
@@ -691,6 +755,76 @@ TEST_F(MetricTest, getPromeathusMultiMap)
     EXPECT_EQ(message_body, res);
 }
 
+TEST_F(MetricTest, getPromeathusHistogram)
+{
+    MetricScraper metric_scraper;
+    function<string()> get_metrics_func;
+    EXPECT_CALL(rest, addGetCall("service-metrics", _)).WillOnce(DoAll(SaveArg<1>(&get_metrics_func), Return(true)));
+    metric_scraper.init();
+
+    stringstream configuration;
+    configuration << "{\"agentSettings\":[{\"key\":\"prometheus\",\"id\":\"id1\",\"value\":\"true\"}]}\n";
+
+    EXPECT_TRUE(Singleton::Consume<Config::I_Config>::from(conf)->loadConfiguration(configuration));
+
+    LatencyMetric metric;
+    metric.init(
+        "Inspection latency",
+        ReportIS::AudienceTeam::AGENT_CORE,
+        ReportIS::IssuingEngine::AGENT_CORE,
+        seconds(5),
+        true
+    );
+    metric.registerListener();
+
+    LatencyEvent("headers", 1).notify();
+    LatencyEvent("headers", 5).notify();
+    LatencyEvent("body", 20).notify();
+
+    string report = metric.generateReport();
+    EXPECT_THAT(
+        report,
+        HasSubstr(
+            "    \"latency\": {\n"
+            "        \"count\": 3,\n"
+            "        \"max\": 20,\n"
+            "        \"p50\": 5,\n"
+            "        \"p90\": 20,\n"
+            "        \"p99\": 20,\n"
+            "        \"p999\": 20\n"
+            "    }"
+        )
+    );
+
+    string message_body = get_metrics_func();
+
+    auto getPromData = [] (const string &name, const string &labels, const string &value)
+    {
+        return
+            "            \"metric_name\": \"" + name + "\",\n"
+            "            \"metric_type\": \"histogram\",\n"
+            "            \"metric_description\": \"\",\n"
+            "            \"labels\": \"{agent=\\\"Unknown\\\",id=\\\"87\\\","
+                "metricName=\\\"Inspection latency\\\"" + labels + "}\",\n"
+            "            \"value\": \"" + value + "\"\n";
+    };
+
+    EXPECT_THAT(message_body, HasSubstr(getPromData("latency_bucket", ",le=\\\"0\\\"", "0")));
+    EXPECT_THAT(message_body, HasSubstr(getPromData("latency_bucket", ",le=\\\"4\\\"", "1")));
+    EXPECT_THAT(message_body, HasSubstr(getPromData("latency_bucket", ",le=\\\"15\\\"", "2")));
+    EXPECT_THAT(message_body, HasSubstr(getPromData("latency_bucket", ",le=\\\"31\\\"", "3")));
+    EXPECT_THAT(message_body, Not(HasSubstr("le=\\\"63\\\"")));
+    EXPECT_THAT(message_body, HasSubstr(getPromData("latency_bucket", ",le=\\\"+Inf\\\"", "3")));
+    EXPECT_THAT(message_body, HasSubstr(getPromData("latency_sum", "", "26")));
+    EXPECT_THAT(message_body, HasSubstr(getPromData("latency_count", "", "3")));
+    EXPECT_THAT(
+        message_body,
+        HasSubstr(getPromData("stageLatency_bucket", ",le=\\\"5\\\",stage=\\\"headers\\\"", "2"))
+    );
+    EXPECT_THAT(message_body, HasSubstr(getPromData("stageLatency_count", ",stage=\\\"body\\\"", "1")));
+
+}
+
 TEST_F(MetricTest, getPromeathusTwoMetrics)
 {
     MetricScraper metric_scraper;
@@ -98,9 +98,78 @@ isGetPossitionSucceccful(SharedRingQueue *queue, uint16_t *read_pos, uint16_t *w
     if (*read_pos > g_num_of_data_segments) return 0;
     if (*write_pos > g_num_of_data_segments) return 0;
 
+    // The data written by the other side before it published its position must be visible from here on
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
     return 1;
 }
 
+static void
+publishReadPosition(SharedRingQueue *queue, uint16_t read_pos)
+{
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    queue->read_pos = read_pos;
+}
+
+static void
+publishWritePosition(SharedRingQueue *queue, uint16_t write_pos)
+{
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    queue->write_pos = write_pos;
+}
+
+// Moves the read position past skipped segments (left by a writer that wrapped around) to the next element
+static uint16_t
+skipToNextElement(uint16_t *buffer_mgmt, uint16_t read_pos)
+{
+    if (read_pos < g_num_of_data_segments && buffer_mgmt[read_pos] == skip_buff_mgmt_magic) {
+        for ( ; read_pos < g_num_of_data_segments && buffer_mgmt[read_pos] == skip_buff_mgmt_magic; ++read_pos) {
+            buffer_mgmt[read_pos] = empty_buff_mgmt_magic;
+        }
+    }
+
+    if (read_pos == g_num_of_data_segments) read_pos = 0;
+    return read_pos;
+}
+
+// Frees the segments of the element in the read position, and returns the read position of the following element
+static uint16_t
+releaseElement(uint16_t *buffer_mgmt, uint16_t read_pos)
+{
+    uint16_t num_of_read_segments = getNumOfDataSegmentsNeeded(buffer_mgmt[read_pos]);
+    uint16_t end_pos;
+
+    if (read_pos + num_of_read_segments > g_num_of_data_segments) {
+        for ( ; read_pos < g_num_of_data_segments; ++read_pos ) {
+            buffer_mgmt[read_pos] = empty_buff_mgmt_magic;
+        }
+        read_pos = 0;
+    }
+
+    end_pos = read_pos + num_of_read_segments;
+
+    for ( ; read_pos < end_pos; ++read_pos ) {
+        buffer_mgmt[read_pos] = empty_buff_mgmt_magic;
+    }
+
+    if (read_pos < g_num_of_data_segments && buffer_mgmt[read_pos] == skip_buff_mgmt_magic) {
+        for ( ; read_pos < g_num_of_data_segments; ++read_pos ) {
+            buffer_mgmt[read_pos] = empty_buff_mgmt_magic;
+        }
+    }
+
+    writeDebug(
+        TraceLevel,
+        "Number of queue elements freed: %u, current read index: %u, end index: %u",
+        num_of_read_segments,
+        read_pos,
+        end_pos
+    );
+
+    if (read_pos == g_num_of_data_segments) read_pos = 0;
+    return read_pos;
+}
+
 void
 resetRingQueue(SharedRingQueue *queue, uint16_t num_of_data_segments)
 {
@@ -320,18 +389,12 @@ peekToQueue(SharedRingQueue *queue, const char **output_buffer, uint16_t *output
         return CORRUPTED_SHMEM_ERROR;
     }
 
-    if (buffer_mgmt[read_pos] == skip_buff_mgmt_magic) {
-        for ( ; read_pos < g_num_of_data_segments && buffer_mgmt[read_pos] == skip_buff_mgmt_magic; ++read_pos) {
-            buffer_mgmt[read_pos] = empty_buff_mgmt_magic;
-        }
-    }
-
-    if (read_pos == g_num_of_data_segments) read_pos = 0;
+    read_pos = skipToNextElement(buffer_mgmt, read_pos);
 
     *output_buffer_size = buffer_mgmt[read_pos];
     *output_buffer = queue->data_segment[read_pos].data;
 
-    queue->read_pos = read_pos;
+    publishReadPosition(queue, read_pos);
 
     writeDebug(
         TraceLevel,
@@ -342,9 +405,11 @@ peekToQueue(SharedRingQueue *queue, const char **output_buffer, uint16_t *output
     return 0;
 }
 
-int
-pushBuffersToQueue(
+static int
+writeBuffersToQueue(
     SharedRingQueue *queue,
+    uint16_t read_pos,
+    uint16_t *write_pos_ptr,
     const char **input_buffers,
     const uint16_t *input_buffers_sizes,
     const uint8_t num_of_input_buffers
@@ -352,19 +417,13 @@ pushBuffersToQueue(
 {
     int idx;
     uint32_t large_total_elem_size = 0;
-    uint16_t read_pos;
-    uint16_t write_pos;
+    uint16_t write_pos = *write_pos_ptr;
     uint16_t total_elem_size;
     uint16_t *buffer_mgmt = (uint16_t *)queue->mgmt_segment.data;
     uint16_t end_pos;
     uint16_t num_of_segments_to_write;
     char *current_copy_pos;
 
-    if (!isGetPossitionSucceccful(queue, &read_pos, &write_pos)) {
-        writeDebug(WarningLevel, "Corrupted shared memory - cannot push new buffers");
-        return -1;
-    }
-
     writeDebug(
         TraceLevel,
         "Writing new data to queue. write index: %u, number of queue elements: %u, number of elements to push: %u",
@@ -448,12 +507,80 @@ pushBuffersToQueue(
     }
 
     if (write_pos >= g_num_of_data_segments) write_pos = 0;
-    queue->write_pos = write_pos;
+    *write_pos_ptr = write_pos;
+
+    return 0;
+}
+
+int
+pushBuffersToQueue(
+    SharedRingQueue *queue,
+    const char **input_buffers,
+    const uint16_t *input_buffers_sizes,
+    const uint8_t num_of_input_buffers
+)
+{
+    uint16_t read_pos;
+    uint16_t write_pos;
+    int res;
+
+    if (!isGetPossitionSucceccful(queue, &read_pos, &write_pos)) {
+        writeDebug(WarningLevel, "Corrupted shared memory - cannot push new buffers");
+        return -1;
+    }
+
+    res = writeBuffersToQueue(queue, read_pos, &write_pos, input_buffers, input_buffers_sizes, num_of_input_buffers);
+    if (res != 0) return res;
+
+    publishWritePosition(queue, write_pos);
     writeDebug(TraceLevel, "Successfully pushed data to queue. New write index: %u", write_pos);
 
     return 0;
 }
 
+int
+pushBatchToQueue(
+    SharedRingQueue *queue,
+    const char **input_buffers,
+    const uint16_t *input_buffers_sizes,
+    const uint16_t num_of_input_buffers
+)
+{
+    uint16_t read_pos;
+    uint16_t write_pos;
+    uint16_t num_of_pushed_buffers = 0;
+    int res = 0;
+
+    if (!isGetPossitionSucceccful(queue, &read_pos, &write_pos)) {
+        writeDebug(WarningLevel, "Corrupted shared memory - cannot push a batch of buffers");
+        return -1;
+    }
+
+    for ( ; num_of_pushed_buffers < num_of_input_buffers; num_of_pushed_buffers++) {
+        res = writeBuffersToQueue(
+            queue,
+            read_pos,
+            &write_pos,
+            &input_buffers[num_of_pushed_buffers],
+            &input_buffers_sizes[num_of_pushed_buffers],
+            1
+        );
+        if (res != 0) break;
+    }
+
+    if (num_of_pushed_buffers == 0) return res;
+
+    publishWritePosition(queue, write_pos);
+    writeDebug(
+        TraceLevel,
+        "Successfully pushed a batch of %u elements to queue. New write index: %u",
+        num_of_pushed_buffers,
+        write_pos
+    );
+
+    return num_of_pushed_buffers;
+}
+
 int
 pushToQueue(SharedRingQueue *queue, const char *input_buffer, const uint16_t input_buffer_size)
 {
@@ -463,10 +590,8 @@ pushToQueue(SharedRingQueue *queue, const char *input_buffer, const uint16_t inp
 int
 popFromQueue(SharedRingQueue *queue)
 {
-    uint16_t num_of_read_segments;
     uint16_t read_pos;
     uint16_t write_pos;
-    uint16_t end_pos;
     uint16_t *buffer_mgmt = (uint16_t *)queue->mgmt_segment.data;
 
     if (!isGetPossitionSucceccful(queue, &read_pos, &write_pos)) {
@@ -485,42 +610,98 @@ popFromQueue(SharedRingQueue *queue)
         writeDebug(TraceLevel, "Cannot pop data from empty queue");
         return -1;
     }
-    num_of_read_segments = getNumOfDataSegmentsNeeded(buffer_mgmt[read_pos]);
 
-    if (read_pos + num_of_read_segments > g_num_of_data_segments) {
-        for ( ; read_pos < g_num_of_data_segments; ++read_pos ) {
-            buffer_mgmt[read_pos] = empty_buff_mgmt_magic;
+    read_pos = releaseElement(buffer_mgmt, read_pos);
+
+    publishReadPosition(queue, read_pos);
+    writeDebug(TraceLevel, "Successfully popped data from queue. New read index: %u", read_pos);
+
+    return 0;
+}
+
+int
+peekBatchFromQueue(
+    SharedRingQueue *queue,
+    const char **output_buffers,
+    uint16_t *output_buffers_sizes,
+    const uint16_t max_num_of_output_buffers
+)
+{
+    uint16_t read_pos;
+    uint16_t write_pos;
+    uint16_t num_of_read_buffers = 0;
+    uint16_t *buffer_mgmt = (uint16_t *)queue->mgmt_segment.data;
+    uint16_t num_of_read_segments;
+
+    if (!isGetPossitionSucceccful(queue, &read_pos, &write_pos)) {
+        writeDebug(WarningLevel, "Corrupted shared memory - cannot peek a batch");
+        return -1;
+    }
+
+    // Only the local copy of the read position advances - the elements remain in the queue until they are popped
+    while (num_of_read_buffers < max_num_of_output_buffers && read_pos != write_pos) {
+        if (read_pos >= g_num_of_data_segments) {
+            writeDebug(
+                WarningLevel,
+                "peekBatchFromQueue: Failed to read from a corrupted queue! (read_pos= %d > num_of_data_segments=%d)\n",
+                read_pos,
+                g_num_of_data_segments
+            );
+            return CORRUPTED_SHMEM_ERROR;
         }
-        read_pos = 0;
+
+        for ( ; read_pos < g_num_of_data_segments && buffer_mgmt[read_pos] == skip_buff_mgmt_magic; ++read_pos);
+        if (read_pos == g_num_of_data_segments) read_pos = 0;
+        if (read_pos == write_pos) break;
+
+        output_buffers_sizes[num_of_read_buffers] = buffer_mgmt[read_pos];
+        output_buffers[num_of_read_buffers] = queue->data_segment[read_pos].data;
+        num_of_read_buffers++;
+
+        num_of_read_segments = getNumOfDataSegmentsNeeded(buffer_mgmt[read_pos]);
+        if (read_pos + num_of_read_segments > g_num_of_data_segments) read_pos = 0;
+        read_pos += num_of_read_segments;
+
+        for ( ; read_pos < g_num_of_data_segments && buffer_mgmt[read_pos] == skip_buff_mgmt_magic; ++read_pos);
+        if (read_pos == g_num_of_data_segments) read_pos = 0;
     }
 
-    end_pos = read_pos + num_of_read_segments;
+    writeDebug(TraceLevel, "Successfully peeked a batch of %u elements from queue", num_of_read_buffers);
+    return num_of_read_buffers;
+}
 
-    for ( ; read_pos < end_pos; ++read_pos ) {
-        buffer_mgmt[read_pos] = empty_buff_mgmt_magic;
+int
+popBatchFromQueue(SharedRingQueue *queue, const uint16_t num_of_elements_to_pop)
+{
+    uint16_t read_pos;
+    uint16_t write_pos;
+    uint16_t num_of_popped_elements = 0;
+    uint16_t *buffer_mgmt = (uint16_t *)queue->mgmt_segment.data;
+
+    if (!isGetPossitionSucceccful(queue, &read_pos, &write_pos)) {
+        writeDebug(WarningLevel, "Corrupted shared memory - cannot pop a batch");
+        return -1;
     }
 
-    if (read_pos < g_num_of_data_segments && buffer_mgmt[read_pos] == skip_buff_mgmt_magic) {
-        for ( ; read_pos < g_num_of_data_segments; ++read_pos ) {
-            buffer_mgmt[read_pos] = empty_buff_mgmt_magic;
-        }
+    for ( ; num_of_popped_elements < num_of_elements_to_pop && read_pos != write_pos; num_of_popped_elements++) {
+        read_pos = skipToNextElement(buffer_mgmt, read_pos);
+        read_pos = releaseElement(buffer_mgmt, read_pos);
+    }
+
+    if (num_of_popped_elements == 0) {
+        writeDebug(TraceLevel, "Cannot pop data from empty queue");
+        return -1;
     }
 
+    publishReadPosition(queue, read_pos);
     writeDebug(
         TraceLevel,
-        "Size of data to remove: %u, number of queue elements to free: %u, current read index: %u, end index: %u",
-        buffer_mgmt[read_pos],
-        num_of_read_segments,
-        read_pos,
-        end_pos
+        "Successfully popped a batch of %u elements from queue. New read index: %u",
+        num_of_popped_elements,
+        read_pos
     );
 
-    if (read_pos == g_num_of_data_segments) read_pos = 0;
-
-    queue->read_pos = read_pos;
-    writeDebug(TraceLevel, "Successfully popped data from queue. New read index: %u", read_pos);
-
-    return 0;
+    return num_of_popped_elements;
 }
 
 int
@@ -529,6 +710,20 @@ isQueueEmpty(SharedRingQueue *queue)
     return queue->read_pos == queue->write_pos;
 }
 
+int
+getQueueUsage(SharedRingQueue *queue)
+{
+    uint16_t read_pos;
+    uint16_t write_pos;
+    uint16_t used_segments;
+
+    if (!isGetPossitionSucceccful(queue, &read_pos, &write_pos)) return 0;
+
+    used_segments =
+        write_pos >= read_pos ? write_pos - read_pos : g_num_of_data_segments - read_pos + write_pos;
+    return used_segments * 100 / g_num_of_data_segments;
+}
+
 int
 isCorruptedQueue(SharedRingQueue *queue, int is_tx)
 {
@@ -54,6 +54,8 @@ createSharedRingQueue(
 void destroySharedRingQueue(SharedRingQueue *queue, int is_owner, int is_tx);
 int isQueueEmpty(SharedRingQueue *queue);
 int isCorruptedQueue(SharedRingQueue *queue, int is_tx);
+// Returns the percentage (0-100) of the queue's data segments that hold elements that were not popped yet.
+int getQueueUsage(SharedRingQueue *queue);
 int peekToQueue(SharedRingQueue *queue, const char **output_buffer, uint16_t *output_buffer_size);
 int popFromQueue(SharedRingQueue *queue);
 int pushToQueue(SharedRingQueue *queue, const char *input_buffer, const uint16_t input_buffer_size);
@@ -68,6 +70,26 @@ pushBuffersToQueue(
     const uint8_t num_of_input_buffers
 );
 
+// Batch operations update the shared read/write position once for the whole batch.
+// On success, they return the number of elements that were handled.
+int
+pushBatchToQueue(
+    SharedRingQueue *queue,
+    const char **input_buffers,
+    const uint16_t *input_buffers_sizes,
+    const uint16_t num_of_input_buffers
+);
+
+int
+peekBatchFromQueue(
+    SharedRingQueue *queue,
+    const char **output_buffers,
+    uint16_t *output_buffers_sizes,
+    const uint16_t max_num_of_output_buffers
+);
+
+int popBatchFromQueue(SharedRingQueue *queue, const uint16_t num_of_elements_to_pop);
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus
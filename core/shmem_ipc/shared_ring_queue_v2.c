@@ -0,0 +1,673 @@
+// Copyright (C) 2022 Check Point Software Technologies Ltd. All rights reserved.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "shared_ring_queue_v2.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#include "shared_ipc_debug.h"
+
+static const uint64_t shared_ring_queue_v2_magic = 0x3256515043504e00ULL;
+static const uint32_t wrap_record_magic = 0xffffffff;
+static const uint32_t record_header_size = 8;
+static const uint32_t record_alignment = 8;
+static const uint32_t max_write_size = 0xffff;
+
+static uint32_t
+getRecordSize(uint32_t data_size)
+{
+    return (record_header_size + data_size + record_alignment - 1) & ~(record_alignment - 1);
+}
+
+static uint32_t
+getQueueCapacity(uint32_t requested_capacity)
+{
+    uint32_t capacity = SHARED_RING_QUEUE_V2_MIN_CAPACITY;
+    while (capacity < requested_capacity && capacity < SHARED_RING_QUEUE_V2_MAX_CAPACITY) capacity <<= 1;
+    return capacity;
+}
+
+static int
+isValidCapacity(uint32_t capacity)
+{
+    if (capacity < SHARED_RING_QUEUE_V2_MIN_CAPACITY || capacity > SHARED_RING_QUEUE_V2_MAX_CAPACITY) return 0;
+    return (capacity & (capacity - 1)) == 0;
+}
+
+static uint32_t
+getSizeOfMemory(uint32_t capacity)
+{
+    return sizeof(SharedRingQueueV2Shmem) + capacity;
+}
+
+static uint32_t *
+getRecordHeader(SharedRingQueueV2 *queue, uint32_t offset)
+{
+    return (uint32_t *)(queue->shmem->data + offset);
+}
+
+static int
+isValidPositions(SharedRingQueueV2 *queue, uint32_t read_pos, uint32_t write_pos)
+{
+    if ((read_pos | write_pos) & (record_alignment - 1)) return 0;
+    return write_pos - read_pos <= queue->capacity;
+}
+
+// The position of the other side is read with acquire semantics, so the data it wrote (or finished reading) before
+// publishing the position is visible from here on
+static int
+isGetPositionSuccessful(SharedRingQueueV2 *queue, uint32_t *read_pos, uint32_t *write_pos)
+{
+    *read_pos = __atomic_load_n(&queue->shmem->read_pos, __ATOMIC_ACQUIRE);
+    *write_pos = __atomic_load_n(&queue->shmem->write_pos, __ATOMIC_ACQUIRE);
+
+    return isValidPositions(queue, *read_pos, *write_pos);
+}
+
+// Finds the record that starts in the read position, skipping the wrap marker left by a writer that did not have
+// enough room at the end of the ring. Returns the size of the record's data, or -1 if the queue is corrupted.
+static int
+findRecord(SharedRingQueueV2 *queue, uint32_t *read_pos, uint32_t write_pos)
+{
+    uint32_t offset = *read_pos & (queue->capacity - 1);
+    uint32_t data_size = *getRecordHeader(queue, offset);
+
+    if (data_size == wrap_record_magic) {
+        if (queue->capacity - offset >= write_pos - *read_pos) return -1;
+        *read_pos += queue->capacity - offset;
+        offset = 0;
+        data_size = *getRecordHeader(queue, offset);
+    }
+
+    if (data_size > max_write_size) return -1;
+    if (getRecordSize(data_size) > write_pos - *read_pos) return -1;
+    if (offset + getRecordSize(data_size) > queue->capacity) return -1;
+
+    return data_size;
+}
+
+static int
+writeRecord(
+    SharedRingQueueV2 *queue,
+    uint32_t read_pos,
+    uint32_t *write_pos_ptr,
+    const char **input_buffers,
+    const uint16_t *input_buffers_sizes,
+    const uint8_t num_of_input_buffers
+)
+{
+    uint32_t write_pos = *write_pos_ptr;
+    uint32_t offset = write_pos & (queue->capacity - 1);
+    uint32_t contiguous_space = queue->capacity - offset;
+    uint32_t total_elem_size = 0;
+    uint32_t record_size;
+    uint32_t needed_space;
+    char *current_copy_pos;
+    int idx;
+
+    for (idx = 0; idx < num_of_input_buffers; idx++) {
+        total_elem_size += input_buffers_sizes[idx];
+    }
+
+    if (total_elem_size > getMaxPushSizeV2(queue)) {
+        writeDebug(
+            WarningLevel,
+            "Requested write size %u exceeds the %u write limit of a queue of capacity %u",
+            total_elem_size,
+            getMaxPushSizeV2(queue),
+            queue->capacity
+        );
+        return SHARED_RING_QUEUE_V2_TOO_LARGE_ERROR;
+    }
+
+    record_size = getRecordSize(total_elem_size);
+    needed_space = record_size + (record_size > contiguous_space ? contiguous_space : 0);
+    if (needed_space > queue->capacity - (write_pos - read_pos)) {
+        writeDebug(
+            DebugLevel,
+            "Cannot write to a full queue. Needed space: %u, read position: %u, write position: %u, capacity: %u",
+            needed_space,
+            read_pos,
+            write_pos,
+            queue->capacity
+        );
+        return -3;
+    }
+
+    if (record_size > contiguous_space) {
+        *getRecordHeader(queue, offset) = wrap_record_magic;
+        write_pos += contiguous_space;
+        offset = 0;
+    }
+
+    *getRecordHeader(queue, offset) = total_elem_size;
+    current_copy_pos = queue->shmem->data + offset + record_header_size;
+    for (idx = 0; idx < num_of_input_buffers; idx++) {
+        memcpy(current_copy_pos, input_buffers[idx], input_buffers_sizes[idx]);
+        current_copy_pos += input_buffers_sizes[idx];
+    }
+
+    *write_pos_ptr = write_pos + record_size;
+    return 0;
+}
+
+int
+getSharedRingQueueVersion(const char *shared_location_name)
+{
+    uint64_t magic = 0;
+    uint32_t version = SHARED_RING_QUEUE_V1;
+    int32_t fd = shm_open(shared_location_name, O_RDONLY, 0);
+
+    if (fd == -1) {
+        writeDebug(
+            WarningLevel,
+            "getSharedRingQueueVersion: Failed to open shared memory for '%s'. Errno: %d\n",
+            shared_location_name,
+            errno
+        );
+        return -1;
+    }
+
+    if (pread(fd, &magic, sizeof(magic), 0) != sizeof(magic)) {
+        close(fd);
+        return -1;
+    }
+
+    if (magic == shared_ring_queue_v2_magic &&
+        pread(fd, &version, sizeof(version), sizeof(magic)) != sizeof(version)
+    ) {
+        close(fd);
+        return -1;
+    }
+
+    close(fd);
+    return version;
+}
+
+SharedRingQueueV2 *
+createSharedRingQueueV2(const char *shared_location_name, uint32_t capacity, int is_owner)
+{
+    SharedRingQueueV2 *queue = NULL;
+    SharedRingQueueV2Shmem *shmem = NULL;
+    uint16_t shmem_fd_flags = is_owner ? O_RDWR | O_CREAT : O_RDWR;
+    uint32_t size_of_memory;
+    struct stat shmem_stat;
+    int32_t fd = -1;
+
+    writeDebug(TraceLevel, "Creating a new shared ring queue (version 2)");
+
+    fd = shm_open(shared_location_name, shmem_fd_flags, S_IRWXU | S_IRWXG | S_IRWXO);
+    if (fd == -1) {
+        writeDebug(
+            WarningLevel,
+            "createSharedRingQueueV2: Failed to open shared memory for '%s'. Errno: %d\n",
+            shared_location_name,
+            errno
+        );
+        return NULL;
+    }
+
+    if (is_owner) {
+        capacity = getQueueCapacity(capacity);
+        size_of_memory = getSizeOfMemory(capacity);
+        if (ftruncate(fd, size_of_memory) != 0) {
+            writeDebug(
+                WarningLevel,
+                "createSharedRingQueueV2: Failed to ftruncate shared memory '%s' to size '%x'\n",
+                shared_location_name,
+                size_of_memory
+            );
+            close(fd);
+            return NULL;
+        }
+    } else {
+        if (fstat(fd, &shmem_stat) != 0 || (size_t)shmem_stat.st_size < sizeof(SharedRingQueueV2Shmem)) {
+            writeDebug(WarningLevel, "createSharedRingQueueV2: Invalid shared memory '%s'\n", shared_location_name);
+            close(fd);
+            return NULL;
+        }
+        size_of_memory = shmem_stat.st_size;
+    }
+
+    shmem = (SharedRingQueueV2Shmem *)mmap(0, size_of_memory, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (shmem == MAP_FAILED) {
+        writeDebug(
+            WarningLevel,
+            "createSharedRingQueueV2: Error allocating queue for '%s' of size=%x\n",
+            shared_location_name,
+            size_of_memory
+        );
+        close(fd);
+        return NULL;
+    }
+
+    if (is_owner) {
+        snprintf(shmem->shared_location_name, MAX_ONE_WAY_QUEUE_NAME_LENGTH, "%s", shared_location_name);
+        shmem->version = SHARED_RING_QUEUE_V2;
+        shmem->capacity = capacity;
+        shmem->size_of_memory = size_of_memory;
+        shmem->is_user_attached = 0;
+        shmem->read_pos = 0;
+        shmem->write_pos = 0;
+        shmem->doorbell = 0;
+        shmem->is_consumer_idle = 1;
+        shmem->is_consumer_waiting_on_doorbell = 0;
+        __atomic_store_n(&shmem->magic, shared_ring_queue_v2_magic, __ATOMIC_RELEASE);
+    } else {
+        capacity = shmem->capacity;
+        if (__atomic_load_n(&shmem->magic, __ATOMIC_ACQUIRE) != shared_ring_queue_v2_magic ||
+            shmem->version != SHARED_RING_QUEUE_V2 ||
+            !isValidCapacity(capacity) ||
+            getSizeOfMemory(capacity) > size_of_memory
+        ) {
+            writeDebug(
+                WarningLevel,
+                "createSharedRingQueueV2: Shared memory '%s' does not hold a valid version 2 queue\n",
+                shared_location_name
+            );
+            munmap(shmem, size_of_memory);
+            close(fd);
+            return NULL;
+        }
+        __atomic_store_n(&shmem->is_user_attached, 1, __ATOMIC_RELEASE);
+    }
+
+    queue = malloc(sizeof(SharedRingQueueV2));
+    if (queue == NULL) {
+        writeDebug(WarningLevel, "createSharedRingQueueV2: Failed to allocate queue for '%s'\n", shared_location_name);
+        munmap(shmem, size_of_memory);
+        close(fd);
+        return NULL;
+    }
+
+    queue->shmem = shmem;
+    queue->fd = fd;
+    queue->capacity = capacity;
+    queue->size_of_memory = size_of_memory;
+    snprintf(queue->shared_location_name, MAX_ONE_WAY_QUEUE_NAME_LENGTH, "%s", shared_location_name);
+
+    writeDebug(
+        TraceLevel,
+        "Successfully created a new shared ring queue (version 2). "
+        "Shared memory path: %s, capacity: %u, is owner: %d, fd: %d, memory size: %u, read index: %u, write index: %u",
+        shared_location_name,
+        capacity,
+        is_owner,
+        fd,
+        size_of_memory,
+        shmem->read_pos,
+        shmem->write_pos
+    );
+
+    return queue;
+}
+
+void
+destroySharedRingQueueV2(SharedRingQueueV2 *queue, int is_owner)
+{
+    if (munmap(queue->shmem, queue->size_of_memory) != 0) {
+        writeDebug(WarningLevel, "destroySharedRingQueueV2: Failed to unmap shared ring queue\n");
+    }
+    if (queue->fd > 0) close(queue->fd);
+    if (is_owner) shm_unlink(queue->shared_location_name);
+
+    writeDebug(TraceLevel, "Successfully destroyed shared ring queue (version 2). Is owner: %d", is_owner);
+    free(queue);
+}
+
+void
+resetRingQueueV2(SharedRingQueueV2 *queue)
+{
+    queue->shmem->read_pos = 0;
+    queue->shmem->write_pos = 0;
+    queue->shmem->is_consumer_idle = 1;
+}
+
+int
+isUserAttachedV2(SharedRingQueueV2 *queue)
+{
+    return __atomic_load_n(&queue->shmem->is_user_attached, __ATOMIC_ACQUIRE) != 0;
+}
+
+uint32_t
+getMaxPushSizeV2(SharedRingQueueV2 *queue)
+{
+    uint32_t max_record_data_size = queue->capacity / 2 - record_header_size;
+    return max_record_data_size < max_write_size ? max_record_data_size : max_write_size;
+}
+
+int
+isQueueEmptyV2(SharedRingQueueV2 *queue)
+{
+    return
+        __atomic_load_n(&queue->shmem->read_pos, __ATOMIC_ACQUIRE) ==
+        __atomic_load_n(&queue->shmem->write_pos, __ATOMIC_ACQUIRE);
+}
+
+int
+getQueueUsageV2(SharedRingQueueV2 *queue)
+{
+    uint32_t read_pos;
+    uint32_t write_pos;
+
+    if (!isGetPositionSuccessful(queue, &read_pos, &write_pos)) return 0;
+
+    return (uint64_t)(write_pos - read_pos) * 100 / queue->capacity;
+}
+
+int
+isCorruptedQueueV2(SharedRingQueueV2 *queue)
+{
+    uint32_t read_pos;
+    uint32_t write_pos;
+
+    writeDebug(
+        TraceLevel,
+        "Checking if shared ring queue is corrupted. "
+        "capacity = %u, queue->capacity = %u, size_of_memory = %u, queue->size_of_memory = %u, "
+        "queue->read_pos = %u, queue->write_pos = %u, queue->shared_location_name = %s",
+        queue->capacity,
+        queue->shmem->capacity,
+        queue->size_of_memory,
+        queue->shmem->size_of_memory,
+        queue->shmem->read_pos,
+        queue->shmem->write_pos,
+        queue->shared_location_name
+    );
+
+    if (queue->shmem->magic != shared_ring_queue_v2_magic) return 1;
+    if (queue->shmem->version != SHARED_RING_QUEUE_V2) return 1;
+    if (queue->shmem->capacity != queue->capacity) return 1;
+    if (queue->shmem->size_of_memory != getSizeOfMemory(queue->capacity)) return 1;
+    if (!isGetPositionSuccessful(queue, &read_pos, &write_pos)) return 1;
+
+    return 0;
+}
+
+void
+dumpRingQueueShmemV2(SharedRingQueueV2 *queue)
+{
+    uint32_t data_idx;
+    char data_byte;
+
+    writeDebug(
+        WarningLevel,
+        "version: %u, capacity: %u, size_of_memory: %u, write_pos: %u, read_pos: %u, "
+        "doorbell: %u, is_consumer_idle: %u, is_consumer_waiting_on_doorbell: %u\n",
+        queue->shmem->version,
+        queue->shmem->capacity,
+        queue->shmem->size_of_memory,
+        queue->shmem->write_pos,
+        queue->shmem->read_pos,
+        queue->shmem->doorbell,
+        queue->shmem->is_consumer_idle,
+        queue->shmem->is_consumer_waiting_on_doorbell
+    );
+
+    writeDebug(WarningLevel, "data: ");
+    for (data_idx = 0; data_idx < queue->capacity; data_idx++) {
+        data_byte = queue->shmem->data[data_idx];
+        writeDebug(WarningLevel, isprint(data_byte) ? "%c" : "%02X", data_byte);
+    }
+    writeDebug(WarningLevel, "\nEnd of memory\n");
+}
+
+int
+peekToQueueV2(SharedRingQueueV2 *queue, const char **output_buffer, uint16_t *output_buffer_size)
+{
+    uint32_t read_pos;
+    uint32_t write_pos;
+    int data_size;
+
+    if (!isGetPositionSuccessful(queue, &read_pos, &write_pos)) {
+        writeDebug(WarningLevel, "peekToQueueV2: Failed to read from a corrupted queue\n");
+        return CORRUPTED_SHMEM_ERROR;
+    }
+
+    if (read_pos == write_pos) {
+        writeDebug(TraceLevel, "peekToQueueV2: Failed to read from an empty queue\n");
+        return -1;
+    }
+
+    data_size = findRecord(queue, &read_pos, write_pos);
+    if (data_size < 0) {
+        writeDebug(WarningLevel, "peekToQueueV2: Found a corrupted element in read index %u\n", read_pos);
+        return CORRUPTED_SHMEM_ERROR;
+    }
+
+    *output_buffer_size = data_size;
+    *output_buffer = queue->shmem->data + (read_pos & (queue->capacity - 1)) + record_header_size;
+
+    writeDebug(TraceLevel, "Successfully read data from queue. Data size: %u, read index: %u", data_size, read_pos);
+    return 0;
+}
+
+int
+peekBatchFromQueueV2(
+    SharedRingQueueV2 *queue,
+    const char **output_buffers,
+    uint16_t *output_buffers_sizes,
+    const uint16_t max_num_of_output_buffers
+)
+{
+    uint32_t read_pos;
+    uint32_t write_pos;
+    uint16_t num_of_elements = 0;
+    int data_size;
+
+    if (!isGetPositionSuccessful(queue, &read_pos, &write_pos)) {
+        writeDebug(WarningLevel, "peekBatchFromQueueV2: Failed to read from a corrupted queue\n");
+        return CORRUPTED_SHMEM_ERROR;
+    }
+
+    for ( ; num_of_elements < max_num_of_output_buffers && read_pos != write_pos; num_of_elements++) {
+        data_size = findRecord(queue, &read_pos, write_pos);
+        if (data_size < 0) {
+            writeDebug(WarningLevel, "peekBatchFromQueueV2: Found a corrupted element in read index %u\n", read_pos);
+            return CORRUPTED_SHMEM_ERROR;
+        }
+
+        output_buffers_sizes[num_of_elements] = data_size;
+        output_buffers[num_of_elements] =
+            queue->shmem->data + (read_pos & (queue->capacity - 1)) + record_header_size;
+        read_pos += getRecordSize(data_size);
+    }
+
+    writeDebug(TraceLevel, "Successfully read a batch of %u elements from queue", num_of_elements);
+    return num_of_elements;
+}
+
+int
+popBatchFromQueueV2(SharedRingQueueV2 *queue, const uint16_t num_of_elements_to_pop)
+{
+    uint32_t read_pos;
+    uint32_t write_pos;
+    uint16_t num_of_popped_elements = 0;
+    int data_size;
+
+    if (!isGetPositionSuccessful(queue, &read_pos, &write_pos)) {
+        writeDebug(WarningLevel, "popBatchFromQueueV2: Failed to pop from a corrupted queue\n");
+        return -1;
+    }
+
+    for ( ; num_of_popped_elements < num_of_elements_to_pop && read_pos != write_pos; num_of_popped_elements++) {
+        data_size = findRecord(queue, &read_pos, write_pos);
+        if (data_size < 0) {
+            writeDebug(WarningLevel, "popBatchFromQueueV2: Found a corrupted element in read index %u\n", read_pos);
+            return -1;
+        }
+        read_pos += getRecordSize(data_size);
+    }
+
+    if (num_of_popped_elements == 0) {
+        writeDebug(TraceLevel, "popBatchFromQueueV2: Failed to pop from an empty queue\n");
+        return -1;
+    }
+
+    __atomic_store_n(&queue->shmem->read_pos, read_pos, __ATOMIC_RELEASE);
+    writeDebug(
+        TraceLevel,
+        "Successfully popped a batch of %u elements from queue. New read index: %u",
+        num_of_popped_elements,
+        read_pos
+    );
+    return num_of_popped_elements;
+}
+
+int
+popFromQueueV2(SharedRingQueueV2 *queue)
+{
+    return popBatchFromQueueV2(queue, 1) == 1 ? 0 : -1;
+}
+
+int
+pushBuffersToQueueV2(
+    SharedRingQueueV2 *queue,
+    const char **input_buffers,
+    const uint16_t *input_buffers_sizes,
+    const uint8_t num_of_input_buffers
+)
+{
+    uint32_t read_pos;
+    uint32_t write_pos;
+    int res;
+
+    if (!isGetPositionSuccessful(queue, &read_pos, &write_pos)) {
+        writeDebug(WarningLevel, "Corrupted shared memory - cannot push new buffers");
+        return -1;
+    }
+
+    res = writeRecord(queue, read_pos, &write_pos, input_buffers, input_buffers_sizes, num_of_input_buffers);
+    if (res != 0) return res;
+
+    __atomic_store_n(&queue->shmem->write_pos, write_pos, __ATOMIC_RELEASE);
+    writeDebug(TraceLevel, "Successfully pushed data to queue. New write index: %u", write_pos);
+    return 0;
+}
+
+int
+pushToQueueV2(SharedRingQueueV2 *queue, const char *input_buffer, const uint16_t input_buffer_size)
+{
+    return pushBuffersToQueueV2(queue, &input_buffer, &input_buffer_size, 1);
+}
+
+int
+pushBatchToQueueV2(
+    SharedRingQueueV2 *queue,
+    const char **input_buffers,
+    const uint16_t *input_buffers_sizes,
+    const uint16_t num_of_input_buffers
+)
+{
+    uint32_t read_pos;
+    uint32_t write_pos;
+    uint16_t num_of_pushed_buffers = 0;
+    int res = 0;
+
+    if (!isGetPositionSuccessful(queue, &read_pos, &write_pos)) {
+        writeDebug(WarningLevel, "Corrupted shared memory - cannot push a batch of buffers");
+        return -1;
+    }
+
+    for ( ; num_of_pushed_buffers < num_of_input_buffers; num_of_pushed_buffers++) {
+        res = writeRecord(
+            queue,
+            read_pos,
+            &write_pos,
+            &input_buffers[num_of_pushed_buffers],
+            &input_buffers_sizes[num_of_pushed_buffers],
+            1
+        );
+        if (res != 0) break;
+    }
+
+    if (num_of_pushed_buffers == 0) return res;
+
+    __atomic_store_n(&queue->shmem->write_pos, write_pos, __ATOMIC_RELEASE);
+    writeDebug(
+        TraceLevel,
+        "Successfully pushed a batch of %u elements to queue. New write index: %u",
+        num_of_pushed_buffers,
+        write_pos
+    );
+    return num_of_pushed_buffers;
+}
+
+int
+armDoorbellV2(SharedRingQueueV2 *queue)
+{
+    // Either this side sees the new elements, or the producer sees the armed doorbell
+    __atomic_store_n(&queue->shmem->is_consumer_idle, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return !isQueueEmptyV2(queue);
+}
+
+void
+disarmDoorbellV2(SharedRingQueueV2 *queue)
+{
+    __atomic_store_n(&queue->shmem->is_consumer_idle, 0, __ATOMIC_RELAXED);
+}
+
+int
+ringDoorbellV2(SharedRingQueueV2 *queue)
+{
+    __atomic_add_fetch(&queue->shmem->doorbell, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!__atomic_exchange_n(&queue->shmem->is_consumer_idle, 0, __ATOMIC_SEQ_CST)) return 0;
+
+    if (__atomic_load_n(&queue->shmem->is_consumer_waiting_on_doorbell, __ATOMIC_RELAXED)) {
+        syscall(SYS_futex, &queue->shmem->doorbell, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    }
+    writeDebug(TraceLevel, "Rang the doorbell of an idle consumer. Queue: %s", queue->shared_location_name);
+    return 1;
+}
+
+int
+waitForDoorbellV2(SharedRingQueueV2 *queue, uint32_t timeout_msec)
+{
+    struct timespec timeout;
+    uint32_t doorbell;
+
+    __atomic_store_n(&queue->shmem->is_consumer_waiting_on_doorbell, 1, __ATOMIC_RELAXED);
+    doorbell = __atomic_load_n(&queue->shmem->doorbell, __ATOMIC_SEQ_CST);
+    if (armDoorbellV2(queue)) {
+        disarmDoorbellV2(queue);
+        return 1;
+    }
+
+    timeout.tv_sec = timeout_msec / 1000;
+    timeout.tv_nsec = (timeout_msec % 1000) * 1000000;
+    syscall(SYS_futex, &queue->shmem->doorbell, FUTEX_WAIT, doorbell, &timeout, NULL, 0);
+
+    disarmDoorbellV2(queue);
+    return !isQueueEmptyV2(queue);
+}
+
+int
+isConsumerWaitingOnDoorbellV2(SharedRingQueueV2 *queue)
+{
+    return __atomic_load_n(&queue->shmem->is_consumer_waiting_on_doorbell, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,131 @@
+// Copyright (C) 2022 Check Point Software Technologies Ltd. All rights reserved.
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __SHARED_RING_QUEUE_V2_H__
+#define __SHARED_RING_QUEUE_V2_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "shared_ring_queue.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif // __cplusplus
+
+#define SHARED_RING_QUEUE_V1 1
+#define SHARED_RING_QUEUE_V2 2
+#define SHARED_MEMORY_CACHE_LINE_SIZE 64
+#define SHARED_RING_QUEUE_V2_MIN_CAPACITY 4096
+#define SHARED_RING_QUEUE_V2_MAX_CAPACITY (1U << 30)
+#define SHARED_RING_QUEUE_V2_TOO_LARGE_ERROR -4
+
+// Version 2 of the queue is a byte oriented ring. Every element is an 8 bytes aligned record that holds its size
+// followed by the data, so small messages only take the space they need.
+// The positions are free running 32 bit counters, and the producer and consumer positions are kept on separate
+// cache lines, so the two sides of the queue do not invalidate each other's cache line on every operation.
+// The first byte of the magic is zero, which tells a version 2 queue apart from a version 1 queue, whose memory
+// starts with the (non empty) name of the queue.
+typedef struct SharedRingQueueV2Shmem {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t size_of_memory;
+    uint32_t is_user_attached;
+    char shared_location_name[MAX_ONE_WAY_QUEUE_NAME_LENGTH];
+    uint32_t write_pos __attribute__((aligned(SHARED_MEMORY_CACHE_LINE_SIZE)));
+    uint32_t read_pos __attribute__((aligned(SHARED_MEMORY_CACHE_LINE_SIZE)));
+    uint32_t doorbell __attribute__((aligned(SHARED_MEMORY_CACHE_LINE_SIZE)));
+    uint32_t is_consumer_idle;
+    uint32_t is_consumer_waiting_on_doorbell;
+    char data[0] __attribute__((aligned(SHARED_MEMORY_CACHE_LINE_SIZE)));
+} SharedRingQueueV2Shmem;
+
+// Process local handle of a version 2 queue. The capacity and size are kept locally, so a corrupted shared memory
+// cannot make this side access memory outside the mapping.
+typedef struct SharedRingQueueV2 {
+    SharedRingQueueV2Shmem *shmem;
+    char shared_location_name[MAX_ONE_WAY_QUEUE_NAME_LENGTH];
+    int32_t fd;
+    uint32_t capacity;
+    uint32_t size_of_memory;
+} SharedRingQueueV2;
+
+// Returns the version of an existing shared memory queue, or -1 if it cannot be opened.
+int getSharedRingQueueVersion(const char *shared_location_name);
+
+SharedRingQueueV2 * createSharedRingQueueV2(const char *shared_location_name, uint32_t capacity, int is_owner);
+void destroySharedRingQueueV2(SharedRingQueueV2 *queue, int is_owner);
+int isQueueEmptyV2(SharedRingQueueV2 *queue);
+int isCorruptedQueueV2(SharedRingQueueV2 *queue);
+// Returns the percentage (0-100) of the queue's capacity that holds elements that were not popped yet.
+int getQueueUsageV2(SharedRingQueueV2 *queue);
+// Returns 1 once the user side has opened the queue, which tells the owner that its peer can use version 2 queues.
+int isUserAttachedV2(SharedRingQueueV2 *queue);
+// Returns the largest data size of a single push. A record of up to half of the ring always fits once the consumer
+// drained the queue, wherever the ring wraps, while a larger record might never fit. Pushing more data than this
+// fails with SHARED_RING_QUEUE_V2_TOO_LARGE_ERROR, rather than as a full queue.
+uint32_t getMaxPushSizeV2(SharedRingQueueV2 *queue);
+int peekToQueueV2(SharedRingQueueV2 *queue, const char **output_buffer, uint16_t *output_buffer_size);
+int popFromQueueV2(SharedRingQueueV2 *queue);
+int pushToQueueV2(SharedRingQueueV2 *queue, const char *input_buffer, const uint16_t input_buffer_size);
+void resetRingQueueV2(SharedRingQueueV2 *queue);
+void dumpRingQueueShmemV2(SharedRingQueueV2 *queue);
+
+int
+pushBuffersToQueueV2(
+    SharedRingQueueV2 *queue,
+    const char **input_buffers,
+    const uint16_t *input_buffers_sizes,
+    const uint8_t num_of_input_buffers
+);
+
+int
+pushBatchToQueueV2(
+    SharedRingQueueV2 *queue,
+    const char **input_buffers,
+    const uint16_t *input_buffers_sizes,
+    const uint16_t num_of_input_buffers
+);
+
+int
+peekBatchFromQueueV2(
+    SharedRingQueueV2 *queue,
+    const char **output_buffers,
+    uint16_t *output_buffers_sizes,
+    const uint16_t max_num_of_output_buffers
+);
+
+int popBatchFromQueueV2(SharedRingQueueV2 *queue, const uint16_t num_of_elements_to_pop);
+
+// Doorbell of the queue's consumer. The consumer arms the doorbell before it goes idle, and the producer rings it
+// after publishing new elements. Only the first ring after the doorbell was armed reports that the consumer has to be
+// woken up, so a single wakeup covers all the elements that were pushed until the consumer drains the queue.
+// A new queue starts with an armed doorbell. armDoorbellV2 returns 1 if the queue already holds elements, in which
+// case the consumer must not go idle.
+int armDoorbellV2(SharedRingQueueV2 *queue);
+void disarmDoorbellV2(SharedRingQueueV2 *queue);
+int ringDoorbellV2(SharedRingQueueV2 *queue);
+
+// Blocks (using a futex in the shared memory) until the queue holds elements or the timeout expires, and marks the
+// consumer as one that waits on the doorbell rather than on an external signal. Returns 1 if the queue holds elements.
+int waitForDoorbellV2(SharedRingQueueV2 *queue, uint32_t timeout_msec);
+int isConsumerWaitingOnDoorbellV2(SharedRingQueueV2 *queue);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // __SHARED_RING_QUEUE_V2_H__
@@ -24,18 +24,23 @@
 #include <stdarg.h>
 
 #include "shared_ring_queue.h"
+#include "shared_ring_queue_v2.h"
 #include "shared_ipc_debug.h"
 
 #define UNUSED(x) (void)(x)
 
 const int corrupted_shmem_error = CORRUPTED_SHMEM_ERROR;
+const int data_too_large_error = SHARED_RING_QUEUE_V2_TOO_LARGE_ERROR;
 static const size_t max_one_way_queue_name_length = MAX_ONE_WAY_QUEUE_NAME_LENGTH;
 static const size_t max_shmem_path_length = 72;
 
 struct SharedMemoryIPC {
     char shm_name[32];
+    uint16_t version;
     SharedRingQueue *rx_queue;
     SharedRingQueue *tx_queue;
+    SharedRingQueueV2 *rx_queue_v2;
+    SharedRingQueueV2 *tx_queue_v2;
 };
 
 void
@@ -61,6 +66,31 @@ isTowardsOwner(int is_owner, int is_tx)
     return is_tx;
 }
 
+static void
+getOneWayQueueName(char *queue_name, size_t queue_name_size, const char *name, int is_tx_queue, int is_owner)
+{
+    const char *direction = isTowardsOwner(is_owner, is_tx_queue) ? "rx" : "tx";
+    snprintf(queue_name, queue_name_size - 1, "__cp_nano_%s_shared_memory_%s__", direction, name);
+}
+
+static int
+setOneWayQueuePermissions(const char *queue_name, const char *name, int is_tx_queue, int is_owner)
+{
+    char shmem_path[max_shmem_path_length];
+    const char *direction = isTowardsOwner(is_owner, is_tx_queue) ? "rx" : "tx";
+    int ret = snprintf(shmem_path, sizeof(shmem_path) - 1, "/dev/shm/%s", queue_name);
+    if (ret < 0 || (size_t)ret < (strlen(direction) + strlen(name))) {
+        return -1;
+    }
+
+    if (is_owner && chmod(shmem_path, 0666) == -1) {
+        writeDebug(WarningLevel, "Failed to set the permissions");
+        return -2;
+    }
+
+    return 0;
+}
+
 static SharedRingQueue *
 createOneWayIPCQueue(
     const char *name,
@@ -73,9 +103,9 @@ createOneWayIPCQueue(
 {
     SharedRingQueue *ring_queue = NULL;
     char queue_name[max_one_way_queue_name_length];
-    char shmem_path[max_shmem_path_length];
     const char *direction = isTowardsOwner(is_owner, is_tx_queue) ? "rx" : "tx";
-    snprintf(queue_name, sizeof(queue_name) - 1, "__cp_nano_%s_shared_memory_%s__", direction, name);
+    int res;
+    getOneWayQueueName(queue_name, sizeof(queue_name), name, is_tx_queue, is_owner);
 
     writeDebug(
         TraceLevel,
@@ -95,13 +125,10 @@ createOneWayIPCQueue(
         );
         return NULL;
     }
-    int ret = snprintf(shmem_path, sizeof(shmem_path) - 1, "/dev/shm/%s", queue_name);
-    if (ret < 0 || (size_t)ret < (strlen(direction) + strlen(name))) {
-        return NULL;
-    }
 
-    if (is_owner && chmod(shmem_path, 0666) == -1) {
-        writeDebug(WarningLevel, "Failed to set the permissions");
+    res = setOneWayQueuePermissions(queue_name, name, is_tx_queue, is_owner);
+    if (res == -1) return NULL;
+    if (res != 0) {
         destroySharedRingQueue(ring_queue, is_owner, isTowardsOwner(is_owner, is_tx_queue));
         return NULL;
     }
@@ -109,25 +136,85 @@ createOneWayIPCQueue(
     writeDebug(
         TraceLevel,
         "Successfully created one way IPC queue. "
-        "Name: %s, user id: %u, group id: %u, is owner: %d, number of queue elements: %u, direction: %s, path: %s",
+        "Name: %s, user id: %u, group id: %u, is owner: %d, number of queue elements: %u, direction: %s",
         queue_name,
         user_id,
         group_id,
         is_owner,
         num_of_queue_elem,
-        direction,
-        shmem_path
+        direction
     );
     return ring_queue;
 }
 
+static SharedRingQueueV2 *
+createOneWayIPCQueueV2(const char *name, int is_tx_queue, int is_owner, uint32_t num_of_queue_elem)
+{
+    SharedRingQueueV2 *ring_queue = NULL;
+    char queue_name[max_one_way_queue_name_length];
+    uint64_t capacity = (uint64_t)num_of_queue_elem * SHARED_MEMORY_SEGMENT_ENTRY_SIZE;
+    getOneWayQueueName(queue_name, sizeof(queue_name), name, is_tx_queue, is_owner);
+
+    if (capacity > SHARED_RING_QUEUE_V2_MAX_CAPACITY) {
+        writeDebug(
+            WarningLevel,
+            "Requested %u queue elements exceed the maximal capacity (%u bytes) of '%s'\n",
+            num_of_queue_elem,
+            SHARED_RING_QUEUE_V2_MAX_CAPACITY,
+            queue_name
+        );
+        return NULL;
+    }
+
+    writeDebug(
+        TraceLevel,
+        "Creating one way IPC queue (version 2). Name: %s, capacity: %u",
+        queue_name,
+        (uint32_t)capacity
+    );
+    ring_queue = createSharedRingQueueV2(queue_name, capacity, is_owner);
+    if (ring_queue == NULL) {
+        writeDebug(
+            WarningLevel,
+            "Failed to create shared ring queue of capacity=%u for '%s'\n",
+            (uint32_t)capacity,
+            queue_name
+        );
+        return NULL;
+    }
+
+    if (setOneWayQueuePermissions(queue_name, name, is_tx_queue, is_owner) != 0) {
+        destroySharedRingQueueV2(ring_queue, is_owner);
+        return NULL;
+    }
+
+    return ring_queue;
+}
+
+// A user uses the version of the queues that were created by the owner
+static uint16_t
+getIpcQueuesVersion(const char *name, int is_owner, uint16_t requested_version)
+{
+    char queue_name[max_one_way_queue_name_length];
+    int version;
+
+    if (is_owner) return requested_version;
+
+    getOneWayQueueName(queue_name, sizeof(queue_name), name, 0, is_owner);
+    version = getSharedRingQueueVersion(queue_name);
+    if (version < 0) return SHMEM_IPC_V1;
+
+    return version;
+}
+
 SharedMemoryIPC *
-initIpc(
+initIpcWithVersion(
     const char queue_name[32],
     uint32_t user_id,
     uint32_t group_id,
     int is_owner,
-    uint16_t num_of_queue_elem,
+    uint32_t num_of_queue_elem,
+    uint16_t version,
     void (*debug_func)(int is_error, const char *func, const char *file, int line_num, const char *fmt, ...))
 {
     SharedMemoryIPC *ipc = NULL;
@@ -136,14 +223,21 @@ initIpc(
     writeDebug(
         TraceLevel,
         "Initializing new IPC. "
-        "Queue name: %s, user id: %u, group id: %u, is owner: %d, number of queue elements: %u\n",
+        "Queue name: %s, user id: %u, group id: %u, is owner: %d, number of queue elements: %u, version: %u\n",
         queue_name,
         user_id,
         group_id,
         is_owner,
-        num_of_queue_elem
+        num_of_queue_elem,
+        version
     );
 
+    if (version != SHMEM_IPC_V1 && version != SHMEM_IPC_V2) {
+        writeDebug(WarningLevel, "Unsupported IPC version %u for '%s'\n", version, queue_name);
+        debug_int = debugInitial;
+        return NULL;
+    }
+
     ipc = malloc(sizeof(SharedMemoryIPC));
     if (ipc == NULL) {
         writeDebug(WarningLevel, "Failed to allocate Shared Memory IPC for '%s'\n", queue_name);
@@ -153,6 +247,52 @@ initIpc(
 
     ipc->rx_queue = NULL;
     ipc->tx_queue = NULL;
+    ipc->rx_queue_v2 = NULL;
+    ipc->tx_queue_v2 = NULL;
+    ipc->version = getIpcQueuesVersion(queue_name, is_owner, version);
+    if (ipc->version > version) {
+        writeDebug(
+            WarningLevel,
+            "IPC queues of '%s' were created in version %u, which is newer than the supported version %u\n",
+            queue_name,
+            ipc->version,
+            version
+        );
+        destroyIpc(ipc, is_owner);
+        return NULL;
+    }
+
+    if (ipc->version == SHMEM_IPC_V2) {
+        ipc->rx_queue_v2 = createOneWayIPCQueueV2(queue_name, 0, is_owner, num_of_queue_elem);
+        if (ipc->rx_queue_v2 != NULL) {
+            ipc->tx_queue_v2 = createOneWayIPCQueueV2(queue_name, 1, is_owner, num_of_queue_elem);
+        }
+        if (ipc->rx_queue_v2 == NULL || ipc->tx_queue_v2 == NULL) {
+            writeDebug(
+                WarningLevel,
+                "Failed to allocate version 2 queues. "
+                "Queue name: %s, user id: %u, group id: %u, is owner: %d, number of queue elements: %u",
+                queue_name,
+                user_id,
+                group_id,
+                is_owner,
+                num_of_queue_elem
+            );
+            destroyIpc(ipc, is_owner);
+            return NULL;
+        }
+
+        writeDebug(TraceLevel, "Successfully allocated IPC (version 2)");
+
+        strncpy(ipc->shm_name, queue_name, sizeof(ipc->shm_name));
+        return ipc;
+    }
+
+    if (num_of_queue_elem > UINT16_MAX) {
+        writeDebug(WarningLevel, "Cannot create IPC queues with %u elements\n", num_of_queue_elem);
+        destroyIpc(ipc, is_owner);
+        return NULL;
+    }
 
     ipc->rx_queue = createOneWayIPCQueue(queue_name, user_id, group_id, 0, is_owner, num_of_queue_elem);
     if (ipc->rx_queue == NULL) {
@@ -168,7 +308,6 @@ initIpc(
         );
 
         destroyIpc(ipc, is_owner);
-        debug_int = debugInitial;
         return NULL;
     }
 
@@ -185,7 +324,6 @@ initIpc(
             num_of_queue_elem
         );
         destroyIpc(ipc, is_owner);
-        debug_int = debugInitial;
         return NULL;
     }
 
@@ -195,10 +333,41 @@ initIpc(
     return ipc;
 }
 
+SharedMemoryIPC *
+initIpc(
+    const char queue_name[32],
+    uint32_t user_id,
+    uint32_t group_id,
+    int is_owner,
+    uint16_t num_of_queue_elem,
+    void (*debug_func)(int is_error, const char *func, const char *file, int line_num, const char *fmt, ...))
+{
+    uint16_t version = is_owner ? SHMEM_IPC_V1 : SHMEM_IPC_V2;
+    return initIpcWithVersion(queue_name, user_id, group_id, is_owner, num_of_queue_elem, version, debug_func);
+}
+
+int
+getIpcVersion(SharedMemoryIPC *ipc)
+{
+    return ipc->version;
+}
+
+int
+isIpcUserAttached(SharedMemoryIPC *ipc)
+{
+    if (ipc->version != SHMEM_IPC_V2) return 1;
+    return isUserAttachedV2(ipc->rx_queue_v2) && isUserAttachedV2(ipc->tx_queue_v2);
+}
+
 void
 resetIpc(SharedMemoryIPC *ipc, uint16_t num_of_data_segments)
 {
     writeDebug(TraceLevel, "Reseting IPC queues\n");
+    if (ipc->version == SHMEM_IPC_V2) {
+        resetRingQueueV2(ipc->rx_queue_v2);
+        resetRingQueueV2(ipc->tx_queue_v2);
+        return;
+    }
     resetRingQueue(ipc->rx_queue, num_of_data_segments);
     resetRingQueue(ipc->tx_queue, num_of_data_segments);
 }
@@ -216,6 +385,14 @@ destroyIpc(SharedMemoryIPC *shmem, int is_owner)
         destroySharedRingQueue(shmem->tx_queue, is_owner, isTowardsOwner(is_owner, 1));
         shmem->tx_queue = NULL;
     }
+    if (shmem->rx_queue_v2 != NULL) {
+        destroySharedRingQueueV2(shmem->rx_queue_v2, is_owner);
+        shmem->rx_queue_v2 = NULL;
+    }
+    if (shmem->tx_queue_v2 != NULL) {
+        destroySharedRingQueueV2(shmem->tx_queue_v2, is_owner);
+        shmem->tx_queue_v2 = NULL;
+    }
     debug_int = debugInitial;
     free(shmem);
 }
@@ -224,6 +401,13 @@ void
 dumpIpcMemory(SharedMemoryIPC *ipc)
 {
     writeDebug(WarningLevel, "Ipc memory dump:\n");
+    if (ipc->version == SHMEM_IPC_V2) {
+        writeDebug(WarningLevel, "RX queue:\n");
+        dumpRingQueueShmemV2(ipc->rx_queue_v2);
+        writeDebug(WarningLevel, "TX queue:\n");
+        dumpRingQueueShmemV2(ipc->tx_queue_v2);
+        return;
+    }
     writeDebug(WarningLevel, "RX queue:\n");
     dumpRingQueueShmem(ipc->rx_queue);
     writeDebug(WarningLevel, "TX queue:\n");
@@ -234,6 +418,7 @@ int
 sendData(SharedMemoryIPC *ipc, const uint16_t data_to_send_size, const char *data_to_send)
 {
     writeDebug(TraceLevel, "Sending data of size %u\n", data_to_send_size);
+    if (ipc->version == SHMEM_IPC_V2) return pushToQueueV2(ipc->tx_queue_v2, data_to_send, data_to_send_size);
     return pushToQueue(ipc->tx_queue, data_to_send, data_to_send_size);
 }
 
@@ -247,13 +432,61 @@ sendChunkedData(
 {
     writeDebug(TraceLevel, "Sending %u chunks of data\n", num_of_data_elem);
 
+    if (ipc->version == SHMEM_IPC_V2) {
+        return pushBuffersToQueueV2(ipc->tx_queue_v2, data_elem_to_send, data_to_send_sizes, num_of_data_elem);
+    }
+
     return pushBuffersToQueue(ipc->tx_queue, data_elem_to_send, data_to_send_sizes, num_of_data_elem);
 }
 
+int
+sendDataBatch(
+    SharedMemoryIPC *ipc,
+    const uint16_t *data_to_send_sizes,
+    const char **data_elem_to_send,
+    const uint16_t num_of_data_elem
+)
+{
+    writeDebug(TraceLevel, "Sending a batch of %u elements\n", num_of_data_elem);
+
+    if (ipc->version == SHMEM_IPC_V2) {
+        return pushBatchToQueueV2(ipc->tx_queue_v2, data_elem_to_send, data_to_send_sizes, num_of_data_elem);
+    }
+
+    return pushBatchToQueue(ipc->tx_queue, data_elem_to_send, data_to_send_sizes, num_of_data_elem);
+}
+
+int
+receiveDataBatch(
+    SharedMemoryIPC *ipc,
+    uint16_t *received_data_sizes,
+    const char **received_data,
+    const uint16_t max_num_of_data_elem
+)
+{
+    int res = ipc->version == SHMEM_IPC_V2 ?
+        peekBatchFromQueueV2(ipc->rx_queue_v2, received_data, received_data_sizes, max_num_of_data_elem) :
+        peekBatchFromQueue(ipc->rx_queue, received_data, received_data_sizes, max_num_of_data_elem);
+    writeDebug(TraceLevel, "Received a batch from queue. Res: %d\n", res);
+    return res;
+}
+
+int
+popDataBatch(SharedMemoryIPC *ipc, const uint16_t num_of_data_elem)
+{
+    int res = ipc->version == SHMEM_IPC_V2 ?
+        popBatchFromQueueV2(ipc->rx_queue_v2, num_of_data_elem) :
+        popBatchFromQueue(ipc->rx_queue, num_of_data_elem);
+    writeDebug(TraceLevel, "Popped a batch from queue. Res: %d\n", res);
+    return res;
+}
+
 int
 receiveData(SharedMemoryIPC *ipc, uint16_t *received_data_size, const char **received_data)
 {
-    int res = peekToQueue(ipc->rx_queue, received_data, received_data_size);
+    int res = ipc->version == SHMEM_IPC_V2 ?
+        peekToQueueV2(ipc->rx_queue_v2, received_data, received_data_size) :
+        peekToQueue(ipc->rx_queue, received_data, received_data_size);
     writeDebug(TraceLevel, "Received data from queue. Res: %d, data size: %u\n", res, *received_data_size);
     return res;
 }
@@ -261,7 +494,7 @@ receiveData(SharedMemoryIPC *ipc, uint16_t *received_data_size, const char **rec
 int
 popData(SharedMemoryIPC *ipc)
 {
-    int res = popFromQueue(ipc->rx_queue);
+    int res = ipc->version == SHMEM_IPC_V2 ? popFromQueueV2(ipc->rx_queue_v2) : popFromQueue(ipc->rx_queue);
     writeDebug(TraceLevel, "Popped data from queue. Res: %d\n", res);
     return res;
 }
@@ -269,14 +502,28 @@ popData(SharedMemoryIPC *ipc)
 int
 isDataAvailable(SharedMemoryIPC *ipc)
 {
-    int res = !isQueueEmpty(ipc->rx_queue);
+    int res = ipc->version == SHMEM_IPC_V2 ? !isQueueEmptyV2(ipc->rx_queue_v2) : !isQueueEmpty(ipc->rx_queue);
     writeDebug(TraceLevel, "Checking if there is data pending to be read. Res: %d\n", res);
     return res;
 }
 
+int
+getRxQueueUsage(SharedMemoryIPC *ipc)
+{
+    return ipc->version == SHMEM_IPC_V2 ? getQueueUsageV2(ipc->rx_queue_v2) : getQueueUsage(ipc->rx_queue);
+}
+
 int
 isCorruptedShmem(SharedMemoryIPC *ipc, int is_owner)
 {
+    if (ipc->version == SHMEM_IPC_V2) {
+        if (isCorruptedQueueV2(ipc->rx_queue_v2) || isCorruptedQueueV2(ipc->tx_queue_v2)) {
+            writeDebug(WarningLevel, "Detected corrupted shared memory queue. Shared memory name: %s", ipc->shm_name);
+            return 1;
+        }
+        return 0;
+    }
+
     if (isCorruptedQueue(ipc->rx_queue, isTowardsOwner(is_owner, 0)) ||
         isCorruptedQueue(ipc->tx_queue, isTowardsOwner(is_owner, 1))
     ) {
@@ -286,3 +533,41 @@ isCorruptedShmem(SharedMemoryIPC *ipc, int is_owner)
 
     return 0;
 }
+
+int
+armDoorbell(SharedMemoryIPC *ipc)
+{
+    if (ipc->version != SHMEM_IPC_V2) return isDataAvailable(ipc);
+    return armDoorbellV2(ipc->rx_queue_v2);
+}
+
+void
+disarmDoorbell(SharedMemoryIPC *ipc)
+{
+    if (ipc->version != SHMEM_IPC_V2) return;
+    disarmDoorbellV2(ipc->rx_queue_v2);
+}
+
+int
+ringDoorbell(SharedMemoryIPC *ipc)
+{
+    if (ipc->version != SHMEM_IPC_V2) return 1;
+    return ringDoorbellV2(ipc->tx_queue_v2);
+}
+
+int
+waitForDoorbell(SharedMemoryIPC *ipc, uint32_t timeout_msec)
+{
+    if (ipc->version != SHMEM_IPC_V2) {
+        writeDebug(WarningLevel, "Cannot wait for a doorbell of version %u IPC", ipc->version);
+        return -1;
+    }
+    return waitForDoorbellV2(ipc->rx_queue_v2, timeout_msec);
+}
+
+int
+isPeerWaitingOnDoorbell(SharedMemoryIPC *ipc)
+{
+    if (ipc->version != SHMEM_IPC_V2) return 0;
+    return isConsumerWaitingOnDoorbellV2(ipc->tx_queue_v2);
+}
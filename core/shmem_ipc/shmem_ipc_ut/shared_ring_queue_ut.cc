@@ -1,7 +1,13 @@
 #include "../shared_ring_queue.h"
 
+#include <chrono>
+
 #include "cptest.h"
 
+extern "C" {
+#include "../shared_ipc_debug.h"
+}
+
 using namespace std;
 using namespace testing;
 
@@ -316,6 +322,197 @@ TEST_F(SharedRingQueueTest, attempt_to_read_and_pop_from_empty_queue)
     EXPECT_EQ(popFromQueue(owners_queue), -1);
 }
 
+TEST_F(SharedRingQueueTest, batch_write_read_pop_transactions)
+{
+    ASSERT_NE(owners_queue, nullptr);
+    ASSERT_NE(users_queue, nullptr);
+
+    vector<string> data_to_write = {
+        "batch data0",
+        string(SHARED_MEMORY_SEGMENT_ENTRY_SIZE + 1, '1'),
+        "batch data2",
+        string(SHARED_MEMORY_SEGMENT_ENTRY_SIZE * 2, '3'),
+        "batch data4"
+    };
+    vector<const char *> buffers;
+    vector<uint16_t> sizes;
+    for (const string &data : data_to_write) {
+        buffers.push_back(data.data());
+        sizes.push_back(data.size());
+    }
+
+    EXPECT_EQ(pushBatchToQueue(users_queue, buffers.data(), sizes.data(), buffers.size()), 5);
+
+    vector<const char *> read_buffers(10, nullptr);
+    vector<uint16_t> read_sizes(10, 0);
+    EXPECT_EQ(peekBatchFromQueue(owners_queue, read_buffers.data(), read_sizes.data(), 3), 3);
+    EXPECT_EQ(peekBatchFromQueue(owners_queue, read_buffers.data(), read_sizes.data(), 10), 5);
+    for (uint i = 0; i < data_to_write.size(); i++) {
+        EXPECT_EQ(string(read_buffers[i], read_sizes[i]), data_to_write[i]);
+    }
+
+    EXPECT_EQ(popBatchFromQueue(owners_queue, 2), 2);
+    EXPECT_EQ(peekBatchFromQueue(owners_queue, read_buffers.data(), read_sizes.data(), 10), 3);
+    EXPECT_EQ(string(read_buffers[0], read_sizes[0]), data_to_write[2]);
+    EXPECT_EQ(popBatchFromQueue(owners_queue, 10), 3);
+    EXPECT_TRUE(isQueueEmpty(owners_queue));
+    EXPECT_EQ(peekBatchFromQueue(owners_queue, read_buffers.data(), read_sizes.data(), 10), 0);
+    EXPECT_EQ(popBatchFromQueue(owners_queue, 1), -1);
+}
+
+TEST_F(SharedRingQueueTest, batch_write_to_almost_full_queue)
+{
+    ASSERT_NE(owners_queue, nullptr);
+    ASSERT_NE(users_queue, nullptr);
+
+    string data(SHARED_MEMORY_SEGMENT_ENTRY_SIZE * 3, 'a');
+    vector<const char *> buffers(5, data.data());
+    vector<uint16_t> sizes(5, data.size());
+
+    EXPECT_EQ(pushBatchToQueue(users_queue, buffers.data(), sizes.data(), buffers.size()), 3);
+    EXPECT_EQ(pushBatchToQueue(users_queue, buffers.data(), sizes.data(), buffers.size()), -3);
+
+    EXPECT_EQ(popBatchFromQueue(owners_queue, 2), 2);
+
+    // The next element does not fit at the end of the queue, so it wraps around
+    EXPECT_EQ(pushBatchToQueue(users_queue, buffers.data(), sizes.data(), buffers.size()), 1);
+
+    vector<const char *> read_buffers(5, nullptr);
+    vector<uint16_t> read_sizes(5, 0);
+    EXPECT_EQ(peekBatchFromQueue(owners_queue, read_buffers.data(), read_sizes.data(), 5), 2);
+    for (uint i = 0; i < 2; i++) {
+        EXPECT_EQ(string(read_buffers[i], read_sizes[i]), data);
+    }
+    EXPECT_EQ(popBatchFromQueue(owners_queue, 5), 2);
+    EXPECT_TRUE(isQueueEmpty(owners_queue));
+}
+
+TEST_F(SharedRingQueueTest, mixed_batch_and_single_operations)
+{
+    ASSERT_NE(owners_queue, nullptr);
+    ASSERT_NE(users_queue, nullptr);
+
+    const char *read_data = nullptr;
+    uint16_t read_bytes = 0;
+    vector<string> data_to_write;
+    for (uint i = 0; i < 100; i++) data_to_write.push_back("mixed data " + to_string(i));
+
+    uint next_to_write = 0;
+    uint next_to_read = 0;
+    while (next_to_read < data_to_write.size()) {
+        if (next_to_write < data_to_write.size()) {
+            const char *buffers[3];
+            uint16_t sizes[3];
+            uint16_t num_to_write = min<uint>(3, data_to_write.size() - next_to_write);
+            for (uint i = 0; i < num_to_write; i++) {
+                buffers[i] = data_to_write[next_to_write + i].data();
+                sizes[i] = data_to_write[next_to_write + i].size();
+            }
+            int res = pushBatchToQueue(users_queue, buffers, sizes, num_to_write);
+            if (res > 0) next_to_write += res;
+        }
+
+        EXPECT_EQ(peekToQueue(owners_queue, &read_data, &read_bytes), 0);
+        EXPECT_EQ(string(read_data, read_bytes), data_to_write[next_to_read]);
+        EXPECT_EQ(popFromQueue(owners_queue), 0);
+        next_to_read++;
+    }
+    EXPECT_TRUE(isQueueEmpty(owners_queue));
+}
+
+static void
+silentDebug(int, const char *, const char *, int, const char *, ...)
+{
+}
+
+TEST_F(SharedRingQueueTest, queue_usage)
+{
+    ASSERT_NE(owners_queue, nullptr);
+    ASSERT_NE(users_queue, nullptr);
+
+    string data = "queue usage data";
+    EXPECT_EQ(getQueueUsage(owners_queue), 0);
+    for (uint i = 0; i < 3; i++) EXPECT_EQ(pushToQueue(users_queue, data.data(), data.size()), 0);
+    EXPECT_EQ(getQueueUsage(owners_queue), 3 * 100 / num_of_shmem_elem);
+    EXPECT_EQ(popFromQueue(owners_queue), 0);
+    EXPECT_EQ(getQueueUsage(users_queue), 2 * 100 / num_of_shmem_elem);
+
+    for (uint i = 0; i < 8; i++) {
+        EXPECT_EQ(pushToQueue(users_queue, data.data(), data.size()), 0);
+        EXPECT_EQ(popFromQueue(owners_queue), 0);
+    }
+    EXPECT_EQ(getQueueUsage(owners_queue), 2 * 100 / num_of_shmem_elem);
+    EXPECT_EQ(popBatchFromQueue(owners_queue, 2), 2);
+    EXPECT_EQ(getQueueUsage(owners_queue), 0);
+}
+
+// Micro benchmark comparing per-message and batched queue operations. The rates are recorded as test properties.
+// Run with: ./shared_ring_queue_ut --gtest_also_run_disabled_tests --gtest_filter=*batch_throughput*
+TEST_F(SharedRingQueueTest, DISABLED_batch_throughput)
+{
+    ASSERT_NE(owners_queue, nullptr);
+    ASSERT_NE(users_queue, nullptr);
+
+    static const uint num_of_messages = 200000;
+    static const uint16_t batch_size = 8;
+    string data(64, 'a');
+    const char *buffers[batch_size];
+    uint16_t sizes[batch_size];
+    for (uint i = 0; i < batch_size; i++) {
+        buffers[i] = data.data();
+        sizes[i] = data.size();
+    }
+    const char *read_buffers[batch_size];
+    uint16_t read_sizes[batch_size];
+    const char *read_data = nullptr;
+    uint16_t read_bytes = 0;
+
+    auto orig_debug_func = debug_int;
+    debug_int = silentDebug;
+
+    uint num_of_read_messages = 0;
+    auto run_single = [&] () {
+        for (uint i = 0; i < num_of_messages; i++) {
+            pushToQueue(users_queue, data.data(), data.size());
+            if (peekToQueue(owners_queue, &read_data, &read_bytes) == 0 && read_bytes == data.size()) {
+                num_of_read_messages++;
+            }
+            popFromQueue(owners_queue);
+        }
+    };
+    auto run_batch = [&] () {
+        for (uint i = 0; i < num_of_messages; i += batch_size) {
+            pushBatchToQueue(users_queue, buffers, sizes, batch_size);
+            int res = peekBatchFromQueue(owners_queue, read_buffers, read_sizes, batch_size);
+            for (int j = 0; j < res; j++) {
+                if (read_sizes[j] == data.size()) num_of_read_messages++;
+            }
+            popBatchFromQueue(owners_queue, res);
+        }
+    };
+    // The best of a few runs, so the comparison is not decided by a single preemption
+    auto measure = [&] (const function<void()> &run) {
+        auto best_duration = chrono::microseconds::max();
+        for (uint attempt = 0; attempt < 3; attempt++) {
+            num_of_read_messages = 0;
+            auto start = chrono::steady_clock::now();
+            run();
+            auto duration = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+            EXPECT_EQ(num_of_read_messages, num_of_messages);
+            best_duration = min(best_duration, duration);
+        }
+        return best_duration;
+    };
+
+    auto single_duration = measure(run_single);
+    auto batch_duration = measure(run_batch);
+    debug_int = orig_debug_func;
+
+    RecordProperty("single_msgs_per_sec", to_string(num_of_messages * 1000000 / single_duration.count()));
+    RecordProperty("batch_msgs_per_sec", to_string(num_of_messages * 1000000 / batch_duration.count()));
+    EXPECT_TRUE(isQueueEmpty(owners_queue));
+}
+
 TEST_F(SharedRingQueueTest, ilegal_queue)
 {
     ASSERT_NE(owners_queue, nullptr);
@@ -0,0 +1,276 @@
+#include "../shared_ring_queue_v2.h"
+
+#include <chrono>
+#include <thread>
+
+#include "cptest.h"
+
+using namespace std;
+using namespace testing;
+
+const static string valid_shmem_path = "shmem_v2_ut";
+const static uint32_t queue_capacity = SHARED_RING_QUEUE_V2_MIN_CAPACITY;
+
+class SharedRingQueueV2Test : public Test
+{
+public:
+    SharedRingQueueV2Test()
+    {
+        owners_queue = createSharedRingQueueV2(valid_shmem_path.c_str(), queue_capacity, 1);
+        users_queue = createSharedRingQueueV2(valid_shmem_path.c_str(), 0, 0);
+    }
+
+    ~SharedRingQueueV2Test()
+    {
+        if (users_queue != nullptr) destroySharedRingQueueV2(users_queue, 0);
+        if (owners_queue != nullptr) destroySharedRingQueueV2(owners_queue, 1);
+        owners_queue = nullptr;
+        users_queue = nullptr;
+    }
+
+    SharedRingQueueV2 *owners_queue = nullptr;
+    SharedRingQueueV2 *users_queue = nullptr;
+};
+
+TEST_F(SharedRingQueueV2Test, init_queues)
+{
+    ASSERT_NE(owners_queue, nullptr);
+    ASSERT_NE(users_queue, nullptr);
+
+    EXPECT_EQ(users_queue->capacity, queue_capacity);
+    EXPECT_EQ(getSharedRingQueueVersion(valid_shmem_path.c_str()), SHARED_RING_QUEUE_V2);
+    EXPECT_TRUE(isQueueEmptyV2(owners_queue));
+    EXPECT_FALSE(isCorruptedQueueV2(owners_queue));
+    EXPECT_FALSE(isCorruptedQueueV2(users_queue));
+
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(&owners_queue->shmem->write_pos) % SHARED_MEMORY_CACHE_LINE_SIZE, 0u);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(&owners_queue->shmem->read_pos) % SHARED_MEMORY_CACHE_LINE_SIZE, 0u);
+    EXPECT_NE(
+        reinterpret_cast<uintptr_t>(&owners_queue->shmem->write_pos) / SHARED_MEMORY_CACHE_LINE_SIZE,
+        reinterpret_cast<uintptr_t>(&owners_queue->shmem->read_pos) / SHARED_MEMORY_CACHE_LINE_SIZE
+    );
+}
+
+TEST_F(SharedRingQueueV2Test, capacity_is_rounded_to_power_of_two)
+{
+    SharedRingQueueV2 *queue = createSharedRingQueueV2("shmem_v2_round_ut", queue_capacity + 1, 1);
+    ASSERT_NE(queue, nullptr);
+    EXPECT_EQ(queue->capacity, queue_capacity * 2);
+    destroySharedRingQueueV2(queue, 1);
+}
+
+TEST_F(SharedRingQueueV2Test, write_read_pop_transactions)
+{
+    ASSERT_NE(owners_queue, nullptr);
+    ASSERT_NE(users_queue, nullptr);
+
+    const char *read_data = nullptr;
+    uint16_t read_bytes = 0;
+    for (uint i = 0; i < 1000; i++) {
+        string data = "data " + to_string(i) + string(i % 100, 'x');
+        EXPECT_EQ(pushToQueueV2(users_queue, data.data(), data.size()), 0);
+        EXPECT_FALSE(isQueueEmptyV2(owners_queue));
+        EXPECT_EQ(peekToQueueV2(owners_queue, &read_data, &read_bytes), 0);
+        EXPECT_EQ(string(read_data, read_bytes), data);
+        EXPECT_EQ(popFromQueueV2(owners_queue), 0);
+        EXPECT_TRUE(isQueueEmptyV2(owners_queue));
+    }
+
+    EXPECT_EQ(peekToQueueV2(owners_queue, &read_data, &read_bytes), -1);
+    EXPECT_EQ(popFromQueueV2(owners_queue), -1);
+}
+
+TEST_F(SharedRingQueueV2Test, write_to_full_queue_and_wrap_around)
+{
+    ASSERT_NE(owners_queue, nullptr);
+    ASSERT_NE(users_queue, nullptr);
+
+    string data(1000, 'a');
+    for (uint i = 0; i < 4; i++) {
+        data[0] = 'a' + i;
+        EXPECT_EQ(pushToQueueV2(users_queue, data.data(), data.size()), 0);
+    }
+    EXPECT_EQ(pushToQueueV2(users_queue, data.data(), data.size()), -3);
+
+    const char *read_data = nullptr;
+    uint16_t read_bytes = 0;
+    EXPECT_EQ(popFromQueueV2(owners_queue), 0);
+
+    // The element does not fit in the remaining space at the end of the ring, so it is written at the beginning
+    data[0] = 'e';
+    EXPECT_EQ(pushToQueueV2(users_queue, data.data(), data.size()), 0);
+    EXPECT_EQ(pushToQueueV2(users_queue, data.data(), data.size()), -3);
+
+    for (uint i = 1; i < 5; i++) {
+        EXPECT_EQ(peekToQueueV2(owners_queue, &read_data, &read_bytes), 0);
+        EXPECT_EQ(read_bytes, data.size());
+        EXPECT_EQ(read_data[0], 'a' + i);
+        EXPECT_EQ(popFromQueueV2(owners_queue), 0);
+    }
+    EXPECT_TRUE(isQueueEmptyV2(owners_queue));
+}
+
+TEST_F(SharedRingQueueV2Test, write_elements_larger_than_queue)
+{
+    ASSERT_NE(owners_queue, nullptr);
+    ASSERT_NE(users_queue, nullptr);
+
+    EXPECT_EQ(getMaxPushSizeV2(users_queue), queue_capacity / 2 - 8);
+
+    string data(queue_capacity, 'a');
+    EXPECT_EQ(pushToQueueV2(users_queue, data.data(), data.size()), SHARED_RING_QUEUE_V2_TOO_LARGE_ERROR);
+    EXPECT_EQ(
+        pushToQueueV2(users_queue, data.data(), getMaxPushSizeV2(users_queue) + 1),
+        SHARED_RING_QUEUE_V2_TOO_LARGE_ERROR
+    );
+
+    vector<const char *> buffers(20, data.data());
+    vector<uint16_t> sizes(20, data.size());
+    EXPECT_EQ(
+        pushBuffersToQueueV2(users_queue, buffers.data(), sizes.data(), buffers.size()),
+        SHARED_RING_QUEUE_V2_TOO_LARGE_ERROR
+    );
+    EXPECT_TRUE(isQueueEmptyV2(owners_queue));
+
+    // A full queue is reported as such, since the data fits once the queue is drained
+    EXPECT_EQ(pushToQueueV2(users_queue, data.data(), getMaxPushSizeV2(users_queue)), 0);
+    EXPECT_EQ(pushToQueueV2(users_queue, data.data(), getMaxPushSizeV2(users_queue)), 0);
+    EXPECT_EQ(pushToQueueV2(users_queue, data.data(), getMaxPushSizeV2(users_queue)), -3);
+}
+
+TEST_F(SharedRingQueueV2Test, batch_write_read_pop_transactions)
+{
+    ASSERT_NE(owners_queue, nullptr);
+    ASSERT_NE(users_queue, nullptr);
+
+    vector<string> data_to_write;
+    vector<const char *> buffers;
+    vector<uint16_t> sizes;
+    for (uint i = 0; i < 10; i++) data_to_write.push_back("batch data " + to_string(i));
+    for (const string &data : data_to_write) {
+        buffers.push_back(data.data());
+        sizes.push_back(data.size());
+    }
+
+    for (uint round = 0; round < 100; round++) {
+        EXPECT_EQ(pushBatchToQueueV2(users_queue, buffers.data(), sizes.data(), buffers.size()), 10);
+
+        vector<const char *> read_buffers(20, nullptr);
+        vector<uint16_t> read_sizes(20, 0);
+        EXPECT_EQ(peekBatchFromQueueV2(owners_queue, read_buffers.data(), read_sizes.data(), 20), 10);
+        for (uint i = 0; i < data_to_write.size(); i++) {
+            EXPECT_EQ(string(read_buffers[i], read_sizes[i]), data_to_write[i]);
+        }
+        EXPECT_EQ(popBatchFromQueueV2(owners_queue, 4), 4);
+        EXPECT_EQ(popBatchFromQueueV2(owners_queue, 20), 6);
+        EXPECT_TRUE(isQueueEmptyV2(owners_queue));
+    }
+    EXPECT_EQ(popBatchFromQueueV2(owners_queue, 1), -1);
+}
+
+TEST_F(SharedRingQueueV2Test, queue_usage)
+{
+    ASSERT_NE(owners_queue, nullptr);
+    ASSERT_NE(users_queue, nullptr);
+
+    string data(1000, 'a');
+    EXPECT_EQ(getQueueUsageV2(owners_queue), 0);
+    EXPECT_EQ(pushToQueueV2(users_queue, data.data(), data.size()), 0);
+    EXPECT_EQ(getQueueUsageV2(owners_queue), 1008 * 100 / queue_capacity);
+    for (uint i = 0; i < 3; i++) EXPECT_EQ(pushToQueueV2(users_queue, data.data(), data.size()), 0);
+    EXPECT_EQ(getQueueUsageV2(users_queue), 4 * 1008 * 100 / queue_capacity);
+    EXPECT_EQ(popBatchFromQueueV2(owners_queue, 4), 4);
+    EXPECT_EQ(getQueueUsageV2(owners_queue), 0);
+}
+
+TEST_F(SharedRingQueueV2Test, corrupted_queue)
+{
+    ASSERT_NE(owners_queue, nullptr);
+    ASSERT_NE(users_queue, nullptr);
+
+    const char *read_data = nullptr;
+    uint16_t read_bytes = 0;
+    string data = "data";
+    EXPECT_EQ(pushToQueueV2(users_queue, data.data(), data.size()), 0);
+
+    owners_queue->shmem->write_pos = queue_capacity * 2;
+    EXPECT_TRUE(isCorruptedQueueV2(owners_queue));
+    EXPECT_EQ(peekToQueueV2(owners_queue, &read_data, &read_bytes), CORRUPTED_SHMEM_ERROR);
+
+    owners_queue->shmem->write_pos = 8;
+    EXPECT_FALSE(isCorruptedQueueV2(owners_queue));
+    EXPECT_EQ(peekToQueueV2(owners_queue, &read_data, &read_bytes), CORRUPTED_SHMEM_ERROR);
+
+    resetRingQueueV2(owners_queue);
+    EXPECT_TRUE(isQueueEmptyV2(owners_queue));
+    EXPECT_FALSE(isCorruptedQueueV2(owners_queue));
+
+    owners_queue->shmem->capacity = queue_capacity * 2;
+    EXPECT_TRUE(isCorruptedQueueV2(users_queue));
+}
+
+TEST_F(SharedRingQueueV2Test, open_version_1_queue)
+{
+    EXPECT_EQ(getSharedRingQueueVersion("shmem_v2_ut_missing"), -1);
+    EXPECT_EQ(createSharedRingQueueV2("shmem_v2_ut_missing", queue_capacity, 0), nullptr);
+
+    SharedRingQueue *v1_queue = createSharedRingQueue("shmem_v1_ut", 11, 1, 1);
+    ASSERT_NE(v1_queue, nullptr);
+    EXPECT_EQ(getSharedRingQueueVersion("shmem_v1_ut"), SHARED_RING_QUEUE_V1);
+    EXPECT_EQ(createSharedRingQueueV2("shmem_v1_ut", queue_capacity, 0), nullptr);
+    destroySharedRingQueue(v1_queue, 1, 1);
+}
+
+TEST_F(SharedRingQueueV2Test, doorbell_coalesces_wakeups)
+{
+    ASSERT_NE(owners_queue, nullptr);
+    ASSERT_NE(users_queue, nullptr);
+
+    string data = "data";
+    EXPECT_EQ(ringDoorbellV2(users_queue), 1);
+    EXPECT_EQ(ringDoorbellV2(users_queue), 0);
+
+    EXPECT_EQ(armDoorbellV2(owners_queue), 0);
+    EXPECT_EQ(pushToQueueV2(users_queue, data.data(), data.size()), 0);
+    EXPECT_EQ(ringDoorbellV2(users_queue), 1);
+    EXPECT_EQ(pushToQueueV2(users_queue, data.data(), data.size()), 0);
+    EXPECT_EQ(ringDoorbellV2(users_queue), 0);
+
+    EXPECT_EQ(popBatchFromQueueV2(owners_queue, 2), 2);
+    EXPECT_EQ(pushToQueueV2(users_queue, data.data(), data.size()), 0);
+    EXPECT_EQ(armDoorbellV2(owners_queue), 1);
+    disarmDoorbellV2(owners_queue);
+    EXPECT_EQ(ringDoorbellV2(users_queue), 0);
+
+    EXPECT_EQ(popFromQueueV2(owners_queue), 0);
+    EXPECT_EQ(armDoorbellV2(owners_queue), 0);
+    EXPECT_EQ(ringDoorbellV2(users_queue), 1);
+    EXPECT_FALSE(isConsumerWaitingOnDoorbellV2(users_queue));
+}
+
+TEST_F(SharedRingQueueV2Test, wait_for_doorbell)
+{
+    ASSERT_NE(owners_queue, nullptr);
+    ASSERT_NE(users_queue, nullptr);
+
+    EXPECT_EQ(waitForDoorbellV2(owners_queue, 1), 0);
+    EXPECT_TRUE(isConsumerWaitingOnDoorbellV2(users_queue));
+
+    string data = "data";
+    thread producer(
+        [&] ()
+        {
+            this_thread::sleep_for(chrono::milliseconds(20));
+            EXPECT_EQ(pushToQueueV2(users_queue, data.data(), data.size()), 0);
+            EXPECT_EQ(ringDoorbellV2(users_queue), 1);
+        }
+    );
+
+    auto start = chrono::steady_clock::now();
+    EXPECT_EQ(waitForDoorbellV2(owners_queue, 10000), 1);
+    EXPECT_LT(chrono::steady_clock::now() - start, chrono::seconds(5));
+    producer.join();
+
+    EXPECT_EQ(waitForDoorbellV2(owners_queue, 10000), 1);
+    EXPECT_EQ(popFromQueueV2(owners_queue), 0);
+}
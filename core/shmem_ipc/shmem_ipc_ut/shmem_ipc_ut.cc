@@ -179,6 +179,32 @@ TEST_F(SharedIPCTest, multiple_write_read_pop_transactions)
     }
 }
 
+TEST_F(SharedIPCTest, batch_write_read_pop_transactions)
+{
+    ASSERT_NE(owners_queue, nullptr);
+    ASSERT_NE(users_queue, nullptr);
+
+    vector<string> messages = { "first message", "second message", "third message" };
+    vector<const char *> buffers;
+    vector<uint16_t> sizes;
+    for (const string &message : messages) {
+        buffers.push_back(message.data());
+        sizes.push_back(message.size());
+    }
+
+    EXPECT_EQ(sendDataBatch(users_queue, sizes.data(), buffers.data(), buffers.size()), 3);
+    EXPECT_TRUE(isDataAvailable(owners_queue));
+
+    vector<const char *> read_data(messages.size(), nullptr);
+    vector<uint16_t> read_bytes(messages.size(), 0);
+    EXPECT_EQ(receiveDataBatch(owners_queue, read_bytes.data(), read_data.data(), read_data.size()), 3);
+    for (uint i = 0; i < messages.size(); i++) {
+        EXPECT_EQ(string(read_data[i], read_bytes[i]), messages[i]);
+    }
+    EXPECT_EQ(popDataBatch(owners_queue, 3), 3);
+    EXPECT_FALSE(isDataAvailable(owners_queue));
+}
+
 TEST_F(SharedIPCTest, reset_shmem)
 {
     string data_to_write = "my basic_write_read_pop_transaction test data";
@@ -269,3 +295,163 @@ TEST_F(SharedIPCTest, ensure_right_permissions)
         EXPECT_NE(info.st_mode & S_IXUSR, static_cast<uint>(S_IXUSR));
     }
 }
+
+TEST_F(SharedIPCTest, version_2_negotiation)
+{
+    const string v2_shmem_name = "shmem_v2_ut";
+    EXPECT_EQ(getIpcVersion(owners_queue), SHMEM_IPC_V1);
+    EXPECT_EQ(getIpcVersion(users_queue), SHMEM_IPC_V1);
+
+    SharedMemoryIPC *v2_owner =
+        initIpcWithVersion(v2_shmem_name.c_str(), uid, gid, 1, num_of_shmem_elem, SHMEM_IPC_V2, debugFunc);
+    ASSERT_NE(v2_owner, nullptr);
+    EXPECT_EQ(getIpcVersion(v2_owner), SHMEM_IPC_V2);
+    EXPECT_TRUE(isIpcUserAttached(owners_queue));
+    EXPECT_FALSE(isIpcUserAttached(v2_owner));
+
+    EXPECT_EQ(
+        initIpcWithVersion(v2_shmem_name.c_str(), uid, gid, 0, num_of_shmem_elem, SHMEM_IPC_V1, debugFunc),
+        nullptr
+    );
+
+    SharedMemoryIPC *v2_user = initIpc(v2_shmem_name.c_str(), uid, gid, 0, num_of_shmem_elem, debugFunc);
+    ASSERT_NE(v2_user, nullptr);
+    EXPECT_EQ(getIpcVersion(v2_user), SHMEM_IPC_V2);
+    EXPECT_TRUE(isIpcUserAttached(v2_owner));
+    EXPECT_FALSE(isCorruptedShmem(v2_owner, 1));
+    EXPECT_FALSE(isCorruptedShmem(v2_user, 0));
+
+    const string message = "my version_2_negotiation test data";
+    const char *read_data = nullptr;
+    uint16_t read_bytes = 0;
+
+    EXPECT_EQ(sendData(v2_owner, message.size(), message.c_str()), 0);
+    EXPECT_TRUE(isDataAvailable(v2_user));
+    EXPECT_EQ(receiveData(v2_user, &read_bytes, &read_data), 0);
+    EXPECT_EQ(string(read_data, read_bytes), message);
+    EXPECT_EQ(popData(v2_user), 0);
+    EXPECT_FALSE(isDataAvailable(v2_user));
+
+    vector<const char *> chunks = { message.data(), message.data() };
+    vector<uint16_t> chunks_sizes = { static_cast<uint16_t>(message.size()), static_cast<uint16_t>(message.size()) };
+    EXPECT_EQ(sendChunkedData(v2_user, chunks_sizes.data(), chunks.data(), chunks.size()), 0);
+    EXPECT_TRUE(isDataAvailable(v2_owner));
+    EXPECT_EQ(receiveData(v2_owner, &read_bytes, &read_data), 0);
+    EXPECT_EQ(string(read_data, read_bytes), message + message);
+    EXPECT_EQ(popData(v2_owner), 0);
+    EXPECT_FALSE(isDataAvailable(v2_owner));
+
+    destroyIpc(v2_user, 0);
+    destroyIpc(v2_owner, 1);
+}
+
+TEST_F(SharedIPCTest, version_2_is_not_limited_by_number_of_segments)
+{
+    const string v2_shmem_name = "shmem_v2_ut";
+    SharedMemoryIPC *v2_owner =
+        initIpcWithVersion(v2_shmem_name.c_str(), uid, gid, 1, num_of_shmem_elem, SHMEM_IPC_V2, debugFunc);
+    SharedMemoryIPC *v2_user = initIpc(v2_shmem_name.c_str(), uid, gid, 0, num_of_shmem_elem, debugFunc);
+    ASSERT_NE(v2_owner, nullptr);
+    ASSERT_NE(v2_user, nullptr);
+
+    const string message = "small message";
+    uint num_of_messages = 0;
+    while (sendData(v2_user, message.size(), message.c_str()) == 0) num_of_messages++;
+    EXPECT_GT(num_of_messages, num_of_shmem_elem * 10u);
+
+    const char *read_data = nullptr;
+    uint16_t read_bytes = 0;
+    for (uint i = 0; i < num_of_messages; i++) {
+        EXPECT_EQ(receiveData(v2_owner, &read_bytes, &read_data), 0);
+        EXPECT_EQ(string(read_data, read_bytes), message);
+        EXPECT_EQ(popData(v2_owner), 0);
+    }
+    EXPECT_FALSE(isDataAvailable(v2_owner));
+
+    EXPECT_EQ(
+        initIpcWithVersion("shmem_v3_ut", uid, gid, 1, num_of_shmem_elem, SHMEM_IPC_V2 + 1, debugFunc),
+        nullptr
+    );
+
+    // A number of elements whose size in bytes does not fit in 32 bits is rejected, rather than wrapping around
+    EXPECT_EQ(
+        initIpcWithVersion("shmem_v2_huge_ut", uid, gid, 1, (1U << 22) + 1, SHMEM_IPC_V2, debugFunc),
+        nullptr
+    );
+
+    destroyIpc(v2_user, 0);
+    destroyIpc(v2_owner, 1);
+}
+
+TEST_F(SharedIPCTest, version_2_rejects_data_larger_than_half_the_queue)
+{
+    const string v2_shmem_name = "shmem_v2_ut";
+    SharedMemoryIPC *v2_owner =
+        initIpcWithVersion(v2_shmem_name.c_str(), uid, gid, 1, num_of_shmem_elem, SHMEM_IPC_V2, debugFunc);
+    SharedMemoryIPC *v2_user = initIpc(v2_shmem_name.c_str(), uid, gid, 0, num_of_shmem_elem, debugFunc);
+    ASSERT_NE(v2_owner, nullptr);
+    ASSERT_NE(v2_user, nullptr);
+
+    // 11 elements make a queue of 16KB, which takes records of up to 8KB
+    const string too_large_message(8192, 'a');
+    EXPECT_EQ(sendData(v2_user, too_large_message.size(), too_large_message.data()), data_too_large_error);
+    vector<const char *> chunks = { too_large_message.data(), too_large_message.data() };
+    vector<uint16_t> chunks_sizes = { 4096, 4096 };
+    EXPECT_EQ(sendChunkedData(v2_user, chunks_sizes.data(), chunks.data(), chunks.size()), data_too_large_error);
+    EXPECT_FALSE(isDataAvailable(v2_owner));
+
+    // Records of up to half the queue always fit once it is drained, wherever the ring wraps
+    const string largest_message(8192 - 8, 'b');
+    const char *read_data = nullptr;
+    uint16_t read_bytes = 0;
+    for (uint i = 0; i < 8; i++) {
+        uint16_t message_size = largest_message.size() - i * 1000;
+        EXPECT_EQ(sendData(v2_user, message_size, largest_message.data()), 0);
+        EXPECT_EQ(receiveData(v2_owner, &read_bytes, &read_data), 0);
+        EXPECT_EQ(read_bytes, message_size);
+        EXPECT_EQ(popData(v2_owner), 0);
+        EXPECT_EQ(sendData(v2_user, largest_message.size(), largest_message.data()), 0);
+        EXPECT_EQ(receiveData(v2_owner, &read_bytes, &read_data), 0);
+        EXPECT_EQ(string(read_data, read_bytes), largest_message);
+        EXPECT_EQ(popData(v2_owner), 0);
+    }
+
+    destroyIpc(v2_user, 0);
+    destroyIpc(v2_owner, 1);
+}
+
+TEST_F(SharedIPCTest, doorbell)
+{
+    EXPECT_EQ(ringDoorbell(owners_queue), 1);
+    EXPECT_EQ(waitForDoorbell(users_queue, 1), -1);
+    EXPECT_FALSE(isPeerWaitingOnDoorbell(owners_queue));
+
+    const string v2_shmem_name = "shmem_v2_ut";
+    SharedMemoryIPC *v2_owner =
+        initIpcWithVersion(v2_shmem_name.c_str(), uid, gid, 1, num_of_shmem_elem, SHMEM_IPC_V2, debugFunc);
+    SharedMemoryIPC *v2_user = initIpc(v2_shmem_name.c_str(), uid, gid, 0, num_of_shmem_elem, debugFunc);
+    ASSERT_NE(v2_owner, nullptr);
+    ASSERT_NE(v2_user, nullptr);
+
+    const string message = "my doorbell test data";
+    EXPECT_EQ(ringDoorbell(v2_user), 1);
+    EXPECT_EQ(armDoorbell(v2_owner), 0);
+    EXPECT_EQ(sendData(v2_user, message.size(), message.c_str()), 0);
+    EXPECT_EQ(ringDoorbell(v2_user), 1);
+    EXPECT_EQ(sendData(v2_user, message.size(), message.c_str()), 0);
+    EXPECT_EQ(ringDoorbell(v2_user), 0);
+    EXPECT_EQ(popData(v2_owner), 0);
+    EXPECT_EQ(popData(v2_owner), 0);
+
+    EXPECT_FALSE(isPeerWaitingOnDoorbell(v2_owner));
+    EXPECT_EQ(ringDoorbell(v2_owner), 1);
+    EXPECT_EQ(waitForDoorbell(v2_user, 1), 0);
+    EXPECT_TRUE(isPeerWaitingOnDoorbell(v2_owner));
+    EXPECT_EQ(sendData(v2_owner, message.size(), message.c_str()), 0);
+    EXPECT_EQ(ringDoorbell(v2_owner), 0);
+    EXPECT_EQ(waitForDoorbell(v2_user, 1), 1);
+    EXPECT_EQ(popData(v2_user), 0);
+
+    destroyIpc(v2_user, 0);
+    destroyIpc(v2_owner, 1);
+}